@@ -117,7 +117,13 @@ void main() {
 	int tile_row = int( ( u_ViewportSize.y - gl_FragCoord.y ) / tile_size );
 	int tile_col = int( gl_FragCoord.x / tile_size );
 	int cols = int( u_ViewportSize.x + tile_size - 1 ) / int( tile_size );
-	int tile_index = tile_row * cols + tile_col;
+	int rows = int( u_ViewportSize.y + tile_size - 1 ) / int( tile_size );
+
+	float view_depth = -( u_V * vec4( v_Position, 1.0 ) ).z;
+	float slice_scale = float( CLUSTER_DEPTH_SLICES ) / log( CLUSTER_FAR_PLANE / u_NearClip );
+	int slice = clamp( int( log( view_depth / u_NearClip ) * slice_scale ), 0, CLUSTER_DEPTH_SLICES - 1 );
+
+	int tile_index = ( slice * rows + tile_row ) * cols + tile_col;
 
 	ivec2 tile = texelFetch( u_DecalTiles, tile_index ).xy;
 
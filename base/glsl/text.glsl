@@ -3,23 +3,25 @@
 uniform sampler2D u_BaseTexture;
 
 layout( std140 ) uniform u_Text {
-	vec4 u_TextColor;
 	vec4 u_BorderColor;
 	vec2 u_AtlasSize;
 	float u_dSDFdTexel;
-	int u_HasBorder;
+	int u_BorderMode; // 0 = no border, 1 = u_BorderColor with the text alpha, 2 = u_BorderColor
 };
 
 v2f vec2 v_TexCoord;
+v2f vec4 v_Color;
 
 #if VERTEX_SHADER
 
 in vec4 a_Position;
 in vec2 a_TexCoord;
+in vec4 a_Color;
 
 void main() {
 	gl_Position = u_P * a_Position;
 	v_TexCoord = a_TexCoord;
+	v_Color = a_Color;
 }
 
 #else
@@ -38,16 +40,20 @@ vec4 SampleMSDF( vec2 uv, float half_pixel_size ) {
 	vec3 sample = texture( u_BaseTexture, uv ).rgb;
 	float d = 2.0 * Median( sample ) - 1.0; // rescale to [-1,1], positive being inside
 
-	if( u_HasBorder != 0 ) {
+	if( u_BorderMode != 0 ) {
+		vec4 border_color = u_BorderColor;
+		if( u_BorderMode == 1 )
+			border_color.a *= v_Color.a;
+
 		float border_amount = LinearStep( -half_pixel_size, half_pixel_size, d );
-		vec4 color = mix( u_BorderColor, u_TextColor, border_amount );
+		vec4 color = mix( border_color, v_Color, border_amount );
 
 		float alpha = LinearStep( -3.0 * half_pixel_size, -half_pixel_size, d );
 		return vec4( color.rgb, color.a * alpha );
 	}
 
 	float alpha = LinearStep( -half_pixel_size, half_pixel_size, d );
-	return vec4( u_TextColor.rgb, u_TextColor.a * alpha );
+	return vec4( v_Color.rgb, v_Color.a * alpha );
 }
 
 void main() {
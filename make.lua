@@ -157,6 +157,56 @@ do
 		gcc_extra_ldflags = "-lm -lpthread -ldl -no-pie -static-libstdc++",
 		msvc_extra_ldflags = "ws2_32.lib crypt32.lib",
 	} )
+
+	bin( "loadgen", {
+		srcs = {
+			"source/gameshared/*.cpp",
+			"source/loadgen/*.cpp",
+			"source/qcommon/*.cpp",
+			platform_srcs
+		},
+
+		libs = {
+			"monocypher",
+			"tracy",
+			"whereami",
+			"zstd",
+		},
+
+		prebuilt_libs = {
+			"curl",
+			"zlib",
+			platform_libs
+		},
+
+		gcc_extra_ldflags = "-lm -lpthread -ldl -no-pie -static-libstdc++",
+		msvc_extra_ldflags = "ws2_32.lib crypt32.lib",
+	} )
+
+	bin( "demotool", {
+		srcs = {
+			"source/gameshared/*.cpp",
+			"source/demotool/*.cpp",
+			"source/qcommon/*.cpp",
+			platform_srcs
+		},
+
+		libs = {
+			"monocypher",
+			"tracy",
+			"whereami",
+			"zstd",
+		},
+
+		prebuilt_libs = {
+			"curl",
+			"zlib",
+			platform_libs
+		},
+
+		gcc_extra_ldflags = "-lm -lpthread -ldl -no-pie -static-libstdc++",
+		msvc_extra_ldflags = "ws2_32.lib crypt32.lib",
+	} )
 end
 
 obj_cxxflags( "source/game/angelwrap/.+", "-I third-party/angelscript/sdk/angelscript/include" )
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "cgame/cg_local.h"
+#include "qcommon/array.h"
 #include "qcommon/cmodel.h"
 #include "client/renderer/renderer.h"
 
@@ -562,23 +563,53 @@ static void CG_AddGenericEnt( centity_t *cent ) {
 /*
 * CG_AddPlayerEnt
 */
+static bool CG_PlayerEntVisible( const centity_t *cent ) {
+	if( ISVIEWERENTITY( cent->current.number ) && !cg.view.thirdperson ) {
+		// CG_AllocPlayerShadow( cent->current.number, cent->ent.origin, playerbox_stand_mins, playerbox_stand_maxs );
+		return false;
+	}
+
+	// if set to invisible, skip
+	return cent->current.team != TEAM_SPECTATOR; // TODO remove?
+}
+
 static void CG_AddPlayerEnt( centity_t *cent ) {
 	if( ISVIEWERENTITY( cent->current.number ) ) {
 		cg.effects = cent->effects;
-		if( !cg.view.thirdperson ) {
-			// CG_AllocPlayerShadow( cent->current.number, cent->ent.origin, playerbox_stand_mins, playerbox_stand_maxs );
-			return;
-		}
 	}
 
-	// if set to invisible, skip
-	if( cent->current.team == TEAM_SPECTATOR ) { // TODO remove?
+	if( !CG_PlayerEntVisible( cent ) ) {
 		return;
 	}
 
 	CG_DrawPlayer( cent );
 }
 
+/*
+* CG_AnimateVisiblePlayers
+* Pose all the player models in one batch before anything gets drawn
+*/
+static void CG_AnimateVisiblePlayers() {
+	TempAllocator temp = cls.frame_arena.temp();
+	DynamicArray< centity_t * > players( &temp );
+
+	for( int pnum = 0; pnum < cg.frame.numEntities; pnum++ ) {
+		SyncEntityState * state = &cg.frame.parsedEntities[pnum & ( MAX_PARSE_ENTITIES - 1 )];
+		centity_t * cent = &cg_entities[state->number];
+
+		if( cent->type != ET_PLAYER && cent->type != ET_CORPSE )
+			continue;
+		if( cent->current.linearMovement && !cent->linearProjectileCanDraw )
+			continue;
+
+		if( CG_PlayerEntVisible( cent ) ) {
+			players.add( cent );
+		}
+	}
+
+	CG_AnimatePlayers( players.span() );
+}
+
 //==========================================================================
 // ET_LASER
 //==========================================================================
@@ -758,6 +789,8 @@ void CG_EntityLoopSound( centity_t * cent, SyncEntityState * state ) {
 void CG_AddEntities( void ) {
 	ZoneScoped;
 
+	CG_AnimateVisiblePlayers();
+
 	for( int pnum = 0; pnum < cg.frame.numEntities; pnum++ ) {
 		SyncEntityState * state = &cg.frame.parsedEntities[pnum & ( MAX_PARSE_ENTITIES - 1 )];
 		centity_t * cent = &cg_entities[state->number];
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "qcommon/base.h"
+#include "qcommon/array.h"
 #include "qcommon/string.h"
 #include "client/assets.h"
 #include "client/renderer/renderer.h"
@@ -56,6 +57,29 @@ static const Font * GetHUDFont() {
 
 //=============================================================================
 
+struct HUDArg;
+
+// formatted strings are kept between frames and only rebuilt when whatever
+// they were built from changes
+struct HUDTextCache {
+	bool valid;
+	int value;
+	u32 bindings_version;
+	char text[ 1024 ];
+};
+
+struct HUDArgs {
+	const HUDArg * args;
+	u32 num_args;
+	u32 cursor;
+	HUDTextCache * text_cache;
+};
+
+static const char * CG_GetStringArg( HUDArgs * args );
+static float CG_GetNumericArg( HUDArgs * args );
+
+//=============================================================================
+
 typedef struct
 {
 	const char *name;
@@ -1516,7 +1540,7 @@ static void CG_DrawAwards( int x, int y, Alignment alignment, float font_size, V
 	}
 }
 
-static bool CG_LFuncDrawCallvote( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawCallvote( HUDArgs * args ) {
 	const char * vote = cgs.configStrings[ CS_CALLVOTE ];
 	if( strlen( vote ) == 0 )
 		return true;
@@ -1544,14 +1568,20 @@ static bool CG_LFuncDrawCallvote( struct cg_layoutnode_s *argumentnode, int numA
 	DrawText( GetHUDFont(), layout_cursor_font_size, temp( "{}/{}", yeses, required ), Alignment_RightTop, right - padding, top + padding, color, true );
 
 	if( !voted ) {
-		char vote_yes_keys[ 128 ];
-		CG_GetBoundKeysString( "vote yes", vote_yes_keys, sizeof( vote_yes_keys ) );
-		char vote_no_keys[ 128 ];
-		CG_GetBoundKeysString( "vote no", vote_no_keys, sizeof( vote_no_keys ) );
+		HUDTextCache * cache = args->text_cache;
+		if( !cache->valid || cache->bindings_version != Key_BindingsVersion() ) {
+			char vote_yes_keys[ 128 ];
+			CG_GetBoundKeysString( "vote yes", vote_yes_keys, sizeof( vote_yes_keys ) );
+			char vote_no_keys[ 128 ];
+			CG_GetBoundKeysString( "vote no", vote_no_keys, sizeof( vote_no_keys ) );
+
+			snprintf( cache->text, sizeof( cache->text ), "[%s] Vote yes [%s] Vote no", vote_yes_keys, vote_no_keys );
+			cache->bindings_version = Key_BindingsVersion();
+			cache->valid = true;
+		}
 
-		const char * str = temp( "[{}] Vote yes [{}] Vote no", vote_yes_keys, vote_no_keys );
 		float y = top + padding + layout_cursor_font_size * 1.2f;
-		DrawText( GetHUDFont(), layout_cursor_font_size, str, left + padding, y, color, true );
+		DrawText( GetHUDFont(), layout_cursor_font_size, cache->text, left + padding, y, color, true );
 	}
 
 	return true;
@@ -1735,11 +1765,6 @@ static opFunc_t CG_OperatorFuncForArgument( const char *token ) {
 
 //=============================================================================
 
-static const char *CG_GetStringArg( struct cg_layoutnode_s **argumentsnode );
-static float CG_GetNumericArg( struct cg_layoutnode_s **argumentsnode );
-
-//=============================================================================
-
 enum {
 	LNODE_NUMERIC,
 	LNODE_STRING,
@@ -1863,10 +1888,10 @@ static void CG_DrawWeaponIcons( int x, int y, int offx, int offy, int iw, int ih
 	}
 }
 
-static bool CG_LFuncDrawPicByName( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawPicByName( HUDArgs * args ) {
 	int x = CG_HorizontalAlignForWidth( layout_cursor_x, layout_cursor_alignment, layout_cursor_width );
 	int y = CG_VerticalAlignForHeight( layout_cursor_y, layout_cursor_alignment, layout_cursor_height );
-	Draw2DBox( x, y, layout_cursor_width, layout_cursor_height, FindMaterial( CG_GetStringArg( &argumentnode ) ), layout_cursor_color );
+	Draw2DBox( x, y, layout_cursor_width, layout_cursor_height, FindMaterial( CG_GetStringArg( args ) ), layout_cursor_color );
 	return true;
 }
 
@@ -1878,58 +1903,58 @@ static float ScaleY( float y ) {
 	return y * frame_static.viewport_height / 600.0f;
 }
 
-static bool CG_LFuncCursor( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	float x = ScaleX( CG_GetNumericArg( &argumentnode ) );
-	float y = ScaleY( CG_GetNumericArg( &argumentnode ) );
+static bool CG_LFuncCursor( HUDArgs * args ) {
+	float x = ScaleX( CG_GetNumericArg( args ) );
+	float y = ScaleY( CG_GetNumericArg( args ) );
 
 	layout_cursor_x = Q_rint( x );
 	layout_cursor_y = Q_rint( y );
 	return true;
 }
 
-static bool CG_LFuncMoveCursor( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	float x = ScaleX( CG_GetNumericArg( &argumentnode ) );
-	float y = ScaleY( CG_GetNumericArg( &argumentnode ) );
+static bool CG_LFuncMoveCursor( HUDArgs * args ) {
+	float x = ScaleX( CG_GetNumericArg( args ) );
+	float y = ScaleY( CG_GetNumericArg( args ) );
 
 	layout_cursor_x += Q_rint( x );
 	layout_cursor_y += Q_rint( y );
 	return true;
 }
 
-static bool CG_LFuncSize( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	float x = ScaleX( CG_GetNumericArg( &argumentnode ) );
-	float y = ScaleY( CG_GetNumericArg( &argumentnode ) );
+static bool CG_LFuncSize( HUDArgs * args ) {
+	float x = ScaleX( CG_GetNumericArg( args ) );
+	float y = ScaleY( CG_GetNumericArg( args ) );
 
 	layout_cursor_width = Q_rint( x );
 	layout_cursor_height = Q_rint( y );
 	return true;
 }
 
-static bool CG_LFuncColor( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncColor( HUDArgs * args ) {
 	for( int i = 0; i < 4; i++ ) {
-		layout_cursor_color[ i ] = Clamp01( CG_GetNumericArg( &argumentnode ) );
+		layout_cursor_color[ i ] = Clamp01( CG_GetNumericArg( args ) );
 	}
 	return true;
 }
 
-static bool CG_LFuncColorToTeamColor( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	layout_cursor_color = CG_TeamColorVec4( CG_GetNumericArg( &argumentnode ) );
+static bool CG_LFuncColorToTeamColor( HUDArgs * args ) {
+	layout_cursor_color = CG_TeamColorVec4( CG_GetNumericArg( args ) );
 	return true;
 }
 
-static bool CG_LFuncAttentionGettingColor( struct cg_layoutnode_s * argumentnode, int numArguments ) {
+static bool CG_LFuncAttentionGettingColor( HUDArgs * args ) {
 	layout_cursor_color = AttentionGettingColor();
 	return true;
 }
 
-static bool CG_LFuncColorAlpha( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	layout_cursor_color.w = CG_GetNumericArg( &argumentnode );
+static bool CG_LFuncColorAlpha( HUDArgs * args ) {
+	layout_cursor_color.w = CG_GetNumericArg( args );
 	return true;
 }
 
-static bool CG_LFuncAlignment( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	const char * x = CG_GetStringArg( &argumentnode );
-	const char * y = CG_GetStringArg( &argumentnode );
+static bool CG_LFuncAlignment( HUDArgs * args ) {
+	const char * x = CG_GetStringArg( args );
+	const char * y = CG_GetStringArg( args );
 
 	if( !Q_stricmp( x, "left" ) ) {
 		layout_cursor_alignment.x = XAlignment_Left;
@@ -1962,9 +1987,9 @@ static bool CG_LFuncAlignment( struct cg_layoutnode_s *argumentnode, int numArgu
 	return true;
 }
 
-static bool CG_LFuncFontSize( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	struct cg_layoutnode_s *charnode = argumentnode;
-	const char * fontsize = CG_GetStringArg( &charnode );
+static bool CG_LFuncFontSize( HUDArgs * args ) {
+	HUDArgs peek = *args;
+	const char * fontsize = CG_GetStringArg( &peek );
 
 	if( !Q_stricmp( fontsize, "tiny" ) ) {
 		layout_cursor_font_size = cgs.textSizeTiny;
@@ -1979,14 +2004,14 @@ static bool CG_LFuncFontSize( struct cg_layoutnode_s *argumentnode, int numArgum
 		layout_cursor_font_size = cgs.textSizeBig;
 	}
 	else {
-		layout_cursor_font_size = CG_GetNumericArg( &argumentnode );
+		layout_cursor_font_size = CG_GetNumericArg( args );
 	}
 
 	return true;
 }
 
-static bool CG_LFuncFontStyle( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	const char * fontstyle = CG_GetStringArg( &argumentnode );
+static bool CG_LFuncFontStyle( HUDArgs * args ) {
+	const char * fontstyle = CG_GetStringArg( args );
 
 	if( !Q_stricmp( fontstyle, "normal" ) ) {
 		layout_cursor_font_style = FontStyle_Normal;
@@ -2008,45 +2033,45 @@ static bool CG_LFuncFontStyle( struct cg_layoutnode_s *argumentnode, int numArgu
 	return true;
 }
 
-static bool CG_LFuncFontBorder( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	const char * border = CG_GetStringArg( &argumentnode );
+static bool CG_LFuncFontBorder( HUDArgs * args ) {
+	const char * border = CG_GetStringArg( args );
 	layout_cursor_font_border = Q_stricmp( border, "on" ) == 0;
 	return true;
 }
 
-static bool CG_LFuncDrawObituaries( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	int internal_align = (int)CG_GetNumericArg( &argumentnode );
-	int icon_size = (int)CG_GetNumericArg( &argumentnode );
+static bool CG_LFuncDrawObituaries( HUDArgs * args ) {
+	int internal_align = (int)CG_GetNumericArg( args );
+	int icon_size = (int)CG_GetNumericArg( args );
 
 	CG_DrawObituaries( layout_cursor_x, layout_cursor_y, layout_cursor_alignment,
 		layout_cursor_width, layout_cursor_height, internal_align, icon_size * frame_static.viewport_height / 600 );
 	return true;
 }
 
-static bool CG_LFuncDrawAwards( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawAwards( HUDArgs * args ) {
 	CG_DrawAwards( layout_cursor_x, layout_cursor_y, layout_cursor_alignment, layout_cursor_font_size, layout_cursor_color, layout_cursor_font_border );
 	return true;
 }
 
-static bool CG_LFuncDrawClock( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawClock( HUDArgs * args ) {
 	CG_DrawClock( layout_cursor_x, layout_cursor_y, layout_cursor_alignment, GetHUDFont(), layout_cursor_font_size, layout_cursor_color, layout_cursor_font_border );
 	return true;
 }
 
-static bool CG_LFuncDrawDamageNumbers( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawDamageNumbers( HUDArgs * args ) {
 	CG_DrawDamageNumbers();
 	return true;
 }
 
-static bool CG_LFuncDrawBombIndicators( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawBombIndicators( HUDArgs * args ) {
 	CG_DrawBombHUD();
 	return true;
 }
 
-static bool CG_LFuncDrawPlayerIcons( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	int team = int( CG_GetNumericArg( &argumentnode ) );
-	int alive = int( CG_GetNumericArg( &argumentnode ) );
-	int total = int( CG_GetNumericArg( &argumentnode ) );
+static bool CG_LFuncDrawPlayerIcons( HUDArgs * args ) {
+	int team = int( CG_GetNumericArg( args ) );
+	int alive = int( CG_GetNumericArg( args ) );
+	int total = int( CG_GetNumericArg( args ) );
 
 	Vec4 team_color = CG_TeamColorVec4( team );
 
@@ -2072,13 +2097,13 @@ static bool CG_LFuncDrawPlayerIcons( struct cg_layoutnode_s *argumentnode, int n
 	return true;
 }
 
-static bool CG_LFuncDrawPointed( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawPointed( HUDArgs * args ) {
 	CG_DrawPlayerNames( GetHUDFont(), layout_cursor_font_size, layout_cursor_color, layout_cursor_font_border );
 	return true;
 }
 
-static bool CG_LFuncDrawString( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	const char *string = CG_GetStringArg( &argumentnode );
+static bool CG_LFuncDrawString( HUDArgs * args ) {
+	const char *string = CG_GetStringArg( args );
 
 	if( !string || !string[0] ) {
 		return false;
@@ -2089,25 +2114,29 @@ static bool CG_LFuncDrawString( struct cg_layoutnode_s *argumentnode, int numArg
 	return true;
 }
 
-static bool CG_LFuncDrawBindString( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	const char * fmt = CG_GetStringArg( &argumentnode );
-	const char * command = CG_GetStringArg( &argumentnode );
+static bool CG_LFuncDrawBindString( HUDArgs * args ) {
+	const char * fmt = CG_GetStringArg( args );
+	const char * command = CG_GetStringArg( args );
 
-	char keys[ 128 ];
-	if( !CG_GetBoundKeysString( command, keys, sizeof( keys ) ) ) {
-		snprintf( keys, sizeof( keys ), "[%s]", command );
-	}
+	HUDTextCache * cache = args->text_cache;
+	if( !cache->valid || cache->bindings_version != Key_BindingsVersion() ) {
+		char keys[ 128 ];
+		if( !CG_GetBoundKeysString( command, keys, sizeof( keys ) ) ) {
+			snprintf( keys, sizeof( keys ), "[%s]", command );
+		}
 
-	char buf[ 1024 ];
-	snprintf( buf, sizeof( buf ), fmt, keys );
+		snprintf( cache->text, sizeof( cache->text ), fmt, keys );
+		cache->bindings_version = Key_BindingsVersion();
+		cache->valid = true;
+	}
 
-	DrawText( GetHUDFont(), layout_cursor_font_size, buf, layout_cursor_alignment, layout_cursor_x, layout_cursor_y, layout_cursor_color, layout_cursor_font_border );
+	DrawText( GetHUDFont(), layout_cursor_font_size, cache->text, layout_cursor_alignment, layout_cursor_x, layout_cursor_y, layout_cursor_color, layout_cursor_font_border );
 
 	return true;
 }
 
-static bool CG_LFuncDrawPlayerName( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	int index = (int)CG_GetNumericArg( &argumentnode ) - 1;
+static bool CG_LFuncDrawPlayerName( HUDArgs * args ) {
+	int index = (int)CG_GetNumericArg( args ) - 1;
 
 	if( index >= 0 && index < client_gs.maxclients && cgs.clientInfo[index].name[0] ) {
 		DrawText( GetHUDFont(), layout_cursor_font_size, cgs.clientInfo[ index ].name, layout_cursor_alignment, layout_cursor_x, layout_cursor_y, layout_cursor_color, layout_cursor_font_border );
@@ -2117,55 +2146,64 @@ static bool CG_LFuncDrawPlayerName( struct cg_layoutnode_s *argumentnode, int nu
 	return false;
 }
 
-static bool CG_LFuncDrawNumeric( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	int value = CG_GetNumericArg( &argumentnode );
-	DrawText( GetHUDFont(), layout_cursor_font_size, va( "%i", value ), layout_cursor_alignment, layout_cursor_x, layout_cursor_y, layout_cursor_color, layout_cursor_font_border );
+static bool CG_LFuncDrawNumeric( HUDArgs * args ) {
+	int value = CG_GetNumericArg( args );
+
+	HUDTextCache * cache = args->text_cache;
+	if( !cache->valid || cache->value != value ) {
+		snprintf( cache->text, sizeof( cache->text ), "%i", value );
+		cache->value = value;
+		cache->valid = true;
+	}
+
+	DrawText( GetHUDFont(), layout_cursor_font_size, cache->text, layout_cursor_alignment, layout_cursor_x, layout_cursor_y, layout_cursor_color, layout_cursor_font_border );
 	return true;
 }
 
-static bool CG_LFuncDrawWeaponIcons( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	int offx = CG_GetNumericArg( &argumentnode ) * frame_static.viewport_width / 800;
-	int offy = CG_GetNumericArg( &argumentnode ) * frame_static.viewport_height / 600;
-	int w = CG_GetNumericArg( &argumentnode ) * frame_static.viewport_width / 800;
-	int h = CG_GetNumericArg( &argumentnode ) * frame_static.viewport_height / 600;
-	float font_size = CG_GetNumericArg( &argumentnode );
+static bool CG_LFuncDrawWeaponIcons( HUDArgs * args ) {
+	int offx = CG_GetNumericArg( args ) * frame_static.viewport_width / 800;
+	int offy = CG_GetNumericArg( args ) * frame_static.viewport_height / 600;
+	int w = CG_GetNumericArg( args ) * frame_static.viewport_width / 800;
+	int h = CG_GetNumericArg( args ) * frame_static.viewport_height / 600;
+	float font_size = CG_GetNumericArg( args );
 
 	CG_DrawWeaponIcons( layout_cursor_x, layout_cursor_y, offx, offy, w, h, layout_cursor_alignment, font_size );
 
 	return true;
 }
 
-static bool CG_LFuncDrawCrossHair( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawCrossHair( HUDArgs * args ) {
 	CG_DrawCrosshair();
 	return true;
 }
 
-static bool CG_LFuncDrawKeyState( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	const char *key = CG_GetStringArg( &argumentnode );
+static bool CG_LFuncDrawKeyState( HUDArgs * args ) {
+	const char *key = CG_GetStringArg( args );
 
 	CG_DrawKeyState( layout_cursor_x, layout_cursor_y, layout_cursor_width, layout_cursor_height, key );
 	return true;
 }
 
-static bool CG_LFuncDrawNet( struct cg_layoutnode_s *argumentnode, int numArguments ) {
+static bool CG_LFuncDrawNet( HUDArgs * args ) {
 	CG_DrawNet( layout_cursor_x, layout_cursor_y, layout_cursor_width, layout_cursor_height, layout_cursor_alignment, layout_cursor_color );
 	return true;
 }
 
-static bool CG_LFuncIf( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	return (int)CG_GetNumericArg( &argumentnode ) != 0;
+static bool CG_LFuncIf( HUDArgs * args ) {
+	return (int)CG_GetNumericArg( args ) != 0;
 }
 
-static bool CG_LFuncIfNot( struct cg_layoutnode_s *argumentnode, int numArguments ) {
-	return (int)CG_GetNumericArg( &argumentnode ) == 0;
+static bool CG_LFuncIfNot( HUDArgs * args ) {
+	return (int)CG_GetNumericArg( args ) == 0;
 }
 
 typedef struct cg_layoutcommand_s
 {
 	const char *name;
-	bool ( *func )( struct cg_layoutnode_s *argumentnode, int numArguments );
+	bool ( *func )( HUDArgs * args );
 	int numparms;
 	const char *help;
+	bool caches_text;
 } cg_layoutcommand_t;
 
 static const cg_layoutcommand_t cg_LayoutCommands[] =
@@ -2266,6 +2304,7 @@ static const cg_layoutcommand_t cg_LayoutCommands[] =
 		CG_LFuncDrawCallvote,
 		0,
 		"Draw callvote",
+		true,
 	},
 
 	{
@@ -2322,6 +2361,7 @@ static const cg_layoutcommand_t cg_LayoutCommands[] =
 		CG_LFuncDrawNumeric,
 		1,
 		"Draws numbers as text",
+		true,
 	},
 
 	{
@@ -2329,6 +2369,7 @@ static const cg_layoutcommand_t cg_LayoutCommands[] =
 		CG_LFuncDrawBindString,
 		2,
 		"Draws a string with %s replaced by a key name",
+		true,
 	},
 
 	{
@@ -2396,7 +2437,7 @@ static const cg_layoutcommand_t cg_LayoutCommands[] =
 
 typedef struct cg_layoutnode_s
 {
-	bool ( *func )( struct cg_layoutnode_s *argumentnode, int numArguments );
+	bool ( *func )( HUDArgs * args );
 	int type;
 	char *string;
 	int integer;
@@ -2408,46 +2449,83 @@ typedef struct cg_layoutnode_s
 } cg_layoutnode_t;
 
 /*
-* CG_GetStringArg
-*/
-static const char *CG_GetStringArg( struct cg_layoutnode_s **argumentsnode ) {
-	struct cg_layoutnode_s *anode = *argumentsnode;
+ * compiled program
+ *
+ * the parser builds a tree of nodes, which gets flattened into an array of
+ * ops with their arguments resolved up front. numeric arguments are chains
+ * of terms that evaluate right to left, i.e. a + b * c is a + ( b * c ),
+ * and any constant tail of a chain gets folded at compile time. if/ifnot
+ * ops store where their block ends so a false condition is just a jump, and
+ * conditions that fold to constants don't make it into the program at all
+ */
+
+struct HUDTerm {
+	int reference; // index into cg_numeric_references, -1 for constants
+	float value;
+	opFunc_t op; // applied to this term and the rest of the chain, NULL on the last term
+};
+
+struct HUDArg {
+	char * string;
+	u32 first_term;
+	u32 num_terms;
+};
+
+struct HUDOp {
+	bool ( *func )( HUDArgs * args );
+	u32 first_arg;
+	u32 num_args;
+	u32 block_end; // 0 unless this is an if
+	s32 text_cache;
+};
+
+struct HUDProgram {
+	DynamicArray< HUDOp > ops;
+	DynamicArray< HUDArg > args;
+	DynamicArray< HUDTerm > terms;
+	DynamicArray< HUDTextCache > text_caches;
 
-	if( !anode || anode->type == LNODE_COMMAND ) {
-		Com_Error( ERR_DROP, "'CG_LayoutGetStringArg': bad arg count" );
+	HUDProgram() : ops( NO_INIT ), args( NO_INIT ), terms( NO_INIT ), text_caches( NO_INIT ) { }
+};
+
+static HUDProgram hud_program;
+
+static const HUDArg * CG_NextArg( HUDArgs * args, const char * caller ) {
+	if( args->cursor >= args->num_args ) {
+		Com_Error( ERR_DROP, "'%s': bad arg count", caller );
 	}
 
-	// we can return anything as string
-	*argumentsnode = anode->next;
-	return anode->string;
+	const HUDArg * arg = &args->args[ args->cursor ];
+	args->cursor++;
+	return arg;
 }
 
 /*
-* CG_GetNumericArg
-* can use recursion for mathematical operations
+* CG_GetStringArg
 */
-static float CG_GetNumericArg( struct cg_layoutnode_s **argumentsnode ) {
-	struct cg_layoutnode_s *anode = *argumentsnode;
-	float value;
-
-	if( !anode || anode->type == LNODE_COMMAND ) {
-		Com_Error( ERR_DROP, "'CG_LayoutGetNumericArg': bad arg count" );
-	}
+static const char * CG_GetStringArg( HUDArgs * args ) {
+	// we can return anything as string
+	return CG_NextArg( args, "CG_LayoutGetStringArg" )->string;
+}
 
-	if( anode->type != LNODE_NUMERIC && anode->type != LNODE_REFERENCE_NUMERIC ) {
-		Com_Printf( "WARNING: 'CG_LayoutGetNumericArg': arg %s is not numeric", anode->string );
-	}
+static float CG_EvaluateTerm( const HUDTerm * term ) {
+	if( term->reference == -1 )
+		return term->value;
+	const reference_numeric_t * ref = &cg_numeric_references[ term->reference ];
+	return ref->func( ref->parameter );
+}
 
-	*argumentsnode = anode->next;
-	if( anode->type == LNODE_REFERENCE_NUMERIC ) {
-		value = cg_numeric_references[anode->integer].func( cg_numeric_references[anode->integer].parameter );
-	} else {
-		value = anode->value;
-	}
+/*
+* CG_GetNumericArg
+*/
+static float CG_GetNumericArg( HUDArgs * args ) {
+	const HUDArg * arg = CG_NextArg( args, "CG_LayoutGetNumericArg" );
+	const HUDTerm * terms = hud_program.terms.ptr() + arg->first_term;
 
-	// recurse if there are operators
-	if( anode->opFunc != NULL ) {
-		value = anode->opFunc( value, CG_GetNumericArg( argumentsnode ) );
+	float value = CG_EvaluateTerm( &terms[ arg->num_terms - 1 ] );
+	for( u32 i = arg->num_terms - 1; i > 0; i-- ) {
+		const HUDTerm * term = &terms[ i - 1 ];
+		value = term->op( CG_EvaluateTerm( term ), value );
 	}
 
 	return value;
@@ -2825,95 +2903,199 @@ static cg_layoutnode_t *CG_RecurseParseLayoutScript( char **ptr, int level ) {
 	return rootnode;
 }
 
-/*
-* CG_ParseLayoutScript
-*/
-static void CG_ParseLayoutScript( char *string, cg_layoutnode_t *rootnode ) {
-
-	CG_RecurseFreeLayoutThread( cg.statusBar );
-	cg.statusBar = CG_RecurseParseLayoutScript( &string, 0 );
+static cg_layoutnode_t * CG_FirstLayoutNode( cg_layoutnode_t * node ) {
+	while( node != NULL && node->parent != NULL ) {
+		node = node->parent;
+	}
+	return node;
 }
 
-//=============================================================================
-
-//=============================================================================
-
 /*
-* CG_RecurseExecuteLayoutThread
-* Execution works like this: First node (on backwards) is expected to be the command, followed by arguments nodes.
-* we keep a pointer to the command and run the tree counting arguments until we reach the next command,
-* then we call the command function sending the pointer to first argument and the pointer to the command.
-* At return we advance one node (we stopped at last argument node) so it starts again from the next command (if any).
-*
-* When finding an "if" command with a subtree, we execute the "if" command. In the case it
-* returns any value, we recurse execute the subtree
-*/
-static void CG_RecurseExecuteLayoutThread( cg_layoutnode_t *rootnode ) {
-	cg_layoutnode_t *argumentnode = NULL;
-	cg_layoutnode_t *commandnode = NULL;
-	int numArguments;
+ * compiles the chain of nodes starting at node into one argument and
+ * returns the first node after it
+ */
+static cg_layoutnode_t * CG_CompileLayoutArgument( HUDProgram * program, cg_layoutnode_t * node ) {
+	HUDArg arg;
+	arg.string = CG_CopyString( node->string );
+	arg.first_term = program->terms.size();
+	arg.num_terms = 0;
 
-	if( !rootnode ) {
-		return;
+	while( true ) {
+		HUDTerm term;
+		term.reference = node->type == LNODE_REFERENCE_NUMERIC ? node->integer : -1;
+		term.value = node->value;
+		term.op = node->opFunc;
+		program->terms.add( term );
+		arg.num_terms++;
+
+		node = node->next;
+		if( term.op == NULL || node == NULL || node->type == LNODE_COMMAND )
+			break;
 	}
 
-	// run until the real root
-	commandnode = rootnode;
-	while( commandnode->parent ) {
-		commandnode = commandnode->parent;
+	// the last term can't have an op, the parser lets them through when
+	// the chain is cut short
+	HUDTerm * terms = program->terms.ptr() + arg.first_term;
+	terms[ arg.num_terms - 1 ].op = NULL;
+
+	// fold constant tails
+	while( arg.num_terms > 1 ) {
+		HUDTerm * last = &terms[ arg.num_terms - 1 ];
+		HUDTerm * prev = &terms[ arg.num_terms - 2 ];
+		if( last->reference != -1 || prev->reference != -1 )
+			break;
+
+		prev->value = prev->op( prev->value, last->value );
+		prev->op = NULL;
+		arg.num_terms--;
 	}
 
-	// now run backwards up to the next command node
-	while( commandnode ) {
-		argumentnode = commandnode->next;
+	program->terms.resize( arg.first_term + arg.num_terms );
+	program->args.add( arg );
 
-		// we could trust the parser, but I prefer counting the arguments here
-		numArguments = 0;
-		while( argumentnode ) {
-			if( argumentnode->type == LNODE_COMMAND ) {
-				break;
+	return node;
+}
+
+static bool CG_IsConstantArg( const HUDProgram * program, const HUDArg * arg, float * value ) {
+	const HUDTerm * term = &program->terms[ arg->first_term ];
+	if( arg->num_terms != 1 || term->reference != -1 )
+		return false;
+	*value = term->value;
+	return true;
+}
+
+static void CG_FreeLayoutArgs( HUDProgram * program, u32 first_arg ) {
+	for( u32 i = first_arg; i < program->args.size(); i++ ) {
+		CG_Free( program->args[ i ].string );
+	}
+}
+
+/*
+ * appends the thread starting at rootnode to the program. like the old
+ * interpreter, an argument count mismatch ends the thread
+ */
+static void CG_CompileLayoutThread( HUDProgram * program, cg_layoutnode_t * rootnode ) {
+	cg_layoutnode_t * commandnode = CG_FirstLayoutNode( rootnode );
+
+	while( commandnode != NULL ) {
+		u32 first_arg = program->args.size();
+		u32 first_term = program->terms.size();
+
+		cg_layoutnode_t * node = commandnode->next;
+		int num_nodes = 0;
+		while( node != NULL && node->type != LNODE_COMMAND ) {
+			cg_layoutnode_t * next = CG_CompileLayoutArgument( program, node );
+			for( cg_layoutnode_t * n = node; n != next; n = n->next ) {
+				num_nodes++;
 			}
+			node = next;
+		}
 
-			argumentnode = argumentnode->next;
-			numArguments++;
+		if( commandnode->integer != num_nodes ) {
+			Com_Printf( "ERROR: Layout command %s: invalid argument count (expecting %i, found %i)\n", commandnode->string, commandnode->integer, num_nodes );
+			CG_FreeLayoutArgs( program, first_arg );
+			program->args.resize( first_arg );
+			program->terms.resize( first_term );
+			return;
 		}
 
-		// reset
-		argumentnode = commandnode->next;
+		if( commandnode->func == NULL ) {
+			commandnode = node;
+			continue;
+		}
 
-		// Execute the command node
-		if( commandnode->integer != numArguments ) {
-			Com_Printf( "ERROR: Layout command %s: invalid argument count (expecting %i, found %i)\n", commandnode->string, commandnode->integer, numArguments );
-			return;
+		bool is_if = commandnode->func == CG_LFuncIf || commandnode->func == CG_LFuncIfNot;
+
+		float condition;
+		if( is_if && CG_IsConstantArg( program, &program->args[ first_arg ], &condition ) ) {
+			bool taken = ( int( condition ) != 0 ) == ( commandnode->func == CG_LFuncIf );
+
+			CG_FreeLayoutArgs( program, first_arg );
+			program->args.resize( first_arg );
+			program->terms.resize( first_term );
+
+			if( taken && commandnode->ifthread != NULL ) {
+				CG_CompileLayoutThread( program, commandnode->ifthread );
+			}
+
+			commandnode = node;
+			continue;
 		}
-		if( commandnode->func ) {
-			//special case for if commands
-			if( commandnode->func( argumentnode, numArguments ) ) {
-				// execute the "if" thread when command returns a value
-				if( commandnode->ifthread ) {
-					CG_RecurseExecuteLayoutThread( commandnode->ifthread );
-				}
+
+		const cg_layoutcommand_t * command = NULL;
+		for( const cg_layoutcommand_t * c = cg_LayoutCommands; c->name != NULL; c++ ) {
+			if( c->func == commandnode->func ) {
+				command = c;
+				break;
 			}
 		}
 
-		//move up to next command node
-		commandnode = argumentnode;
-		if( commandnode == rootnode ) {
-			return;
+		HUDOp op;
+		op.func = commandnode->func;
+		op.first_arg = first_arg;
+		op.num_args = program->args.size() - first_arg;
+		op.block_end = 0;
+		op.text_cache = -1;
+
+		if( command != NULL && command->caches_text ) {
+			HUDTextCache cache = { };
+			op.text_cache = program->text_caches.add( cache );
 		}
 
-		while( commandnode && commandnode->type != LNODE_COMMAND ) {
-			commandnode = commandnode->next;
+		size_t op_idx = program->ops.add( op );
+
+		if( is_if ) {
+			if( commandnode->ifthread != NULL ) {
+				CG_CompileLayoutThread( program, commandnode->ifthread );
+			}
+			program->ops[ op_idx ].block_end = program->ops.size();
 		}
+
+		commandnode = node;
 	}
 }
 
+static void CG_ClearLayoutProgram( HUDProgram * program ) {
+	CG_FreeLayoutArgs( program, 0 );
+	program->ops.clear();
+	program->args.clear();
+	program->terms.clear();
+	program->text_caches.clear();
+}
+
+/*
+* CG_ParseLayoutScript
+*/
+static void CG_ParseLayoutScript( char *string ) {
+	cg_layoutnode_t * tree = CG_RecurseParseLayoutScript( &string, 0 );
+
+	CG_ClearLayoutProgram( &hud_program );
+	CG_CompileLayoutThread( &hud_program, tree );
+
+	CG_RecurseFreeLayoutThread( tree );
+}
+
 /*
 * CG_ExecuteLayoutProgram
 */
-void CG_ExecuteLayoutProgram( struct cg_layoutnode_s *rootnode ) {
+void CG_ExecuteLayoutProgram() {
 	ZoneScoped;
-	CG_RecurseExecuteLayoutThread( rootnode );
+
+	HUDProgram * program = &hud_program;
+
+	size_t i = 0;
+	while( i < program->ops.size() ) {
+		const HUDOp * op = &program->ops[ i ];
+
+		HUDArgs args;
+		args.args = program->args.ptr() + op->first_arg;
+		args.num_args = op->num_args;
+		args.cursor = 0;
+		args.text_cache = op->text_cache == -1 ? NULL : &program->text_caches[ op->text_cache ];
+
+		bool result = op->func( &args );
+		i = op->block_end != 0 && !result ? op->block_end : i + 1;
+	}
 }
 
 //=============================================================================
@@ -2966,18 +3148,28 @@ static void CG_LoadHUD() {
 		return;
 	}
 
-	CG_ParseLayoutScript( const_cast< char * >( script.c_str() ), cg.statusBar );
+	CG_ParseLayoutScript( const_cast< char * >( script.c_str() ) );
 
 	layout_cursor_font_style = FontStyle_Normal;
 	layout_cursor_font_size = cgs.textSizeSmall;
 }
 
 void CG_InitHUD() {
+	hud_program.ops.init( sys_allocator );
+	hud_program.args.init( sys_allocator );
+	hud_program.terms.init( sys_allocator );
+	hud_program.text_caches.init( sys_allocator );
+
 	Cmd_AddCommand( "reloadhud", CG_LoadHUD );
 	CG_LoadHUD();
 }
 
 void CG_ShutdownHUD() {
-	CG_RecurseFreeLayoutThread( cg.statusBar );
+	CG_ClearLayoutProgram( &hud_program );
+	hud_program.ops.shutdown();
+	hud_program.args.shutdown();
+	hud_program.terms.shutdown();
+	hud_program.text_caches.shutdown();
+
 	Cmd_RemoveCommand( "reloadhud" );
 }
@@ -380,9 +380,6 @@ typedef struct {
 	int64_t award_times[MAX_AWARD_LINES];
 	int award_head;
 
-	// statusbar program
-	struct cg_layoutnode_s *statusBar;
-
 	cg_viewweapon_t weapon;
 	cg_viewdef_t view;
 } cg_state_t;
@@ -489,7 +486,7 @@ void CG_InitHUD();
 void CG_ShutdownHUD();
 void CG_SC_ResetObituaries();
 void CG_SC_Obituary();
-void CG_ExecuteLayoutProgram( struct cg_layoutnode_s *rootnode );
+void CG_ExecuteLayoutProgram();
 void CG_ClearAwards();
 
 //
@@ -1,6 +1,9 @@
+#include <xmmintrin.h>
+
 #include "qcommon/fs.h"
 #include "qcommon/serialization.h"
 #include "client/assets.h"
+#include "client/threadpool.h"
 #include "client/renderer/renderer.h"
 #include "cgame/cg_local.h"
 
@@ -74,50 +77,107 @@ void DeleteParticleSystem( Allocator * a, ParticleSystem ps ) {
 	DeleteMesh( ps.mesh );
 }
 
-static float EvaluateEasingDerivative( EasingFunction func, float t ) {
+// the easing is the same for every particle in a system, so the switch
+// happens once per chunk and the math runs on all 4 lanes at once
+static __m128 EvaluateEasingDerivative( EasingFunction func, __m128 t ) {
 	switch( func ) {
-		case EasingFunction_Linear: return 1.0f;
-		case EasingFunction_Quadratic: return t < 0.5f ? 4.0f * t : -4.0f * t + 4.0f;
-		case EasingFunction_QuadraticEaseIn: return 2.0f * t;
-		case EasingFunction_QuadraticEaseOut: return -2.0f * t + 2.0f;
+		case EasingFunction_Linear: return _mm_set1_ps( 1.0f );
+		// t < 0.5 ? 4t : 4 - 4t
+		case EasingFunction_Quadratic: return _mm_mul_ps( _mm_set1_ps( 4.0f ), _mm_min_ps( t, _mm_sub_ps( _mm_set1_ps( 1.0f ), t ) ) );
+		case EasingFunction_QuadraticEaseIn: return _mm_mul_ps( _mm_set1_ps( 2.0f ), t );
+		case EasingFunction_QuadraticEaseOut: return _mm_sub_ps( _mm_set1_ps( 2.0f ), _mm_mul_ps( _mm_set1_ps( 2.0f ), t ) );
 	}
 
-	return 0.0f;
+	return _mm_setzero_ps();
 }
 
 static void UpdateParticleChunk( const ParticleSystem * ps, ParticleChunk * chunk, Vec3 acceleration, float dt ) {
-	DisableFPEScoped;
+	__m128 dt4 = _mm_set1_ps( dt );
+	__m128 min_velocity = _mm_set1_ps( 0.0001f );
+
+	__m128 t = _mm_add_ps( _mm_load_ps( chunk->t ), dt4 );
+	_mm_store_ps( chunk->t, t );
+	__m128 frac = _mm_div_ps( t, _mm_load_ps( chunk->lifetime ) );
+
+	__m128 vx = _mm_add_ps( _mm_load_ps( chunk->velocity_x ), _mm_set1_ps( acceleration.x * dt ) );
+	__m128 vy = _mm_add_ps( _mm_load_ps( chunk->velocity_y ), _mm_set1_ps( acceleration.y * dt ) );
+	__m128 vz = _mm_add_ps( _mm_load_ps( chunk->velocity_z ), _mm_set1_ps( acceleration.z * dt ) );
+
+	__m128 length_squared = _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, vx ), _mm_mul_ps( vy, vy ) ), _mm_mul_ps( vz, vz ) );
+	__m128 velocity = _mm_max_ps( min_velocity, _mm_sqrt_ps( length_squared ) );
+	__m128 new_velocity = _mm_max_ps( min_velocity, _mm_add_ps( velocity, _mm_mul_ps( _mm_load_ps( chunk->dvelocity ), dt4 ) ) );
+	__m128 velocity_scale = _mm_div_ps( new_velocity, velocity );
+
+	vx = _mm_mul_ps( vx, velocity_scale );
+	vy = _mm_mul_ps( vy, velocity_scale );
+	vz = _mm_mul_ps( vz, velocity_scale );
+	_mm_store_ps( chunk->velocity_x, vx );
+	_mm_store_ps( chunk->velocity_y, vy );
+	_mm_store_ps( chunk->velocity_z, vz );
+
+	_mm_store_ps( chunk->position_x, _mm_add_ps( _mm_load_ps( chunk->position_x ), _mm_mul_ps( vx, dt4 ) ) );
+	_mm_store_ps( chunk->position_y, _mm_add_ps( _mm_load_ps( chunk->position_y ), _mm_mul_ps( vy, dt4 ) ) );
+	_mm_store_ps( chunk->position_z, _mm_add_ps( _mm_load_ps( chunk->position_z ), _mm_mul_ps( vz, dt4 ) ) );
+
+	__m128 color_step = _mm_mul_ps( EvaluateEasingDerivative( ps->color_easing, frac ), dt4 );
+	_mm_store_ps( chunk->color_r, _mm_add_ps( _mm_load_ps( chunk->color_r ), _mm_mul_ps( color_step, _mm_load_ps( chunk->dcolor_r ) ) ) );
+	_mm_store_ps( chunk->color_g, _mm_add_ps( _mm_load_ps( chunk->color_g ), _mm_mul_ps( color_step, _mm_load_ps( chunk->dcolor_g ) ) ) );
+	_mm_store_ps( chunk->color_b, _mm_add_ps( _mm_load_ps( chunk->color_b ), _mm_mul_ps( color_step, _mm_load_ps( chunk->dcolor_b ) ) ) );
+	_mm_store_ps( chunk->color_a, _mm_add_ps( _mm_load_ps( chunk->color_a ), _mm_mul_ps( color_step, _mm_load_ps( chunk->dcolor_a ) ) ) );
+
+	__m128 size_step = _mm_mul_ps( EvaluateEasingDerivative( ps->size_easing, frac ), dt4 );
+	_mm_store_ps( chunk->size, _mm_add_ps( _mm_load_ps( chunk->size ), _mm_mul_ps( size_step, _mm_load_ps( chunk->dsize ) ) ) );
+}
 
-	for( int i = 0; i < 4; i++ ) {
-		chunk->t[ i ] += dt;
-		float t = chunk->t[ i ] / chunk->lifetime[ i ];
+// ParticleChunk is nothing but float[ 4 ] lanes, so moving one particle is
+// copying the same lane out of every field
+constexpr size_t PARTICLE_CHUNK_FIELDS = sizeof( ParticleChunk ) / sizeof( float[ 4 ] );
+STATIC_ASSERT( sizeof( ParticleChunk ) == PARTICLE_CHUNK_FIELDS * sizeof( float[ 4 ] ) );
 
-		chunk->velocity_x[ i ] += acceleration.x * dt;
-		chunk->velocity_y[ i ] += acceleration.y * dt;
-		chunk->velocity_z[ i ] += acceleration.z * dt;
+static void CopyParticle( ParticleChunk * dst, size_t dst_lane, const ParticleChunk * src, size_t src_lane ) {
+	float ( *dst_fields )[ 4 ] = ( float ( * )[ 4 ] ) dst;
+	const float ( *src_fields )[ 4 ] = ( const float ( * )[ 4 ] ) src;
+	for( size_t i = 0; i < PARTICLE_CHUNK_FIELDS; i++ ) {
+		dst_fields[ i ][ dst_lane ] = src_fields[ i ][ src_lane ];
+	}
+}
 
-		float velocity = Max2( 0.0001f, Length( Vec3( chunk->velocity_x[ i ], chunk->velocity_y[ i ], chunk->velocity_z[ i ] ) ) );
-		float new_velocity = Max2( 0.0001f, velocity + chunk->dvelocity[ i ] * dt );
-		float velocity_scale = new_velocity / velocity;
+static void DeleteExpiredParticles( ParticleSystem * ps ) {
+	// stream compaction. test a whole chunk at a time, move full chunks
+	// with one copy and only go lane by lane around the holes
+	size_t num_chunks = AlignPow2( ps->num_particles, size_t( 4 ) ) / 4;
+	size_t write = 0;
 
-		chunk->velocity_x[ i ] *= velocity_scale;
-		chunk->velocity_y[ i ] *= velocity_scale;
-		chunk->velocity_z[ i ] *= velocity_scale;
+	for( size_t i = 0; i < num_chunks; i++ ) {
+		const ParticleChunk * chunk = &ps->chunks[ i ];
 
-		chunk->position_x[ i ] += chunk->velocity_x[ i ] * dt;
-		chunk->position_y[ i ] += chunk->velocity_y[ i ] * dt;
-		chunk->position_z[ i ] += chunk->velocity_z[ i ] * dt;
+		// NaN t stays alive, same as a scalar t > lifetime test
+		__m128 alive = _mm_cmpngt_ps( _mm_load_ps( chunk->t ), _mm_load_ps( chunk->lifetime ) );
+		size_t valid_lanes = Min2( ps->num_particles - i * 4, size_t( 4 ) );
+		int mask = _mm_movemask_ps( alive ) & ( ( 1 << valid_lanes ) - 1 );
 
-		chunk->color_r[ i ] += EvaluateEasingDerivative( ps->color_easing, t ) * chunk->dcolor_r[ i ] * dt;
-		chunk->color_g[ i ] += EvaluateEasingDerivative( ps->color_easing, t ) * chunk->dcolor_g[ i ] * dt;
-		chunk->color_b[ i ] += EvaluateEasingDerivative( ps->color_easing, t ) * chunk->dcolor_b[ i ] * dt;
-		chunk->color_a[ i ] += EvaluateEasingDerivative( ps->color_easing, t ) * chunk->dcolor_a[ i ] * dt;
+		if( mask == 0xf && write % 4 == 0 ) {
+			if( write != i * 4 ) {
+				ps->chunks[ write / 4 ] = *chunk;
+			}
+			write += 4;
+			continue;
+		}
 
-		chunk->size[ i ] += EvaluateEasingDerivative( ps->size_easing, t ) * chunk->dsize[ i ] * dt;
+		for( size_t lane = 0; lane < 4; lane++ ) {
+			if( mask & ( 1 << lane ) ) {
+				CopyParticle( &ps->chunks[ write / 4 ], write % 4, chunk, lane );
+				write++;
+			}
+		}
 	}
+
+	ps->num_particles = write;
 }
 
 void UpdateParticleSystem( ParticleSystem * ps, float dt ) {
+	DisableFPEScoped;
+
 	{
 		ZoneScopedN( "Update particles" );
 		size_t active_chunks = AlignPow2( ps->num_particles, size_t( 4 ) ) / 4;
@@ -127,56 +187,12 @@ void UpdateParticleSystem( ParticleSystem * ps, float dt ) {
 	}
 
 	ZoneScopedN( "Delete expired particles" );
-
-	// delete expired particles
-	for( size_t i = 0; i < ps->num_particles; i++ ) {
-		ParticleChunk & chunk = ps->chunks[ i / 4 ];
-		size_t chunk_offset = i % 4;
-
-		if( chunk.t[ chunk_offset ] > chunk.lifetime[ chunk_offset ] ) {
-			ps->num_particles--;
-			i--;
-
-			ParticleChunk & swap_chunk = ps->chunks[ ps->num_particles / 4 ];
-			size_t swap_offset = ps->num_particles % 4;
-
-			Swap2( &chunk.t[ chunk_offset ], &swap_chunk.t[ swap_offset ] );
-			Swap2( &chunk.lifetime[ chunk_offset ], &swap_chunk.lifetime[ swap_offset ] );
-
-			Swap2( &chunk.position_x[ chunk_offset ], &swap_chunk.position_x[ swap_offset ] );
-			Swap2( &chunk.position_y[ chunk_offset ], &swap_chunk.position_y[ swap_offset ] );
-			Swap2( &chunk.position_z[ chunk_offset ], &swap_chunk.position_z[ swap_offset ] );
-
-			Swap2( &chunk.velocity_x[ chunk_offset ], &swap_chunk.velocity_x[ swap_offset ] );
-			Swap2( &chunk.velocity_y[ chunk_offset ], &swap_chunk.velocity_y[ swap_offset ] );
-			Swap2( &chunk.velocity_z[ chunk_offset ], &swap_chunk.velocity_z[ swap_offset ] );
-
-			Swap2( &chunk.dvelocity[ chunk_offset ], &swap_chunk.dvelocity[ swap_offset ] );
-
-			Swap2( &chunk.color_r[ chunk_offset ], &swap_chunk.color_r[ swap_offset ] );
-			Swap2( &chunk.color_g[ chunk_offset ], &swap_chunk.color_g[ swap_offset ] );
-			Swap2( &chunk.color_b[ chunk_offset ], &swap_chunk.color_b[ swap_offset ] );
-			Swap2( &chunk.color_a[ chunk_offset ], &swap_chunk.color_a[ swap_offset ] );
-
-			Swap2( &chunk.dcolor_r[ chunk_offset ], &swap_chunk.dcolor_r[ swap_offset ] );
-			Swap2( &chunk.dcolor_g[ chunk_offset ], &swap_chunk.dcolor_g[ swap_offset ] );
-			Swap2( &chunk.dcolor_b[ chunk_offset ], &swap_chunk.dcolor_b[ swap_offset ] );
-			Swap2( &chunk.dcolor_a[ chunk_offset ], &swap_chunk.dcolor_a[ swap_offset ] );
-
-			Swap2( &chunk.size[ chunk_offset ], &swap_chunk.size[ swap_offset ] );
-			Swap2( &chunk.dsize[ chunk_offset ], &swap_chunk.dsize[ swap_offset ] );
-		}
-	}
+	DeleteExpiredParticles( ps );
 }
 
-void DrawParticleSystem( ParticleSystem * ps ) {
+static void FillParticleVertexBuffer( ParticleSystem * ps ) {
 	DisableFPEScoped;
 
-	if( ps->num_particles == 0 )
-		return;
-
-	ZoneScoped;
-
 	size_t active_chunks = AlignPow2( ps->num_particles, size_t( 4 ) ) / 4;
 	for( size_t i = 0; i < active_chunks; i++ ) {
 		const ParticleChunk & chunk = ps->chunks[ i ];
@@ -188,20 +204,52 @@ void DrawParticleSystem( ParticleSystem * ps ) {
 			ps->vb_memory[ i * 4 + j ].color = RGBA8( color );
 		}
 	}
+}
+
+static void SubmitParticleSystem( ParticleSystem * ps ) {
+	if( ps->num_particles == 0 )
+		return;
+
+	ZoneScoped;
 
 	WriteVertexBuffer( ps->vb, ps->vb_memory, ps->num_particles * sizeof( GPUParticle ) );
 
 	DrawInstancedParticles( ps->mesh, ps->vb, ps->material, ps->gradient, ps->blend_func, ps->num_particles );
 }
 
+void DrawParticleSystem( ParticleSystem * ps ) {
+	if( ps->num_particles == 0 )
+		return;
+
+	FillParticleVertexBuffer( ps );
+	SubmitParticleSystem( ps );
+}
+
+struct UpdateParticlesJob {
+	ParticleSystem * ps;
+	float dt;
+};
+
 void DrawParticles() {
 	float dt = cls.frametime / 1000.0f;
-	UpdateParticleSystem( &cgs.ions, dt );
-	UpdateParticleSystem( &cgs.bullet_sparks, dt );
-	UpdateParticleSystem( &cgs.sparks, dt );
-	DrawParticleSystem( &cgs.ions );
-	DrawParticleSystem( &cgs.bullet_sparks );
-	DrawParticleSystem( &cgs.sparks );
+
+	// the systems don't share anything until they get submitted, so
+	// simulate them and fill their vertex buffers on the thread pool
+	UpdateParticlesJob jobs[] = {
+		{ &cgs.ions, dt },
+		{ &cgs.bullet_sparks, dt },
+		{ &cgs.sparks, dt },
+	};
+
+	ParallelFor( Span< UpdateParticlesJob >( jobs, ARRAY_COUNT( jobs ) ), []( TempAllocator * temp, void * data ) {
+		UpdateParticlesJob * job = ( UpdateParticlesJob * ) data;
+		UpdateParticleSystem( job->ps, job->dt );
+		FillParticleVertexBuffer( job->ps );
+	} );
+
+	for( const UpdateParticlesJob & job : jobs ) {
+		SubmitParticleSystem( job.ps );
+	}
 }
 
 static void EmitParticle( ParticleSystem * ps, float lifetime, Vec3 position, Vec3 velocity, float dvelocity, Vec4 color, Vec4 dcolor, float size, float dsize ) {
@@ -18,20 +18,29 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#include "qcommon/array.h"
 #include "cgame/cg_local.h"
 #include "client/assets.h"
 #include "client/renderer/renderer.h"
 #include "client/renderer/model.h"
+#include "client/threadpool.h"
 
 pmodel_t cg_entPModels[MAX_EDICTS];
 PlayerModelMetadata *cg_PModelInfos;
 
+static DynamicArray< Mat4 > player_pose_matrices( NO_INIT );
+
 void CG_PModelsInit() {
-	memset( cg_entPModels, 0, sizeof( cg_entPModels ) );
+	for( pmodel_t & pmodel : cg_entPModels ) {
+		pmodel = { };
+	}
 	cg_PModelInfos = NULL;
+	player_pose_matrices.init( sys_allocator );
 }
 
 void CG_PModelsShutdown() {
+	player_pose_matrices.shutdown();
+
 	PlayerModelMetadata * next = cg_PModelInfos;
 	while( next != NULL ) {
 		PlayerModelMetadata * curr = next;
@@ -42,7 +51,7 @@ void CG_PModelsShutdown() {
 
 void CG_ResetPModels( void ) {
 	for( int i = 0; i < MAX_EDICTS; i++ ) {
-		memset( &cg_entPModels[i].animState, 0, sizeof( pmodel_animationstate_t ) );
+		cg_entPModels[i].animState = { };
 	}
 	memset( &cg.weapon, 0, sizeof( cg.weapon ) );
 }
@@ -776,6 +785,99 @@ static Mat4 TransformTag( const Model * model, const Mat4 & transform, const Mat
 	return transform * model->transform * pose.joint_poses[ tag.joint_idx ] * tag.transform;
 }
 
+struct PlayerPoseJob {
+	const PlayerModelMetadata * meta;
+	float lower_time, upper_time;
+
+	bool rotate_joints;
+	Quaternion upper_rotation;
+	Quaternion head_rotation;
+
+	MatrixPalettes pose;
+};
+
+/*
+* CG_AnimatePlayers
+*
+* Poses every player model that's going to be drawn this frame. Anything
+* that reads or writes cgame state happens here on the main thread, and
+* the sampling and matrix palettes, which only read the model, run on the
+* thread pool
+*/
+void CG_AnimatePlayers( Span< centity_t * > players ) {
+	ZoneScoped;
+
+	TempAllocator temp = cls.frame_arena.temp();
+	Span< PlayerPoseJob > jobs = ALLOC_SPAN( &temp, PlayerPoseJob, players.n );
+
+	// size the palettes up front so the spans don't move under the jobs
+	size_t num_matrices = 0;
+	for( centity_t * cent : players ) {
+		num_matrices += cg_entPModels[ cent->current.number ].metadata->model->num_joints * 2;
+	}
+	player_pose_matrices.resize( num_matrices );
+
+	size_t cursor = 0;
+	for( size_t i = 0; i < players.n; i++ ) {
+		centity_t * cent = players[ i ];
+		pmodel_t * pmodel = &cg_entPModels[ cent->current.number ];
+		PlayerPoseJob * job = &jobs[ i ];
+
+		job->meta = pmodel->metadata;
+		CG_GetAnimationTimes( pmodel, cl.serverTime, &job->lower_time, &job->upper_time );
+
+		// add skeleton effects (pose is unmounted yet)
+		job->rotate_joints = cent->current.type != ET_CORPSE;
+		if( job->rotate_joints ) {
+			Vec3 tmpangles;
+			// if it's our client use the predicted angles
+			if( cg.view.playerPrediction && ISVIEWERENTITY( cent->current.number ) ) {
+				tmpangles.y = cg.predictedPlayerState.viewangles.y;
+				tmpangles.x = 0;
+				tmpangles.z = 0;
+			}
+			else {
+				// apply interpolated LOWER angles to entity
+				tmpangles = LerpAngles( pmodel->oldangles[LOWER], cg.lerpfrac, pmodel->angles[LOWER] );
+			}
+
+			AnglesToAxis( tmpangles, cent->ent.axis );
+
+			// apply UPPER and HEAD angles to rotator joints
+			// also add rotations from velocity leaning
+			EulerDegrees3 upper_angles = EulerDegrees3( LerpAngles( pmodel->oldangles[ UPPER ], cg.lerpfrac, pmodel->angles[ UPPER ] ) * 0.5f );
+			job->upper_rotation = EulerAnglesToQuaternion( upper_angles );
+
+			EulerDegrees3 head_angles = EulerDegrees3( LerpAngles( pmodel->oldangles[ HEAD ], cg.lerpfrac, pmodel->angles[ HEAD ] ) );
+			job->head_rotation = EulerAnglesToQuaternion( head_angles );
+		}
+
+		size_t num_joints = job->meta->model->num_joints;
+		job->pose.joint_poses = Span< Mat4 >( player_pose_matrices.ptr() + cursor, num_joints );
+		job->pose.skinning_matrices = Span< Mat4 >( player_pose_matrices.ptr() + cursor + num_joints, num_joints );
+		cursor += num_joints * 2;
+
+		pmodel->pose = job->pose;
+	}
+
+	ParallelFor( jobs, []( TempAllocator * temp, void * data ) {
+		PlayerPoseJob * job = ( PlayerPoseJob * ) data;
+		const PlayerModelMetadata * meta = job->meta;
+
+		Span< TRS > lower = SampleAnimation( temp, meta->model, job->lower_time );
+		Span< TRS > upper = SampleAnimation( temp, meta->model, job->upper_time );
+		MergeLowerUpperPoses( lower, upper, meta->model, meta->upper_root_joint );
+
+		if( job->rotate_joints ) {
+			lower[ meta->upper_rotator_joints[ 0 ] ].rotation *= job->upper_rotation;
+			lower[ meta->upper_rotator_joints[ 1 ] ].rotation *= job->upper_rotation;
+			lower[ meta->head_rotator_joint ].rotation *= job->head_rotation;
+		}
+
+		ComputeMatrixPalettes( &job->pose, meta->model, lower );
+	} );
+}
+
 void CG_DrawPlayer( centity_t *cent ) {
 	pmodel_t * pmodel = &cg_entPModels[ cent->current.number ];
 	const PlayerModelMetadata * meta = pmodel->metadata;
@@ -801,48 +903,8 @@ void CG_DrawPlayer( centity_t *cent ) {
 		cent->ent.origin2 = origin;
 	}
 
-	TempAllocator temp = cls.frame_arena.temp();
-
-	float lower_time, upper_time;
-	CG_GetAnimationTimes( pmodel, cl.serverTime, &lower_time, &upper_time );
-	Span< TRS > lower = SampleAnimation( &temp, meta->model, lower_time );
-	Span< TRS > upper = SampleAnimation( &temp, meta->model, upper_time );
-	MergeLowerUpperPoses( lower, upper, meta->model, meta->upper_root_joint );
-
-	// add skeleton effects (pose is unmounted yet)
+	MatrixPalettes pose = pmodel->pose;
 	bool corpse = cent->current.type == ET_CORPSE;
-	if( !corpse ) {
-		Vec3 tmpangles;
-		// if it's our client use the predicted angles
-		if( cg.view.playerPrediction && ISVIEWERENTITY( cent->current.number ) ) {
-			tmpangles.y = cg.predictedPlayerState.viewangles.y;
-			tmpangles.x = 0;
-			tmpangles.z = 0;
-		}
-		else {
-			// apply interpolated LOWER angles to entity
-			tmpangles = LerpAngles( pmodel->oldangles[LOWER], cg.lerpfrac, pmodel->angles[LOWER] );
-		}
-
-		AnglesToAxis( tmpangles, cent->ent.axis );
-
-		// apply UPPER and HEAD angles to rotator joints
-		// also add rotations from velocity leaning
-		{
-			EulerDegrees3 angles = EulerDegrees3( LerpAngles( pmodel->oldangles[ UPPER ], cg.lerpfrac, pmodel->angles[ UPPER ] ) * 0.5f );
-
-			Quaternion q = EulerAnglesToQuaternion( angles );
-			lower[ meta->upper_rotator_joints[ 0 ] ].rotation *= q;
-			lower[ meta->upper_rotator_joints[ 1 ] ].rotation *= q;
-		}
-
-		{
-			EulerDegrees3 angles = EulerDegrees3( LerpAngles( pmodel->oldangles[ HEAD ], cg.lerpfrac, pmodel->angles[ HEAD ] ) );
-			lower[ meta->head_rotator_joint ].rotation *= EulerAnglesToQuaternion( angles );
-		}
-	}
-
-	MatrixPalettes pose = ComputeMatrixPalettes( &temp, meta->model, lower );
 
 	// CG_AllocPlayerShadow( cent->current.number, cent->ent.origin, playerbox_stand_mins, playerbox_stand_maxs );
 
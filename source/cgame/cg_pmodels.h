@@ -218,6 +218,8 @@ typedef struct {
 	Vec3 angles[PMODEL_PARTS];                // for rotations
 	Vec3 oldangles[PMODEL_PARTS];             // for rotations
 
+	MatrixPalettes pose;                // filled in by CG_AnimatePlayers each frame
+
 	// effects
 	orientation_t projectionSource;     // for projectiles
 } pmodel_t;
@@ -241,6 +243,7 @@ void CG_PModelsInit( void );
 void CG_PModelsShutdown( void );
 void CG_ResetPModels( void );
 PlayerModelMetadata *CG_RegisterPlayerModel( const char *filename );
+void CG_AnimatePlayers( Span< centity_t * > players );
 void CG_DrawPlayer( centity_t * cent );
 bool CG_PModel_GetProjectionSource( int entnum, orientation_t *tag_result );
 void CG_UpdatePlayerModelEnt( centity_t *cent );
@@ -658,7 +658,7 @@ void CG_Draw2DView( void ) {
 	}
 
 	CG_DrawScope();
-	CG_ExecuteLayoutProgram( cg.statusBar );
+	CG_ExecuteLayoutProgram();
 	CG_DrawChat();
 }
 
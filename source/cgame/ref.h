@@ -29,6 +29,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define RDF_BLURRED             0x4
 
 constexpr u32 TILE_SIZE = 32; // forward+ tile size
+constexpr u32 CLUSTER_DEPTH_SLICES = 16;
+constexpr u32 CLUSTER_FAR_PLANE = 4096; // depth slices are log spaced between the near plane and this
 
 typedef struct orientation_s {
 	mat3_t axis;
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "client/client.h"
+#include "qcommon/array.h"
 
 static void CL_PauseDemo( bool paused );
 
@@ -196,6 +197,29 @@ void CL_Record_f( void ) {
 static int demofilehandle;
 static int demofilelen, demofilelentotal;
 
+// keyframe seek index, built the first time we need to jump backwards and
+// kept until a different demo is opened
+struct DemoKeyframe {
+	int64_t serverTime;
+	int offset;
+};
+
+static DynamicArray< DemoKeyframe > demo_keyframes( NO_INIT );
+static char *demo_keyframes_filename;
+static int demo_keyframes_filelen;
+
+/*
+* CL_FreeDemoKeyframeIndex
+*/
+static void CL_FreeDemoKeyframeIndex( void ) {
+	if( demo_keyframes_filename == NULL ) {
+		return;
+	}
+	Mem_ZoneFree( demo_keyframes_filename );
+	demo_keyframes_filename = NULL;
+	demo_keyframes.shutdown();
+}
+
 /*
 * CL_DemoCompleted
 *
@@ -279,6 +303,74 @@ void CL_ReadDemoPackets( void ) {
 	cls.demo.play_jump = false;
 }
 
+/*
+* CL_BuildDemoKeyframeIndex
+*
+* Scans the whole demo for keyframe markers. Leaves the file position
+* undefined
+*/
+static void CL_BuildDemoKeyframeIndex( void ) {
+	ZoneScoped;
+
+	if( demo_keyframes_filename != NULL ) {
+		return;
+	}
+
+	demo_keyframes.init( sys_allocator );
+	demo_keyframes_filename = ZoneCopyString( cls.demo.filename );
+	demo_keyframes_filelen = demofilelentotal;
+
+	static uint8_t msgbuf[MAX_MSGLEN];
+	msg_t msg;
+	MSG_Init( &msg, msgbuf, sizeof( msgbuf ) );
+
+	int64_t start = Sys_Milliseconds();
+
+	FS_Seek( demofilehandle, 0, FS_SEEK_SET );
+	for( ;; ) {
+		int offset = FS_Tell( demofilehandle );
+
+		// don't use SNAP_ReadDemoMessage, a truncated demo should still be
+		// playable up to where it ends
+		int msglen = -1;
+		if( FS_Read( &msglen, 4, demofilehandle ) != 4 ) {
+			break;
+		}
+		msglen = LittleLong( msglen );
+		if( msglen < 0 || (size_t)msglen > msg.maxsize ) {
+			break;
+		}
+		if( FS_Read( msg.data, msglen, demofilehandle ) != msglen ) {
+			break;
+		}
+		msg.cursize = msglen;
+
+		DemoKeyframe keyframe;
+		keyframe.offset = offset;
+		if( SNAP_IsDemoKeyframe( &msg, &keyframe.serverTime ) ) {
+			demo_keyframes.add( keyframe );
+		}
+	}
+
+	Com_DPrintf( "Indexed %zu demo keyframes in %" PRIi64 "ms\n", demo_keyframes.size(), Sys_Milliseconds() - start );
+}
+
+/*
+* CL_FindDemoKeyframe
+*
+* Returns the last keyframe at or before serverTime, or NULL
+*/
+static const DemoKeyframe *CL_FindDemoKeyframe( int64_t serverTime ) {
+	const DemoKeyframe *best = NULL;
+	for( const DemoKeyframe & keyframe : demo_keyframes ) {
+		if( keyframe.serverTime > serverTime ) {
+			break;
+		}
+		best = &keyframe;
+	}
+	return best;
+}
+
 /*
 * CL_LatchedDemoJump
 *
@@ -297,7 +389,21 @@ void CL_LatchedDemoJump( void ) {
 
 	CL_AdjustServerTime( 1 );
 
-	if( cl.serverTime < cl.snapShots[cl.receivedSnapNum & UPDATE_MASK].serverTime ) {
+	int64_t lastSnapTime = cl.snapShots[cl.receivedSnapNum & UPDATE_MASK].serverTime;
+	bool backwards = cl.serverTime < lastSnapTime;
+
+	if( backwards ) {
+		CL_BuildDemoKeyframeIndex();
+	}
+
+	// skip forward jumps if there's a keyframe well past where we are
+	const DemoKeyframe *keyframe = demo_keyframes_filename != NULL ? CL_FindDemoKeyframe( cl.serverTime ) : NULL;
+	bool skip = keyframe != NULL && ( backwards || keyframe->serverTime > lastSnapTime + SNAP_DEMO_KEYFRAME_INTERVAL );
+
+	if( skip ) {
+		FS_Seek( demofilehandle, keyframe->offset, FS_SEEK_SET );
+		cl.currentSnapNum = cl.receivedSnapNum = 0;
+	} else if( backwards ) {
 		demofilelen = demofilelentotal;
 		FS_Seek( demofilehandle, 0, FS_SEEK_SET );
 		cl.currentSnapNum = cl.receivedSnapNum = 0;
@@ -373,6 +479,13 @@ static void CL_StartDemo( const char *demoname, bool pause_on_stop ) {
 	cls.demo.filename = ZoneCopyString( name );
 	cls.demo.name = ZoneCopyString( servername );
 
+	// keep the keyframe index if the same demo is played again
+	if( demo_keyframes_filename != NULL ) {
+		if( Q_stricmp( demo_keyframes_filename, cls.demo.filename ) != 0 || demo_keyframes_filelen != demofilelentotal ) {
+			CL_FreeDemoKeyframeIndex();
+		}
+	}
+
 	CL_PauseDemo( false );
 
 	Mem_TempFree( name );
@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "qcommon/version.h"
 #include "qcommon/hash.h"
 #include "qcommon/csprng.h"
+#include "qcommon/memtrack.h"
 #include "gameshared/gs_public.h"
 
 cvar_t *rcon_client_password;
@@ -1856,6 +1857,7 @@ void CL_Init( void ) {
 	constexpr size_t frame_arena_size = 1024 * 1024; // 1MB
 	void * frame_arena_memory = ALLOC_SIZE( sys_allocator, frame_arena_size, 16 );
 	cls.frame_arena = ArenaAllocator( frame_arena_memory, frame_arena_size );
+	RegisterArena( "Client frame", &cls.frame_arena );
 
 	u64 entropy[ 2 ];
 	CSPRNG_Bytes( entropy, sizeof( entropy ) );
@@ -1969,5 +1971,6 @@ void CL_Shutdown( void ) {
 	cls.state = CA_UNINITIALIZED;
 	cl_initialized = false;
 
+	UnregisterArena( &cls.frame_arena );
 	FREE( sys_allocator, cls.frame_arena.get_memory() );
 }
@@ -1,74 +1,298 @@
+#include <atomic>
+
 #include "qcommon/base.h"
 #include "qcommon/qcommon.h"
 #include "qcommon/cmodel.h"
 #include "qcommon/compression.h"
 #include "qcommon/hashtable.h"
+#include "qcommon/shared_bsp.h"
+#include "qcommon/threads.h"
 #include "client/assets.h"
 #include "client/maps.h"
 #include "client/renderer/model.h"
 
 constexpr u32 MAX_MAPS = 128;
+constexpr u32 MAX_RESIDENT_MAPS = 3; // the current map, the next one in the rotation and a spare
+
+enum MapState {
+	MapState_Unloaded,
+	MapState_Prefetching, // being decompressed on the prefetch thread
+	MapState_Decompressed,
+	MapState_Loaded,
+	MapState_Broken,
+};
+
+struct MapEntry {
+	Map map;
+	MapState state;
+	u64 last_used;
+};
 
-static Map maps[ MAX_MAPS ];
+static MapEntry maps[ MAX_MAPS ];
 static u32 num_maps;
 static Hashtable< MAX_MAPS * 2 > maps_hashtable;
 
-void InitMaps() {
+static const MapEntry * current_map;
+static u64 map_use_counter;
+
+struct MapPrefetch {
+	Thread * thread;
+	MapEntry * entry;
+	Span< u8 > compressed;
+
+	Span< u8 > data;
+	bool ok;
+	std::atomic< bool > done;
+};
+
+static MapPrefetch prefetch;
+
+static bool DecompressBSP( const char * path, Span< const u8 > compressed, Span< u8 > * data ) {
 	ZoneScoped;
+	ZoneText( path, strlen( path ) );
 
-	num_maps = 0;
+	if( compressed.n < 4 ) {
+		Com_Printf( S_COLOR_RED "BSP too small %s\n", path );
+		return false;
+	}
 
-	for( const char * path : AssetPaths() ) {
-		Span< const char > ext = FileExtension( path );
-		if( ext != ".bsp" )
-			continue;
+	Span< u8 > decompressed;
+	if( !Decompress( path, sys_allocator, compressed, &decompressed ) ) {
+		FREE( sys_allocator, decompressed.ptr );
+		return false;
+	}
 
-		ZoneScopedN( "Load map" );
-		ZoneText( path, strlen( path ) );
+	// keep our own copy of uncompressed maps too, hotloading can free the asset
+	if( decompressed.ptr == NULL ) {
+		decompressed = ALLOC_SPAN( sys_allocator, u8, compressed.n );
+		memcpy( decompressed.ptr, compressed.ptr, compressed.n );
+	}
 
-		Span< const u8 > compressed = AssetBinary( path );
-		if( compressed.n < 4 ) {
-			Com_Printf( S_COLOR_RED "BSP too small %s\n", path );
-			continue;
+	*data = decompressed;
+	return true;
+}
+
+static void PrefetchThread( void * data ) {
+	prefetch.ok = DecompressBSP( prefetch.entry->map.name, prefetch.compressed, &prefetch.data );
+	prefetch.done.store( true, std::memory_order_release );
+}
+
+static void FinishPrefetch() {
+	JoinThread( prefetch.thread );
+	prefetch.thread = NULL;
+	FREE( sys_allocator, prefetch.compressed.ptr );
+
+	MapEntry * entry = prefetch.entry;
+	if( !prefetch.ok ) {
+		entry->state = MapState_Broken;
+		return;
+	}
+
+	entry->map.data = prefetch.data;
+	entry->state = MapState_Decompressed;
+	entry->last_used = ++map_use_counter;
+	ShareBSP( entry->map.base_hash, entry->map.data );
+}
+
+static void StartPrefetch( u64 base_hash ) {
+	if( prefetch.thread != NULL )
+		return;
+
+	u64 idx;
+	if( !maps_hashtable.get( base_hash, &idx ) || maps[ idx ].state != MapState_Unloaded )
+		return;
+
+	// copy it so hotloading can't free it from under the prefetch thread
+	Span< const u8 > compressed = AssetBinary( maps[ idx ].map.name );
+	prefetch.compressed = ALLOC_SPAN( sys_allocator, u8, compressed.n );
+	memcpy( prefetch.compressed.ptr, compressed.ptr, compressed.n );
+
+	prefetch.entry = &maps[ idx ];
+	prefetch.entry->state = MapState_Prefetching;
+	prefetch.done.store( false, std::memory_order_relaxed );
+	prefetch.thread = NewThread( PrefetchThread );
+}
+
+static u64 NextMapInRotation( u64 base_hash ) {
+	// we can only see the local rotation, so this only helps listen servers
+	const char * seps = " ,\n\r";
+	const char * cursor = Cvar_String( "g_maplist" );
+	u64 maps_prefix = Hash64( "maps/", strlen( "maps/" ) );
+
+	u64 first = 0;
+	bool found = false;
+	while( true ) {
+		cursor += strspn( cursor, seps );
+		if( *cursor == '\0' )
+			break;
+
+		size_t len = strcspn( cursor, seps );
+		u64 hash = Hash64( cursor, len, maps_prefix );
+		cursor += len;
+
+		if( found )
+			return hash;
+		if( first == 0 )
+			first = hash;
+		found = hash == base_hash;
+	}
+
+	return found ? first : 0;
+}
+
+static void UnloadMap( MapEntry * entry ) {
+	ZoneScoped;
+
+	if( entry->state == MapState_Loaded ) {
+		UnloadBSPRenderData( &entry->map );
+		CM_Free( CM_Client, entry->map.cms );
+		entry->map.cms = NULL;
+	}
+
+	UnshareBSP( entry->map.base_hash );
+	FREE( sys_allocator, const_cast< u8 * >( entry->map.data.ptr ) );
+	entry->map.data = Span< const u8 >();
+	entry->state = MapState_Unloaded;
+}
+
+static bool LoadMap( MapEntry * entry ) {
+	ZoneScoped;
+	ZoneText( entry->map.name, strlen( entry->map.name ) );
+
+	if( entry->state == MapState_Prefetching ) {
+		FinishPrefetch();
+	}
+
+	if( entry->state == MapState_Unloaded ) {
+		Span< u8 > data;
+		if( !DecompressBSP( entry->map.name, AssetBinary( entry->map.name ), &data ) ) {
+			entry->state = MapState_Broken;
+			return false;
 		}
 
-		Span< u8 > decompressed;
-		defer { FREE( sys_allocator, decompressed.ptr ); };
-		bool ok = Decompress( path, sys_allocator, compressed, &decompressed );
-		if( !ok )
-			continue;
+		entry->map.data = data;
+		entry->state = MapState_Decompressed;
+		ShareBSP( entry->map.base_hash, entry->map.data );
+	}
+
+	if( entry->state != MapState_Decompressed )
+		return entry->state == MapState_Loaded;
+
+	// CM_LoadMap drops with Com_Error on bad lumps, which longjmps, so it has
+	// to run on the main thread and before any render jobs are in flight
+	entry->map.cms = CM_LoadMap( CM_Client, entry->map.data, entry->map.base_hash );
+	if( entry->map.cms == NULL || !LoadBSPRenderData( &entry->map, entry->map.base_hash, entry->map.data ) ) {
+		if( entry->map.cms != NULL ) {
+			CM_Free( CM_Client, entry->map.cms );
+			entry->map.cms = NULL;
+		}
+		UnloadMap( entry );
+		entry->state = MapState_Broken;
+		return false;
+	}
+
+	// nothing points into the BSP once it's loaded, so only prefetched maps
+	// stay decompressed for a listen server to pick up
+	UnshareBSP( entry->map.base_hash );
+	FREE( sys_allocator, const_cast< u8 * >( entry->map.data.ptr ) );
+	entry->map.data = Span< const u8 >();
+
+	entry->state = MapState_Loaded;
+	return true;
+}
+
+static void EvictMaps() {
+	while( true ) {
+		u32 resident = 0;
+		MapEntry * lru = NULL;
+
+		for( u32 i = 0; i < num_maps; i++ ) {
+			MapEntry * entry = &maps[ i ];
+			if( entry->state != MapState_Decompressed && entry->state != MapState_Loaded )
+				continue;
+
+			resident++;
+			if( entry != current_map && ( lru == NULL || entry->last_used < lru->last_used ) ) {
+				lru = entry;
+			}
+		}
+
+		if( resident <= MAX_RESIDENT_MAPS || lru == NULL )
+			return;
+
+		UnloadMap( lru );
+	}
+}
 
-		Span< const u8 > data = decompressed.ptr == NULL ? compressed : decompressed;
+void InitMaps() {
+	ZoneScoped;
 
-		maps[ num_maps ].name = CopyString( sys_allocator, path );
-		u64 base_hash = Hash64( path, strlen( path ) - ext.n );
+	num_maps = 0;
+	current_map = NULL;
+	map_use_counter = 0;
 
-		if( !LoadBSPRenderData( &maps[ num_maps ], base_hash, data ) )
+	// maps get loaded the first time they're needed
+	for( const char * path : AssetPaths() ) {
+		Span< const char > ext = FileExtension( path );
+		if( ext != ".bsp" || num_maps == MAX_MAPS )
 			continue;
 
-		maps[ num_maps ].cms = CM_LoadMap( CM_Client, data, base_hash );
-		if( maps[ num_maps ].cms == NULL )
-			// TODO: free render data
+		if( AssetBinary( path ).n < 4 ) {
+			Com_Printf( S_COLOR_RED "BSP too small %s\n", path );
 			continue;
+		}
+
+		MapEntry * entry = &maps[ num_maps ];
+		*entry = { };
+		entry->map.name = CopyString( sys_allocator, path );
+		entry->map.base_hash = Hash64( path, strlen( path ) - ext.n );
+		entry->state = MapState_Unloaded;
 
-		maps_hashtable.add( base_hash, num_maps );
+		maps_hashtable.add( entry->map.base_hash, num_maps );
 		num_maps++;
 	}
-
 }
 
 void ShutdownMaps() {
+	if( prefetch.thread != NULL ) {
+		FinishPrefetch();
+	}
+
 	for( u32 i = 0; i < num_maps; i++ ) {
-		FREE( sys_allocator, const_cast< char * >( maps[ i ].name ) );
-		CM_Free( CM_Client, maps[ i ].cms );
+		if( maps[ i ].state == MapState_Decompressed || maps[ i ].state == MapState_Loaded ) {
+			UnloadMap( &maps[ i ] );
+		}
+		FREE( sys_allocator, const_cast< char * >( maps[ i ].map.name ) );
 	}
+
+	maps_hashtable.clear();
+	num_maps = 0;
+	current_map = NULL;
 }
 
 const Map * FindMap( StringHash name ) {
+	if( prefetch.thread != NULL && prefetch.done.load( std::memory_order_acquire ) ) {
+		FinishPrefetch();
+		EvictMaps();
+	}
+
 	u64 idx;
 	if( !maps_hashtable.get( name.hash, &idx ) )
 		return NULL;
-	return &maps[ idx ];
+
+	MapEntry * entry = &maps[ idx ];
+	if( entry->state != MapState_Loaded && !LoadMap( entry ) )
+		return NULL;
+
+	entry->last_used = ++map_use_counter;
+
+	if( entry != current_map ) {
+		current_map = entry;
+		EvictMaps();
+		StartPrefetch( NextMapInRotation( entry->map.base_hash ) );
+	}
+
+	return &entry->map;
 }
 
 const Map * FindMap( const char * name ) {
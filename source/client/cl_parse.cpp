@@ -793,6 +793,18 @@ static void CL_ParseFrame( msg_t *msg ) {
 										 cl.configstrings[0], cl_baselines );
 
 				// the rest of the demo file will be individual frames
+				cls.demo.last_keyframe = snap->serverTime;
+			} else if( !cls.demo.waiting ) {
+				// periodically ask for a nodelta frame and mark it as a keyframe
+				bool keyframe_due = snap->serverTime - cls.demo.last_keyframe >= SNAP_DEMO_KEYFRAME_INTERVAL;
+				if( keyframe_due && !snap->delta ) {
+					SNAP_RecordDemoKeyframe( cls.demo.file, snap->serverTime, cl.configstrings[0] );
+					cls.demo.last_keyframe = snap->serverTime;
+					cls.demo.keyframe_requested = false;
+				} else if( keyframe_due && !cls.demo.keyframe_requested ) {
+					CL_AddReliableCommand( "nodelta" );
+					cls.demo.keyframe_requested = true;
+				}
 			}
 
 			if( !cls.demo.waiting ) {
@@ -889,6 +901,14 @@ typedef struct {
 	void ( *func )( void );
 } svcmd_t;
 
+/*
+* CL_DemoKeyframe_f
+*
+* demo seeking marker, nothing to do when it's played back
+*/
+static void CL_DemoKeyframe_f( void ) {
+}
+
 svcmd_t svcmds[] =
 {
 	{ "forcereconnect", CL_Reconnect_f },
@@ -899,6 +919,7 @@ svcmd_t svcmds[] =
 	{ "cs", CL_ParseConfigstringCommand },
 	{ "disconnect", CL_ServerDisconnect_f },
 	{ "initdownload", CL_InitDownload_f },
+	{ "keyframe", CL_DemoKeyframe_f },
 
 	{ NULL, NULL }
 };
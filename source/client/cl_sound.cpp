@@ -8,20 +8,20 @@
 #include "client/client.h"
 #include "client/assets.h"
 #include "client/sound.h"
+#include "client/mixer.h"
 #include "client/threadpool.h"
 #include "gameshared/gs_public.h"
 
-#define AL_LIBTYPE_STATIC
-#include "openal/al.h"
-#include "openal/alc.h"
-#include "openal/alext.h"
-
 #define STB_VORBIS_HEADER_ONLY
 #include "stb/stb_vorbis.h"
 
 struct Sound {
-	ALuint buf;
+	s16 * samples;
+	u32 num_frames;
+	u32 sample_rate;
 	bool mono;
+
+	Span< u8 > ogg; // set for streamed sounds
 };
 
 struct SoundEffect {
@@ -62,7 +62,7 @@ struct PlayingSound {
 	Vec3 origin;
 	Vec3 end;
 
-	ALuint sources[ ARRAY_COUNT( &SoundEffect::sounds ) ];
+	MixerVoice voices[ ARRAY_COUNT( &SoundEffect::sounds ) ];
 	bool started[ ARRAY_COUNT( &SoundEffect::sounds ) ];
 	bool stopped[ ARRAY_COUNT( &SoundEffect::sounds ) ];
 };
@@ -72,9 +72,6 @@ struct EntitySound {
 	Vec3 velocity;
 };
 
-static ALCdevice * al_device;
-static ALCcontext * al_context;
-
 // so we don't crash when some other application is running in exclusive playback mode (WASAPI/JACK/etc)
 static bool initialized;
 
@@ -85,6 +82,7 @@ static cvar_t * s_muteinbackground;
 constexpr u32 MAX_SOUND_ASSETS = 4096;
 constexpr u32 MAX_SOUND_EFFECTS = 4096;
 constexpr u32 MAX_PLAYING_SOUNDS = 128;
+constexpr u32 STREAM_SOUND_SECONDS = 10;
 
 static Sound sounds[ MAX_SOUND_ASSETS ];
 static u32 num_sounds;
@@ -94,144 +92,19 @@ static SoundEffect sound_effects[ MAX_SOUND_EFFECTS ];
 static u32 num_sound_effects;
 static Hashtable< MAX_SOUND_EFFECTS * 2 > sound_effects_hashtable;
 
-static ALuint free_sound_sources[ MAX_PLAYING_SOUNDS ];
-static u32 num_free_sound_sources;
-
 static PlayingSound playing_sound_effects[ MAX_PLAYING_SOUNDS ];
 static u32 num_playing_sound_effects;
 
 static Hashtable< MAX_PLAYING_SOUNDS * 2 > immediate_sounds_hashtable;
 static u64 immediate_sounds_autoinc;
 
-static ALuint music_source;
+static MixerVoice music_voice;
 static bool music_playing;
 
 static bool window_focused;
 
 static EntitySound entities[ MAX_EDICTS ];
 
-const char *S_ErrorMessage( ALenum error ) {
-	switch( error ) {
-		case AL_NO_ERROR:
-			return "No error";
-		case AL_INVALID_NAME:
-			return "Invalid name";
-		case AL_INVALID_ENUM:
-			return "Invalid enumerator";
-		case AL_INVALID_VALUE:
-			return "Invalid value";
-		case AL_INVALID_OPERATION:
-			return "Invalid operation";
-		case AL_OUT_OF_MEMORY:
-			return "Out of memory";
-		default:
-			return "Unknown error";
-	}
-}
-
-static void CheckALErrors() {
-	ALenum err = alGetError();
-	if( err != AL_NO_ERROR ) {
-		Sys_Error( "%s", S_ErrorMessage( err ) );
-	}
-}
-
-static void CheckedALListener( ALenum param, float x ) {
-	alListenerf( param, x );
-	CheckALErrors();
-}
-
-static void CheckedALListener( ALenum param, Vec3 v ) {
-	alListenerfv( param, v.ptr() );
-	CheckALErrors();
-}
-
-static void CheckedALListener( ALenum param, const mat3_t m ) {
-	float forward_and_up[ 6 ];
-	forward_and_up[ 0 ] = m[ AXIS_FORWARD ];
-	forward_and_up[ 1 ] = m[ AXIS_FORWARD + 1 ];
-	forward_and_up[ 2 ] = m[ AXIS_FORWARD + 2 ];
-	forward_and_up[ 3 ] = m[ AXIS_UP ];
-	forward_and_up[ 4 ] = m[ AXIS_UP + 1 ];
-	forward_and_up[ 5 ] = m[ AXIS_UP + 2 ];
-	alListenerfv( param, forward_and_up );
-	CheckALErrors();
-}
-
-static ALint CheckedALGetSource( ALuint source, ALenum param ) {
-	ALint res;
-	alGetSourcei( source, param, &res );
-	CheckALErrors();
-	return res;
-}
-
-static void CheckedALSource( ALuint source, ALenum param, ALint x ) {
-	alSourcei( source, param, x );
-	CheckALErrors();
-}
-
-static void CheckedALSource( ALuint source, ALenum param, ALuint x ) {
-	alSourcei( source, param, x );
-	CheckALErrors();
-}
-
-static void CheckedALSource( ALuint source, ALenum param, float x ) {
-	alSourcef( source, param, x );
-	CheckALErrors();
-}
-
-static void CheckedALSource( ALuint source, ALenum param, Vec3 v ) {
-	alSourcefv( source, param, v.ptr() );
-	CheckALErrors();
-}
-
-static void CheckedALSourcePlay( ALuint source ) {
-	alSourcePlay( source );
-	CheckALErrors();
-}
-
-static void CheckedALSourceStop( ALuint source ) {
-	alSourceStop( source );
-	CheckALErrors();
-}
-
-static bool S_InitAL() {
-	ZoneScoped;
-
-	al_device = alcOpenDevice( NULL );
-	if( al_device == NULL ) {
-		Com_Printf( S_COLOR_RED "Failed to open device\n" );
-		return false;
-	}
-
-	ALCint attrs[] = { ALC_HRTF_SOFT, ALC_HRTF_ENABLED_SOFT, 0 };
-	al_context = alcCreateContext( al_device, attrs );
-	if( al_context == NULL ) {
-		alcCloseDevice( al_device );
-		Com_Printf( S_COLOR_RED "Failed to create context\n" );
-		return false;
-	}
-	alcMakeContextCurrent( al_context );
-
-	alDopplerFactor( 1.0f );
-	alDopplerVelocity( 10976.0f );
-	alSpeedOfSound( 10976.0f );
-
-	alDistanceModel( AL_INVERSE_DISTANCE_CLAMPED );
-
-	alGenSources( ARRAY_COUNT( free_sound_sources ), free_sound_sources );
-	alGenSources( 1, &music_source );
-	num_free_sound_sources = ARRAY_COUNT( free_sound_sources );
-
-	if( alGetError() != AL_NO_ERROR ) {
-		Com_Printf( S_COLOR_RED "Failed to allocate sound sources\n" );
-		S_Shutdown();
-		return false;
-	}
-
-	return true;
-}
-
 struct DecodeSoundJob {
 	struct {
 		const char * path;
@@ -239,23 +112,58 @@ struct DecodeSoundJob {
 	} in;
 
 	struct {
+		bool ok;
+		bool stream;
 		int channels;
 		int sample_rate;
-		int num_samples;
+		u32 num_frames;
 		s16 * samples;
 	} out;
 };
 
-static void AddSound( const char * path, int num_samples, int channels, int sample_rate, s16 * samples ) {
+/*
+ * short sounds get decoded up front, long ones (music etc) get decoded by
+ * the mixer as they play so we don't keep minutes of PCM around
+ */
+static void DecodeSound( DecodeSoundJob * job ) {
 	ZoneScoped;
-	ZoneText( path, strlen( path ) );
+	ZoneText( job->in.path, strlen( job->in.path ) );
+
+	job->out = { };
+
+	stb_vorbis * decoder = stb_vorbis_open_memory( job->in.ogg.ptr, job->in.ogg.num_bytes(), NULL, NULL );
+	if( decoder == NULL )
+		return;
+	defer { stb_vorbis_close( decoder ); };
+
+	stb_vorbis_info info = stb_vorbis_get_info( decoder );
+	u32 num_frames = stb_vorbis_stream_length_in_samples( decoder );
+
+	job->out.ok = true;
+	job->out.channels = Min2( info.channels, 2 );
+	job->out.sample_rate = info.sample_rate;
+	job->out.num_frames = num_frames;
+
+	if( num_frames > info.sample_rate * STREAM_SOUND_SECONDS ) {
+		job->out.stream = true;
+		return;
+	}
+
+	int num_samples = num_frames * job->out.channels;
+	job->out.samples = ALLOC_MANY( sys_allocator, s16, num_samples );
+	job->out.num_frames = stb_vorbis_get_samples_short_interleaved( decoder, job->out.channels, job->out.samples, num_samples );
+}
 
-	if( num_samples == -1 ) {
-		Com_Printf( S_COLOR_RED "Couldn't decode sound %s\n", path );
+static void AddSound( const DecodeSoundJob & job ) {
+	ZoneScoped;
+	ZoneText( job.in.path, strlen( job.in.path ) );
+
+	if( !job.out.ok ) {
+		Com_Printf( S_COLOR_RED "Couldn't decode sound %s\n", job.in.path );
 		return;
 	}
 
-	u64 hash = Hash64( path, strlen( path ) - strlen( ".ogg" ) );
+	u64 hash = Hash64( job.in.path, strlen( job.in.path ) - strlen( ".ogg" ) );
 
 	bool restart_music = false;
 
@@ -282,21 +190,34 @@ static void AddSound( const char * path, int num_samples, int channels, int samp
 	else {
 		restart_music = music_playing;
 		S_StopAllSounds( true );
-		alDeleteBuffers( 1, &sounds[ idx ].buf );
+		// leak the old samples rather than free them under the audio thread
+		if( MixerFlush() ) {
+			FREE( sys_allocator, sounds[ idx ].samples );
+			FREE( sys_allocator, sounds[ idx ].ogg.ptr );
+		}
+		else {
+			Com_Printf( S_COLOR_YELLOW "Audio thread is stuck, leaking %s\n", job.in.path );
+		}
 	}
 
-	ALenum format = channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
-	alGenBuffers( 1, &sounds[ idx ].buf );
-	alBufferData( sounds[ idx ].buf, format, samples, num_samples * channels * sizeof( s16 ), sample_rate );
-	CheckALErrors();
+	// the mixer reads straight out of these so we hang on to them
+	Sound * sound = &sounds[ idx ];
+	*sound = { };
+	sound->samples = job.out.samples;
+	sound->num_frames = job.out.num_frames;
+	sound->sample_rate = job.out.sample_rate;
+	sound->mono = job.out.channels == 1;
 
-	sounds[ idx ].mono = channels == 1;
+	// take a copy of streamed sounds because hotloading frees the asset
+	// before we get a chance to stop the stream
+	if( job.out.stream ) {
+		sound->ogg = ALLOC_SPAN( sys_allocator, u8, job.in.ogg.n );
+		memcpy( sound->ogg.ptr, job.in.ogg.ptr, job.in.ogg.num_bytes() );
+	}
 
 	if( restart_music ) {
 		S_StartMenuMusic();
 	}
-
-	free( samples );
 }
 
 static void LoadSounds() {
@@ -322,17 +243,23 @@ static void LoadSounds() {
 	}
 
 	ParallelFor( jobs.span(), []( TempAllocator * temp, void * data ) {
-		DecodeSoundJob * job = ( DecodeSoundJob * ) data;
-
-		ZoneScopedN( "stb_vorbis_decode_memory" );
-		ZoneText( job->in.path, strlen( job->in.path ) );
-
-		job->out.num_samples = stb_vorbis_decode_memory( job->in.ogg.ptr, job->in.ogg.num_bytes(), &job->out.channels, &job->out.sample_rate, &job->out.samples );
+		DecodeSound( ( DecodeSoundJob * ) data );
 	} );
 
-	for( DecodeSoundJob job : jobs ) {
-		AddSound( job.in.path, job.out.num_samples, job.out.channels, job.out.sample_rate, job.out.samples );
+	size_t resident = 0;
+	size_t streamed = 0;
+	for( const DecodeSoundJob & job : jobs ) {
+		AddSound( job );
+
+		if( job.out.stream ) {
+			streamed += job.in.ogg.num_bytes();
+		}
+		else {
+			resident += job.out.num_frames * job.out.channels * sizeof( s16 );
+		}
 	}
+
+	Com_Printf( "Loaded %zu sounds, %zuKB decoded, %zuKB streamed\n", jobs.size(), resident / 1024, streamed / 1024 );
 }
 
 static void HotloadSounds() {
@@ -340,17 +267,12 @@ static void HotloadSounds() {
 
 	for( const char * path : ModifiedAssetPaths() ) {
 		if( FileExtension( path ) == ".ogg" ) {
-			Span< const u8 > ogg = AssetBinary( path );
-
-			int num_samples, channels, sample_rate;
-			s16 * samples;
-			{
-				ZoneScopedN( "stb_vorbis_decode_memory" );
-				ZoneText( path, strlen( path ) );
-				num_samples = stb_vorbis_decode_memory( ogg.ptr, ogg.num_bytes(), &channels, &sample_rate, &samples );
-			}
+			DecodeSoundJob job;
+			job.in.path = path;
+			job.in.ogg = AssetBinary( path );
 
-			AddSound( path, num_samples, channels, sample_rate, samples );
+			DecodeSound( &job );
+			AddSound( job );
 		}
 	}
 }
@@ -519,7 +441,8 @@ bool S_Init() {
 	s_muteinbackground = Cvar_Get( "s_muteinbackground", "1", CVAR_ARCHIVE );
 	s_muteinbackground->modified = true;
 
-	if( !S_InitAL() )
+	// +1 for music
+	if( !InitMixer( MAX_PLAYING_SOUNDS + 1 ) )
 		return false;
 
 	LoadSounds();
@@ -540,17 +463,12 @@ void S_Shutdown() {
 
 	Cmd_RemoveCommand( "playsound" );
 
-	alDeleteSources( ARRAY_COUNT( free_sound_sources ), free_sound_sources );
-	alDeleteSources( 1, &music_source );
+	ShutdownMixer();
 
 	for( u32 i = 0; i < num_sounds; i++ ) {
-		alDeleteBuffers( 1, &sounds[ i ].buf );
+		FREE( sys_allocator, sounds[ i ].samples );
+		FREE( sys_allocator, sounds[ i ].ogg.ptr );
 	}
-
-	CheckALErrors();
-
-	alcDestroyContext( al_context );
-	alcCloseDevice( al_device );
 }
 
 static bool FindSound( StringHash name, Sound * sound ) {
@@ -561,6 +479,16 @@ static bool FindSound( StringHash name, Sound * sound ) {
 	return true;
 }
 
+static MixerSound ToMixerSound( const Sound & sound ) {
+	MixerSound mixer_sound;
+	mixer_sound.samples = sound.samples;
+	mixer_sound.num_frames = sound.num_frames;
+	mixer_sound.sample_rate = sound.sample_rate;
+	mixer_sound.mono = sound.mono;
+	mixer_sound.ogg = sound.ogg;
+	return mixer_sound;
+}
+
 const SoundEffect * FindSoundEffect( StringHash name ) {
 	u64 idx;
 	if( !initialized || !sound_effects_hashtable.get( name.hash, &idx ) )
@@ -588,63 +516,43 @@ static bool StartSound( PlayingSound * ps, u8 i ) {
 	if( !FindSound( config.sounds[ idx ], &sound ) )
 		return false;
 
-	if( num_free_sound_sources == 0 ) {
-		Com_Printf( S_COLOR_YELLOW "Too many playing sounds!\n" );
-		return false;
-	}
-
 	if( !sound.mono && ps->type != PlayingSoundType_Global ) {
 		Com_Printf( S_COLOR_YELLOW "Positioned sounds must be mono!\n" );
 		return false;
 	}
 
-	num_free_sound_sources--;
-	ALuint source = free_sound_sources[ num_free_sound_sources ];
-	ps->sources[ i ] = source;
+	MixerSound mixer_sound = ToMixerSound( sound );
 
-	CheckedALSource( source, AL_BUFFER, sound.buf );
-	CheckedALSource( source, AL_GAIN, ps->volume * config.volume * s_volume->value );
-	CheckedALSource( source, AL_REFERENCE_DISTANCE, S_DEFAULT_ATTENUATION_REFDISTANCE );
-	CheckedALSource( source, AL_MAX_DISTANCE, S_DEFAULT_ATTENUATION_MAXDISTANCE );
-	CheckedALSource( source, AL_ROLLOFF_FACTOR, config.attenuation );
+	MixerVoiceConfig voice_config = { };
+	voice_config.gain = ps->volume * config.volume * s_volume->value;
+	voice_config.attenuation = config.attenuation;
+	voice_config.looping = ps->immediate_handle.x != 0;
 
 	switch( ps->type ) {
 		case PlayingSoundType_Global:
-			CheckedALSource( source, AL_POSITION, Vec3( 0.0f ) );
-			CheckedALSource( source, AL_VELOCITY, Vec3( 0.0f ) );
-			CheckedALSource( source, AL_SOURCE_RELATIVE, AL_TRUE );
+			voice_config.global = true;
 			break;
 
 		case PlayingSoundType_Position:
-			CheckedALSource( source, AL_POSITION, ps->origin );
-			CheckedALSource( source, AL_VELOCITY, Vec3( 0.0f ) );
-			CheckedALSource( source, AL_SOURCE_RELATIVE, AL_FALSE );
+		case PlayingSoundType_Line:
+			voice_config.origin = ps->origin;
 			break;
 
 		case PlayingSoundType_Entity:
-			CheckedALSource( source, AL_POSITION, entities[ ps->ent_num ].origin );
-			CheckedALSource( source, AL_VELOCITY, entities[ ps->ent_num ].velocity );
-			CheckedALSource( source, AL_SOURCE_RELATIVE, AL_FALSE );
-			break;
-
-		case PlayingSoundType_Line:
-			CheckedALSource( source, AL_POSITION, ps->origin );
-			CheckedALSource( source, AL_VELOCITY, Vec3( 0.0f ) ); // TODO
-			CheckedALSource( source, AL_SOURCE_RELATIVE, AL_FALSE );
+			voice_config.origin = entities[ ps->ent_num ].origin;
 			break;
 	}
 
-	CheckedALSource( source, AL_LOOPING, ps->immediate_handle.x == 0 ? AL_FALSE : AL_TRUE );
-	CheckedALSourcePlay( source );
+	if( !MixerPlay( mixer_sound, voice_config, &ps->voices[ i ] ) ) {
+		Com_Printf( S_COLOR_YELLOW "Too many playing sounds!\n" );
+		return false;
+	}
 
 	return true;
 }
 
 static void StopSound( PlayingSound * ps, u8 i ) {
-	CheckedALSourceStop( ps->sources[ i ] );
-	CheckedALSource( ps->sources[ i ], AL_BUFFER, 0 );
-	free_sound_sources[ num_free_sound_sources ] = ps->sources[ i ];
-	num_free_sound_sources++;
+	MixerStop( ps->voices[ i ] );
 	ps->stopped[ i ] = true;
 }
 
@@ -657,11 +565,10 @@ void S_Update( Vec3 origin, Vec3 velocity, const mat3_t axis ) {
 	HotloadSounds();
 	HotloadSoundEffects();
 
-	CheckedALListener( AL_GAIN, IsWindowFocused() || s_muteinbackground->integer == 0 ? 1 : 0 );
-
-	CheckedALListener( AL_POSITION, origin );
-	CheckedALListener( AL_VELOCITY, velocity );
-	CheckedALListener( AL_ORIENTATION, axis );
+	Vec3 forward = Vec3( axis[ AXIS_FORWARD ], axis[ AXIS_FORWARD + 1 ], axis[ AXIS_FORWARD + 2 ] );
+	Vec3 up = Vec3( axis[ AXIS_UP ], axis[ AXIS_UP + 1 ], axis[ AXIS_UP + 2 ] );
+	float listener_gain = IsWindowFocused() || s_muteinbackground->integer == 0 ? 1.0f : 0.0f;
+	MixerSetListener( origin, forward, up, listener_gain );
 
 	for( size_t i = 0; i < num_playing_sound_effects; i++ ) {
 		PlayingSound * ps = &playing_sound_effects[ i ];
@@ -676,8 +583,7 @@ void S_Update( Vec3 origin, Vec3 velocity, const mat3_t axis ) {
 				if( ps->stopped[ j ] )
 					continue;
 
-				ALint state = CheckedALGetSource( ps->sources[ j ], AL_SOURCE_STATE );;
-				if( not_touched || state == AL_STOPPED ) {
+				if( not_touched || MixerVoiceFinished( ps->voices[ j ] ) ) {
 					StopSound( ps, j );
 				}
 				else {
@@ -722,22 +628,21 @@ void S_Update( Vec3 origin, Vec3 velocity, const mat3_t axis ) {
 				continue;
 
 			if( s_volume->modified ) {
-				CheckedALSource( ps->sources[ j ], AL_GAIN, ps->volume * ps->sfx->sounds[ j ].volume * s_volume->value );
+				MixerSetGain( ps->voices[ j ], ps->volume * ps->sfx->sounds[ j ].volume * s_volume->value );
 			}
 
 			if( ps->type == PlayingSoundType_Entity ) {
-				CheckedALSource( ps->sources[ j ], AL_POSITION, entities[ ps->ent_num ].origin );
-				CheckedALSource( ps->sources[ j ], AL_VELOCITY, entities[ ps->ent_num ].velocity );
+				MixerSetPosition( ps->voices[ j ], entities[ ps->ent_num ].origin );
 			}
 			else if( ps->type == PlayingSoundType_Line ) {
 				Vec3 p = ClosestPointOnSegment( ps->origin, ps->end, origin );
-				CheckedALSource( ps->sources[ j ], AL_POSITION, p );
+				MixerSetPosition( ps->voices[ j ], p );
 			}
 		}
 	}
 
 	if( ( s_volume->modified || s_musicvolume->modified ) && music_playing ) {
-		CheckedALSource( music_source, AL_GAIN, s_volume->value * s_musicvolume->value );
+		MixerSetGain( music_voice, s_volume->value * s_musicvolume->value );
 	}
 
 	s_volume->modified = false;
@@ -920,20 +825,19 @@ void S_StartMenuMusic() {
 	if( music_playing )
 		return;
 
-	CheckedALSource( music_source, AL_GAIN, s_volume->value * s_musicvolume->value );
-	CheckedALSource( music_source, AL_DIRECT_CHANNELS_SOFT, AL_TRUE );
-	CheckedALSource( music_source, AL_LOOPING, AL_TRUE );
-	CheckedALSource( music_source, AL_BUFFER, sound.buf );
+	MixerSound mixer_sound = ToMixerSound( sound );
 
-	CheckedALSourcePlay( music_source );
+	MixerVoiceConfig config = { };
+	config.gain = s_volume->value * s_musicvolume->value;
+	config.global = true;
+	config.looping = true;
 
-	music_playing = true;
+	music_playing = MixerPlay( mixer_sound, config, &music_voice );
 }
 
 void S_StopBackgroundTrack() {
 	if( initialized && music_playing ) {
-		CheckedALSourceStop( music_source );
-		CheckedALSource( music_source, AL_BUFFER, 0 );
+		MixerStop( music_voice );
 	}
 	music_playing = false;
 }
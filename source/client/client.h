@@ -153,6 +153,8 @@ typedef struct {
 	time_t localtime;       // time of day of demo recording
 	int64_t time;           // milliseconds passed since the start of the demo
 	int64_t duration, basetime;
+	int64_t last_keyframe;
+	bool keyframe_requested;
 
 	bool play_jump;
 	bool play_jump_latched;
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "client/client.h"
 
 static char *keybindings[256];
+static u32 bindings_version;
 static bool keydown[256];
 
 struct keyname_t {
@@ -158,6 +159,12 @@ void Key_SetBinding( int keynum, const char *binding ) {
 	if( binding != NULL ) {
 		keybindings[keynum] = ZoneCopyString( binding );
 	}
+
+	bindings_version++;
+}
+
+u32 Key_BindingsVersion() {
+	return bindings_version;
 }
 
 static void Key_Unbind_f() {
@@ -119,6 +119,7 @@ void Key_Shutdown();
 void Key_WriteBindings( int file );
 void Key_SetBinding( int keynum, const char *binding );
 const char *Key_GetBindingBuf( int binding );
+u32 Key_BindingsVersion(); // changes whenever a binding does
 void Key_ClearStates();
 
 const char *Key_KeynumToString( int keynum );
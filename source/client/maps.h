@@ -14,6 +14,8 @@ struct Map {
 	float fog_strength;
 
 	CollisionModel * cms;
+
+	Span< const u8 > data; // decompressed BSP until the map is loaded, shared with a listen server
 };
 
 void InitMaps();
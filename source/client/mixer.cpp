@@ -0,0 +1,668 @@
+#include <atomic>
+#include <emmintrin.h>
+
+#include "qcommon/base.h"
+#include "qcommon/qcommon.h"
+#include "qcommon/threads.h"
+#include "client/mixer.h"
+
+#define AL_LIBTYPE_STATIC
+#include "openal/al.h"
+#include "openal/alc.h"
+#include "openal/alext.h"
+
+#define STB_VORBIS_HEADER_ONLY
+#include "stb/stb_vorbis.h"
+
+static constexpr u32 MAX_MIXER_VOICES = 256;
+static constexpr u32 MIXER_CHUNK_FRAMES = 512;
+static constexpr u32 MIXER_STREAM_BUFFERS = 4; // ~45ms of latency at 44.1kHz
+static constexpr u32 MIXER_COMMAND_QUEUE_SIZE = 4096;
+static constexpr u32 MAX_STREAMING_VOICES = 8;
+static constexpr u32 STREAM_BLOCK_FRAMES = 4096;
+static constexpr s64 MIXER_FLUSH_TIMEOUT = 500; // ms
+
+STATIC_ASSERT( MIXER_CHUNK_FRAMES % 4 == 0 );
+STATIC_ASSERT( IsPowerOf2( MIXER_COMMAND_QUEUE_SIZE ) );
+
+enum MixerCommandType {
+	MixerCommand_Play,
+	MixerCommand_Stop,
+	MixerCommand_SetGain,
+	MixerCommand_SetPosition,
+	MixerCommand_SetListener,
+};
+
+struct MixerCommand {
+	MixerCommandType type;
+	MixerVoice voice;
+
+	MixerSound sound;
+	MixerVoiceConfig config;
+
+	Vec3 origin;
+	Vec3 forward;
+	Vec3 up;
+	float gain;
+};
+
+// audio thread state
+struct Voice {
+	bool active;
+	u32 serial;
+
+	MixerSound sound;
+	MixerVoiceConfig config;
+
+	u64 cursor; // 32.32 fixed point frame index
+	u64 step;
+
+	// streamed voices decode into a block of sound.samples at a time
+	stb_vorbis * decoder;
+	u32 decode_slot;
+
+	float left_gain;
+	float right_gain;
+};
+
+struct Listener {
+	Vec3 origin;
+	Vec3 forward;
+	Vec3 up;
+	float gain;
+};
+
+static ALCdevice * al_device;
+static ALCcontext * al_context;
+static ALuint stream_source;
+static ALuint stream_buffers[ MIXER_STREAM_BUFFERS ];
+static u32 device_sample_rate;
+
+static Thread * audio_thread;
+static std::atomic< bool > audio_thread_running;
+
+// single producer (main thread), single consumer (audio thread)
+static MixerCommand command_queue[ MIXER_COMMAND_QUEUE_SIZE ];
+static std::atomic< u32 > command_queue_head; // written by the main thread
+static std::atomic< u32 > command_queue_tail; // written by the audio thread
+static std::atomic< u32 > commands_completed; // commands applied by the audio thread
+
+static std::atomic< u32 > finished_serials[ MAX_MIXER_VOICES ];
+
+// main thread voice allocation
+static u32 max_voices;
+static u32 free_voices[ MAX_MIXER_VOICES ];
+static u32 num_free_voices;
+static u32 voice_serial;
+
+// last gain/position sent for each voice, so we don't queue redundant updates
+static float sent_gain[ MAX_MIXER_VOICES ];
+static Vec3 sent_origin[ MAX_MIXER_VOICES ];
+
+// audio thread only
+static Voice voices[ MAX_MIXER_VOICES ];
+static Listener listener;
+alignas( 16 ) static float mix_buffer[ MIXER_CHUNK_FRAMES * 2 ];
+alignas( 16 ) static s16 output_buffer[ MIXER_CHUNK_FRAMES * 2 ];
+static s16 decode_buffers[ MAX_STREAMING_VOICES ][ STREAM_BLOCK_FRAMES * 2 ];
+static bool decode_buffer_used[ MAX_STREAMING_VOICES ];
+
+/*
+ * streaming
+ */
+
+static bool DecodeBlock( Voice * voice ) {
+	ZoneScoped;
+
+	int channels = voice->sound.mono ? 1 : 2;
+	s16 * buffer = decode_buffers[ voice->decode_slot ];
+
+	int frames = stb_vorbis_get_samples_short_interleaved( voice->decoder, channels, buffer, STREAM_BLOCK_FRAMES * channels );
+	if( frames == 0 && voice->config.looping ) {
+		stb_vorbis_seek_start( voice->decoder );
+		frames = stb_vorbis_get_samples_short_interleaved( voice->decoder, channels, buffer, STREAM_BLOCK_FRAMES * channels );
+	}
+
+	voice->sound.samples = buffer;
+	voice->sound.num_frames = frames;
+
+	return frames > 0;
+}
+
+static bool StartStream( Voice * voice ) {
+	u32 slot = 0;
+	while( slot < MAX_STREAMING_VOICES && decode_buffer_used[ slot ] ) {
+		slot++;
+	}
+	if( slot == MAX_STREAMING_VOICES )
+		return false;
+
+	voice->decoder = stb_vorbis_open_memory( voice->sound.ogg.ptr, voice->sound.ogg.num_bytes(), NULL, NULL );
+	if( voice->decoder == NULL )
+		return false;
+
+	voice->decode_slot = slot;
+	decode_buffer_used[ slot ] = true;
+
+	return DecodeBlock( voice );
+}
+
+static void ReleaseVoice( Voice * voice ) {
+	voice->active = false;
+
+	if( voice->decoder != NULL ) {
+		stb_vorbis_close( voice->decoder );
+		voice->decoder = NULL;
+		decode_buffer_used[ voice->decode_slot ] = false;
+	}
+}
+
+// moves the cursor into the next block, returns false when the voice is done
+static bool NextBlock( Voice * voice ) {
+	voice->cursor -= u64( voice->sound.num_frames ) << 32;
+
+	if( voice->decoder == NULL )
+		return voice->config.looping;
+
+	return DecodeBlock( voice );
+}
+
+/*
+ * command queue
+ */
+
+static bool CommandQueueFull( u32 head ) {
+	return head - command_queue_tail.load( std::memory_order_acquire ) == MIXER_COMMAND_QUEUE_SIZE;
+}
+
+// gain/position updates get dropped when the queue is full, and the next
+// frame sends them again. everything else waits for the audio thread to
+// make space, which only happens if we push thousands of commands in a frame
+static bool PushCommand( const MixerCommand & command ) {
+	u32 head = command_queue_head.load( std::memory_order_relaxed );
+
+	if( command.type == MixerCommand_SetGain || command.type == MixerCommand_SetPosition ) {
+		if( CommandQueueFull( head ) )
+			return false;
+	}
+
+	while( CommandQueueFull( head ) ) {
+		Sys_Sleep( 1 );
+	}
+
+	command_queue[ head % MIXER_COMMAND_QUEUE_SIZE ] = command;
+	command_queue_head.store( head + 1, std::memory_order_release );
+
+	return true;
+}
+
+static void ApplyCommand( const MixerCommand & command ) {
+	Voice * voice = &voices[ command.voice.id ];
+
+	switch( command.type ) {
+		case MixerCommand_Play:
+			ReleaseVoice( voice );
+			*voice = { };
+			voice->active = true;
+			voice->serial = command.voice.serial;
+			voice->sound = command.sound;
+			voice->config = command.config;
+			voice->step = ( u64( command.sound.sample_rate ) << 32 ) / device_sample_rate;
+			voice->left_gain = -1.0f; // snap to the first computed gains
+
+			if( command.sound.samples == NULL && !StartStream( voice ) ) {
+				ReleaseVoice( voice );
+				finished_serials[ command.voice.id ].store( voice->serial, std::memory_order_release );
+			}
+			break;
+
+		case MixerCommand_Stop:
+			ReleaseVoice( voice );
+			break;
+
+		case MixerCommand_SetGain:
+			voice->config.gain = command.gain;
+			break;
+
+		case MixerCommand_SetPosition:
+			voice->config.origin = command.origin;
+			break;
+
+		case MixerCommand_SetListener:
+			listener.origin = command.origin;
+			listener.forward = command.forward;
+			listener.up = command.up;
+			listener.gain = command.gain;
+			break;
+	}
+}
+
+// mixing happens on this thread too, so once a command has been applied
+// nothing can read samples belonging to the voices it stopped
+static void DrainCommands() {
+	u32 tail = command_queue_tail.load( std::memory_order_relaxed );
+	u32 head = command_queue_head.load( std::memory_order_acquire );
+
+	while( tail != head ) {
+		ApplyCommand( command_queue[ tail % MIXER_COMMAND_QUEUE_SIZE ] );
+		tail++;
+	}
+
+	command_queue_tail.store( tail, std::memory_order_release );
+	commands_completed.store( tail, std::memory_order_release );
+}
+
+/*
+ * mixing
+ */
+
+// same as AL_INVERSE_DISTANCE_CLAMPED
+static float DistanceAttenuation( float distance, float rolloff ) {
+	float ref = S_DEFAULT_ATTENUATION_REFDISTANCE;
+	float d = Clamp( ref, distance, float( S_DEFAULT_ATTENUATION_MAXDISTANCE ) );
+	return ref / ( ref + rolloff * ( d - ref ) );
+}
+
+static void VoiceGains( const Voice * voice, float * left, float * right ) {
+	float gain = voice->config.gain;
+
+	if( voice->config.global ) {
+		*left = gain;
+		*right = gain;
+		return;
+	}
+
+	Vec3 dir = voice->config.origin - listener.origin;
+	float distance = Length( dir );
+	gain *= DistanceAttenuation( distance, voice->config.attenuation );
+
+	// constant power panning
+	float pan = 0.0f;
+	if( distance > 0.001f ) {
+		Vec3 listener_right = Cross( listener.forward, listener.up );
+		pan = Clamp( -1.0f, Dot( dir / distance, listener_right ), 1.0f );
+	}
+
+	float angle = ( pan + 1.0f ) * PI * 0.25f;
+	*left = gain * cosf( angle );
+	*right = gain * sinf( angle );
+}
+
+static __m128 LoadS16x4( const s16 * samples ) {
+	__m128i x = _mm_loadl_epi64( ( const __m128i * ) samples );
+	x = _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 );
+	return _mm_cvtepi32_ps( x );
+}
+
+/*
+ * mixes n frames starting at frame into mix, with the gains ramping by
+ * dl/dr per frame. only used when the sound is at the device rate, which
+ * is basically always
+ */
+static void MixFramesSIMD( const Voice * voice, u32 frame, float * mix, u32 n, float l, float r, float dl, float dr ) {
+	__m128 gl = _mm_setr_ps( l, l + dl, l + dl * 2.0f, l + dl * 3.0f );
+	__m128 gr = _mm_setr_ps( r, r + dr, r + dr * 2.0f, r + dr * 3.0f );
+	__m128 gl_step = _mm_set1_ps( dl * 4.0f );
+	__m128 gr_step = _mm_set1_ps( dr * 4.0f );
+
+	u32 simd_frames = n & ~3u;
+
+	if( voice->sound.mono ) {
+		const s16 * samples = voice->sound.samples + frame;
+		for( u32 i = 0; i < simd_frames; i += 4 ) {
+			__m128 s = LoadS16x4( samples + i );
+			__m128 sl = _mm_mul_ps( s, gl );
+			__m128 sr = _mm_mul_ps( s, gr );
+
+			float * out = mix + i * 2;
+			_mm_storeu_ps( out, _mm_add_ps( _mm_loadu_ps( out ), _mm_unpacklo_ps( sl, sr ) ) );
+			_mm_storeu_ps( out + 4, _mm_add_ps( _mm_loadu_ps( out + 4 ), _mm_unpackhi_ps( sl, sr ) ) );
+
+			gl = _mm_add_ps( gl, gl_step );
+			gr = _mm_add_ps( gr, gr_step );
+		}
+
+		for( u32 i = simd_frames; i < n; i++ ) {
+			float s = samples[ i ];
+			mix[ i * 2 + 0 ] += s * ( l + dl * i );
+			mix[ i * 2 + 1 ] += s * ( r + dr * i );
+		}
+	}
+	else {
+		const s16 * samples = voice->sound.samples + frame * 2;
+		for( u32 i = 0; i < simd_frames; i += 4 ) {
+			__m128 s01 = LoadS16x4( samples + i * 2 );
+			__m128 s23 = LoadS16x4( samples + i * 2 + 4 );
+
+			float * out = mix + i * 2;
+			_mm_storeu_ps( out, _mm_add_ps( _mm_loadu_ps( out ), _mm_mul_ps( s01, _mm_unpacklo_ps( gl, gr ) ) ) );
+			_mm_storeu_ps( out + 4, _mm_add_ps( _mm_loadu_ps( out + 4 ), _mm_mul_ps( s23, _mm_unpackhi_ps( gl, gr ) ) ) );
+
+			gl = _mm_add_ps( gl, gl_step );
+			gr = _mm_add_ps( gr, gr_step );
+		}
+
+		for( u32 i = simd_frames; i < n; i++ ) {
+			mix[ i * 2 + 0 ] += samples[ i * 2 + 0 ] * ( l + dl * i );
+			mix[ i * 2 + 1 ] += samples[ i * 2 + 1 ] * ( r + dr * i );
+		}
+	}
+}
+
+static float SampleLinear( const MixerSound & sound, u64 cursor, u32 channel, bool looping ) {
+	u32 frame = u32( cursor >> 32 );
+	float frac = float( cursor & U32_MAX ) * ( 1.0f / 4294967296.0f );
+
+	u32 next = frame + 1;
+	if( next == sound.num_frames )
+		next = looping ? 0 : frame;
+
+	u32 channels = sound.mono ? 1 : 2;
+	float a = sound.samples[ frame * channels + channel ];
+	float b = sound.samples[ next * channels + channel ];
+	return Lerp( a, frac, b );
+}
+
+// returns false when the voice has run out of samples
+static bool MixVoice( Voice * voice ) {
+	float target_left, target_right;
+	VoiceGains( voice, &target_left, &target_right );
+
+	if( voice->left_gain < 0.0f ) {
+		voice->left_gain = target_left;
+		voice->right_gain = target_right;
+	}
+
+	float l = voice->left_gain;
+	float r = voice->right_gain;
+	float dl = ( target_left - l ) / MIXER_CHUNK_FRAMES;
+	float dr = ( target_right - r ) / MIXER_CHUNK_FRAMES;
+
+	voice->left_gain = target_left;
+	voice->right_gain = target_right;
+
+	if( voice->step == U64( 1 ) << 32 ) {
+		u32 mixed = 0;
+		while( mixed < MIXER_CHUNK_FRAMES ) {
+			u32 frame = u32( voice->cursor >> 32 );
+			u32 n = Min2( MIXER_CHUNK_FRAMES - mixed, voice->sound.num_frames - frame );
+
+			MixFramesSIMD( voice, frame, mix_buffer + mixed * 2, n, l + dl * mixed, r + dr * mixed, dl, dr );
+
+			mixed += n;
+			voice->cursor += u64( n ) << 32;
+
+			if( voice->cursor >= u64( voice->sound.num_frames ) << 32 ) {
+				if( !NextBlock( voice ) )
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	// wrapping only makes sense when the whole sound is resident
+	bool wrap = voice->config.looping && voice->decoder == NULL;
+
+	for( u32 i = 0; i < MIXER_CHUNK_FRAMES; i++ ) {
+		float gl = l + dl * i;
+		float gr = r + dr * i;
+
+		if( voice->sound.mono ) {
+			float s = SampleLinear( voice->sound, voice->cursor, 0, wrap );
+			mix_buffer[ i * 2 + 0 ] += s * gl;
+			mix_buffer[ i * 2 + 1 ] += s * gr;
+		}
+		else {
+			mix_buffer[ i * 2 + 0 ] += SampleLinear( voice->sound, voice->cursor, 0, wrap ) * gl;
+			mix_buffer[ i * 2 + 1 ] += SampleLinear( voice->sound, voice->cursor, 1, wrap ) * gr;
+		}
+
+		voice->cursor += voice->step;
+		while( voice->cursor >= u64( voice->sound.num_frames ) << 32 ) {
+			if( !NextBlock( voice ) )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static void MixChunk() {
+	ZoneScoped;
+
+	DrainCommands();
+
+	memset( mix_buffer, 0, sizeof( mix_buffer ) );
+
+	for( u32 i = 0; i < max_voices; i++ ) {
+		Voice * voice = &voices[ i ];
+		if( !voice->active )
+			continue;
+
+		if( !MixVoice( voice ) ) {
+			ReleaseVoice( voice );
+			finished_serials[ i ].store( voice->serial, std::memory_order_release );
+		}
+	}
+
+	__m128 gain = _mm_set1_ps( listener.gain );
+	for( u32 i = 0; i < ARRAY_COUNT( mix_buffer ); i += 8 ) {
+		__m128i a = _mm_cvtps_epi32( _mm_mul_ps( _mm_load_ps( mix_buffer + i ), gain ) );
+		__m128i b = _mm_cvtps_epi32( _mm_mul_ps( _mm_load_ps( mix_buffer + i + 4 ), gain ) );
+		_mm_store_si128( ( __m128i * ) ( output_buffer + i ), _mm_packs_epi32( a, b ) );
+	}
+}
+
+static void QueueChunk( ALuint buffer ) {
+	MixChunk();
+	alBufferData( buffer, AL_FORMAT_STEREO16, output_buffer, sizeof( output_buffer ), device_sample_rate );
+	alSourceQueueBuffers( stream_source, 1, &buffer );
+}
+
+static void AudioThread( void * data ) {
+	for( ALuint buffer : stream_buffers ) {
+		QueueChunk( buffer );
+	}
+	alSourcePlay( stream_source );
+
+	while( audio_thread_running.load( std::memory_order_acquire ) ) {
+		// keep the queue moving even when no buffer needs refilling
+		DrainCommands();
+
+		ALint processed;
+		alGetSourcei( stream_source, AL_BUFFERS_PROCESSED, &processed );
+
+		for( ALint i = 0; i < processed; i++ ) {
+			ALuint buffer;
+			alSourceUnqueueBuffers( stream_source, 1, &buffer );
+			QueueChunk( buffer );
+		}
+
+		// restart after an underrun
+		ALint state;
+		alGetSourcei( stream_source, AL_SOURCE_STATE, &state );
+		if( state != AL_PLAYING ) {
+			alSourcePlay( stream_source );
+		}
+
+		if( processed == 0 ) {
+			Sys_Sleep( 1 );
+		}
+	}
+
+	alSourceStop( stream_source );
+}
+
+/*
+ * main thread API
+ */
+
+bool InitMixer( u32 num_voices ) {
+	ZoneScoped;
+
+	assert( num_voices <= MAX_MIXER_VOICES );
+
+	al_device = alcOpenDevice( NULL );
+	if( al_device == NULL ) {
+		Com_Printf( S_COLOR_RED "Failed to open device\n" );
+		return false;
+	}
+
+	al_context = alcCreateContext( al_device, NULL );
+	if( al_context == NULL ) {
+		alcCloseDevice( al_device );
+		Com_Printf( S_COLOR_RED "Failed to create context\n" );
+		return false;
+	}
+	alcMakeContextCurrent( al_context );
+
+	ALCint frequency = 0;
+	alcGetIntegerv( al_device, ALC_FREQUENCY, 1, &frequency );
+	device_sample_rate = frequency > 0 ? u32( frequency ) : 44100;
+
+	alGenSources( 1, &stream_source );
+	alGenBuffers( ARRAY_COUNT( stream_buffers ), stream_buffers );
+	alSourcei( stream_source, AL_DIRECT_CHANNELS_SOFT, AL_TRUE );
+	alSourcei( stream_source, AL_SOURCE_RELATIVE, AL_TRUE );
+
+	if( alGetError() != AL_NO_ERROR ) {
+		Com_Printf( S_COLOR_RED "Failed to allocate stream source\n" );
+		alcMakeContextCurrent( NULL );
+		alcDestroyContext( al_context );
+		alcCloseDevice( al_device );
+		return false;
+	}
+
+	max_voices = num_voices;
+	for( u32 i = 0; i < max_voices; i++ ) {
+		free_voices[ i ] = max_voices - i - 1;
+		finished_serials[ i ].store( 0 );
+		voices[ i ] = { };
+	}
+	num_free_voices = max_voices;
+	voice_serial = 0;
+
+	listener = { };
+	listener.forward = Vec3( 1, 0, 0 );
+	listener.up = Vec3( 0, 0, 1 );
+	listener.gain = 1.0f;
+
+	command_queue_head.store( 0 );
+	command_queue_tail.store( 0 );
+	commands_completed.store( 0 );
+
+	audio_thread_running.store( true );
+	audio_thread = NewThread( AudioThread );
+
+	return true;
+}
+
+void ShutdownMixer() {
+	audio_thread_running.store( false, std::memory_order_release );
+	JoinThread( audio_thread );
+
+	for( u32 i = 0; i < max_voices; i++ ) {
+		ReleaseVoice( &voices[ i ] );
+	}
+
+	alDeleteSources( 1, &stream_source );
+	alDeleteBuffers( ARRAY_COUNT( stream_buffers ), stream_buffers );
+
+	alcMakeContextCurrent( NULL );
+	alcDestroyContext( al_context );
+	alcCloseDevice( al_device );
+}
+
+bool MixerPlay( const MixerSound & sound, const MixerVoiceConfig & config, MixerVoice * voice ) {
+	if( num_free_voices == 0 )
+		return false;
+
+	bool empty = sound.samples == NULL ? sound.ogg.ptr == NULL : sound.num_frames == 0;
+	if( empty )
+		return false;
+
+	num_free_voices--;
+	voice->id = free_voices[ num_free_voices ];
+
+	voice_serial++;
+	if( voice_serial == 0 )
+		voice_serial++;
+	voice->serial = voice_serial;
+
+	MixerCommand command = { };
+	command.type = MixerCommand_Play;
+	command.voice = *voice;
+	command.sound = sound;
+	command.config = config;
+	PushCommand( command );
+
+	sent_gain[ voice->id ] = config.gain;
+	sent_origin[ voice->id ] = config.origin;
+
+	return true;
+}
+
+void MixerStop( MixerVoice voice ) {
+	MixerCommand command = { };
+	command.type = MixerCommand_Stop;
+	command.voice = voice;
+	PushCommand( command );
+
+	free_voices[ num_free_voices ] = voice.id;
+	num_free_voices++;
+}
+
+bool MixerVoiceFinished( MixerVoice voice ) {
+	return finished_serials[ voice.id ].load( std::memory_order_acquire ) == voice.serial;
+}
+
+void MixerSetGain( MixerVoice voice, float gain ) {
+	if( gain == sent_gain[ voice.id ] )
+		return;
+
+	MixerCommand command = { };
+	command.type = MixerCommand_SetGain;
+	command.voice = voice;
+	command.gain = gain;
+	if( PushCommand( command ) ) {
+		sent_gain[ voice.id ] = gain;
+	}
+}
+
+void MixerSetPosition( MixerVoice voice, Vec3 origin ) {
+	if( origin == sent_origin[ voice.id ] )
+		return;
+
+	MixerCommand command = { };
+	command.type = MixerCommand_SetPosition;
+	command.voice = voice;
+	command.origin = origin;
+	if( PushCommand( command ) ) {
+		sent_origin[ voice.id ] = origin;
+	}
+}
+
+void MixerSetListener( Vec3 origin, Vec3 forward, Vec3 up, float gain ) {
+	MixerCommand command = { };
+	command.type = MixerCommand_SetListener;
+	command.origin = origin;
+	command.forward = forward;
+	command.up = up;
+	command.gain = gain;
+	PushCommand( command );
+}
+
+bool MixerFlush() {
+	ZoneScoped;
+
+	u32 head = command_queue_head.load( std::memory_order_relaxed );
+	s64 deadline = Sys_Milliseconds() + MIXER_FLUSH_TIMEOUT;
+	while( s32( commands_completed.load( std::memory_order_acquire ) - head ) < 0 ) {
+		if( Sys_Milliseconds() > deadline )
+			return false;
+		Sys_Sleep( 1 );
+	}
+
+	return true;
+}
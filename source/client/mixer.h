@@ -0,0 +1,48 @@
+#pragma once
+
+#include "qcommon/types.h"
+
+/*
+ * software mixer. voices are mixed on a dedicated thread and handed to the
+ * device as a single stereo stream. everything here gets called from the
+ * main thread, and talks to the audio thread through a lock-free queue
+ */
+
+struct MixerSound {
+	const s16 * samples;
+	u32 num_frames;
+	u32 sample_rate;
+	bool mono;
+
+	// if samples is NULL, the audio thread decodes this as it plays
+	Span< const u8 > ogg;
+};
+
+struct MixerVoiceConfig {
+	float gain;
+	float attenuation; // rolloff factor, 0 means no attenuation
+	bool global; // ignores position and plays straight to both ears
+	bool looping;
+	Vec3 origin;
+};
+
+struct MixerVoice {
+	u32 id;
+	u32 serial;
+};
+
+bool InitMixer( u32 max_voices );
+void ShutdownMixer();
+
+bool MixerPlay( const MixerSound & sound, const MixerVoiceConfig & config, MixerVoice * voice );
+void MixerStop( MixerVoice voice );
+bool MixerVoiceFinished( MixerVoice voice );
+
+void MixerSetGain( MixerVoice voice, float gain );
+void MixerSetPosition( MixerVoice voice, Vec3 origin );
+void MixerSetListener( Vec3 origin, Vec3 forward, Vec3 up, float gain );
+
+// blocks until the audio thread has applied every command so far, after
+// which it's safe to free samples belonging to stopped voices. returns false
+// if the audio thread didn't get there in time
+bool MixerFlush();
@@ -1,5 +1,3 @@
-#include <algorithm> // std::stable_sort
-
 #include "glad/glad.h"
 
 #include "tracy/TracyOpenGL.hpp"
@@ -8,6 +6,9 @@
 #include "qcommon/qcommon.h"
 #include "qcommon/array.h"
 #include "qcommon/hash.h"
+#include "qcommon/radix_sort.h"
+#include "qcommon/threads.h"
+#include "client/threadpool.h"
 #include "client/renderer/renderer.h"
 
 template< typename S, typename T >
@@ -43,12 +44,23 @@ struct DrawCall {
 	VertexBuffer instance_data;
 };
 
+/*
+ * each thread records into its own buffer so draw calls can be built from
+ * thread pool jobs. the buffers get merged with a radix sort at submit time
+ */
+struct alignas( 64 ) DrawCallBuffer {
+	DynamicArray< DrawCall > draw_calls;
+	u32 num_vertices;
+
+	DrawCallBuffer() : draw_calls( NO_INIT ) { }
+};
+
 static DynamicArray< RenderPass > render_passes( NO_INIT );
-static DynamicArray< DrawCall > draw_calls( NO_INIT );
+static DrawCallBuffer draw_call_buffers[ MAX_THREAD_POOL_WORKERS + 1 ];
+static DynamicArray< RadixSortItem > sorted_draw_calls( NO_INIT );
+static DynamicArray< RadixSortItem > sort_scratch( NO_INIT );
 static DynamicArray< Mesh > deferred_deletes( NO_INIT );
 
-static u32 num_vertices_this_frame;
-
 static bool in_frame;
 
 struct UBO {
@@ -59,12 +71,25 @@ struct UBO {
 
 static UBO ubos[ 16 ]; // 1MB of uniform space
 static u32 ubo_offset_alignment;
+static Mutex * ubo_mutex;
 
 static PipelineState prev_pipeline;
 static GLuint prev_fbo;
 static u32 prev_viewport_width;
 static u32 prev_viewport_height;
 
+// what's actually bound, so SetPipelineState can skip redundant binds
+struct BoundState {
+	UniformBlock uniforms[ ARRAY_COUNT( &Shader::uniforms ) ];
+	GLuint textures[ ARRAY_COUNT( &Shader::textures ) ];
+	bool textures_msaa[ ARRAY_COUNT( &Shader::textures ) ];
+	GLuint texture_buffers[ ARRAY_COUNT( &Shader::texture_buffers ) ];
+	GLuint texture_array;
+	u32 active_texture;
+};
+
+static BoundState bound;
+
 static GLenum DepthFuncToGL( DepthFunc depth_func ) {
 	switch( depth_func ) {
 		case DepthFunc_Less:
@@ -263,9 +288,15 @@ void RenderBackendInit() {
 	TracyGpuContext;
 
 	render_passes.init( sys_allocator );
-	draw_calls.init( sys_allocator );
+	for( DrawCallBuffer & buffer : draw_call_buffers ) {
+		buffer.draw_calls.init( sys_allocator );
+	}
+	sorted_draw_calls.init( sys_allocator );
+	sort_scratch.init( sys_allocator );
 	deferred_deletes.init( sys_allocator );
 
+	ubo_mutex = NewMutex();
+
 	glEnable( GL_DEPTH_TEST );
 	glDepthFunc( GL_LESS );
 
@@ -304,8 +335,14 @@ void RenderBackendShutdown() {
 		glDeleteBuffers( 1, &ubo.ubo );
 	}
 
+	DeleteMutex( ubo_mutex );
+
 	render_passes.shutdown();
-	draw_calls.shutdown();
+	for( DrawCallBuffer & buffer : draw_call_buffers ) {
+		buffer.draw_calls.shutdown();
+	}
+	sorted_draw_calls.shutdown();
+	sort_scratch.shutdown();
 	deferred_deletes.shutdown();
 }
 
@@ -314,11 +351,12 @@ void RenderBackendBeginFrame() {
 	in_frame = true;
 
 	render_passes.clear();
-	draw_calls.clear();
+	for( DrawCallBuffer & buffer : draw_call_buffers ) {
+		buffer.draw_calls.clear();
+		buffer.num_vertices = 0;
+	}
 	deferred_deletes.clear();
 
-	num_vertices_this_frame = 0;
-
 	for( UBO & ubo : ubos ) {
 		glBindBuffer( GL_UNIFORM_BUFFER, ubo.ubo );
 		ubo.buffer = ( u8 * ) glMapBufferRange( GL_UNIFORM_BUFFER, 0, UNIFORM_BUFFER_SIZE, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
@@ -337,6 +375,29 @@ static bool operator!=( PipelineState::Scissor a, PipelineState::Scissor b ) {
 	return a.x != b.x || a.y != b.y || a.w != b.w || a.h != b.h;
 }
 
+static void SetActiveTexture( u32 unit ) {
+	if( unit != bound.active_texture ) {
+		glActiveTexture( GL_TEXTURE0 + unit );
+		bound.active_texture = unit;
+	}
+}
+
+// other code binds textures/buffers outside of submission, so forget
+// everything we think is bound at the start of each submit
+static void ResetBoundState() {
+	for( UniformBlock & block : bound.uniforms ) {
+		block.ubo = U32_MAX;
+	}
+	for( GLuint & texture : bound.textures ) {
+		texture = U32_MAX;
+	}
+	for( GLuint & texture : bound.texture_buffers ) {
+		texture = U32_MAX;
+	}
+	bound.texture_array = U32_MAX;
+	bound.active_texture = U32_MAX;
+}
+
 static void SetPipelineState( PipelineState pipeline, bool ccw_winding ) {
 	TracyGpuZone( "Set pipeline state" );
 
@@ -345,70 +406,83 @@ static void SetPipelineState( PipelineState pipeline, bool ccw_winding ) {
 	}
 
 	// uniforms
-	// TODO: maybe these shouldn't always get rebound
 	for( size_t i = 0; i < ARRAY_COUNT( pipeline.shader->uniforms ); i++ ) {
-		bool found = false;
+		UniformBlock block = { };
 		for( size_t j = 0; j < pipeline.num_uniforms; j++ ) {
-			UniformBlock block = pipeline.uniforms[ j ].block;
-			if( pipeline.uniforms[ j ].name_hash == pipeline.shader->uniforms[ i ] && block.size > 0 ) {
-				glBindBufferRange( GL_UNIFORM_BUFFER, i, block.ubo, block.offset, block.size );
-				found = true;
+			if( pipeline.uniforms[ j ].name_hash == pipeline.shader->uniforms[ i ] && pipeline.uniforms[ j ].block.size > 0 ) {
+				block = pipeline.uniforms[ j ].block;
 				break;
 			}
 		}
 
-		if( !found ) {
+		UniformBlock * prev = &bound.uniforms[ i ];
+		if( block.ubo == prev->ubo && block.offset == prev->offset && block.size == prev->size )
+			continue;
+
+		if( block.size > 0 ) {
+			glBindBufferRange( GL_UNIFORM_BUFFER, i, block.ubo, block.offset, block.size );
+		}
+		else {
 			glBindBufferBase( GL_UNIFORM_BUFFER, i, 0 );
 		}
+		*prev = block;
 	}
 
 	// textures
 	for( size_t i = 0; i < ARRAY_COUNT( pipeline.shader->textures ); i++ ) {
-		glActiveTexture( GL_TEXTURE0 + i );
-
-		bool found = false;
+		GLuint texture = 0;
+		bool msaa = false;
 		for( size_t j = 0; j < pipeline.num_textures; j++ ) {
 			if( pipeline.textures[ j ].name_hash == pipeline.shader->textures[ i ] ) {
-				GLenum target = pipeline.textures[ j ].texture->msaa ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
-				GLenum other_target = pipeline.textures[ j ].texture->msaa ? GL_TEXTURE_2D : GL_TEXTURE_2D_MULTISAMPLE;
-				glBindTexture( other_target, 0 );
-				glBindTexture( target, pipeline.textures[ j ].texture->texture );
-				found = true;
+				texture = pipeline.textures[ j ].texture->texture;
+				msaa = pipeline.textures[ j ].texture->msaa;
 				break;
 			}
 		}
 
-		if( !found ) {
+		if( texture == bound.textures[ i ] && msaa == bound.textures_msaa[ i ] )
+			continue;
+
+		SetActiveTexture( i );
+		if( texture != 0 ) {
+			GLenum target = msaa ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+			GLenum other_target = msaa ? GL_TEXTURE_2D : GL_TEXTURE_2D_MULTISAMPLE;
+			glBindTexture( other_target, 0 );
+			glBindTexture( target, texture );
+		}
+		else {
 			glBindTexture( GL_TEXTURE_2D, 0 );
 			glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, 0 );
 		}
+
+		bound.textures[ i ] = texture;
+		bound.textures_msaa[ i ] = msaa;
 	}
 
 	// texture buffers
 	for( size_t i = 0; i < ARRAY_COUNT( pipeline.shader->texture_buffers ); i++ ) {
-		glActiveTexture( GL_TEXTURE0 + ARRAY_COUNT( pipeline.shader->textures ) + i );
-
-		bool found = false;
+		GLuint texture = 0;
 		for( size_t j = 0; j < pipeline.num_texture_buffers; j++ ) {
 			if( pipeline.texture_buffers[ j ].name_hash == pipeline.shader->texture_buffers[ i ] ) {
-				glBindTexture( GL_TEXTURE_BUFFER, pipeline.texture_buffers[ j ].tb.texture );
-				found = true;
+				texture = pipeline.texture_buffers[ j ].tb.texture;
 				break;
 			}
 		}
 
-		if( !found ) {
-			glBindTexture( GL_TEXTURE_BUFFER, 0 );
-		}
+		if( texture == bound.texture_buffers[ i ] )
+			continue;
+
+		SetActiveTexture( ARRAY_COUNT( pipeline.shader->textures ) + i );
+		glBindTexture( GL_TEXTURE_BUFFER, texture );
+		bound.texture_buffers[ i ] = texture;
 	}
 
 	// texture array
-	glActiveTexture( GL_TEXTURE0 + ARRAY_COUNT( pipeline.shader->textures ) + ARRAY_COUNT( pipeline.shader->texture_buffers ) );
-	if( pipeline.texture_array.name_hash == pipeline.shader->texture_array ) {
-		glBindTexture( GL_TEXTURE_2D_ARRAY, pipeline.texture_array.ta.texture );
-	}
-	else {
-		glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+	GLuint texture_array = pipeline.texture_array.name_hash == pipeline.shader->texture_array ? pipeline.texture_array.ta.texture : 0;
+	if( texture_array != bound.texture_array ) {
+		SetActiveTexture( ARRAY_COUNT( pipeline.shader->textures ) + ARRAY_COUNT( pipeline.shader->texture_buffers ) );
+		glBindTexture( GL_TEXTURE_2D_ARRAY, texture_array );
+		bound.texture_array = texture_array;
 	}
 
 	// alpha blending
@@ -501,12 +575,33 @@ static void SetPipelineState( PipelineState pipeline, bool ccw_winding ) {
 	prev_pipeline = pipeline;
 }
 
-static bool SortDrawCall( const DrawCall & a, const DrawCall & b ) {
-	if( a.pipeline.pass != b.pipeline.pass )
-		return a.pipeline.pass < b.pipeline.pass;
-	if( !render_passes[ a.pipeline.pass ].sorted )
-		return false;
-	return a.pipeline.shader < b.pipeline.shader;
+/*
+ * pass in the top byte, then shader program in sorted passes. the radix
+ * sort is stable so draw calls with equal keys keep their recording order
+ */
+static u64 DrawCallSortKey( const DrawCall & dc ) {
+	u64 key = u64( dc.pipeline.pass ) << 56;
+	if( render_passes[ dc.pipeline.pass ].sorted && dc.pipeline.shader != NULL ) {
+		key |= u64( dc.pipeline.shader->program ) << 24;
+	}
+	return key;
+}
+
+static void MergeAndSortDrawCalls() {
+	ZoneScoped;
+
+	sorted_draw_calls.clear();
+	for( const DrawCallBuffer & buffer : draw_call_buffers ) {
+		for( const DrawCall & dc : buffer.draw_calls ) {
+			RadixSortItem item;
+			item.key = DrawCallSortKey( dc );
+			item.value = u64( uintptr_t( &dc ) );
+			sorted_draw_calls.add( item );
+		}
+	}
+
+	sort_scratch.resize( sorted_draw_calls.size() );
+	RadixSort( sorted_draw_calls.span(), sort_scratch.span() );
 }
 
 static void SetupAttribute( GLuint index, VertexFormat format, u32 stride = 0, u32 offset = 0 ) {
@@ -632,17 +727,17 @@ void RenderBackendSubmitFrame() {
 		}
 	}
 
-	{
-		ZoneScopedN( "Sort draw calls" );
-		std::stable_sort( draw_calls.begin(), draw_calls.end(), SortDrawCall );
-	}
+	MergeAndSortDrawCalls();
+	ResetBoundState();
 
 	SetupRenderPass( render_passes[ 0 ] );
 	u8 pass_idx = 0;
 
 	{
 		ZoneScopedN( "Submit draw calls" );
-		for( const DrawCall & dc : draw_calls ) {
+		for( RadixSortItem item : sorted_draw_calls ) {
+			const DrawCall & dc = *( const DrawCall * ) uintptr_t( item.value );
+
 			while( dc.pipeline.pass > pass_idx ) {
 				if( GLAD_GL_KHR_debug != 0 )
 					glPopDebugGroup();
@@ -686,16 +781,27 @@ void RenderBackendSubmitFrame() {
 }
 
 u32 renderer_num_draw_calls() {
-	return draw_calls.size();
+	u32 n = 0;
+	for( const DrawCallBuffer & buffer : draw_call_buffers ) {
+		n += buffer.draw_calls.size();
+	}
+	return n;
 }
 
 u32 renderer_num_vertices() {
-	return num_vertices_this_frame;
+	u32 n = 0;
+	for( const DrawCallBuffer & buffer : draw_call_buffers ) {
+		n += buffer.num_vertices;
+	}
+	return n;
 }
 
 UniformBlock UploadUniforms( const void * data, size_t size ) {
 	assert( in_frame );
 
+	Lock( ubo_mutex );
+	defer { Unlock( ubo_mutex ); };
+
 	UBO * ubo = NULL;
 	u32 offset = 0;
 
@@ -1310,6 +1416,18 @@ u8 AddUnsortedRenderPass( const char * name ) {
 	return AddRenderPass( pass );
 }
 
+static void AddDrawCall( const DrawCall & dc, u32 num_vertices ) {
+	u32 thread = ThreadPoolThreadIndex();
+
+	// unsorted passes draw in recording order, which only means anything
+	// on a single thread
+	assert( thread == 0 || render_passes[ dc.pipeline.pass ].sorted );
+
+	DrawCallBuffer * buffer = &draw_call_buffers[ thread ];
+	buffer->draw_calls.add( dc );
+	buffer->num_vertices += num_vertices;
+}
+
 void AddResolveMSAAPass( Framebuffer fb ) {
 	RenderPass pass;
 	pass.name = "Resolve MSAA";
@@ -1321,7 +1439,7 @@ void AddResolveMSAAPass( Framebuffer fb ) {
 
 	DrawCall dc = { };
 	dc.pipeline = dummy;
-	draw_calls.add( dc );
+	AddDrawCall( dc, 0 );
 }
 
 void DeferDeleteMesh( const Mesh & mesh ) {
@@ -1338,9 +1456,7 @@ void DrawMesh( const Mesh & mesh, const PipelineState & pipeline, u32 num_vertic
 	dc.pipeline = pipeline;
 	dc.num_vertices = num_vertices_override == 0 ? mesh.num_vertices : num_vertices_override;
 	dc.index_offset = index_offset;
-	draw_calls.add( dc );
-
-	num_vertices_this_frame += mesh.num_vertices;
+	AddDrawCall( dc, mesh.num_vertices );
 }
 
 void DrawInstancedParticles( const Mesh & mesh, VertexBuffer vb, const Material * material, const Material * gradient, BlendFunc blend_func, u32 num_particles ) {
@@ -1363,8 +1479,7 @@ void DrawInstancedParticles( const Mesh & mesh, VertexBuffer vb, const Material
 	dc.instance_data = vb;
 	dc.num_instances = num_particles;
 
-	draw_calls.add( dc );
-	num_vertices_this_frame += mesh.num_vertices * num_particles;
+	AddDrawCall( dc, mesh.num_vertices * num_particles );
 }
 
 void DownloadFramebuffer( void * buf ) {
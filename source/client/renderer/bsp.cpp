@@ -6,6 +6,7 @@
 #include "qcommon/string.h"
 #include "qcommon/span2d.h"
 #include "client/assets.h"
+#include "client/threadpool.h"
 #include "client/renderer/renderer.h"
 #include "client/maps.h"
 
@@ -280,10 +281,81 @@ static bool SortByMaterial( const BSPDrawCall & a, const BSPDrawCall & b ) {
 	return a.material < b.material;
 }
 
-static void LoadBSPModel( DynamicArray< BSPModelVertex > & vertices, const BSPSpans & bsp, u64 base_hash, size_t model_idx ) {
+struct BSPModelJob {
+	const BSPSpans * bsp;
+	Span< const BSPModelVertex > base_vertices;
+	size_t model_idx;
+
+	// only the vertices this model uses, in the order they get fetched
+	DynamicArray< BSPModelVertex > vertices;
+	DynamicArray< u32 > indices;
+	DynamicArray< Model::Primitive > primitives;
+};
+
+static void OptimizeBSPModelGeometry( BSPModelJob * job, Span< const BSPModelVertex > patch_vertices ) {
 	ZoneScoped;
 
-	const BSPModel & bsp_model = bsp.models[ model_idx ];
+	Span< u32 > indices = job->indices.span();
+	if( indices.n == 0 )
+		return;
+
+	// indices point into the whole map's vertices, so gather the ones this
+	// model uses. submodels only touch a small range so size the table to it
+	u32 min_index = U32_MAX;
+	u32 max_index = 0;
+	for( u32 index : indices ) {
+		min_index = Min2( min_index, index );
+		max_index = Max2( max_index, index );
+	}
+
+	Span< u32 > gathered = ALLOC_SPAN( sys_allocator, u32, max_index - min_index + 1 );
+	defer { FREE( sys_allocator, gathered.ptr ); };
+	memset( gathered.ptr, 0xff, gathered.num_bytes() );
+
+	DynamicArray< BSPModelVertex > & vertices = job->vertices;
+	for( u32 & index : indices ) {
+		u32 & slot = gathered[ index - min_index ];
+		if( slot == U32_MAX ) {
+			slot = vertices.size();
+			vertices.add( index < job->base_vertices.n ? job->base_vertices[ index ] : patch_vertices[ index - job->base_vertices.n ] );
+		}
+		index = slot;
+	}
+
+	// adjacent patches duplicate the vertices along their shared edges
+	{
+		ZoneScopedN( "Weld vertices" );
+
+		Span< u32 > remap = ALLOC_SPAN( sys_allocator, u32, vertices.size() );
+		defer { FREE( sys_allocator, remap.ptr ); };
+
+		size_t num_vertices = meshopt_generateVertexRemap( remap.ptr, indices.ptr, indices.n, vertices.ptr(), vertices.size(), sizeof( BSPModelVertex ) );
+		meshopt_remapIndexBuffer( indices.ptr, indices.ptr, indices.n, remap.ptr );
+		meshopt_remapVertexBuffer( vertices.ptr(), vertices.ptr(), vertices.size(), sizeof( BSPModelVertex ), remap.ptr );
+		vertices.resize( num_vertices );
+	}
+
+	for( const Model::Primitive & prim : job->primitives ) {
+		Span< u32 > prim_indices( indices.ptr + prim.first_index, prim.num_vertices );
+		OptimizeTriangleOrder( prim_indices, &vertices[ 0 ].position, vertices.size(), sizeof( BSPModelVertex ) );
+	}
+
+	{
+		ZoneScopedN( "Optimize vertex fetch" );
+		meshopt_optimizeVertexFetch( vertices.ptr(), indices.ptr, indices.n, vertices.ptr(), vertices.size(), sizeof( BSPModelVertex ) );
+	}
+}
+
+static void BuildBSPModelGeometry( BSPModelJob * job ) {
+	ZoneScoped;
+
+	const BSPSpans & bsp = *job->bsp;
+	const BSPModel & bsp_model = bsp.models[ job->model_idx ];
+
+	job->vertices.init( sys_allocator );
+	job->indices.init( sys_allocator );
+	job->primitives.init( sys_allocator );
+
 	if( bsp_model.num_faces == 0 )
 		return;
 
@@ -327,9 +399,10 @@ static void LoadBSPModel( DynamicArray< BSPModelVertex > & vertices, const BSPSp
 
 	// generate patch geometry and merge draw calls
 	// TODO: this generates terrible geometry then relies on meshopt to fix it up. maybe it could be done better
-	DynamicArray< u32 > indices( sys_allocator );
+	DynamicArray< BSPModelVertex > vertices( sys_allocator );
+	DynamicArray< u32 > & indices = job->indices;
+	DynamicArray< Model::Primitive > & primitives = job->primitives;
 
-	DynamicArray< Model::Primitive > primitives( sys_allocator );
 	Model::Primitive first;
 	first.first_index = 0;
 	first.num_vertices = 0;
@@ -357,24 +430,20 @@ static void LoadBSPModel( DynamicArray< BSPModelVertex > & vertices, const BSPSp
 			for( u32 patch_y = 0; patch_y < num_patches_y; patch_y++ ) {
 				for( u32 patch_x = 0; patch_x < num_patches_x; patch_x++ ) {
 					u32 control_base = ( patch_y * 2 * dc.patch_width + patch_x * 2 ) + dc.base_vertex;
+					Span2D< const BSPModelVertex > control( &job->base_vertices[ control_base ], 3, 3, dc.patch_width );
 
 					float max_error = 1.0f;
 					int tess_x = 0;
 					int tess_y = 0;
-					{
-						Span2D< const BSPModelVertex > control( &vertices[ control_base ], 3, 3, dc.patch_width );
-						for( int j = 0; j < 3; j++ ) {
-							tess_x = Max2( tess_x, Order2BezierSubdivisions( control( 0, j ).position, control( 1, j ).position, control( 2, j ).position, max_error ) );
-							tess_y = Max2( tess_y, Order2BezierSubdivisions( control( j, 0 ).position, control( j, 1 ).position, control( j, 2 ).position, max_error ) );
-						}
+					for( int j = 0; j < 3; j++ ) {
+						tess_x = Max2( tess_x, Order2BezierSubdivisions( control( 0, j ).position, control( 1, j ).position, control( 2, j ).position, max_error ) );
+						tess_y = Max2( tess_y, Order2BezierSubdivisions( control( j, 0 ).position, control( j, 1 ).position, control( j, 2 ).position, max_error ) );
 					}
 
-					u32 base_vert = vertices.size();
+					u32 base_vert = job->base_vertices.n + vertices.size();
 
 					for( int y = 0; y <= tess_y; y++ ) {
 						for( int x = 0; x <= tess_x; x++ ) {
-							// add can reallocate vertices so we need to recreate this every iteration
-							Span2D< const BSPModelVertex > control( &vertices[ control_base ], 3, 3, dc.patch_width );
 							float tx = float( x ) / tess_x;
 							float ty = float( y ) / tess_y;
 							vertices.add( Order2Bezier2D( tx, ty, control ) );
@@ -412,37 +481,47 @@ static void LoadBSPModel( DynamicArray< BSPModelVertex > & vertices, const BSPSp
 		}
 	}
 
-	// TODO: meshopt
+	OptimizeBSPModelGeometry( job, vertices.span() );
+}
+
+static void UploadBSPModel( const BSPModelJob * job, u64 base_hash ) {
+	ZoneScoped;
 
-	String< 16 > suffix( "*{}", model_idx );
+	if( job->primitives.size() == 0 )
+		return;
+
+	String< 16 > suffix( "*{}", job->model_idx );
 	Model * model = NewModel( Hash64( suffix.c_str(), suffix.len(), base_hash ) );
 	*model = { };
 	model->transform = Mat4::Identity();
 
-	model->primitives = ALLOC_MANY( sys_allocator, Model::Primitive, primitives.size() );
-	model->num_primitives = primitives.size();
-	memcpy( model->primitives, primitives.ptr(), primitives.num_bytes() );
+	model->primitives = ALLOC_MANY( sys_allocator, Model::Primitive, job->primitives.size() );
+	model->num_primitives = job->primitives.size();
+	memcpy( model->primitives, job->primitives.ptr(), job->primitives.num_bytes() );
 
 	MeshConfig mesh_config;
 	mesh_config.ccw_winding = false;
-	mesh_config.unified_buffer = NewVertexBuffer( vertices.ptr(), vertices.num_bytes() );
-	mesh_config.stride = sizeof( vertices[ 0 ] );
+	mesh_config.unified_buffer = NewVertexBuffer( job->vertices.ptr(), job->vertices.num_bytes() );
+	mesh_config.stride = sizeof( BSPModelVertex );
 	mesh_config.positions_offset = offsetof( BSPModelVertex, position );
 	mesh_config.normals_offset = offsetof( BSPModelVertex, normal );
 	mesh_config.tex_coords_offset = offsetof( BSPModelVertex, uv );
-	mesh_config.num_vertices = indices.size();
-
-	// if( num_verts <= U16_MAX ) {
-	// 	DynamicArray< u16 > indices_u16( sys_allocator, indices.size() );
-	// 	for( u32 i = 0; i < indices.size(); i++ ) {
-	// 		indices_u16.add( indices[ i ] );
-	// 	}
-	// 	mesh_config.indices = NewIndexBuffer( indices.ptr(), indices.num_bytes() );
-	// }
-	// else {
-		mesh_config.indices = NewIndexBuffer( indices.ptr(), indices.num_bytes() );
+	mesh_config.num_vertices = job->indices.size();
+
+	// submodels only carry their own vertices now, so most of them fit in u16
+	if( job->vertices.size() <= U16_MAX ) {
+		Span< u16 > indices_u16 = ALLOC_SPAN( sys_allocator, u16, job->indices.size() );
+		defer { FREE( sys_allocator, indices_u16.ptr ); };
+		for( size_t i = 0; i < job->indices.size(); i++ ) {
+			indices_u16[ i ] = job->indices[ i ];
+		}
+		mesh_config.indices = NewIndexBuffer( indices_u16 );
+		mesh_config.indices_format = IndexFormat_U16;
+	}
+	else {
+		mesh_config.indices = NewIndexBuffer( job->indices.ptr(), job->indices.num_bytes() );
 		mesh_config.indices_format = IndexFormat_U32;
-	// }
+	}
 
 	model->mesh = NewMesh( mesh_config );
 }
@@ -477,8 +556,25 @@ bool LoadBSPRenderData( Map * map, u64 base_hash, Span< const u8 > data ) {
 		}
 	}
 
-	for( size_t i = 0; i < bsp.models.n; i++ ) {
-		LoadBSPModel( vertices, bsp, base_hash, i );
+	// build geometry for every submodel in parallel, then upload on the main thread
+	Span< BSPModelJob > jobs = ALLOC_SPAN( sys_allocator, BSPModelJob, bsp.models.n );
+	defer { FREE( sys_allocator, jobs.ptr ); };
+
+	for( size_t i = 0; i < jobs.n; i++ ) {
+		jobs[ i ].bsp = &bsp;
+		jobs[ i ].base_vertices = vertices.span();
+		jobs[ i ].model_idx = i;
+	}
+
+	ParallelFor( jobs, []( TempAllocator * temp, void * data ) {
+		BuildBSPModelGeometry( ( BSPModelJob * ) data );
+	} );
+
+	for( BSPModelJob & job : jobs ) {
+		UploadBSPModel( &job, base_hash );
+		job.vertices.shutdown();
+		job.indices.shutdown();
+		job.primitives.shutdown();
 	}
 
 	map->base_hash = base_hash;
@@ -487,3 +583,10 @@ bool LoadBSPRenderData( Map * map, u64 base_hash, Span< const u8 > data ) {
 
 	return true;
 }
+
+void UnloadBSPRenderData( const Map * map ) {
+	for( u32 i = 0; i < map->num_models; i++ ) {
+		String< 16 > suffix( "*{}", i );
+		FreeModel( Hash64( suffix.c_str(), suffix.len(), map->base_hash ) );
+	}
+}
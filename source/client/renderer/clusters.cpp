@@ -0,0 +1,396 @@
+#include <xmmintrin.h>
+
+#include "qcommon/base.h"
+#include "qcommon/qcommon.h"
+#include "client/client.h"
+#include "client/threadpool.h"
+#include "client/renderer/renderer.h"
+#include "client/renderer/clusters.h"
+
+static constexpr size_t PARALLEL_BINNING_THRESHOLD = 256;
+static constexpr size_t SPHERES_PER_JOB = 256;
+static constexpr u32 MAX_ROW_BANDS = 8;
+
+void InitClusterBinner( ClusterBinner * binner, u32 max_spheres, u32 max_per_cluster, u32 max_indices ) {
+	*binner = { };
+	binner->max_per_cluster = max_per_cluster;
+	binner->ranges = ALLOC_SPAN( sys_allocator, ClusterRange, max_spheres );
+	binner->indices = ALLOC_SPAN( sys_allocator, u32, max_indices );
+}
+
+void ShutdownClusterBinner( ClusterBinner * binner ) {
+	FREE( sys_allocator, binner->clusters.ptr );
+	FREE( sys_allocator, binner->cursors.ptr );
+	FREE( sys_allocator, binner->ranges.ptr );
+	FREE( sys_allocator, binner->indices.ptr );
+}
+
+/*
+ * implementation of "2D Polyhedral Bounds of a Clipped, Perspective-Projected
+ * 3D Sphere" in JCGT
+ *
+ * https://pdfs.semanticscholar.org/9e5f/117618c96175ce683e9b708bacdfb8252e38.pdf
+ */
+static MinMax3 ScreenSpaceBoundsForAxis( Vec2 axis, Vec3 view_space_origin, float radius ) {
+	float z_near = -frame_static.near_plane;
+	bool fully_infront_of_near_plane = view_space_origin.z + radius < z_near;
+
+	Vec2 C = Vec2( Dot( Vec3( axis, 0.0f ), view_space_origin ), view_space_origin.z );
+
+	float tSquared = LengthSquared( C ) - radius * radius;
+	bool camera_outside_sphere = tSquared > 0.0f;
+
+	Vec2 min, max;
+
+	if( camera_outside_sphere ) {
+		float t = sqrtf( tSquared );
+		float cos_theta = t / Length( C );
+		float sin_theta = radius / Length( C );
+
+		Mat2 Rtheta = Mat2Rotation( cos_theta, sin_theta );
+		Mat2 Rmintheta = Mat2Rotation( cos_theta, -sin_theta );
+
+		max = cos_theta * ( Rtheta * C );
+		min = cos_theta * ( Rmintheta * C );
+	}
+
+	if( !fully_infront_of_near_plane ) {
+		float chord_half_length = sqrtf( radius * radius - Square( z_near - C.y ) );
+
+		if( !camera_outside_sphere || max.y > z_near ) {
+			max.x = C.x + chord_half_length;
+			max.y = z_near;
+		}
+
+		if( !camera_outside_sphere || min.y > z_near ) {
+			min.x = C.x - chord_half_length;
+			min.y = z_near;
+		}
+	}
+
+	return MinMax3(
+		Vec3( min.x * axis, min.y ),
+		Vec3( max.x * axis, max.y )
+	);
+}
+
+static MinMax2 SphereScreenSpaceBounds( Vec3 view_space_origin, float radius ) {
+	MinMax3 x_bounds = ScreenSpaceBoundsForAxis( Vec2( 1.0f, 0.0f ), view_space_origin, radius );
+	MinMax3 y_bounds = ScreenSpaceBoundsForAxis( Vec2( 0.0f, 1.0f ), view_space_origin, radius );
+
+	Mat4 P = frame_static.P;
+	float min_x = Dot( x_bounds.mins, P.row0().xyz() ) / Dot( x_bounds.mins, P.row3().xyz() );
+	float max_x = Dot( x_bounds.maxs, P.row0().xyz() ) / Dot( x_bounds.maxs, P.row3().xyz() );
+	float min_y = Dot( y_bounds.mins, P.row1().xyz() ) / Dot( y_bounds.mins, P.row3().xyz() );
+	float max_y = Dot( y_bounds.maxs, P.row1().xyz() ) / Dot( y_bounds.maxs, P.row3().xyz() );
+
+	return MinMax2( Vec2( min_x, min_y ), Vec2( max_x, max_y ) );
+}
+
+/*
+ * same as ScreenSpaceBoundsForAxis for 4 spheres at once, but only valid
+ * when the spheres are entirely in front of the near plane, which means
+ * the camera is outside them too. that's nearly everything, and the rest
+ * go through the scalar path
+ *
+ * the cos_theta scale on min/max cancels out in the perspective divide so
+ * it's dropped
+ */
+static void ScreenSpaceBoundsForAxis4( __m128 c_x, __m128 c_y, __m128 radius, Vec4 row, Vec4 row3, bool y_axis, __m128 * min_ndc, __m128 * max_ndc ) {
+	__m128 length_squared = _mm_add_ps( _mm_mul_ps( c_x, c_x ), _mm_mul_ps( c_y, c_y ) );
+	__m128 inv_length = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( length_squared ) );
+	__m128 t = _mm_sqrt_ps( _mm_sub_ps( length_squared, _mm_mul_ps( radius, radius ) ) );
+	__m128 cos_theta = _mm_mul_ps( t, inv_length );
+	__m128 sin_theta = _mm_mul_ps( radius, inv_length );
+
+	__m128 max_a = _mm_sub_ps( _mm_mul_ps( cos_theta, c_x ), _mm_mul_ps( sin_theta, c_y ) );
+	__m128 max_z = _mm_add_ps( _mm_mul_ps( sin_theta, c_x ), _mm_mul_ps( cos_theta, c_y ) );
+	__m128 min_a = _mm_add_ps( _mm_mul_ps( cos_theta, c_x ), _mm_mul_ps( sin_theta, c_y ) );
+	__m128 min_z = _mm_sub_ps( _mm_mul_ps( cos_theta, c_y ), _mm_mul_ps( sin_theta, c_x ) );
+
+	__m128 row_a = _mm_set1_ps( y_axis ? row.y : row.x );
+	__m128 row_z = _mm_set1_ps( row.z );
+	__m128 row3_a = _mm_set1_ps( y_axis ? row3.y : row3.x );
+	__m128 row3_z = _mm_set1_ps( row3.z );
+
+	*min_ndc = _mm_div_ps(
+		_mm_add_ps( _mm_mul_ps( row_a, min_a ), _mm_mul_ps( row_z, min_z ) ),
+		_mm_add_ps( _mm_mul_ps( row3_a, min_a ), _mm_mul_ps( row3_z, min_z ) ) );
+	*max_ndc = _mm_div_ps(
+		_mm_add_ps( _mm_mul_ps( row_a, max_a ), _mm_mul_ps( row_z, max_z ) ),
+		_mm_add_ps( _mm_mul_ps( row3_a, max_a ), _mm_mul_ps( row3_z, max_z ) ) );
+}
+
+static u8 DepthSlice( float depth, float depth_scale ) {
+	float slice = logf( depth / frame_static.near_plane ) * depth_scale;
+	return u8( Clamp( 0.0f, slice, float( CLUSTER_DEPTH_SLICES - 1 ) ) );
+}
+
+static ClusterRange ClusterRangeForBounds( MinMax2 bounds, float view_z, float radius, float depth_scale ) {
+	ClusterRange range = { };
+
+	// NDC y points up but tile rows go down
+	bounds.mins.y = -bounds.mins.y;
+	bounds.maxs.y = -bounds.maxs.y;
+	Swap2( &bounds.mins.y, &bounds.maxs.y );
+
+	if( bounds.maxs.x <= -1.0f || bounds.maxs.y <= -1.0f || bounds.mins.x >= 1.0f || bounds.mins.y >= 1.0f ) {
+		return range;
+	}
+
+	Vec2 mins = ( bounds.mins + 1.0f ) * 0.5f * frame_static.viewport;
+	mins = Clamp( Vec2( 0.0f ), mins, frame_static.viewport - 1.0f ) / float( TILE_SIZE );
+
+	Vec2 maxs = ( bounds.maxs + 1.0f ) * 0.5f * frame_static.viewport;
+	maxs = Clamp( Vec2( 0.0f ), maxs, frame_static.viewport - 1.0f ) / float( TILE_SIZE );
+
+	// pad the depth range a little so fragments right on a slice boundary
+	// don't get missed because the shader's log disagrees with ours
+	float near_depth = Max2( frame_static.near_plane, -view_z - radius );
+	float far_depth = -view_z + radius;
+
+	range.x0 = u16( mins.x );
+	range.y0 = u16( mins.y );
+	range.x1 = u16( maxs.x );
+	range.y1 = u16( maxs.y );
+	range.z0 = DepthSlice( near_depth * 0.99f, depth_scale );
+	range.z1 = DepthSlice( far_depth * 1.01f, depth_scale );
+	range.visible = true;
+
+	return range;
+}
+
+static void ComputeClusterRanges( ClusterBinner * binner, const u8 * spheres, size_t stride, size_t first, size_t count ) {
+	ZoneScoped;
+	DisableFPEScoped;
+
+	const Mat4 & V = frame_static.V;
+	Vec4 P_row0 = frame_static.P.row0();
+	Vec4 P_row1 = frame_static.P.row1();
+	Vec4 P_row3 = frame_static.P.row3();
+	float depth_scale = CLUSTER_DEPTH_SLICES / logf( CLUSTER_FAR_PLANE / frame_static.near_plane );
+
+	for( size_t base = first; base < first + count; base += 4 ) {
+		size_t lanes = Min2( first + count - base, size_t( 4 ) );
+
+		alignas( 16 ) float origin_x[ 4 ], origin_y[ 4 ], origin_z[ 4 ], radius[ 4 ];
+		for( size_t i = 0; i < 4; i++ ) {
+			// pad short groups with the last sphere
+			const float * sphere = ( const float * ) ( spheres + stride * ( base + Min2( i, lanes - 1 ) ) );
+			origin_x[ i ] = sphere[ 0 ];
+			origin_y[ i ] = sphere[ 1 ];
+			origin_z[ i ] = sphere[ 2 ];
+			radius[ i ] = sphere[ 3 ];
+		}
+
+		__m128 ox = _mm_load_ps( origin_x );
+		__m128 oy = _mm_load_ps( origin_y );
+		__m128 oz = _mm_load_ps( origin_z );
+		__m128 r = _mm_load_ps( radius );
+
+		// view space origins, i.e. the top 3 rows of V * Vec4( origin, 1 )
+		__m128 view_x = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( V.col0.x ), ox ), _mm_mul_ps( _mm_set1_ps( V.col1.x ), oy ) ), _mm_add_ps( _mm_mul_ps( _mm_set1_ps( V.col2.x ), oz ), _mm_set1_ps( V.col3.x ) ) );
+		__m128 view_y = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( V.col0.y ), ox ), _mm_mul_ps( _mm_set1_ps( V.col1.y ), oy ) ), _mm_add_ps( _mm_mul_ps( _mm_set1_ps( V.col2.y ), oz ), _mm_set1_ps( V.col3.y ) ) );
+		__m128 view_z = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( V.col0.z ), ox ), _mm_mul_ps( _mm_set1_ps( V.col1.z ), oy ) ), _mm_add_ps( _mm_mul_ps( _mm_set1_ps( V.col2.z ), oz ), _mm_set1_ps( V.col3.z ) ) );
+
+		int fast_lanes = _mm_movemask_ps( _mm_cmplt_ps( _mm_add_ps( view_z, r ), _mm_set1_ps( -frame_static.near_plane ) ) );
+
+		__m128 min_x, max_x, min_y, max_y;
+		ScreenSpaceBoundsForAxis4( view_x, view_z, r, P_row0, P_row3, false, &min_x, &max_x );
+		ScreenSpaceBoundsForAxis4( view_y, view_z, r, P_row1, P_row3, true, &min_y, &max_y );
+
+		alignas( 16 ) float vx[ 4 ], vy[ 4 ], vz[ 4 ];
+		alignas( 16 ) float min_xs[ 4 ], max_xs[ 4 ], min_ys[ 4 ], max_ys[ 4 ];
+		_mm_store_ps( vx, view_x );
+		_mm_store_ps( vy, view_y );
+		_mm_store_ps( vz, view_z );
+		_mm_store_ps( min_xs, min_x );
+		_mm_store_ps( max_xs, max_x );
+		_mm_store_ps( min_ys, min_y );
+		_mm_store_ps( max_ys, max_y );
+
+		for( size_t i = 0; i < lanes; i++ ) {
+			ClusterRange * range = &binner->ranges[ base + i ];
+
+			MinMax2 bounds;
+			if( fast_lanes & ( 1 << i ) ) {
+				bounds = MinMax2( Vec2( min_xs[ i ], min_ys[ i ] ), Vec2( max_xs[ i ], max_ys[ i ] ) );
+			}
+			else {
+				bool fully_behind_near_plane = vz[ i ] - radius[ i ] >= -frame_static.near_plane;
+				if( fully_behind_near_plane ) {
+					*range = { };
+					continue;
+				}
+
+				bounds = SphereScreenSpaceBounds( Vec3( vx[ i ], vy[ i ], vz[ i ] ), radius[ i ] );
+			}
+
+			*range = ClusterRangeForBounds( bounds, vz[ i ], radius[ i ], depth_scale );
+		}
+	}
+}
+
+/*
+ * binning is two passes over the ranges so the indices can be packed
+ * tightly without a fixed size list per cluster. the first pass counts,
+ * then a prefix sum hands out space, then the second pass fills it. both
+ * passes go in sphere order so a full cluster keeps the same spheres the
+ * count pass saw. bands of rows own disjoint clusters so they can run in
+ * parallel
+ */
+
+static u32 ClusterIndex( const ClusterBinner * binner, u32 x, u32 y, u32 z ) {
+	return ( z * binner->rows + y ) * binner->cols + x;
+}
+
+template< typename F >
+static void ForEachClusterInBand( const ClusterBinner * binner, size_t num_spheres, u32 first_row, u32 end_row, F f ) {
+	for( size_t i = 0; i < num_spheres; i++ ) {
+		const ClusterRange & range = binner->ranges[ i ];
+		if( !range.visible || range.y1 < first_row || range.y0 >= end_row )
+			continue;
+
+		u32 y0 = Max2( u32( range.y0 ), first_row );
+		u32 y1 = Min2( u32( range.y1 ), end_row - 1 );
+
+		for( u32 z = range.z0; z <= range.z1; z++ ) {
+			for( u32 y = y0; y <= y1; y++ ) {
+				for( u32 x = range.x0; x <= range.x1; x++ ) {
+					f( ClusterIndex( binner, x, y, z ), u32( i ) );
+				}
+			}
+		}
+	}
+}
+
+static void CountBand( ClusterBinner * binner, size_t num_spheres, u32 first_row, u32 end_row ) {
+	ZoneScoped;
+
+	ForEachClusterInBand( binner, num_spheres, first_row, end_row, [ binner ]( u32 cluster, u32 sphere ) {
+		binner->clusters[ cluster ].count++;
+	} );
+}
+
+static void FillBand( ClusterBinner * binner, size_t num_spheres, u32 first_row, u32 end_row ) {
+	ZoneScoped;
+
+	ForEachClusterInBand( binner, num_spheres, first_row, end_row, [ binner ]( u32 cluster, u32 sphere ) {
+		const GPUCluster & c = binner->clusters[ cluster ];
+		u32 & cursor = binner->cursors[ cluster ];
+		if( cursor < c.first + c.count ) {
+			binner->indices[ cursor ] = sphere;
+			cursor++;
+		}
+	} );
+}
+
+static void AllocateClusterIndices( ClusterBinner * binner ) {
+	ZoneScoped;
+
+	u32 total = 0;
+	for( size_t i = 0; i < binner->clusters.n; i++ ) {
+		GPUCluster * cluster = &binner->clusters[ i ];
+		u32 count = Min2( cluster->count, binner->max_per_cluster );
+		count = Min2( count, u32( binner->indices.n ) - total );
+
+		cluster->first = total;
+		cluster->count = count;
+		binner->cursors[ i ] = total;
+
+		total += count;
+	}
+
+	binner->num_indices = total;
+}
+
+struct ClusterRangesJob {
+	ClusterBinner * binner;
+	const u8 * spheres;
+	size_t stride;
+	size_t first, count;
+};
+
+struct ClusterBandJob {
+	ClusterBinner * binner;
+	size_t num_spheres;
+	u32 first_row, end_row;
+};
+
+static bool ResizeClusterGrid( ClusterBinner * binner ) {
+	u32 rows = ( frame_static.viewport_height + TILE_SIZE - 1 ) / TILE_SIZE;
+	u32 cols = ( frame_static.viewport_width + TILE_SIZE - 1 ) / TILE_SIZE;
+	if( rows == binner->rows && cols == binner->cols )
+		return false;
+
+	ZoneScoped;
+
+	FREE( sys_allocator, binner->clusters.ptr );
+	FREE( sys_allocator, binner->cursors.ptr );
+
+	binner->rows = rows;
+	binner->cols = cols;
+	binner->clusters = ALLOC_SPAN( sys_allocator, GPUCluster, rows * cols * CLUSTER_DEPTH_SLICES );
+	binner->cursors = ALLOC_SPAN( sys_allocator, u32, rows * cols * CLUSTER_DEPTH_SLICES );
+
+	return true;
+}
+
+bool BinSpheres( ClusterBinner * binner, const void * spheres, size_t n, size_t stride ) {
+	ZoneScoped;
+
+	bool resized = ResizeClusterGrid( binner );
+
+	n = Min2( n, binner->ranges.n );
+	memset( binner->clusters.ptr, 0, binner->clusters.num_bytes() );
+
+	if( n < PARALLEL_BINNING_THRESHOLD ) {
+		ComputeClusterRanges( binner, ( const u8 * ) spheres, stride, 0, n );
+		CountBand( binner, n, 0, binner->rows );
+		AllocateClusterIndices( binner );
+		FillBand( binner, n, 0, binner->rows );
+		return resized;
+	}
+
+	TempAllocator temp = cls.frame_arena.temp();
+
+	{
+		size_t num_jobs = ( n + SPHERES_PER_JOB - 1 ) / SPHERES_PER_JOB;
+		Span< ClusterRangesJob > jobs = ALLOC_SPAN( &temp, ClusterRangesJob, num_jobs );
+		for( size_t i = 0; i < num_jobs; i++ ) {
+			jobs[ i ].binner = binner;
+			jobs[ i ].spheres = ( const u8 * ) spheres;
+			jobs[ i ].stride = stride;
+			jobs[ i ].first = i * SPHERES_PER_JOB;
+			jobs[ i ].count = Min2( SPHERES_PER_JOB, n - jobs[ i ].first );
+		}
+
+		ParallelFor( jobs, []( TempAllocator * temp, void * data ) {
+			ClusterRangesJob * job = ( ClusterRangesJob * ) data;
+			ComputeClusterRanges( job->binner, job->spheres, job->stride, job->first, job->count );
+		} );
+	}
+
+	u32 num_bands = Min2( binner->rows, MAX_ROW_BANDS );
+	Span< ClusterBandJob > bands = ALLOC_SPAN( &temp, ClusterBandJob, num_bands );
+	for( u32 i = 0; i < num_bands; i++ ) {
+		bands[ i ].binner = binner;
+		bands[ i ].num_spheres = n;
+		bands[ i ].first_row = binner->rows * i / num_bands;
+		bands[ i ].end_row = binner->rows * ( i + 1 ) / num_bands;
+	}
+
+	ParallelFor( bands, []( TempAllocator * temp, void * data ) {
+		ClusterBandJob * band = ( ClusterBandJob * ) data;
+		CountBand( band->binner, band->num_spheres, band->first_row, band->end_row );
+	} );
+
+	AllocateClusterIndices( binner );
+
+	ParallelFor( bands, []( TempAllocator * temp, void * data ) {
+		ClusterBandJob * band = ( ClusterBandJob * ) data;
+		FillBand( band->binner, band->num_spheres, band->first_row, band->end_row );
+	} );
+
+	return resized;
+}
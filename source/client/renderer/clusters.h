@@ -0,0 +1,43 @@
+#pragma once
+
+#include "qcommon/types.h"
+
+/*
+ * clustered binning for forward+ shading. the screen is split into
+ * TILE_SIZE tiles and each tile into CLUSTER_DEPTH_SLICES exponentially
+ * spaced depth slices. spheres get binned into every cluster they touch,
+ * and the shader walks the list for the cluster its fragment lands in
+ *
+ * clusters are laid out slice major, then row, then column
+ */
+
+struct GPUCluster {
+	u32 first;
+	u32 count;
+};
+
+struct ClusterRange {
+	u16 x0, y0, x1, y1;
+	u8 z0, z1;
+	bool visible;
+};
+
+struct ClusterBinner {
+	u32 max_per_cluster;
+
+	u32 cols, rows;
+	Span< GPUCluster > clusters;
+	Span< u32 > cursors;
+
+	Span< ClusterRange > ranges;
+
+	Span< u32 > indices;
+	u32 num_indices;
+};
+
+void InitClusterBinner( ClusterBinner * binner, u32 max_spheres, u32 max_per_cluster, u32 max_indices );
+void ShutdownClusterBinner( ClusterBinner * binner );
+
+// each element must start with a Vec3 origin followed by a float radius.
+// returns true if the grid was resized, i.e. GPU buffers need reallocating
+bool BinSpheres( ClusterBinner * binner, const void * spheres, size_t n, size_t stride );
@@ -6,6 +6,7 @@
 #include "cgame/ref.h"
 
 #include "cgltf/cgltf.h"
+#include "meshoptimizer/meshoptimizer.h"
 
 // like cgltf_load_buffers, but doesn't try to load URIs
 static bool LoadBinaryBuffers( cgltf_data * data ) {
@@ -112,6 +113,25 @@ static MinMax3 Extend( MinMax3 bounds, Vec3 p ) {
 	);
 }
 
+static const cgltf_accessor * FindAttribute( const cgltf_primitive & prim, cgltf_attribute_type type ) {
+	for( size_t i = 0; i < prim.attributes_count; i++ ) {
+		if( prim.attributes[ i ].type == type ) {
+			return prim.attributes[ i ].data;
+		}
+	}
+
+	return NULL;
+}
+
+static VertexBuffer NewRemappedVertexBuffer( Span< const u8 > stream, size_t num_vertices, Span< const u32 > remap, size_t num_unique_vertices ) {
+	size_t vertex_size = stream.n / num_vertices;
+	Span< u8 > remapped = ALLOC_SPAN( sys_allocator, u8, num_unique_vertices * vertex_size );
+	defer { FREE( sys_allocator, remapped.ptr ); };
+
+	meshopt_remapVertexBuffer( remapped.ptr, stream.ptr, num_vertices, vertex_size, remap.ptr );
+	return NewVertexBuffer( remapped );
+}
+
 static void LoadNode( Model * model, const cgltf_node * node, bool animated ) {
 	for( size_t i = 0; i < node->children_count; i++ ) {
 		LoadNode( model, node->children[ i ], animated );
@@ -123,40 +143,52 @@ static void LoadNode( Model * model, const cgltf_node * node, bool animated ) {
 
 	const cgltf_primitive & prim = node->mesh->primitives[ 0 ];
 
+	const cgltf_accessor * position_accessor = FindAttribute( prim, cgltf_attribute_type_position );
+	if( position_accessor == NULL || prim.indices == NULL ) {
+		return;
+	}
+
+	// static meshes get baked into model space
+	Mat4 node_transform = Mat4::Identity();
+	if( !animated ) {
+		cgltf_node_transform_local( node, node_transform.ptr() );
+	}
+
+	Span< const Vec3 > source_positions = AccessorToSpan( position_accessor ).cast< const Vec3 >();
+	Span< Vec3 > positions = ALLOC_SPAN( sys_allocator, Vec3, source_positions.n );
+	defer { FREE( sys_allocator, positions.ptr ); };
+
+	for( size_t i = 0; i < positions.n; i++ ) {
+		positions[ i ] = ( node_transform * Vec4( source_positions[ i ], 1.0f ) ).xyz();
+		model->bounds = Extend( model->bounds, positions[ i ] );
+	}
+
+	Span< u32 > indices = ALLOC_SPAN( sys_allocator, u32, prim.indices->count );
+	defer { FREE( sys_allocator, indices.ptr ); };
+	for( size_t i = 0; i < indices.n; i++ ) {
+		indices[ i ] = checked_cast< u32 >( cgltf_accessor_read_index( prim.indices, i ) );
+	}
+
+	OptimizeTriangleOrder( indices, positions.ptr, positions.n, sizeof( Vec3 ) );
+
+	// put vertices in the order the triangles use them, every stream has to follow along
+	Span< u32 > remap = ALLOC_SPAN( sys_allocator, u32, positions.n );
+	defer { FREE( sys_allocator, remap.ptr ); };
+	size_t num_vertices = meshopt_optimizeVertexFetchRemap( remap.ptr, indices.ptr, indices.n, positions.n );
+	meshopt_remapIndexBuffer( indices.ptr, indices.ptr, indices.n, remap.ptr );
+
 	MeshConfig mesh_config;
+	mesh_config.positions = NewRemappedVertexBuffer( positions.cast< const u8 >(), positions.n, remap, num_vertices );
 
 	for( size_t i = 0; i < prim.attributes_count; i++ ) {
 		const cgltf_attribute & attr = prim.attributes[ i ];
 
-		if( attr.type == cgltf_attribute_type_position ) {
-			Span< const Vec3 > positions = AccessorToSpan( attr.data ).cast< const Vec3 >();
-			mesh_config.num_vertices = positions.n;
-			if( animated ) {
-				mesh_config.positions = NewVertexBuffer( positions );
-				for( Vec3 p : positions ) {
-					model->bounds = Extend( model->bounds, p );
-				}
-			}
-			else {
-				Mat4 node_transform;
-				cgltf_node_transform_local( node, node_transform.ptr() );
-
-				Span< Vec3 > transformed = ALLOC_SPAN( sys_allocator, Vec3, positions.n );
-				for( size_t j = 0; j < positions.n; j++ ) {
-					transformed[ j ] = ( node_transform * Vec4( positions[ j ], 1.0f ) ).xyz();
-					model->bounds = Extend( model->bounds, transformed[ j ] );
-				}
-				mesh_config.positions = NewVertexBuffer( transformed );
-				FREE( sys_allocator, transformed.ptr );
-			}
-		}
-
 		if( attr.type == cgltf_attribute_type_normal ) {
-			mesh_config.normals = NewVertexBuffer( AccessorToSpan( attr.data ) );
+			mesh_config.normals = NewRemappedVertexBuffer( AccessorToSpan( attr.data ), positions.n, remap, num_vertices );
 		}
 
 		if( attr.type == cgltf_attribute_type_texcoord ) {
-			mesh_config.tex_coords = NewVertexBuffer( AccessorToSpan( attr.data ) );
+			mesh_config.tex_coords = NewRemappedVertexBuffer( AccessorToSpan( attr.data ), positions.n, remap, num_vertices );
 		}
 
 		if( attr.type == cgltf_attribute_type_joints ) {
@@ -165,7 +197,7 @@ static void LoadNode( Model * model, const cgltf_node * node, bool animated ) {
 			for( size_t j = 0; j < joints_u16.n; j++ ) {
 				joints_u8[ j ] = checked_cast< u8 >( joints_u16[ j ] );
 			}
-			mesh_config.joints = NewVertexBuffer( joints_u8 );
+			mesh_config.joints = NewRemappedVertexBuffer( joints_u8, positions.n, remap, num_vertices );
 			mesh_config.joints_format = VertexFormat_U8x4;
 			FREE( sys_allocator, joints_u8.ptr );
 		}
@@ -176,15 +208,26 @@ static void LoadNode( Model * model, const cgltf_node * node, bool animated ) {
 			for( size_t k = 0; k < weights_float.n; k++ ) {
 				weights_u8[ k ] = weights_float[ k ] * 255;
 			}
-			mesh_config.weights = NewVertexBuffer( weights_u8 );
+			mesh_config.weights = NewRemappedVertexBuffer( weights_u8, positions.n, remap, num_vertices );
 			mesh_config.weights_format = VertexFormat_U8x4_Norm;
 			FREE( sys_allocator, weights_u8.ptr );
 		}
 	}
 
-	mesh_config.indices = NewIndexBuffer( AccessorToSpan( prim.indices ) );
-	mesh_config.indices_format = prim.indices->component_type == cgltf_component_type_r_16u ? IndexFormat_U16 : IndexFormat_U32;
-	mesh_config.num_vertices = prim.indices->count;
+	if( num_vertices <= U16_MAX ) {
+		Span< u16 > indices_u16 = ALLOC_SPAN( sys_allocator, u16, indices.n );
+		for( size_t i = 0; i < indices.n; i++ ) {
+			indices_u16[ i ] = indices[ i ];
+		}
+		mesh_config.indices = NewIndexBuffer( indices_u16 );
+		mesh_config.indices_format = IndexFormat_U16;
+		FREE( sys_allocator, indices_u16.ptr );
+	}
+	else {
+		mesh_config.indices = NewIndexBuffer( indices );
+		mesh_config.indices_format = IndexFormat_U32;
+	}
+	mesh_config.num_vertices = indices.n;
 	mesh_config.ccw_winding = true;
 
 	Model::Primitive * primitive = &model->primitives[ model->num_primitives ];
@@ -198,6 +241,26 @@ static void LoadNode( Model * model, const cgltf_node * node, bool animated ) {
 	primitive->material = FindMaterial( material_name );
 }
 
+template< typename T >
+static void DetectUniformSampling( Model::AnimationChannel< T > * channel ) {
+	channel->inv_sample_interval = 0.0f;
+	if( channel->num_samples < 2 )
+		return;
+
+	float interval = ( channel->times[ channel->num_samples - 1 ] - channel->times[ 0 ] ) / ( channel->num_samples - 1 );
+	if( interval <= 0.0f )
+		return;
+
+	for( u32 i = 1; i < channel->num_samples; i++ ) {
+		float expected = channel->times[ 0 ] + i * interval;
+		if( Abs( channel->times[ i ] - expected ) > interval * 0.001f ) {
+			return;
+		}
+	}
+
+	channel->inv_sample_interval = 1.0f / interval;
+}
+
 template< typename T >
 static void LoadChannel( const cgltf_animation_channel * chan, Model::AnimationChannel< T > * out_channel ) {
 	constexpr size_t lanes = sizeof( T ) / sizeof( float );
@@ -213,6 +276,8 @@ static void LoadChannel( const cgltf_animation_channel * chan, Model::AnimationC
 		ok = ok && cgltf_accessor_read_float( chan->sampler->output, i, out_channel->samples[ i ].ptr(), lanes );
 		assert( ok != 0 );
 	}
+
+	DetectUniformSampling( out_channel );
 }
 
 static void LoadScaleChannel( const cgltf_animation_channel * chan, Model::AnimationChannel< float > * out_channel ) {
@@ -234,6 +299,8 @@ static void LoadScaleChannel( const cgltf_animation_channel * chan, Model::Anima
 
 		out_channel->samples[ i ] = scale[ 0 ];
 	}
+
+	DetectUniformSampling( out_channel );
 }
 
 static void LoadAnimation( Model * model, const cgltf_animation * animation ) {
@@ -1,3 +1,5 @@
+#include <algorithm> // std::lower_bound
+
 #include "qcommon/base.h"
 #include "qcommon/qcommon.h"
 #include "qcommon/hashtable.h"
@@ -5,16 +7,23 @@
 #include "client/renderer/renderer.h"
 #include "client/renderer/model.h"
 
+#include "meshoptimizer/meshoptimizer.h"
+
 constexpr u32 MAX_MODEL_ASSETS = 1024;
 
 static Model models[ MAX_MODEL_ASSETS ];
 static u32 num_models;
 static Hashtable< MAX_MODEL_ASSETS * 2 > models_hashtable;
 
+// slots freed by FreeModel, reused before growing num_models
+static u32 free_models[ MAX_MODEL_ASSETS ];
+static u32 num_free_models;
+
 void InitModels() {
 	ZoneScoped;
 
 	num_models = 0;
+	num_free_models = 0;
 
 	for( const char * path : AssetPaths() ) {
 		Span< const char > ext = FileExtension( path );
@@ -27,6 +36,19 @@ void InitModels() {
 	}
 }
 
+// reorders triangles for the post-transform cache, then trades a little of
+// that back for less overdraw. safe to call from worker threads
+void OptimizeTriangleOrder( Span< u32 > indices, const Vec3 * positions, size_t num_vertices, size_t positions_stride ) {
+	ZoneScoped;
+
+	if( indices.n == 0 )
+		return;
+
+	constexpr float overdraw_threshold = 1.05f;
+	meshopt_optimizeVertexCache( indices.ptr, indices.ptr, indices.n, num_vertices );
+	meshopt_optimizeOverdraw( indices.ptr, indices.ptr, indices.n, positions->ptr(), num_vertices, positions_stride, overdraw_threshold );
+}
+
 static void DeleteModel( Model * model ) {
 	for( u32 i = 0; i < model->num_primitives; i++ ) {
 		if( model->primitives[ i ].num_vertices == 0 ) {
@@ -79,10 +101,22 @@ void ShutdownModels() {
 }
 
 Model * NewModel( u64 hash ) {
-	Model * model = &models[ num_models ];
-	models_hashtable.add( hash, num_models );
-	num_models++;
-	return model;
+	u32 idx = num_free_models > 0 ? free_models[ --num_free_models ] : num_models++;
+	models_hashtable.add( hash, idx );
+	return &models[ idx ];
+}
+
+void FreeModel( u64 hash ) {
+	u64 idx;
+	if( !models_hashtable.get( hash, &idx ) )
+		return;
+
+	DeleteModel( &models[ idx ] );
+	models[ idx ] = { };
+
+	models_hashtable.remove( hash );
+	free_models[ num_free_models ] = idx;
+	num_free_models++;
 }
 
 const Model * FindModel( StringHash name ) {
@@ -219,12 +253,16 @@ static T SampleAnimationChannel( const Model::AnimationChannel< T > & channel, f
 
 	t = Clamp( channel.times[ 0 ], t, channel.times[ channel.num_samples - 1 ] );
 
-	u32 sample = 0;
-	for( u32 i = 1; i < channel.num_samples; i++ ) {
-		if( channel.times[ i ] >= t ) {
-			sample = i - 1;
-			break;
-		}
+	// exported animations are nearly always baked at a fixed rate, so we
+	// can index straight into them. otherwise find the first sample at or
+	// after t
+	u32 sample;
+	if( channel.inv_sample_interval != 0.0f ) {
+		sample = Min2( u32( ( t - channel.times[ 0 ] ) * channel.inv_sample_interval ), channel.num_samples - 2 );
+	}
+	else {
+		const float * after = std::lower_bound( channel.times + 1, channel.times + channel.num_samples, t );
+		sample = u32( after - channel.times ) - 1;
 	}
 
 	float lerp_frac = ( t - channel.times[ sample ] ) / ( channel.times[ sample + 1 ] - channel.times[ sample ] );
@@ -277,28 +315,24 @@ static Mat4 TRSToMat4( const TRS & trs ) {
 	);
 }
 
-MatrixPalettes ComputeMatrixPalettes( Allocator * a, const Model * model, Span< TRS > local_poses ) {
+void ComputeMatrixPalettes( MatrixPalettes * palettes, const Model * model, Span< const TRS > local_poses ) {
 	ZoneScoped;
 
 	assert( local_poses.n == model->num_joints );
-
-	MatrixPalettes palettes;
-	palettes.joint_poses = ALLOC_SPAN( a, Mat4, model->num_joints );
-	palettes.skinning_matrices = ALLOC_SPAN( a, Mat4, model->num_joints );
+	assert( palettes->joint_poses.n == model->num_joints );
+	assert( palettes->skinning_matrices.n == model->num_joints );
 
 	u8 joint_idx = model->root_joint;
-	palettes.joint_poses[ joint_idx ] = TRSToMat4( local_poses[ joint_idx ] );
+	palettes->joint_poses[ joint_idx ] = TRSToMat4( local_poses[ joint_idx ] );
 	for( u8 i = 0; i < model->num_joints - 1; i++ ) {
 		joint_idx = model->joints[ joint_idx ].next;
 		u8 parent = model->joints[ joint_idx ].parent;
-		palettes.joint_poses[ joint_idx ] = palettes.joint_poses[ parent ] * TRSToMat4( local_poses[ joint_idx ] );
+		palettes->joint_poses[ joint_idx ] = palettes->joint_poses[ parent ] * TRSToMat4( local_poses[ joint_idx ] );
 	}
 
 	for( u8 i = 0; i < model->num_joints; i++ ) {
-		palettes.skinning_matrices[ i ] = palettes.joint_poses[ i ] * model->joints[ i ].joint_to_bind;
+		palettes->skinning_matrices[ i ] = palettes->joint_poses[ i ] * model->joints[ i ].joint_to_bind;
 	}
-
-	return palettes;
 }
 
 bool FindJointByName( const Model * model, u32 name, u8 * joint_idx ) {
@@ -17,6 +17,7 @@ struct Model {
 		T * samples;
 		float * times;
 		u32 num_samples;
+		float inv_sample_interval; // 0 if the samples aren't evenly spaced
 	};
 
 	struct Joint {
@@ -55,11 +56,15 @@ const Model * FindModel( StringHash name );
 const Model * FindModel( const char * name );
 
 Model * NewModel( u64 hash );
+void FreeModel( u64 hash );
 
 bool LoadGLTFModel( Model * model, const char * path );
 
+void OptimizeTriangleOrder( Span< u32 > indices, const Vec3 * positions, size_t num_vertices, size_t positions_stride );
+
 struct Map;
 bool LoadBSPRenderData( Map * map, u64 base_hash, Span< const u8 > data );
+void UnloadBSPRenderData( const Map * map );
 
 void DrawModelPrimitive( const Model * model, const Model::Primitive * primitive, const PipelineState & pipeline );
 void DrawModel( const Model * model, const Mat4 & transform, const Vec4 & color, Span< const Mat4 > skinning_matrices = Span< const Mat4 >() );
@@ -71,6 +76,6 @@ void DrawOutlinedModel( const Model * model, const Mat4 & transform, const Vec4
 MinMax3 ModelBounds( const Model * model );
 
 Span< TRS > SampleAnimation( Allocator * a, const Model * model, float t );
-MatrixPalettes ComputeMatrixPalettes( Allocator * a, const Model * model, Span< TRS > local_poses );
+void ComputeMatrixPalettes( MatrixPalettes * palettes, const Model * model, Span< const TRS > local_poses );
 bool FindJointByName( const Model * model, u32 name, u8 * joint_idx );
 void MergeLowerUpperPoses( Span< TRS > lower, Span< const TRS > upper, const Model * model, u8 upper_root_joint );
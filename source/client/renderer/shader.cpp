@@ -90,7 +90,9 @@ static void LoadShaders() {
 		"#define APPLY_DRAWFLAT 1\n"
 		"#define APPLY_FOG 1\n"
 		"#define APPLY_DECALS 1\n"
-		"#define TILE_SIZE {}\n", TILE_SIZE );
+		"#define TILE_SIZE {}\n"
+		"#define CLUSTER_DEPTH_SLICES {}\n"
+		"#define CLUSTER_FAR_PLANE {}.0\n", TILE_SIZE, CLUSTER_DEPTH_SLICES, CLUSTER_FAR_PLANE );
 	BuildShaderSrcs( "glsl/standard.glsl", world_defines, &srcs, &lengths );
 	ReplaceShader( &shaders.world, srcs.span(), lengths.span() );
 
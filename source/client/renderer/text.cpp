@@ -4,6 +4,7 @@
 #include "qcommon/string.h"
 #include "qcommon/utf8.h"
 #include "qcommon/hash.h"
+#include "qcommon/hashtable.h"
 #include "qcommon/serialization.h"
 
 #include "client/renderer/renderer.h"
@@ -18,8 +19,6 @@
 
 #include "stb/stb_image.h"
 
-static constexpr size_t MAX_CHARS_PER_FRAME = 100000;
-
 struct Glyph {
 	MinMax2 bounds;
 	MinMax2 uv_bounds;
@@ -44,6 +43,13 @@ static FT_Library freetype;
 static Font fonts[ 64 ];
 static size_t num_fonts;
 
+struct FontUniforms {
+	s64 frame;
+	UniformBlock blocks[ 2 ];
+};
+
+static FontUniforms font_uniforms[ ARRAY_COUNT( fonts ) ];
+
 bool InitText() {
 	int err = FT_Init_FreeType( &freetype );
 	if( err != 0 ) {
@@ -52,6 +58,9 @@ bool InitText() {
 	}
 
 	num_fonts = 0;
+	for( FontUniforms & uniforms : font_uniforms ) {
+		uniforms.frame = -1;
+	}
 
 	return true;
 }
@@ -146,23 +155,71 @@ const Font * RegisterFont( const char * path ) {
 	return font;
 }
 
-static void DrawText( const Font * font, float pixel_size, Span< const char > str, float x, float y, Vec4 color, bool border, Vec4 border_color ) {
-	if( font == NULL )
+/*
+ * text layout cache
+ *
+ * layout is linear in the font size so runs are stored in font units and
+ * keyed on ( font, string ) only. there are two generations of cache,
+ * strings used this frame get copied into the current generation and the
+ * previous one is thrown away at the start of each frame, so anything that
+ * goes a frame without being drawn gets evicted
+ */
+
+static constexpr size_t MAX_CACHED_STRINGS = 1024;
+static constexpr size_t MAX_CACHED_GLYPHS = 32768;
+
+struct ShapedGlyph {
+	MinMax2 bounds; // relative to the start of the run
+	MinMax2 uv_bounds;
+};
+
+struct ShapedText {
+	Span< const ShapedGlyph > glyphs;
+	MinMax2 bounds;
+};
+
+struct TextCacheGeneration {
+	Hashtable< MAX_CACHED_STRINGS * 2 > hashtable;
+
+	MinMax2 bounds[ MAX_CACHED_STRINGS ];
+	u32 first_glyph[ MAX_CACHED_STRINGS ];
+	u32 num_glyphs[ MAX_CACHED_STRINGS ];
+	size_t num_strings;
+
+	ShapedGlyph glyphs[ MAX_CACHED_GLYPHS ];
+	size_t num_glyphs_total;
+};
+
+static TextCacheGeneration text_cache_generations[ 2 ];
+static size_t current_text_cache_generation;
+static s64 text_cache_frame = -1;
+
+// scratch space for strings that don't fit in the cache
+static ShapedGlyph uncached_glyphs[ MAX_CACHED_GLYPHS ];
+
+static void ClearTextCacheGeneration( TextCacheGeneration * gen ) {
+	gen->hashtable.clear();
+	gen->num_strings = 0;
+	gen->num_glyphs_total = 0;
+}
+
+static void CycleTextCache() {
+	if( text_cache_frame == cls.framecount )
 		return;
 
-	y += pixel_size * font->ascent;
+	current_text_cache_generation = 1 - current_text_cache_generation;
+	ClearTextCacheGeneration( &text_cache_generations[ current_text_cache_generation ] );
+	text_cache_frame = cls.framecount;
+}
 
-	ImGuiShaderAndMaterial sam;
-	sam.shader = &shaders.text;
-	sam.material = &font->material;
-	sam.uniform_name = "u_Text";
-	sam.uniform_block = UploadUniformBlock(
-		color, border_color,
-		Vec2( font->atlas.width, font->atlas.height ),
-		font->dSDF_dTexel, border ? 1 : 0 );
+// returns the number of glyphs that would have been written, which can be
+// more than max_glyphs
+static size_t ShapeText( const Font * font, Span< const char > str, ShapedGlyph * glyphs, size_t max_glyphs, MinMax2 * bounds ) {
+	size_t num_glyphs = 0;
 
-	ImDrawList * bg = ImGui::GetBackgroundDrawList();
-	bg->PushTextureID( sam );
+	float x = 0.0f;
+	MinMax1 y_extents = MinMax1::Empty();
+	const Glyph * glyph = NULL;
 
 	u32 state = 0;
 	u32 c = 0;
@@ -172,65 +229,200 @@ static void DrawText( const Font * font, float pixel_size, Span< const char > st
 		if( c > 255 )
 			c = '?';
 
-		const Glyph * glyph = &font->glyphs[ c ];
+		glyph = &font->glyphs[ c ];
 
 		if( glyph->bounds.mins.x != glyph->bounds.maxs.x && glyph->bounds.mins.y != glyph->bounds.maxs.y ) {
-			// TODO: this is bogus. it should expand glyphs by 1 or
-			// 2 pixels to allow for border/antialiasing, up to a
-			// limit determined by font->glyph_padding
-			Vec2 mins = Vec2( x, y ) + pixel_size * ( glyph->bounds.mins - font->glyph_padding );
-			Vec2 maxs = Vec2( x, y ) + pixel_size * ( glyph->bounds.maxs + font->glyph_padding );
-			bg->PrimReserve( 6, 4 );
-			bg->PrimRectUV( mins, maxs, glyph->uv_bounds.mins, glyph->uv_bounds.maxs, IM_COL32_WHITE );
+			if( num_glyphs < max_glyphs ) {
+				// TODO: this is bogus. it should expand glyphs by 1 or
+				// 2 pixels to allow for border/antialiasing, up to a
+				// limit determined by font->glyph_padding
+				ShapedGlyph * shaped = &glyphs[ num_glyphs ];
+				shaped->bounds.mins = Vec2( x, 0.0f ) + glyph->bounds.mins - font->glyph_padding;
+				shaped->bounds.maxs = Vec2( x, 0.0f ) + glyph->bounds.maxs + font->glyph_padding;
+				shaped->uv_bounds = glyph->uv_bounds;
+			}
+			num_glyphs++;
 		}
 
-		x += pixel_size * glyph->advance;
+		x += glyph->advance;
+		y_extents.lo = Min2( glyph->bounds.mins.y, y_extents.lo );
+		y_extents.hi = Max2( glyph->bounds.maxs.y, y_extents.hi );
 		// TODO: kerning
 	}
 
-	bg->PopTextureID();
+	if( glyph == NULL ) {
+		*bounds = MinMax2( Vec2( 0 ), Vec2( 0 ) );
+	}
+	else {
+		float width = x - glyph->advance + glyph->bounds.maxs.x - glyph->bounds.mins.x;
+		*bounds = MinMax2( Vec2( 0, y_extents.lo ), Vec2( width, y_extents.hi ) );
+	}
+
+	return num_glyphs;
 }
 
-void DrawText( const Font * font, float pixel_size, const char * str, float x, float y, Vec4 color, bool border ) {
-	Vec4 border_color = Vec4( 0, 0, 0, color.w );
-	DrawText( font, pixel_size, MakeSpan( str ), x, y, color, border, border_color );
+static ShapedText ShapedTextFromCache( const TextCacheGeneration * gen, u64 idx ) {
+	ShapedText text;
+	text.glyphs = Span< const ShapedGlyph >( gen->glyphs + gen->first_glyph[ idx ], gen->num_glyphs[ idx ] );
+	text.bounds = gen->bounds[ idx ];
+	return text;
 }
 
-void DrawText( const Font * font, float pixel_size, const char * str, float x, float y, Vec4 color, Vec4 border_color ) {
-	DrawText( font, pixel_size, MakeSpan( str ), x, y, color, true, border_color );
+static bool AddToTextCache( TextCacheGeneration * gen, u64 key, Span< const ShapedGlyph > glyphs, MinMax2 bounds, ShapedText * text ) {
+	if( gen->num_strings == MAX_CACHED_STRINGS || gen->num_glyphs_total + glyphs.n > MAX_CACHED_GLYPHS )
+		return false;
+
+	size_t idx = gen->num_strings;
+	if( !gen->hashtable.add( key, idx ) )
+		return false;
+
+	memcpy( gen->glyphs + gen->num_glyphs_total, glyphs.ptr, glyphs.num_bytes() );
+	gen->first_glyph[ idx ] = gen->num_glyphs_total;
+	gen->num_glyphs[ idx ] = glyphs.n;
+	gen->bounds[ idx ] = bounds;
+
+	gen->num_strings++;
+	gen->num_glyphs_total += glyphs.n;
+
+	*text = ShapedTextFromCache( gen, idx );
+	return true;
 }
 
-MinMax2 TextBounds( const Font * font, float pixel_size, const char * str ) {
-	float width = 0.0f;
-	MinMax1 y_extents = MinMax1::Empty();
+static ShapedText LayoutText( const Font * font, Span< const char > str ) {
+	ZoneScoped;
 
-	u32 state = 0;
-	u32 c = 0;
-	const Glyph * glyph = NULL;
+	CycleTextCache();
 
-	for( const char * p = str; *p != '\0'; p++ ) {
-		if( DecodeUTF8( &state, &c, *p ) != 0 )
-			continue;
-		if( c > 255 )
-			c = '?';
+	TextCacheGeneration * current = &text_cache_generations[ current_text_cache_generation ];
+	TextCacheGeneration * previous = &text_cache_generations[ 1 - current_text_cache_generation ];
 
-		glyph = &font->glyphs[ c ];
-		width += glyph->advance;
-		y_extents.lo = Min2( glyph->bounds.mins.y, y_extents.lo );
-		y_extents.hi = Max2( glyph->bounds.maxs.y, y_extents.hi );
+	u64 key = Hash64( str.ptr, str.n, font->path_hash );
+	key = key == 0 ? 1 : key;
+
+	u64 idx;
+	if( current->hashtable.get( key, &idx ) ) {
+		return ShapedTextFromCache( current, idx );
+	}
+
+	ShapedText text;
+
+	if( previous->hashtable.get( key, &idx ) ) {
+		ShapedText old = ShapedTextFromCache( previous, idx );
+		if( AddToTextCache( current, key, old.glyphs, old.bounds, &text ) ) {
+			return text;
+		}
+		return old;
+	}
+
+	// shape straight into the cache if it fits, otherwise into scratch space
+	size_t space = current->num_strings < MAX_CACHED_STRINGS ? MAX_CACHED_GLYPHS - current->num_glyphs_total : 0;
+
+	MinMax2 bounds;
+	size_t num_glyphs = ShapeText( font, str, current->glyphs + current->num_glyphs_total, space, &bounds );
+	if( num_glyphs <= space && current->hashtable.add( key, current->num_strings ) ) {
+		size_t i = current->num_strings;
+		current->first_glyph[ i ] = current->num_glyphs_total;
+		current->num_glyphs[ i ] = num_glyphs;
+		current->bounds[ i ] = bounds;
+		current->num_strings++;
+		current->num_glyphs_total += num_glyphs;
+		return ShapedTextFromCache( current, i );
+	}
+
+	num_glyphs = ShapeText( font, str, uncached_glyphs, ARRAY_COUNT( uncached_glyphs ), &bounds );
+	text.glyphs = Span< const ShapedGlyph >( uncached_glyphs, Min2( num_glyphs, ARRAY_COUNT( uncached_glyphs ) ) );
+	text.bounds = bounds;
+	return text;
+}
+
+/*
+ * text color goes in the vertex colors so the uniforms only depend on the
+ * font and the border mode, and are uploaded once per frame. that lets
+ * ImGui merge consecutive DrawText calls with the same font into a single
+ * draw call
+ */
+
+enum BorderMode {
+	BorderMode_None,
+	BorderMode_TextAlpha, // black border that follows the text alpha
+	BorderMode_Custom,
+};
+
+static UniformBlock TextUniforms( const Font * font, Vec4 border_color, BorderMode mode ) {
+	if( mode == BorderMode_Custom ) {
+		return UploadUniformBlock( border_color, Vec2( font->atlas.width, font->atlas.height ), font->dSDF_dTexel, s32( mode ) );
+	}
+
+	FontUniforms * uniforms = &font_uniforms[ font - fonts ];
+	if( uniforms->frame != cls.framecount ) {
+		for( s32 i = 0; i < 2; i++ ) {
+			uniforms->blocks[ i ] = UploadUniformBlock( Vec4( 0, 0, 0, 1 ), Vec2( font->atlas.width, font->atlas.height ), font->dSDF_dTexel, i );
+		}
+		uniforms->frame = cls.framecount;
+	}
+
+	return uniforms->blocks[ mode ];
+}
+
+static void DrawShapedText( const Font * font, float pixel_size, const ShapedText & text, float x, float y, Vec4 color, bool border, Vec4 border_color ) {
+	y += pixel_size * font->ascent;
+
+	BorderMode mode = BorderMode_None;
+	if( border ) {
+		bool default_border = border_color.xyz() == Vec3( 0.0f ) && border_color.w == color.w;
+		mode = default_border ? BorderMode_TextAlpha : BorderMode_Custom;
+	}
+
+	ImGuiShaderAndMaterial sam;
+	sam.shader = &shaders.text;
+	sam.material = &font->material;
+	sam.uniform_name = "u_Text";
+	sam.uniform_block = TextUniforms( font, border_color, mode );
+
+	RGBA8 rgba = RGBA8( Clamp01( color ) );
+	ImU32 col = IM_COL32( rgba.r, rgba.g, rgba.b, rgba.a );
+
+	ImDrawList * bg = ImGui::GetBackgroundDrawList();
+	bg->PushTextureID( sam );
+	bg->PrimReserve( text.glyphs.n * 6, text.glyphs.n * 4 );
+
+	Vec2 origin = Vec2( x, y );
+	for( const ShapedGlyph & glyph : text.glyphs ) {
+		Vec2 mins = origin + pixel_size * glyph.bounds.mins;
+		Vec2 maxs = origin + pixel_size * glyph.bounds.maxs;
+		bg->PrimRectUV( mins, maxs, glyph.uv_bounds.mins, glyph.uv_bounds.maxs, col );
 	}
 
-	if( glyph == NULL )
-		return MinMax2( Vec2( 0 ), Vec2( 0 ) );
+	bg->PopTextureID();
+}
 
-	width -= glyph->advance;
-	width += glyph->bounds.maxs.x - glyph->bounds.mins.x;
+static void DrawText( const Font * font, float pixel_size, Span< const char > str, float x, float y, Vec4 color, bool border, Vec4 border_color ) {
+	if( font == NULL )
+		return;
 
-	return MinMax2( pixel_size * Vec2( 0, y_extents.lo ), pixel_size * Vec2( width, y_extents.hi ) );
+	DrawShapedText( font, pixel_size, LayoutText( font, str ), x, y, color, border, border_color );
+}
+
+void DrawText( const Font * font, float pixel_size, const char * str, float x, float y, Vec4 color, bool border ) {
+	Vec4 border_color = Vec4( 0, 0, 0, color.w );
+	DrawText( font, pixel_size, MakeSpan( str ), x, y, color, border, border_color );
+}
+
+void DrawText( const Font * font, float pixel_size, const char * str, float x, float y, Vec4 color, Vec4 border_color ) {
+	DrawText( font, pixel_size, MakeSpan( str ), x, y, color, true, border_color );
+}
+
+MinMax2 TextBounds( const Font * font, float pixel_size, const char * str ) {
+	MinMax2 bounds = LayoutText( font, MakeSpan( str ) ).bounds;
+	return MinMax2( pixel_size * bounds.mins, pixel_size * bounds.maxs );
 }
 
 static void DrawText( const Font * font, float pixel_size, const char * str, Alignment align, float x, float y, Vec4 color, bool border, Vec4 border_color ) {
-	MinMax2 bounds = TextBounds( font, pixel_size, str );
+	if( font == NULL )
+		return;
+
+	ShapedText text = LayoutText( font, MakeSpan( str ) );
+	MinMax2 bounds = MinMax2( pixel_size * text.bounds.mins, pixel_size * text.bounds.maxs );
 
 	if( align.x == XAlignment_Center ) {
 		x -= bounds.maxs.x / 2.0f;
@@ -247,7 +439,7 @@ static void DrawText( const Font * font, float pixel_size, const char * str, Ali
 		y += ( bounds.maxs.y - bounds.mins.y ) / 2.0f;
 	}
 
-	DrawText( font, pixel_size, MakeSpan( str ), x, y, color, border, border_color );
+	DrawShapedText( font, pixel_size, text, x, y, color, border, border_color );
 }
 
 void DrawText( const Font * font, float pixel_size, const char * str, Alignment align, float x, float y, Vec4 color, bool border ) {
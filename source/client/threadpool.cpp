@@ -1,4 +1,5 @@
 #include "qcommon/base.h"
+#include "qcommon/memtrack.h"
 #include "qcommon/threads.h"
 #include "client/client.h"
 #include "client/threadpool.h"
@@ -22,15 +23,19 @@ static size_t jobs_head;
 static size_t jobs_length;
 static size_t jobs_done;
 
-static Worker workers[ 32 ];
+static Worker workers[ MAX_THREAD_POOL_WORKERS ];
 static u32 num_workers;
 
+static thread_local u32 thread_index;
+
 static void ThreadPoolWorker( void * data ) {
 #if TRACY_ENABLE
 	tracy::SetThreadName( "Thread pool worker" );
 #endif
 
-	ArenaAllocator * arena = ( ArenaAllocator * ) data;
+	Worker * worker = ( Worker * ) data;
+	ArenaAllocator * arena = &worker->arena;
+	thread_index = 1 + u32( worker - workers );
 
 	while( true ) {
 		Wait( jobs_sem );
@@ -82,7 +87,8 @@ void InitThreadPool() {
 		constexpr size_t arena_size = 1024 * 1024; // 1MB
 		void * arena_memory = ALLOC_SIZE( sys_allocator, arena_size, 16 );
 		workers[ i ].arena = ArenaAllocator( arena_memory, arena_size );
-		workers[ i ].thread = NewThread( ThreadPoolWorker, &workers[ i ].arena );
+		RegisterArena( "Thread pool worker", &workers[ i ].arena );
+		workers[ i ].thread = NewThread( ThreadPoolWorker, &workers[ i ] );
 	}
 }
 
@@ -99,6 +105,7 @@ void ShutdownThreadPool() {
 
 	for( u32 i = 0; i < num_workers; i++ ) {
 		JoinThread( workers[ i ].thread );
+		UnregisterArena( &workers[ i ].arena );
 		FREE( sys_allocator, workers[ i ].arena.get_memory() );
 	}
 
@@ -175,3 +182,7 @@ void ThreadPoolFinish() {
 
 	Unlock( jobs_mutex );
 }
+
+u32 ThreadPoolThreadIndex() {
+	return thread_index;
+}
@@ -4,6 +4,8 @@
 
 typedef void ( *JobCallback )( TempAllocator * temp, void * data );
 
+constexpr u32 MAX_THREAD_POOL_WORKERS = 32;
+
 void InitThreadPool();
 void ShutdownThreadPool();
 
@@ -11,6 +13,9 @@ void ThreadPoolDo( JobCallback callback, void * data = NULL );
 void ParallelFor( void * datum, size_t n, size_t stride, JobCallback callback );
 void ThreadPoolFinish();
 
+// 0 on the main thread, 1 + worker index on pool workers
+u32 ThreadPoolThreadIndex();
+
 template< typename T >
 void ParallelFor( Span< T > datum, JobCallback callback ) {
 	ParallelFor( datum.ptr, datum.n, sizeof( T ), callback );
@@ -0,0 +1,578 @@
+#include <stddef.h> // offsetof
+
+#include "qcommon/qcommon.h"
+#include "qcommon/array.h"
+#include "qcommon/threads.h"
+#include "qcommon/version.h"
+#include "cgame/cg_public.h"
+
+/*
+ * headless demo exporter. it stands in for the client half of the engine,
+ * reads demos with the same snapshot parsing the client uses and dumps
+ * per-frame player and entity state for offline analysis. nothing is
+ * rendered or interpolated so it runs as fast as the disk and the delta
+ * decoder allow, one demo per core
+ *
+ * csv output writes <demo>.players.csv and <demo>.entities.csv
+ *
+ * binary output writes <demo>.cdstats, which is columnar:
+ *   "CDST", u32 version, u32 num tables
+ *   per table: u8 name length, name, u32 num rows, u32 num columns
+ *   per column: u8 name length, name, u8 type (0 = s64, 1 = s32, 2 = f32),
+ *     then num rows packed little endian values
+ */
+
+struct PlayerRow {
+	s64 server_time;
+	s32 player_num;
+	s32 team;
+	s32 health;
+	s32 weapon;
+	float origin[ 3 ];
+	float velocity[ 3 ];
+	float pitch, yaw;
+};
+
+struct EntityRow {
+	s64 server_time;
+	s32 number;
+	s32 type;
+	s32 team;
+	s32 weapon;
+	float origin[ 3 ];
+	float origin2[ 3 ];
+	float angles[ 3 ];
+};
+
+enum ColumnType : u8 {
+	ColumnType_S64,
+	ColumnType_S32,
+	ColumnType_F32,
+};
+
+struct Column {
+	const char * name;
+	ColumnType type;
+	size_t offset;
+};
+
+static const Column player_columns[] = {
+	{ "server_time", ColumnType_S64, offsetof( PlayerRow, server_time ) },
+	{ "player_num", ColumnType_S32, offsetof( PlayerRow, player_num ) },
+	{ "team", ColumnType_S32, offsetof( PlayerRow, team ) },
+	{ "health", ColumnType_S32, offsetof( PlayerRow, health ) },
+	{ "weapon", ColumnType_S32, offsetof( PlayerRow, weapon ) },
+	{ "x", ColumnType_F32, offsetof( PlayerRow, origin[ 0 ] ) },
+	{ "y", ColumnType_F32, offsetof( PlayerRow, origin[ 1 ] ) },
+	{ "z", ColumnType_F32, offsetof( PlayerRow, origin[ 2 ] ) },
+	{ "vx", ColumnType_F32, offsetof( PlayerRow, velocity[ 0 ] ) },
+	{ "vy", ColumnType_F32, offsetof( PlayerRow, velocity[ 1 ] ) },
+	{ "vz", ColumnType_F32, offsetof( PlayerRow, velocity[ 2 ] ) },
+	{ "pitch", ColumnType_F32, offsetof( PlayerRow, pitch ) },
+	{ "yaw", ColumnType_F32, offsetof( PlayerRow, yaw ) },
+};
+
+static const Column entity_columns[] = {
+	{ "server_time", ColumnType_S64, offsetof( EntityRow, server_time ) },
+	{ "number", ColumnType_S32, offsetof( EntityRow, number ) },
+	{ "type", ColumnType_S32, offsetof( EntityRow, type ) },
+	{ "team", ColumnType_S32, offsetof( EntityRow, team ) },
+	{ "weapon", ColumnType_S32, offsetof( EntityRow, weapon ) },
+	{ "x", ColumnType_F32, offsetof( EntityRow, origin[ 0 ] ) },
+	{ "y", ColumnType_F32, offsetof( EntityRow, origin[ 1 ] ) },
+	{ "z", ColumnType_F32, offsetof( EntityRow, origin[ 2 ] ) },
+	{ "x2", ColumnType_F32, offsetof( EntityRow, origin2[ 0 ] ) },
+	{ "y2", ColumnType_F32, offsetof( EntityRow, origin2[ 1 ] ) },
+	{ "z2", ColumnType_F32, offsetof( EntityRow, origin2[ 2 ] ) },
+	{ "pitch", ColumnType_F32, offsetof( EntityRow, angles[ 0 ] ) },
+	{ "yaw", ColumnType_F32, offsetof( EntityRow, angles[ 1 ] ) },
+	{ "roll", ColumnType_F32, offsetof( EntityRow, angles[ 2 ] ) },
+};
+
+struct DemoJob {
+	const char * filename;
+
+	bool ok;
+	u32 frames;
+	size_t player_rows;
+	size_t entity_rows;
+	int64_t duration; // in game time
+	int64_t elapsed; // in real time
+};
+
+static cvar_t * demotool_entities;
+static cvar_t * demotool_format;
+static cvar_t * demotool_threads;
+
+static DemoJob * jobs;
+static int num_jobs;
+static int next_job;
+static Mutex * jobs_mutex;
+
+/*
+ * output
+ */
+
+struct OutputFile {
+	int file;
+	size_t used;
+	char buf[ 64 * 1024 ];
+};
+
+static bool OpenOutput( OutputFile * out, const char * filename ) {
+	out->used = 0;
+	if( FS_FOpenAbsoluteFile( filename, &out->file, FS_WRITE ) == -1 ) {
+		Com_Printf( S_COLOR_RED "Couldn't open %s for writing\n", filename );
+		return false;
+	}
+	return true;
+}
+
+static void FlushOutput( OutputFile * out ) {
+	FS_Write( out->buf, out->used, out->file );
+	out->used = 0;
+}
+
+static void CloseOutput( OutputFile * out ) {
+	FlushOutput( out );
+	FS_FCloseFile( out->file );
+}
+
+static void Write( OutputFile * out, const void * data, size_t len ) {
+	if( out->used + len > sizeof( out->buf ) ) {
+		FlushOutput( out );
+	}
+	memcpy( out->buf + out->used, data, len );
+	out->used += len;
+}
+
+static void WriteName( OutputFile * out, const char * name ) {
+	u8 len = u8( strlen( name ) );
+	Write( out, &len, sizeof( len ) );
+	Write( out, name, len );
+}
+
+static size_t ColumnSize( ColumnType type ) {
+	return type == ColumnType_S64 ? sizeof( s64 ) : sizeof( s32 );
+}
+
+// rows are plain structs of little endian scalars, so a column is a strided copy
+static void WriteBinaryTable( OutputFile * out, const char * name, const Column * columns, u32 num_columns, const void * rows, u32 num_rows, size_t stride ) {
+	WriteName( out, name );
+	Write( out, &num_rows, sizeof( num_rows ) );
+	Write( out, &num_columns, sizeof( num_columns ) );
+
+	for( u32 i = 0; i < num_columns; i++ ) {
+		const Column & column = columns[ i ];
+		WriteName( out, column.name );
+		Write( out, &column.type, sizeof( column.type ) );
+
+		size_t size = ColumnSize( column.type );
+		const char * cursor = ( const char * ) rows + column.offset;
+		for( u32 j = 0; j < num_rows; j++ ) {
+			Write( out, cursor, size );
+			cursor += stride;
+		}
+	}
+}
+
+static void WriteCSVHeader( OutputFile * out, const Column * columns, size_t num_columns ) {
+	for( size_t i = 0; i < num_columns; i++ ) {
+		const char * name = columns[ i ].name;
+		Write( out, name, strlen( name ) );
+		Write( out, i == num_columns - 1 ? "\n" : ",", 1 );
+	}
+}
+
+static void WriteCSVRow( OutputFile * out, const Column * columns, size_t num_columns, const void * row ) {
+	for( size_t i = 0; i < num_columns; i++ ) {
+		const void * value = ( const char * ) row + columns[ i ].offset;
+
+		// %.2f of FLT_MAX is 43 chars, so this always fits
+		char buf[ 64 ];
+		int n = 0;
+		switch( columns[ i ].type ) {
+			case ColumnType_S64: n = snprintf( buf, sizeof( buf ), "%" PRIi64, *( const s64 * ) value ); break;
+			case ColumnType_S32: n = snprintf( buf, sizeof( buf ), "%d", *( const s32 * ) value ); break;
+			case ColumnType_F32: n = snprintf( buf, sizeof( buf ), "%.2f", *( const float * ) value ); break;
+		}
+
+		Write( out, buf, Clamp( 0, n, int( sizeof( buf ) - 1 ) ) );
+		Write( out, i == num_columns - 1 ? "\n" : ",", 1 );
+	}
+}
+
+static void WriteCSVTable( const char * filename, const Column * columns, size_t num_columns, const void * rows, size_t num_rows, size_t stride ) {
+	OutputFile * out = ALLOC( sys_allocator, OutputFile );
+	if( OpenOutput( out, filename ) ) {
+		WriteCSVHeader( out, columns, num_columns );
+		for( size_t i = 0; i < num_rows; i++ ) {
+			WriteCSVRow( out, columns, num_columns, ( const char * ) rows + i * stride );
+		}
+		CloseOutput( out );
+	}
+	FREE( sys_allocator, out );
+}
+
+/*
+ * parsing
+ */
+
+struct DemoParser {
+	snapshot_t * snapshots;
+	SyncEntityState * baselines;
+	int64_t last_frame;
+	bool reliable;
+
+	DynamicArray< PlayerRow > * players;
+	DynamicArray< EntityRow > * entities;
+
+	int64_t first_time;
+	int64_t last_time;
+	u32 frames;
+};
+
+// like SNAP_ReadDemoMessage but demos that were cut off by a crash just
+// end early instead of dropping to the console
+static bool ReadDemoMessage( int file, msg_t * msg ) {
+	int msglen = -1;
+	if( FS_Read( &msglen, sizeof( msglen ), file ) != sizeof( msglen ) )
+		return false;
+
+	msglen = LittleLong( msglen );
+	if( msglen < 0 || size_t( msglen ) > msg->maxsize )
+		return false;
+
+	if( FS_Read( msg->data, msglen, file ) != msglen )
+		return false;
+
+	msg->cursize = msglen;
+	msg->readcount = 0;
+	return true;
+}
+
+static void AddPlayerRow( DemoParser * parser, const snapshot_t * snap, const SyncPlayerState * ps ) {
+	PlayerRow row;
+	row.server_time = snap->serverTime;
+	row.player_num = ps->playerNum;
+	row.team = ps->team;
+	row.health = ps->health;
+	row.weapon = ps->weapon;
+	for( int i = 0; i < 3; i++ ) {
+		row.origin[ i ] = ps->pmove.origin[ i ];
+		row.velocity[ i ] = ps->pmove.velocity[ i ];
+	}
+	row.pitch = ps->viewangles[ PITCH ];
+	row.yaw = ps->viewangles[ YAW ];
+	parser->players->add( row );
+}
+
+static void AddEntityRow( DemoParser * parser, const snapshot_t * snap, const SyncEntityState * ent ) {
+	EntityRow row;
+	row.server_time = snap->serverTime;
+	row.number = ent->number;
+	row.type = ent->type;
+	row.team = ent->team;
+	row.weapon = ent->weapon;
+	for( int i = 0; i < 3; i++ ) {
+		row.origin[ i ] = ent->origin[ i ];
+		row.origin2[ i ] = ent->origin2[ i ];
+		row.angles[ i ] = ent->angles[ i ];
+	}
+	parser->entities->add( row );
+}
+
+static void ParseFrame( DemoParser * parser, msg_t * msg ) {
+	snapshot_t * last = parser->last_frame > 0 ? &parser->snapshots[ parser->last_frame & UPDATE_MASK ] : NULL;
+	snapshot_t * snap = SNAP_ParseFrame( msg, last, parser->snapshots, parser->baselines, 0 );
+	if( !snap->valid )
+		return;
+
+	parser->last_frame = snap->serverFrame;
+	if( parser->frames == 0 ) {
+		parser->first_time = snap->serverTime;
+	}
+	parser->last_time = snap->serverTime;
+	parser->frames++;
+
+	// server demos carry everyone, client demos only the recorder's POV
+	if( snap->multipov ) {
+		for( int i = 0; i < snap->numplayers; i++ ) {
+			AddPlayerRow( parser, snap, &snap->playerStates[ i ] );
+		}
+	}
+	else {
+		AddPlayerRow( parser, snap, &snap->playerState );
+	}
+
+	if( demotool_entities->integer != 0 ) {
+		for( int i = 0; i < snap->numEntities; i++ ) {
+			AddEntityRow( parser, snap, &snap->parsedEntities[ i & ( MAX_PARSE_ENTITIES - 1 ) ] );
+		}
+	}
+}
+
+static bool ParseDemoMessage( DemoParser * parser, msg_t * msg ) {
+	while( msg->readcount < msg->cursize ) {
+		int cmd = MSG_ReadUint8( msg );
+		switch( cmd ) {
+			case svc_demoinfo: {
+				MSG_ReadInt32( msg ); // length
+				MSG_ReadInt32( msg ); // meta data offset
+				MSG_ReadInt32( msg ); // meta data size
+				int meta_data_maxsize = MSG_ReadInt32( msg );
+				MSG_SkipData( msg, meta_data_maxsize );
+			} break;
+
+			case svc_serverdata: {
+				int protocol = MSG_ReadInt32( msg );
+				if( protocol != APP_PROTOCOL_VERSION ) {
+					Com_Printf( "demo has version %i, not %i\n", protocol, APP_PROTOCOL_VERSION );
+					return false;
+				}
+
+				MSG_ReadInt32( msg ); // servercount
+				MSG_ReadInt16( msg ); // snapFrameTime
+				MSG_ReadString( msg ); // base game directory
+				MSG_ReadInt16( msg ); // playernum
+
+				int sv_bitflags = MSG_ReadUint8( msg );
+				parser->reliable = ( sv_bitflags & SV_BITFLAGS_RELIABLE ) != 0;
+				if( sv_bitflags & SV_BITFLAGS_HTTP ) {
+					if( sv_bitflags & SV_BITFLAGS_HTTP_BASEURL ) {
+						MSG_ReadString( msg );
+					}
+					else {
+						MSG_ReadInt16( msg );
+					}
+				}
+			} break;
+
+			case svc_servercmd:
+				if( !parser->reliable ) {
+					MSG_ReadInt32( msg );
+				}
+				MSG_ReadString( msg );
+				break;
+
+			case svc_servercs:
+				MSG_ReadString( msg );
+				break;
+
+			case svc_spawnbaseline:
+				SNAP_ParseBaseline( msg, parser->baselines );
+				break;
+
+			case svc_frame:
+				ParseFrame( parser, msg );
+				break;
+
+			default:
+				Com_Printf( "unexpected server message %i\n", cmd );
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// corrupt frames Com_Error inside SNAP_ParseFrame, trap that so only this
+// demo fails instead of the whole batch. nothing between here and the error
+// has destructors to skip
+static bool ParseDemo( DemoParser * parser, int file, msg_t * msg ) {
+	jmp_buf trap;
+	if( setjmp( trap ) != 0 ) {
+		Com_SetErrorTrap( NULL );
+		return false;
+	}
+
+	Com_SetErrorTrap( &trap );
+
+	bool ok = true;
+	while( ok && ReadDemoMessage( file, msg ) ) {
+		ok = ParseDemoMessage( parser, msg );
+	}
+
+	Com_SetErrorTrap( NULL );
+	return ok;
+}
+
+static void WriteOutputs( const char * demo, const DynamicArray< PlayerRow > * players, const DynamicArray< EntityRow > * entities ) {
+	// va isn't thread safe
+	char base[ 1024 ];
+	Q_strncpyz( base, demo, sizeof( base ) );
+	COM_StripExtension( base );
+
+	char filename[ 1024 ];
+
+	if( strcmp( demotool_format->string, "bin" ) == 0 ) {
+		OutputFile * out = ALLOC( sys_allocator, OutputFile );
+		snprintf( filename, sizeof( filename ), "%s.cdstats", base );
+		if( OpenOutput( out, filename ) ) {
+			u32 header[] = { 1, 2 }; // version, num tables
+			Write( out, "CDST", 4 );
+			Write( out, header, sizeof( header ) );
+			WriteBinaryTable( out, "players", player_columns, ARRAY_COUNT( player_columns ), players->ptr(), players->size(), sizeof( PlayerRow ) );
+			WriteBinaryTable( out, "entities", entity_columns, ARRAY_COUNT( entity_columns ), entities->ptr(), entities->size(), sizeof( EntityRow ) );
+			CloseOutput( out );
+		}
+		FREE( sys_allocator, out );
+	}
+	else {
+		snprintf( filename, sizeof( filename ), "%s.players.csv", base );
+		WriteCSVTable( filename, player_columns, ARRAY_COUNT( player_columns ), players->ptr(), players->size(), sizeof( PlayerRow ) );
+		if( demotool_entities->integer != 0 ) {
+			snprintf( filename, sizeof( filename ), "%s.entities.csv", base );
+			WriteCSVTable( filename, entity_columns, ARRAY_COUNT( entity_columns ), entities->ptr(), entities->size(), sizeof( EntityRow ) );
+		}
+	}
+}
+
+static void ExportDemo( DemoJob * job ) {
+	ZoneScoped;
+
+	int64_t start = Sys_Milliseconds();
+
+	int file;
+	if( FS_FOpenAbsoluteFile( job->filename, &file, FS_READ | SNAP_DEMO_GZ ) == -1 ) {
+		Com_Printf( S_COLOR_RED "Couldn't open %s\n", job->filename );
+		return;
+	}
+
+	DynamicArray< PlayerRow > players( sys_allocator );
+	DynamicArray< EntityRow > entities( sys_allocator );
+
+	DemoParser parser = { };
+	parser.players = &players;
+	parser.entities = &entities;
+	parser.snapshots = ALLOC_MANY( sys_allocator, snapshot_t, UPDATE_BACKUP );
+	parser.baselines = ALLOC_MANY( sys_allocator, SyncEntityState, MAX_EDICTS );
+	memset( parser.snapshots, 0, UPDATE_BACKUP * sizeof( snapshot_t ) );
+	memset( parser.baselines, 0, MAX_EDICTS * sizeof( SyncEntityState ) );
+
+	u8 * msg_data = ALLOC_MANY( sys_allocator, u8, MAX_MSGLEN );
+	msg_t msg;
+	MSG_Init( &msg, msg_data, MAX_MSGLEN );
+
+	bool ok = ParseDemo( &parser, file, &msg );
+
+	FS_FCloseFile( file );
+
+	if( ok ) {
+		WriteOutputs( job->filename, &players, &entities );
+	}
+
+	job->ok = ok;
+	job->frames = parser.frames;
+	job->player_rows = players.size();
+	job->entity_rows = entities.size();
+	job->duration = parser.last_time - parser.first_time;
+	job->elapsed = Sys_Milliseconds() - start;
+
+	FREE( sys_allocator, msg_data );
+	FREE( sys_allocator, parser.snapshots );
+	FREE( sys_allocator, parser.baselines );
+}
+
+static void WorkerThread( void * data ) {
+	while( true ) {
+		Lock( jobs_mutex );
+		int job = next_job;
+		next_job++;
+		Unlock( jobs_mutex );
+
+		if( job >= num_jobs )
+			break;
+
+		ExportDemo( &jobs[ job ] );
+	}
+}
+
+/*
+ * commands
+ */
+
+static void DemoExport_f() {
+	if( Cmd_Argc() < 2 ) {
+		Com_Printf( "Usage: %s <demo> [demo...]\n", Cmd_Argv( 0 ) );
+		Com_Printf( "Writes per-frame player and entity state next to each demo, as csv or columnar binary depending on demotool_format\n" );
+		return;
+	}
+
+	num_jobs = Cmd_Argc() - 1;
+	next_job = 0;
+	jobs = ALLOC_MANY( sys_allocator, DemoJob, num_jobs );
+	memset( jobs, 0, num_jobs * sizeof( DemoJob ) );
+	for( int i = 0; i < num_jobs; i++ ) {
+		// Cmd_Argv storage lives until the next tokenize, which can't happen
+		// while we block here
+		jobs[ i ].filename = Cmd_Argv( i + 1 );
+	}
+
+	int num_threads = demotool_threads->integer > 0 ? demotool_threads->integer : int( GetCoreCount() );
+	num_threads = Clamp( 1, num_threads, num_jobs );
+
+	int64_t start = Sys_Milliseconds();
+
+	Thread ** threads = ALLOC_MANY( sys_allocator, Thread *, num_threads );
+	for( int i = 0; i < num_threads; i++ ) {
+		threads[ i ] = NewThread( WorkerThread );
+	}
+	for( int i = 0; i < num_threads; i++ ) {
+		JoinThread( threads[ i ] );
+	}
+	FREE( sys_allocator, threads );
+
+	int64_t elapsed = Max2( int64_t( 1 ), Sys_Milliseconds() - start );
+	int64_t total_duration = 0;
+	int failed = 0;
+
+	for( int i = 0; i < num_jobs; i++ ) {
+		const DemoJob * job = &jobs[ i ];
+		total_duration += job->duration;
+		if( !job->ok ) {
+			failed++;
+			Com_Printf( S_COLOR_RED "%s: failed\n", job->filename );
+			continue;
+		}
+
+		Com_Printf( "%s: %u frames, %zu player rows, %zu entity rows, %.1fs of game in %" PRIi64 "ms\n",
+			job->filename, job->frames, job->player_rows, job->entity_rows, job->duration / 1000.0f, job->elapsed );
+	}
+
+	Com_Printf( "Exported %d demos (%d failed) on %d threads in %" PRIi64 "ms, %.0fx real time\n",
+		num_jobs - failed, failed, num_threads, elapsed, float( total_duration ) / float( elapsed ) );
+
+	FREE( sys_allocator, jobs );
+	jobs = NULL;
+	num_jobs = 0;
+}
+
+/*
+ * engine interface
+ */
+
+void CL_Init() {
+	demotool_entities = Cvar_Get( "demotool_entities", "1", CVAR_ARCHIVE );
+	demotool_format = Cvar_Get( "demotool_format", "csv", CVAR_ARCHIVE );
+	demotool_threads = Cvar_Get( "demotool_threads", "0", CVAR_ARCHIVE );
+
+	jobs_mutex = NewMutex();
+
+	Cmd_AddCommand( "demoexport", DemoExport_f );
+}
+
+void CL_Shutdown() {
+	Cmd_RemoveCommand( "demoexport" );
+
+	DeleteMutex( jobs_mutex );
+}
+
+void CL_Frame( int realMsec, int gameMsec ) { }
+
+void CL_Disconnect( const char * message ) { }
+
+void Con_Print( const char * text ) { }
+
+void Key_Init() { }
+void Key_Shutdown() { }
@@ -0,0 +1,6 @@
+#include "qcommon/qcommon.h"
+
+void SV_Init() { }
+void SV_Shutdown( const char * finalmsg ) { }
+void SV_ShutdownGame( const char * finalmsg, bool reconnect ) { }
+void SV_Frame( unsigned realMsec, unsigned gameMsec ) { }
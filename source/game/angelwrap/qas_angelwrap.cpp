@@ -25,7 +25,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "addon/addon_time.h"
 #include "addon/addon_vec3.h"
 #include "addon/addon_cvar.h"
+#include "qcommon/hashmap.h"
 
+#include <algorithm> // std::sort
 #include <list>
 #include <map>
 
@@ -429,6 +431,9 @@ void qasReleaseEngine( asIScriptEngine *engine ) {
 		contexts.erase( it );
 	}
 
+	// functions belong to the engine's modules, so their pointers are about to become stale
+	qasResetProfile();
+
 	engine->Release();
 }
 
@@ -498,6 +503,236 @@ asIScriptContext *qasGetActiveContext( void ) {
 	return asGetActiveContext();
 }
 
+/*************************************
+* Profiling and budgets
+**************************************/
+
+#define QAS_MAX_PROFILED_FUNCTIONS 1024
+#define QAS_MAX_CALL_DEPTH 16
+
+struct ScriptFunctionProfile {
+	char decl[ 128 ];
+	u64 self_time;
+	u64 total_time;
+	u64 max_time;
+	u64 lines;
+	u64 calls;
+};
+
+// a context that is currently executing. scripts can call back into the
+// game which executes more scripts, so these form a stack
+struct ScriptCall {
+	asIScriptFunction * func;
+	bool budgeted;
+	u64 start_time;
+	u64 line_time;
+	asIScriptFunction * line_func;
+};
+
+static Hashmap< ScriptFunctionProfile, QAS_MAX_PROFILED_FUNCTIONS > script_profile;
+static ScriptCall script_calls[ QAS_MAX_CALL_DEPTH ];
+static int script_call_depth;
+
+static int64_t budget_frame = -1;
+static u64 budget_frame_used;
+static bool budget_exceeded;
+
+static ScriptFunctionProfile * qasGetFunctionProfile( asIScriptFunction *func ) {
+	if( func == NULL ) {
+		return NULL;
+	}
+
+	u64 key = u64( uintptr_t( func ) );
+	ScriptFunctionProfile * profile = script_profile.get( key );
+	if( profile != NULL ) {
+		return profile;
+	}
+
+	profile = script_profile.add( key );
+	if( profile == NULL ) {
+		return NULL;
+	}
+
+	*profile = { };
+	Q_strncpyz( profile->decl, func->GetDeclaration( true, true ), sizeof( profile->decl ) );
+	return profile;
+}
+
+static void qasAccumulateLineTime( ScriptCall * call, u64 now ) {
+	ScriptFunctionProfile * profile = qasGetFunctionProfile( call->line_func );
+	if( profile != NULL ) {
+		profile->self_time += now - call->line_time;
+	}
+	call->line_time = now;
+}
+
+static u64 qasBudgetMicroseconds() {
+	return u64( Max2( g_asBudget->value, 0.0f ) * 1000.0f );
+}
+
+/*
+* qasLineCallback
+*
+* Runs before every script statement while profiling or budgets are enabled.
+* Time between two callbacks is charged to the function that ran the first
+* line, which gives exclusive per-function times including native calls.
+*/
+static void qasLineCallback( asIScriptContext *ctx, void *param ) {
+	if( script_call_depth == 0 ) {
+		return;
+	}
+
+	ScriptCall * call = &script_calls[ script_call_depth - 1 ];
+	u64 now = Sys_Microseconds();
+
+	if( g_asProfile->integer ) {
+		qasAccumulateLineTime( call, now );
+		call->line_func = ctx->GetFunction();
+
+		ScriptFunctionProfile * profile = qasGetFunctionProfile( call->line_func );
+		if( profile != NULL ) {
+			profile->lines++;
+		}
+	}
+
+	// nested calls are charged to whatever started the outermost one
+	u64 budget = qasBudgetMicroseconds();
+	if( budget > 0 && script_calls[ 0 ].budgeted ) {
+		u64 used = budget_frame_used + now - script_calls[ 0 ].start_time;
+		if( used > budget ) {
+			// keep aborting everything that runs over, but only log the first one each frame
+			if( !budget_exceeded ) {
+				const char * section = "";
+				int line = ctx->GetLineNumber( 0, NULL, &section );
+				asIScriptFunction * func = ctx->GetFunction();
+
+				Com_Printf( S_COLOR_RED "Script budget exceeded (%.2fms > %.2fms) in %s (%s:%d), aborting\n",
+					used / 1000.0, budget / 1000.0, func != NULL ? func->GetDeclaration( true ) : "?", section, line );
+
+				budget_exceeded = true;
+			}
+
+			ctx->Abort();
+		}
+	}
+}
+
+/*
+* qasExecute
+*
+* Wraps asIScriptContext::Execute with timing for the profiler, Tracy, the
+* per-frame script budget and the server frame watchdog. Only per-frame
+* callbacks are budgeted, init and spawning always run to completion
+*/
+int qasExecute( asIScriptContext *ctx, bool budgeted ) {
+	ZoneScoped;
+
+	asIScriptFunction * func = ctx->GetFunction();
+	if( func != NULL ) {
+		ZoneText( func->GetName(), strlen( func->GetName() ) );
+	}
+
+	if( budget_frame != svs.gametime ) {
+		budget_frame = svs.gametime;
+		budget_frame_used = 0;
+		budget_exceeded = false;
+	}
+
+	bool profiling = g_asProfile->integer != 0;
+	bool budget_enabled = qasBudgetMicroseconds() > 0;
+
+	bool line_timing = profiling || budget_enabled;
+
+	// the frame's budget is already spent, don't start anything new until the next frame
+	if( script_call_depth == 0 && budgeted && budget_enabled && budget_frame_used > qasBudgetMicroseconds() ) {
+		return asEXECUTION_ABORTED;
+	}
+
+	if( script_call_depth == QAS_MAX_CALL_DEPTH ) {
+		return ctx->Execute();
+	}
+
+	u64 start = Sys_Microseconds();
+
+	// pause the caller's line timer so nested scripts aren't counted twice
+	if( script_call_depth > 0 && profiling ) {
+		qasAccumulateLineTime( &script_calls[ script_call_depth - 1 ], start );
+	}
+
+	ScriptCall * call = &script_calls[ script_call_depth ];
+	call->func = func;
+	call->budgeted = budgeted;
+	call->start_time = start;
+	call->line_time = start;
+	call->line_func = func;
+	script_call_depth++;
+
+	if( line_timing ) {
+		ctx->SetLineCallback( asFUNCTION( qasLineCallback ), NULL, asCALL_CDECL );
+	}
+	int result = ctx->Execute();
+	if( line_timing ) {
+		ctx->ClearLineCallback();
+	}
+
+	u64 end = Sys_Microseconds();
+	script_call_depth--;
+
+	if( profiling ) {
+		qasAccumulateLineTime( call, end );
+
+		ScriptFunctionProfile * profile = qasGetFunctionProfile( func );
+		if( profile != NULL ) {
+			u64 dt = end - start;
+			profile->calls++;
+			profile->total_time += dt;
+			profile->max_time = Max2( profile->max_time, dt );
+		}
+	}
+
+	if( script_call_depth == 0 ) {
+		if( budgeted ) {
+			budget_frame_used += end - start;
+		}
+		SV_Watchdog_ScriptCall( func != NULL ? func->GetName() : "?", end - start );
+	}
+	else if( profiling ) {
+		script_calls[ script_call_depth - 1 ].line_time = end;
+	}
+
+	return result;
+}
+
+void qasResetProfile( void ) {
+	script_profile.clear();
+}
+
+void qasPrintProfile( void ) {
+	if( script_profile.n == 0 ) {
+		Com_Printf( "No script profile data. Set g_asProfile 1 to collect some.\n" );
+		return;
+	}
+
+	ScriptFunctionProfile * sorted[ QAS_MAX_PROFILED_FUNCTIONS ];
+	u64 total_self = 0;
+	for( size_t i = 0; i < script_profile.n; i++ ) {
+		sorted[ i ] = &script_profile.values[ i ];
+		total_self += sorted[ i ]->self_time;
+	}
+
+	std::sort( sorted, sorted + script_profile.n, []( const ScriptFunctionProfile * a, const ScriptFunctionProfile * b ) {
+		return a->self_time > b->self_time;
+	} );
+
+	Com_Printf( "%10s %6s %10s %8s %10s %10s  %s\n", "self ms", "self %", "lines", "calls", "total ms", "max ms", "function" );
+	for( size_t i = 0; i < Min2( script_profile.n, size_t( 25 ) ); i++ ) {
+		const ScriptFunctionProfile * p = sorted[ i ];
+		Com_Printf( "%10.2f %6.1f %10" PRIu64 " %8" PRIu64 " %10.2f %10.2f  %s\n",
+			p->self_time / 1000.0, total_self == 0 ? 0.0 : 100.0 * p->self_time / total_self,
+			p->lines, p->calls, p->total_time / 1000.0, p->max_time / 1000.0, p->decl );
+	}
+}
+
 /*************************************
 * Scripts
 **************************************/
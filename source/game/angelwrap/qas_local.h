@@ -52,6 +52,9 @@ asIScriptContext *qasAcquireContext( asIScriptEngine *engine );
 void qasReleaseContext( asIScriptContext *ctx );
 void qasReleaseEngine( asIScriptEngine *engine );
 asIScriptContext *qasGetActiveContext( void );
+int qasExecute( asIScriptContext *ctx, bool budgeted );
+void qasPrintProfile( void );
+void qasResetProfile( void );
 void qasWriteEngineDocsToFile( asIScriptEngine *engine, const char *path, bool singleFile, bool markdown, unsigned andMask, unsigned notMask );
 
 // array tools
@@ -30,6 +30,10 @@ struct angelwrap_api_s *QAS_GetAngelExport() {
 	angelExport.asAcquireContext = qasAcquireContext;
 	angelExport.asReleaseContext = qasReleaseContext;
 	angelExport.asGetActiveContext = qasGetActiveContext;
+	angelExport.asExecute = qasExecute;
+
+	angelExport.asPrintProfile = qasPrintProfile;
+	angelExport.asResetProfile = qasResetProfile;
 
 	angelExport.asStringFactoryBuffer = qasStringFactoryBuffer;
 	angelExport.asStringRelease = qasStringRelease;
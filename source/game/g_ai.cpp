@@ -60,11 +60,178 @@ void AI_SpawnBot() {
 	game.numBots++;
 }
 
+struct Bot {
+	int path[ 64 ];
+	int path_len;
+	int path_pos;
+
+	edict_t * target;
+	int64_t next_plan;
+
+	Vec3 last_origin;
+	int64_t last_moved;
+};
+
+static Bot bots[ MAX_CLIENTS ];
+
+// path planning is the expensive part of bot thinking, so only a few bots
+// are allowed to replan each frame and the rest keep following their old paths
+static int64_t plan_framenum;
+static int plans_this_frame;
+
+static Bot * GetBot( edict_t * ent ) {
+	return &bots[ PLAYERNUM( ent ) ];
+}
+
 void AI_Respawn( edict_t * ent ) {
 	ent->r.client->ps.pmove.delta_angles[ 0 ] = 0;
 	ent->r.client->ps.pmove.delta_angles[ 1 ] = 0;
 	ent->r.client->ps.pmove.delta_angles[ 2 ] = 0;
 	ent->r.client->level.last_activity = level.time;
+
+	Bot * bot = GetBot( ent );
+	*bot = { };
+	bot->last_origin = ent->s.origin;
+	bot->last_moved = level.time;
+}
+
+void AI_ResetBotPaths() {
+	for( Bot & bot : bots ) {
+		bot.path_len = 0;
+		bot.path_pos = 0;
+		bot.target = NULL;
+		bot.next_plan = 0;
+	}
+}
+
+static bool IsEnemy( edict_t * self, edict_t * other ) {
+	if( other == self || !other->r.inuse || other->r.client == NULL )
+		return false;
+	if( G_ISGHOSTING( other ) || G_IsDead( other ) || other->s.team == TEAM_SPECTATOR )
+		return false;
+	return !GS_TeamBasedGametype( &server_gs ) || other->s.team != self->s.team;
+}
+
+static Vec3 EyePosition( edict_t * ent ) {
+	return ent->s.origin + Vec3( 0.0f, 0.0f, ent->viewheight );
+}
+
+static bool CanSee( edict_t * self, edict_t * other ) {
+	trace_t tr;
+	G_Trace( &tr, EyePosition( self ), Vec3( 0.0f ), Vec3( 0.0f ), EyePosition( other ), self, MASK_OPAQUE );
+	return tr.fraction == 1.0f || tr.ent == ENTNUM( other );
+}
+
+static edict_t * PickTarget( edict_t * self ) {
+	edict_t * best = NULL;
+	float best_dist = FLT_MAX;
+	bool best_visible = false;
+
+	for( int i = 0; i < server_gs.maxclients; i++ ) {
+		edict_t * other = game.edicts + 1 + i;
+		if( !IsEnemy( self, other ) )
+			continue;
+
+		bool visible = CanSee( self, other );
+		float dist = LengthSquared( other->s.origin - self->s.origin );
+		if( ( visible && !best_visible ) || ( visible == best_visible && dist < best_dist ) ) {
+			best = other;
+			best_dist = dist;
+			best_visible = visible;
+		}
+	}
+
+	return best;
+}
+
+static void Plan( edict_t * self, Bot * bot ) {
+	ZoneScoped;
+
+	bot->target = PickTarget( self );
+	bot->next_plan = level.time + 500 + random_uniform( &svs.rng, 0, 500 );
+	bot->path_len = 0;
+	bot->path_pos = 0;
+
+	int from = AI_NearestNavNode( self->s.origin );
+	if( bot->target != NULL ) {
+		bot->path_len = AI_FindPath( from, AI_NearestNavNode( bot->target->s.origin ), bot->path, ARRAY_COUNT( bot->path ) );
+	}
+
+	// wander if there's nobody to chase or we can't get to them
+	if( bot->path_len == 0 ) {
+		bot->path_len = AI_FindPath( from, AI_RandomNavNode( &svs.rng ), bot->path, ARRAY_COUNT( bot->path ) );
+	}
+}
+
+static bool WantsToPlan( const Bot * bot ) {
+	if( bot->next_plan <= level.time )
+		return true;
+	// wandering bots pick a new random goal when they reach the end of their path
+	if( bot->target == NULL && bot->path_pos >= bot->path_len )
+		return true;
+	return bot->target != NULL && !bot->target->r.inuse;
+}
+
+static float ApproachAngle( float current, float target, float max_step ) {
+	float delta = AngleNormalize180( target - current );
+	return current + Clamp( -max_step, delta, max_step );
+}
+
+static void Steer( edict_t * self, Bot * bot, usercmd_t * ucmd ) {
+	const float max_turn = 720.0f * game.frametime * 0.001f;
+
+	Vec3 move_dir = Vec3( 0.0f );
+	if( bot->path_pos < bot->path_len ) {
+		int node = bot->path[ bot->path_pos ];
+		Vec3 waypoint = AI_NavNodeOrigin( node );
+		Vec3 feet = self->s.origin + Vec3( 0.0f, 0.0f, playerbox_stand_mins.z );
+		Vec3 to_waypoint = waypoint - feet;
+
+		if( Length( Vec2( to_waypoint.x, to_waypoint.y ) ) < 16.0f && Abs( to_waypoint.z ) < 48.0f ) {
+			bot->path_pos++;
+		}
+		else {
+			move_dir = SafeNormalize( Vec3( to_waypoint.x, to_waypoint.y, 0.0f ) );
+
+			int prev = bot->path_pos > 0 ? bot->path[ bot->path_pos - 1 ] : AI_NearestNavNode( self->s.origin );
+			if( prev >= 0 && AI_NavLinkIsJump( prev, node ) && self->groundentity != NULL ) {
+				ucmd->upmove = 127;
+			}
+		}
+	}
+
+	Vec3 look_dir = move_dir;
+	bool target_visible = bot->target != NULL && IsEnemy( self, bot->target ) && CanSee( self, bot->target );
+	if( target_visible ) {
+		look_dir = EyePosition( bot->target ) - EyePosition( self );
+	}
+
+	if( look_dir != Vec3( 0.0f ) ) {
+		Vec3 desired = VecToAngles( look_dir );
+		self->s.angles.x = ApproachAngle( self->s.angles.x, desired.x, max_turn );
+		self->s.angles.y = ApproachAngle( self->s.angles.y, desired.y, max_turn );
+
+		if( target_visible && Abs( AngleNormalize180( desired.y - self->s.angles.y ) ) < 10.0f ) {
+			ucmd->buttons |= BUTTON_ATTACK;
+		}
+	}
+
+	// move relative to where we're looking, so we can strafe while shooting
+	Vec3 forward, right;
+	AngleVectors( Vec3( 0.0f, self->s.angles.y, 0.0f ), &forward, &right, NULL );
+	ucmd->forwardmove = s8( Clamp( -127.0f, Dot( move_dir, forward ) * 127.0f, 127.0f ) );
+	ucmd->sidemove = s8( Clamp( -127.0f, Dot( move_dir, right ) * 127.0f, 127.0f ) );
+
+	// if we've been stuck for a while jump and find another way
+	if( LengthSquared( self->s.origin - bot->last_origin ) > 16.0f * 16.0f ) {
+		bot->last_origin = self->s.origin;
+		bot->last_moved = level.time;
+	}
+	else if( move_dir != Vec3( 0.0f ) && level.time - bot->last_moved > 1000 ) {
+		ucmd->upmove = 127;
+		bot->next_plan = level.time;
+		bot->last_moved = level.time;
+	}
 }
 
 static void AI_SpecThink( edict_t * self ) {
@@ -98,6 +265,8 @@ static void AI_SpecThink( edict_t * self ) {
 }
 
 static void AI_GameThink( edict_t * self ) {
+	ZoneScoped;
+
 	if( GS_MatchState( &server_gs ) <= MATCH_STATE_WARMUP ) {
 		G_Match_Ready( self );
 	}
@@ -105,6 +274,24 @@ static void AI_GameThink( edict_t * self ) {
 	usercmd_t ucmd;
 	memset( &ucmd, 0, sizeof( usercmd_t ) );
 
+	if( !G_IsDead( self ) ) {
+		// normally built in G_LoadMap, this only catches bots added with g_numbots 0 at load
+		AI_LoadNavMesh( false );
+
+		if( plan_framenum != level.framenum ) {
+			plan_framenum = level.framenum;
+			plans_this_frame = 0;
+		}
+
+		Bot * bot = GetBot( self );
+		if( WantsToPlan( bot ) && plans_this_frame < g_bot_plans_per_frame->integer ) {
+			Plan( self, bot );
+			plans_this_frame++;
+		}
+
+		Steer( self, bot, &ucmd );
+	}
+
 	// set up for pmove
 	ucmd.angles[ 0 ] = (short)ANGLE2SHORT( self->s.angles.x ) - self->r.client->ps.pmove.delta_angles[ 0 ];
 	ucmd.angles[ 1 ] = (short)ANGLE2SHORT( self->s.angles.y ) - self->r.client->ps.pmove.delta_angles[ 1 ];
@@ -2,4 +2,16 @@
 
 void AI_SpawnBot();
 void AI_Respawn( edict_t * ent );
+void AI_ResetBotPaths();
 void AI_Think( edict_t * self );
+
+// g_navmesh.cpp
+void AI_LoadNavMesh( bool rebuild );
+void AI_FreeNavMesh();
+void AI_BuildNavMesh_f();
+
+int AI_NearestNavNode( Vec3 p );
+int AI_RandomNavNode( RNG * rng );
+Vec3 AI_NavNodeOrigin( int node );
+bool AI_NavLinkIsJump( int from, int to );
+int AI_FindPath( int from, int to, int * path, int max_len );
@@ -123,6 +123,11 @@ typedef struct angelwrap_api_s {
 	asIScriptContext *( *asAcquireContext )( asIScriptEngine * engine );
 	void ( *asReleaseContext )( asIScriptContext *context );
 	asIScriptContext *( *asGetActiveContext )( void );
+	int ( *asExecute )( asIScriptContext *context, bool budgeted ); // budgeted calls count against g_asBudget
+
+	// profiling
+	void ( *asPrintProfile )( void );
+	void ( *asResetProfile )( void );
 
 	// strings
 	asstring_t *( *asStringFactoryBuffer )( const char *buffer, unsigned int length );
@@ -75,7 +75,7 @@ void GT_asCallSpawn( void ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, false );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -97,7 +97,7 @@ void GT_asCallMatchStateStarted( void ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, false );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -123,11 +123,15 @@ bool GT_asCallMatchStateFinished( int incomingMatchState ) {
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgDWord( 0, incomingMatchState );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, false );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
 
+	if( error != asEXECUTION_FINISHED ) {
+		return true;
+	}
+
 	// Retrieve the return from the context
 	result = ctx->GetReturnByte() == 0 ? false : true;
 
@@ -150,7 +154,7 @@ void GT_asCallThinkRules( void ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -177,7 +181,7 @@ void GT_asCallPlayerRespawn( edict_t *ent, int old_team, int new_team ) {
 	ctx->SetArgDWord( 1, old_team );
 	ctx->SetArgDWord( 2, new_team );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -216,7 +220,7 @@ void GT_asCallScoreEvent( gclient_t *client, const char *score_event, const char
 	ctx->SetArgObject( 1, s1 );
 	ctx->SetArgObject( 2, s2 );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -242,13 +246,19 @@ void GT_asCallScoreboardMessage( char * buf, size_t buf_size ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
 
+	// aborted by g_asBudget, keep last frame's scoreboard
+	if( error != asEXECUTION_FINISHED ) {
+		return;
+	}
+
 	string = ( asstring_t * )ctx->GetReturnObject();
 	if( !string || !string->len || !string->buffer ) {
+		buf[ 0 ] = '\0';
 		return;
 	}
 
@@ -273,11 +283,15 @@ edict_t *GT_asCallSelectSpawnPoint( edict_t *ent ) {
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, false );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
 
+	if( error != asEXECUTION_FINISHED ) {
+		return NULL;
+	}
+
 	return ( edict_t * )ctx->GetReturnObject();
 }
 
@@ -313,7 +327,7 @@ bool GT_asCallGameCommand( gclient_t *client, const char *cmd, const char *args,
 	ctx->SetArgObject( 2, s2 );
 	ctx->SetArgDWord( 3, argc );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -321,6 +335,10 @@ bool GT_asCallGameCommand( gclient_t *client, const char *cmd, const char *args,
 	game.asExport->asStringRelease( s1 );
 	game.asExport->asStringRelease( s2 );
 
+	if( error != asEXECUTION_FINISHED ) {
+		return false;
+	}
+
 	// Retrieve the return from the context
 	return ctx->GetReturnByte() == 0 ? false : true;
 }
@@ -341,7 +359,7 @@ void GT_asCallShutdown( void ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, false );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -476,8 +494,8 @@ static bool G_asInitializeGametypeScript( asIScriptModule *asModule ) {
 		return false;
 	}
 
-	error = ctx->Execute();
-	if( G_ExecutionErrorReport( error ) ) {
+	error = game.asExport->asExecute( ctx, false );
+	if( error != asEXECUTION_FINISHED ) {
 		return false;
 	}
 
@@ -1802,9 +1802,11 @@ bool G_asCallMapEntitySpawnScript( const char *classname, edict_t *ent ) {
 	// Now we need to pass the parameters to the script function.
 	asContext->SetArgObject( 0, ent );
 
-	error = asContext->Execute();
-	if( G_ExecutionErrorReport( error ) ) {
-		GT_asShutdownScript();
+	error = game.asExport->asExecute( asContext, false );
+	if( error != asEXECUTION_FINISHED ) {
+		if( G_ExecutionErrorReport( error ) ) {
+			GT_asShutdownScript();
+		}
 		ent->asScriptModule = NULL;
 		ent->asSpawnFunc = NULL;
 		ent->scriptSpawned = false;
@@ -1877,7 +1879,7 @@ void G_asCallMapEntityThink( edict_t *ent ) {
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -1912,7 +1914,7 @@ void G_asCallMapEntityTouch( edict_t *ent, edict_t *other, cplane_t *plane, int
 	ctx->SetArgObject( 2, &normal );
 	ctx->SetArgDWord( 3, surfFlags );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -1939,7 +1941,7 @@ void G_asCallMapEntityUse( edict_t *ent, edict_t *other, edict_t *activator ) {
 	ctx->SetArgObject( 1, other );
 	ctx->SetArgObject( 2, activator );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -1967,7 +1969,7 @@ void G_asCallMapEntityPain( edict_t *ent, edict_t *other, float kick, float dama
 	ctx->SetArgFloat( 2, kick );
 	ctx->SetArgFloat( 3, damage );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -1994,7 +1996,7 @@ void G_asCallMapEntityDie( edict_t *ent, edict_t *inflicter, edict_t *attacker,
 	ctx->SetArgObject( 1, inflicter );
 	ctx->SetArgObject( 2, attacker );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -2019,7 +2021,7 @@ void G_asCallMapEntityStop( edict_t *ent ) {
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = game.asExport->asExecute( ctx, true );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -2029,7 +2031,8 @@ void G_asCallMapEntityStop( edict_t *ent ) {
 * G_ExecutionErrorReport
 */
 bool G_ExecutionErrorReport( int error ) {
-	if( error == asEXECUTION_FINISHED ) {
+	// aborted calls ran over g_asBudget and were already reported
+	if( error == asEXECUTION_FINISHED || error == asEXECUTION_ABORTED ) {
 		return false;
 	}
 	return true;
@@ -2561,3 +2564,22 @@ void G_asDumpAPI_f( void ) {
 	snprintf( path, sizeof( path ), "AS_API/v%.g/", Cvar_Value( "version" ) );
 	G_asDumpAPIToFile( path );
 }
+
+/*
+* G_asProfile_f
+*
+* Print the hottest script functions recorded while g_asProfile is set
+*/
+void G_asProfile_f( void ) {
+	if( Cmd_Argc() == 2 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		game.asExport->asResetProfile();
+		return;
+	}
+
+	if( Cmd_Argc() != 1 ) {
+		Com_Printf( "Usage: asprofile [reset]\n" );
+		return;
+	}
+
+	game.asExport->asPrintProfile();
+}
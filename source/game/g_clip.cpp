@@ -330,31 +330,17 @@ static void GClip_LinkEntity_AreaGrid( areagrid_t *areagrid, edict_t *ent ) {
 }
 
 /*
-* GClip_EntitiesInBox_AreaGrid
+* GClip_AreaGridRange
 */
-static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, Vec3 mins, Vec3 maxs, int *list, int maxcount, int areatype, int timeDelta ) {
-	int numlist;
-	link_t *grid;
-	link_t *l;
-	c4clipedict_t *clipEnt;
-	Vec3 paddedmins, paddedmaxs;
-	int igrid[3], igridmins[3], igridmaxs[3];
-
-	paddedmins = mins;
-	paddedmaxs = maxs;
+static void GClip_AreaGridRange( const areagrid_t *areagrid, Vec3 mins, Vec3 maxs, int *igridmins, int *igridmaxs ) {
+	igridmins[0] = (int) floorf( ( mins.x + areagrid->bias.x ) * areagrid->scale.x );
+	igridmins[1] = (int) floorf( ( mins.y + areagrid->bias.y ) * areagrid->scale.y );
 
-	// FIXME: if areagrid_marknumber wraps, all entities need their
-	// ent->priv.server->areagridmarknumber reset
-	areagrid->marknumber++;
+	//igridmins[2] = (int) ( (mins[2] + areagrid->bias[2]) * areagrid->scale[2] );
+	igridmaxs[0] = (int) floorf( ( maxs.x + areagrid->bias.x ) * areagrid->scale.x ) + 1;
+	igridmaxs[1] = (int) floorf( ( maxs.y + areagrid->bias.y ) * areagrid->scale.y ) + 1;
 
-	igridmins[0] = (int) floorf( ( paddedmins.x + areagrid->bias.x ) * areagrid->scale.x );
-	igridmins[1] = (int) floorf( ( paddedmins.y + areagrid->bias.y ) * areagrid->scale.y );
-
-	//igridmins[2] = (int) ( (paddedmins[2] + areagrid->bias[2]) * areagrid->scale[2] );
-	igridmaxs[0] = (int) floorf( ( paddedmaxs.x + areagrid->bias.x ) * areagrid->scale.x ) + 1;
-	igridmaxs[1] = (int) floorf( ( paddedmaxs.y + areagrid->bias.y ) * areagrid->scale.y ) + 1;
-
-	//igridmaxs[2] = (int) ( (paddedmaxs[2] + areagrid->bias[2]) * areagrid->scale[2] ) + 1;
+	//igridmaxs[2] = (int) ( (maxs[2] + areagrid->bias[2]) * areagrid->scale[2] ) + 1;
 	igridmins[0] = Max2( 0, igridmins[0] );
 	igridmins[1] = Max2( 0, igridmins[1] );
 
@@ -366,6 +352,41 @@ static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, Vec3 mins, Vec3 m
 
 	// paranoid debugging
 	//VectorSet( igridmins, 0, 0, 0 );VectorSet( igridmaxs, AREA_GRID, AREA_GRID, AREA_GRID );
+}
+
+/*
+* GClip_AreaGridEntityMatches
+*/
+static bool GClip_AreaGridEntityMatches( const c4clipedict_t *clipEnt, int areatype ) {
+	if( !clipEnt->r.inuse ) {
+		return false; // deactivated
+	}
+	if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
+		return false;
+	}
+	if( areatype == AREA_SOLID &&
+		( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
+		return false;
+	}
+	return true;
+}
+
+/*
+* GClip_WalkAreaGrid
+* if bounds is NULL every matching entity in the grid range is returned,
+* otherwise only the ones overlapping bounds[0]..bounds[1]
+*/
+static int GClip_WalkAreaGrid( areagrid_t *areagrid, const int *igridmins, const int *igridmaxs, const Vec3 *bounds,
+	int *list, int maxcount, int areatype, int timeDelta ) {
+	int numlist;
+	link_t *grid;
+	link_t *l;
+	c4clipedict_t *clipEnt;
+	int igrid[2];
+
+	// FIXME: if areagrid_marknumber wraps, all entities need their
+	// ent->priv.server->areagridmarknumber reset
+	areagrid->marknumber++;
 
 	numlist = 0;
 
@@ -381,18 +402,11 @@ static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, Vec3 mins, Vec3 m
 			}
 			areagrid->entmarknumber[l->entNum] = areagrid->marknumber;
 
-			if( !clipEnt->r.inuse ) {
-				continue; // deactivated
-			}
-			if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
-				continue;
-			}
-			if( areatype == AREA_SOLID &&
-				( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
+			if( !GClip_AreaGridEntityMatches( clipEnt, areatype ) ) {
 				continue;
 			}
 
-			if( BoundsOverlap( paddedmins, paddedmaxs, clipEnt->r.absmin, clipEnt->r.absmax ) ) {
+			if( bounds == NULL || BoundsOverlap( bounds[0], bounds[1], clipEnt->r.absmin, clipEnt->r.absmax ) ) {
 				if( numlist < maxcount ) {
 					list[numlist] = l->entNum;
 				}
@@ -418,18 +432,11 @@ static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, Vec3 mins, Vec3 m
 				}
 				areagrid->entmarknumber[l->entNum] = areagrid->marknumber;
 
-				if( !clipEnt->r.inuse ) {
-					continue; // deactivated
-				}
-				if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
-					continue;
-				}
-				if( areatype == AREA_SOLID &&
-					( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
+				if( !GClip_AreaGridEntityMatches( clipEnt, areatype ) ) {
 					continue;
 				}
 
-				if( BoundsOverlap( paddedmins, paddedmaxs, clipEnt->r.absmin, clipEnt->r.absmax ) ) {
+				if( bounds == NULL || BoundsOverlap( bounds[0], bounds[1], clipEnt->r.absmin, clipEnt->r.absmax ) ) {
 					if( numlist < maxcount ) {
 						list[numlist] = l->entNum;
 					}
@@ -442,6 +449,127 @@ static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, Vec3 mins, Vec3 m
 	return numlist;
 }
 
+/*
+ * trace batches
+ *
+ * a single Pmove does a dozen or more traces around the same spot, and
+ * nothing moves between them until the triggers are touched at the end.
+ * while a batch is open, the grid walk for a given cell range is done once
+ * and later queries covering the exact same cells filter the remembered
+ * candidates by bounds instead. the cells are visited in the same order and
+ * the bounds test is the same, so results are identical to a fresh walk
+ */
+
+#define TRACE_BATCH_QUERIES 4
+
+struct AreaGridQuery {
+	int igridmins[2], igridmaxs[2];
+	int areatype;
+	int timeDelta;
+	int num;
+	int list[MAX_EDICTS];
+};
+
+struct TraceBatch {
+	bool active;
+	AreaGridQuery queries[TRACE_BATCH_QUERIES];
+	int num_queries;
+	int next_query;
+
+	int64_t hits, misses, mismatches;
+};
+
+static TraceBatch trace_batch;
+
+void GClip_BeginTraceBatch() {
+	trace_batch.active = true;
+	trace_batch.num_queries = 0;
+	trace_batch.next_query = 0;
+}
+
+void GClip_EndTraceBatch() {
+	trace_batch.active = false;
+	trace_batch.num_queries = 0;
+}
+
+static void GClip_InvalidateTraceBatch() {
+	trace_batch.num_queries = 0;
+}
+
+static const AreaGridQuery *GClip_BatchedAreaGridQuery( areagrid_t *areagrid, const int *igridmins, const int *igridmaxs, int areatype, int timeDelta ) {
+	for( int i = 0; i < trace_batch.num_queries; i++ ) {
+		const AreaGridQuery *query = &trace_batch.queries[i];
+		if( query->igridmins[0] == igridmins[0] && query->igridmins[1] == igridmins[1]
+			&& query->igridmaxs[0] == igridmaxs[0] && query->igridmaxs[1] == igridmaxs[1]
+			&& query->areatype == areatype && query->timeDelta == timeDelta ) {
+			trace_batch.hits++;
+			return query;
+		}
+	}
+
+	trace_batch.misses++;
+
+	AreaGridQuery *query = &trace_batch.queries[trace_batch.next_query];
+	trace_batch.next_query = ( trace_batch.next_query + 1 ) % TRACE_BATCH_QUERIES;
+	trace_batch.num_queries = Min2( trace_batch.num_queries + 1, TRACE_BATCH_QUERIES );
+
+	query->igridmins[0] = igridmins[0];
+	query->igridmins[1] = igridmins[1];
+	query->igridmaxs[0] = igridmaxs[0];
+	query->igridmaxs[1] = igridmaxs[1];
+	query->areatype = areatype;
+	query->timeDelta = timeDelta;
+	query->num = GClip_WalkAreaGrid( areagrid, igridmins, igridmaxs, NULL, query->list, MAX_EDICTS, areatype, timeDelta );
+
+	return query;
+}
+
+/*
+* GClip_EntitiesInBox_AreaGrid
+*/
+static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, Vec3 mins, Vec3 maxs, int *list, int maxcount, int areatype, int timeDelta ) {
+	int igridmins[2], igridmaxs[2];
+	GClip_AreaGridRange( areagrid, mins, maxs, igridmins, igridmaxs );
+
+	Vec3 bounds[] = { mins, maxs };
+
+	if( !trace_batch.active ) {
+		return GClip_WalkAreaGrid( areagrid, igridmins, igridmaxs, bounds, list, maxcount, areatype, timeDelta );
+	}
+
+	const AreaGridQuery *query = GClip_BatchedAreaGridQuery( areagrid, igridmins, igridmaxs, areatype, timeDelta );
+
+	int numlist = 0;
+	for( int i = 0; i < query->num; i++ ) {
+		const c4clipedict_t *clipEnt = GClip_GetClipEdictForDeltaTime( query->list[i], timeDelta );
+		if( BoundsOverlap( mins, maxs, clipEnt->r.absmin, clipEnt->r.absmax ) ) {
+			if( numlist < maxcount ) {
+				list[numlist] = query->list[i];
+			}
+			numlist++;
+		}
+	}
+
+	if( g_pmove_validate->integer ) {
+		int scalar[MAX_EDICTS];
+		int num_scalar = GClip_WalkAreaGrid( areagrid, igridmins, igridmaxs, bounds, scalar, MAX_EDICTS, areatype, timeDelta );
+		int num_batched = Min2( numlist, maxcount );
+		if( num_scalar != numlist || memcmp( scalar, list, Min2( num_scalar, num_batched ) * sizeof( int ) ) != 0 ) {
+			trace_batch.mismatches++;
+			Com_Printf( S_COLOR_RED "Trace batch mismatch: %i entities batched, %i scalar (areatype %i, timeDelta %i)\n",
+				numlist, num_scalar, areatype, timeDelta );
+		}
+	}
+
+	return numlist;
+}
+
+void GClip_PrintTraceBatchStats() {
+	int64_t total = trace_batch.hits + trace_batch.misses;
+	Com_Printf( "Trace batch: %" PRIi64 " queries, %" PRIi64 " reused (%.1f%%), %" PRIi64 " mismatches\n",
+		total, trace_batch.hits, total == 0 ? 0.0 : 100.0 * trace_batch.hits / total, trace_batch.mismatches );
+}
+
 
 /*
 * GClip_ClearWorld
@@ -465,6 +593,7 @@ void GClip_UnlinkEntity( edict_t *ent ) {
 	if( !ent->linked ) {
 		return; // not linked in anywhere
 	}
+	GClip_InvalidateTraceBatch();
 	GClip_UnlinkEntity_AreaGrid( ent );
 	ent->linked = false;
 }
@@ -486,6 +615,7 @@ void GClip_LinkEntity( edict_t *ent ) {
 	int topnode;
 
 	GClip_UnlinkEntity( ent ); // unlink from old position
+	GClip_InvalidateTraceBatch();
 
 	if( ent == game.edicts ) {
 		return; // don't add the world
@@ -940,6 +1070,9 @@ void GClip_TouchTriggers( edict_t *ent ) {
 }
 
 void G_PMoveTouchTriggers( pmove_t *pm, Vec3 previous_origin ) {
+	// touch functions can do anything, so stop reusing grid walks here
+	GClip_EndTraceBatch();
+
 	if( pm->playerState->POVnum <= 0 || (int)pm->playerState->POVnum > server_gs.maxclients ) {
 		return;
 	}
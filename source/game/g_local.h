@@ -209,6 +209,7 @@ extern cvar_t *g_scorelimit;
 
 extern cvar_t *g_projectile_prestep;
 extern cvar_t *g_numbots;
+extern cvar_t *g_bot_plans_per_frame;
 extern cvar_t *g_maxtimeouts;
 
 extern cvar_t *g_self_knockback;
@@ -218,6 +219,7 @@ extern cvar_t *g_respawn_delay_max;
 extern cvar_t *g_deadbody_followkiller;
 extern cvar_t *g_antilag_timenudge;
 extern cvar_t *g_antilag_maxtimedelta;
+extern cvar_t *g_pmove_validate;
 
 extern cvar_t *g_teams_maxplayers;
 extern cvar_t *g_teams_allow_uneven;
@@ -229,6 +231,8 @@ extern cvar_t *g_allow_spectator_voting;
 
 extern cvar_t *g_asGC_stats;
 extern cvar_t *g_asGC_interval;
+extern cvar_t *g_asProfile;
+extern cvar_t *g_asBudget;
 
 edict_t **G_Teams_ChallengersQueue( void );
 void G_Teams_Join_Cmd( edict_t *ent );
@@ -335,6 +339,7 @@ void G_asInitGameModuleEngine( void );
 void G_asShutdownGameModuleEngine( void );
 void G_asGarbageCollect( bool force );
 void G_asDumpAPI_f( void );
+void G_asProfile_f( void );
 
 #define world game.edicts
 
@@ -498,6 +503,13 @@ bool IsHeadshot( int entNum, Vec3 hit, int timeDelta );
 #define AREA_SOLID      1
 #define AREA_TRIGGERS   2
 int GClip_AreaEdicts( Vec3 mins, Vec3 maxs, int *list, int maxcount, int areatype, int timeDelta );
+
+// between Begin/End, area queries over the same grid cells reuse the first
+// walk. only valid while no entity is linked, unlinked or changes solidity
+// without relinking
+void GClip_BeginTraceBatch();
+void GClip_EndTraceBatch();
+void GClip_PrintTraceBatchStats();
 bool GClip_EntityContact( Vec3 mins, Vec3 maxs, edict_t *ent );
 
 //
@@ -55,10 +55,12 @@ cvar_t *g_inactivity_maxtime;
 
 cvar_t *g_projectile_prestep;
 cvar_t *g_numbots;
+cvar_t *g_bot_plans_per_frame;
 cvar_t *g_maxtimeouts;
 cvar_t *g_antilag;
 cvar_t *g_antilag_maxtimedelta;
 cvar_t *g_antilag_timenudge;
+cvar_t *g_pmove_validate;
 cvar_t *g_autorecord;
 cvar_t *g_autorecord_maxdemos;
 
@@ -73,6 +75,8 @@ cvar_t *g_allow_spectator_voting;
 
 cvar_t *g_asGC_stats;
 cvar_t *g_asGC_interval;
+cvar_t *g_asProfile;
+cvar_t *g_asBudget;
 
 static char *map_rotation_s = NULL;
 static char **map_rotation_p = NULL;
@@ -163,12 +167,14 @@ void G_Init( unsigned int framemsec ) {
 	g_respawn_delay_min = Cvar_Get( "g_respawn_delay_min", "600", CVAR_DEVELOPER );
 	g_respawn_delay_max = Cvar_Get( "g_respawn_delay_max", "6000", CVAR_DEVELOPER );
 	g_numbots = Cvar_Get( "g_numbots", "0", CVAR_ARCHIVE );
+	g_bot_plans_per_frame = Cvar_Get( "g_bot_plans_per_frame", "4", CVAR_ARCHIVE );
 	g_deadbody_followkiller = Cvar_Get( "g_deadbody_followkiller", "1", CVAR_DEVELOPER );
 	g_maxtimeouts = Cvar_Get( "g_maxtimeouts", "2", CVAR_ARCHIVE );
 	g_antilag_maxtimedelta = Cvar_Get( "g_antilag_maxtimedelta", "200", CVAR_ARCHIVE );
 	g_antilag_maxtimedelta->modified = true;
 	g_antilag_timenudge = Cvar_Get( "g_antilag_timenudge", "0", CVAR_ARCHIVE );
 	g_antilag_timenudge->modified = true;
+	g_pmove_validate = Cvar_Get( "g_pmove_validate", "0", CVAR_DEVELOPER );
 
 	g_allow_spectator_voting = Cvar_Get( "g_allow_spectator_voting", "1", CVAR_ARCHIVE );
 
@@ -208,6 +214,8 @@ void G_Init( unsigned int framemsec ) {
 
 	g_asGC_stats = Cvar_Get( "g_asGC_stats", "0", CVAR_ARCHIVE );
 	g_asGC_interval = Cvar_Get( "g_asGC_interval", "10", CVAR_ARCHIVE );
+	g_asProfile = Cvar_Get( "g_asProfile", "0", 0 );
+	g_asBudget = Cvar_Get( "g_asBudget", "0", CVAR_ARCHIVE );
 
 	// initialize all entities for this game
 	game.maxentities = MAX_EDICTS;
@@ -246,6 +254,8 @@ void G_Shutdown( void ) {
 
 	G_LevelFreePool();
 
+	AI_FreeNavMesh();
+
 	for( int i = 0; i < game.numentities; i++ ) {
 		if( game.edicts[i].r.inuse ) {
 			G_FreeEdict( &game.edicts[i] );
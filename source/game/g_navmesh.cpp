@@ -0,0 +1,676 @@
+#include <algorithm> // std::sort, std::lower_bound, std::push_heap
+
+#include "g_local.h"
+#include "qcommon/array.h"
+#include "qcommon/cmodel.h"
+
+/*
+ * the navmesh is a grid of walkable cells sampled from the tops of the
+ * world's brushes and patch facets. each cell is linked to the cells around
+ * it that a player can walk to, jump up to or drop down to
+ */
+
+#define NAV_CELL_SIZE 32
+#define NAV_JUMP_HEIGHT 40
+#define NAV_MAX_DROP 256
+#define NAV_MIN_WALK_NORMAL 0.7f
+#define NAV_MAX_SEARCH_NODES 8192
+
+// cells are much coarser than the player so test a slimmer hull, otherwise
+// narrow corridors and doorways fall through the gaps. steering sorts out the
+// last few units
+static constexpr Vec3 NAV_HULL_MINS = Vec3( -8.0f, -8.0f, playerbox_stand_mins.z );
+static constexpr Vec3 NAV_HULL_MAXS = Vec3( 8.0f, 8.0f, playerbox_stand_maxs.z );
+
+static constexpr u32 NAV_MAGIC = U32( 0x3156414e ); // NAV1
+static constexpr u32 NAV_VERSION = 1;
+
+enum NavLinkType : u32 {
+	NavLink_Walk,
+	NavLink_Jump,
+	NavLink_Drop,
+};
+
+struct NavNode {
+	Vec3 origin; // where the player's feet go
+	s32 cx, cy;
+	u32 first_link;
+	u32 num_links;
+};
+
+struct NavLink {
+	u32 target;
+	NavLinkType type;
+};
+
+struct NavFileHeader {
+	u32 magic;
+	u32 version;
+	u32 map_checksum;
+	u32 num_nodes;
+	u32 num_links;
+};
+
+struct NavMesh {
+	u64 world_hash;
+	u32 map_checksum;
+
+	Span< NavNode > nodes;
+	Span< NavLink > links;
+
+	// A* scratch, stamped with search_id so it never needs clearing
+	u32 search_id;
+	u32 * visited;
+	u32 * parent;
+	float * cost;
+};
+
+struct NavOpenNode {
+	float f;
+	u32 node;
+};
+
+static NavMesh navmesh;
+
+static u64 NavColumnKey( s32 cx, s32 cy ) {
+	return ( u64( u32( cx ) ) << 32 ) | u64( u32( cy ) );
+}
+
+static u64 NavColumnKey( const NavNode & node ) {
+	return NavColumnKey( node.cx, node.cy );
+}
+
+static bool NavNodeLess( const NavNode & a, const NavNode & b ) {
+	u64 ka = NavColumnKey( a );
+	u64 kb = NavColumnKey( b );
+	if( ka != kb )
+		return ka < kb;
+	return a.origin.z < b.origin.z;
+}
+
+static Vec3 NavHullCenter( Vec3 feet ) {
+	return feet - Vec3( 0.0f, 0.0f, NAV_HULL_MINS.z );
+}
+
+static void NavWorldTrace( trace_t * tr, Vec3 start, Vec3 end, Vec3 mins, Vec3 maxs ) {
+	CM_TransformedBoxTrace( CM_Server, svs.cms, tr, start, end, mins, maxs, NULL, MASK_PLAYERSOLID, Vec3( 0.0f ), Vec3( 0.0f ) );
+}
+
+static const char * NavMeshPath( TempAllocator * temp ) {
+	return ( *temp )( "navmesh/{}.nav", sv.mapname );
+}
+
+void AI_FreeNavMesh() {
+	// bots' paths are node indices into the mesh we're about to free
+	AI_ResetBotPaths();
+
+	FREE( sys_allocator, navmesh.nodes.ptr );
+	FREE( sys_allocator, navmesh.links.ptr );
+	FREE( sys_allocator, navmesh.visited );
+	FREE( sys_allocator, navmesh.parent );
+	FREE( sys_allocator, navmesh.cost );
+	navmesh = { };
+}
+
+static void AllocateSearchScratch() {
+	size_t n = navmesh.nodes.n;
+	navmesh.visited = ALLOC_MANY( sys_allocator, u32, n );
+	navmesh.parent = ALLOC_MANY( sys_allocator, u32, n );
+	navmesh.cost = ALLOC_MANY( sys_allocator, float, n );
+	memset( navmesh.visited, 0, n * sizeof( u32 ) );
+	navmesh.search_id = 0;
+}
+
+/*
+ * generation
+ */
+
+static bool FindFloorAt( const cbrush_t * brush, float x, float y, Vec3 * feet ) {
+	trace_t down;
+	NavWorldTrace( &down, Vec3( x, y, brush->maxs.z + 1.0f ), Vec3( x, y, brush->mins.z - 1.0f ), Vec3( 0.0f ), Vec3( 0.0f ) );
+	if( down.startsolid || down.fraction == 1.0f || down.plane.normal.z < NAV_MIN_WALK_NORMAL )
+		return false;
+
+	*feet = down.endpos + Vec3( 0.0f, 0.0f, 1.0f );
+
+	trace_t hull;
+	Vec3 center = NavHullCenter( *feet );
+	NavWorldTrace( &hull, center, center, NAV_HULL_MINS, NAV_HULL_MAXS );
+	if( hull.startsolid )
+		return false;
+
+	int contents = CM_TransformedPointContents( CM_Server, svs.cms, *feet + Vec3( 0.0f, 0.0f, 4.0f ), NULL, Vec3( 0.0f ), Vec3( 0.0f ) );
+	return ( contents & ( CONTENTS_LAVA | CONTENTS_SLIME | CONTENTS_NODROP ) ) == 0;
+}
+
+static bool FindFloorInCell( const cbrush_t * brush, s32 cx, s32 cy, Vec3 * feet ) {
+	// try the middle of the cell first, and nudge away from walls if the player doesn't fit
+	constexpr float nudge = NAV_CELL_SIZE / 4;
+	static const Vec2 offsets[] = {
+		Vec2( 0.0f, 0.0f ),
+		Vec2( nudge, 0.0f ), Vec2( -nudge, 0.0f ), Vec2( 0.0f, nudge ), Vec2( 0.0f, -nudge ),
+		Vec2( nudge, nudge ), Vec2( -nudge, nudge ), Vec2( nudge, -nudge ), Vec2( -nudge, -nudge ),
+	};
+
+	for( Vec2 offset : offsets ) {
+		float x = ( cx + 0.5f ) * NAV_CELL_SIZE + offset.x;
+		float y = ( cy + 0.5f ) * NAV_CELL_SIZE + offset.y;
+		if( x < brush->mins.x || x > brush->maxs.x || y < brush->mins.y || y > brush->maxs.y )
+			continue;
+
+		if( FindFloorAt( brush, x, y, feet ) )
+			return true;
+	}
+
+	return false;
+}
+
+static void SampleBrush( DynamicArray< NavNode > * nodes, const cbrush_t * brush ) {
+	if( !( brush->contents & MASK_PLAYERSOLID ) )
+		return;
+
+	bool walkable = false;
+	for( int i = 0; i < brush->numsides; i++ ) {
+		if( brush->brushsides[ i ].plane.normal.z >= NAV_MIN_WALK_NORMAL ) {
+			walkable = true;
+			break;
+		}
+	}
+
+	if( !walkable )
+		return;
+
+	s32 min_cx = s32( floorf( brush->mins.x / NAV_CELL_SIZE ) );
+	s32 min_cy = s32( floorf( brush->mins.y / NAV_CELL_SIZE ) );
+	s32 max_cx = s32( floorf( brush->maxs.x / NAV_CELL_SIZE ) );
+	s32 max_cy = s32( floorf( brush->maxs.y / NAV_CELL_SIZE ) );
+
+	for( s32 cx = min_cx; cx <= max_cx; cx++ ) {
+		for( s32 cy = min_cy; cy <= max_cy; cy++ ) {
+			Vec3 feet;
+			if( !FindFloorInCell( brush, cx, cy, &feet ) )
+				continue;
+
+			NavNode node = { };
+			node.origin = feet;
+			node.cx = cx;
+			node.cy = cy;
+			nodes->add( node );
+		}
+	}
+}
+
+static bool HasGroundBetween( Vec3 a, Vec3 b ) {
+	Vec3 mid = ( a + b ) * 0.5f;
+	float top = Max2( a.z, b.z ) + 1.0f;
+	float bottom = Min2( a.z, b.z ) - STEPSIZE;
+
+	trace_t tr;
+	NavWorldTrace( &tr, Vec3( mid.x, mid.y, top ), Vec3( mid.x, mid.y, bottom ), Vec3( 0.0f ), Vec3( 0.0f ) );
+	return tr.fraction < 1.0f && !tr.startsolid;
+}
+
+static bool ClassifyLink( const NavNode & from, const NavNode & to, NavLinkType * type ) {
+	float dz = to.origin.z - from.origin.z;
+	Vec3 a = NavHullCenter( from.origin );
+	Vec3 b = NavHullCenter( to.origin );
+
+	trace_t tr;
+	if( dz <= STEPSIZE && dz >= -STEPSIZE ) {
+		Vec3 step( 0.0f, 0.0f, STEPSIZE );
+		NavWorldTrace( &tr, a + step, b + step, NAV_HULL_MINS, NAV_HULL_MAXS );
+		if( tr.fraction < 1.0f || tr.startsolid )
+			return false;
+		*type = HasGroundBetween( from.origin, to.origin ) ? NavLink_Walk : NavLink_Jump;
+		return true;
+	}
+
+	if( dz > 0.0f ) {
+		if( dz > NAV_JUMP_HEIGHT )
+			return false;
+
+		// up to the top of the jump, then across
+		Vec3 apex = a + Vec3( 0.0f, 0.0f, dz + 1.0f );
+		NavWorldTrace( &tr, a, apex, NAV_HULL_MINS, NAV_HULL_MAXS );
+		if( tr.fraction < 1.0f || tr.startsolid )
+			return false;
+		NavWorldTrace( &tr, apex, b + Vec3( 0.0f, 0.0f, 1.0f ), NAV_HULL_MINS, NAV_HULL_MAXS );
+		if( tr.fraction < 1.0f )
+			return false;
+		*type = NavLink_Jump;
+		return true;
+	}
+
+	if( dz < -NAV_MAX_DROP )
+		return false;
+
+	// across, then fall
+	Vec3 ledge( b.x, b.y, a.z );
+	NavWorldTrace( &tr, a + Vec3( 0.0f, 0.0f, 1.0f ), ledge + Vec3( 0.0f, 0.0f, 1.0f ), NAV_HULL_MINS, NAV_HULL_MAXS );
+	if( tr.fraction < 1.0f || tr.startsolid )
+		return false;
+	NavWorldTrace( &tr, ledge, b, NAV_HULL_MINS, NAV_HULL_MAXS );
+	if( tr.fraction < 1.0f )
+		return false;
+	*type = NavLink_Drop;
+	return true;
+}
+
+static Span< const NavNode > NodesInColumn( Span< const NavNode > nodes, s32 cx, s32 cy ) {
+	u64 key = NavColumnKey( cx, cy );
+	const NavNode * first = std::lower_bound( nodes.begin(), nodes.end(), key, []( const NavNode & node, u64 k ) {
+		return NavColumnKey( node ) < k;
+	} );
+
+	const NavNode * last = first;
+	while( last < nodes.end() && NavColumnKey( *last ) == key ) {
+		last++;
+	}
+
+	return Span< const NavNode >( first, last - first );
+}
+
+static void LinkNodes( Span< NavNode > nodes, DynamicArray< NavLink > * links ) {
+	for( size_t i = 0; i < nodes.n; i++ ) {
+		NavNode * node = &nodes[ i ];
+		node->first_link = links->size();
+
+		for( s32 dx = -1; dx <= 1; dx++ ) {
+			for( s32 dy = -1; dy <= 1; dy++ ) {
+				if( dx == 0 && dy == 0 )
+					continue;
+
+				Span< const NavNode > column = NodesInColumn( nodes, node->cx + dx, node->cy + dy );
+				for( const NavNode & other : column ) {
+					NavLinkType type;
+					if( !ClassifyLink( *node, other, &type ) )
+						continue;
+
+					NavLink link;
+					link.target = &other - nodes.ptr;
+					link.type = type;
+					links->add( link );
+				}
+			}
+		}
+
+		node->num_links = links->size() - node->first_link;
+	}
+}
+
+static bool FindNearestGeneratedNode( Span< const NavNode > nodes, Vec3 p, s32 radius, u32 * result );
+
+/*
+ * drop cells that can't be reached from any spawn point, like the tops of
+ * the walls around the map
+ */
+static void PruneUnreachable( DynamicArray< NavNode > * nodes, DynamicArray< NavLink > * links ) {
+	static const char * spawn_classnames[] = {
+		"info_player_deathmatch",
+		"info_player_start",
+		"team_CTF_alphaspawn",
+		"team_CTF_betaspawn",
+		"spawn_bomb_attacking",
+		"spawn_bomb_defending",
+		"spawn_gladiator",
+	};
+
+	DynamicArray< u32 > queue( sys_allocator );
+	DynamicArray< u32 > remap( sys_allocator );
+	remap.resize( nodes->size() );
+	for( u32 & r : remap ) {
+		r = U32_MAX;
+	}
+
+	for( const char * classname : spawn_classnames ) {
+		for( edict_t * spot = NULL; ( spot = G_Find( spot, FOFS( classname ), classname ) ) != NULL; ) {
+			u32 start;
+			if( FindNearestGeneratedNode( nodes->span(), spot->s.origin, 1, &start ) && remap[ start ] == U32_MAX ) {
+				remap[ start ] = 0;
+				queue.add( start );
+			}
+		}
+	}
+
+	if( queue.size() == 0 )
+		return;
+
+	for( size_t i = 0; i < queue.size(); i++ ) {
+		const NavNode & node = ( *nodes )[ queue[ i ] ];
+		for( u32 j = 0; j < node.num_links; j++ ) {
+			u32 target = ( *links )[ node.first_link + j ].target;
+			if( remap[ target ] == U32_MAX ) {
+				remap[ target ] = 0;
+				queue.add( target );
+			}
+		}
+	}
+
+	u32 num_kept = 0;
+	for( size_t i = 0; i < nodes->size(); i++ ) {
+		if( remap[ i ] != U32_MAX ) {
+			remap[ i ] = num_kept;
+			num_kept++;
+		}
+	}
+
+	u32 num_links = 0;
+	for( size_t i = 0; i < nodes->size(); i++ ) {
+		if( remap[ i ] == U32_MAX )
+			continue;
+
+		NavNode node = ( *nodes )[ i ];
+		u32 first_link = num_links;
+		for( u32 j = 0; j < node.num_links; j++ ) {
+			NavLink link = ( *links )[ node.first_link + j ];
+			if( remap[ link.target ] == U32_MAX )
+				continue;
+			link.target = remap[ link.target ];
+			( *links )[ num_links ] = link;
+			num_links++;
+		}
+
+		node.first_link = first_link;
+		node.num_links = num_links - first_link;
+		( *nodes )[ remap[ i ] ] = node;
+	}
+
+	nodes->resize( num_kept );
+	links->resize( num_links );
+}
+
+static void BuildNavMesh() {
+	ZoneScoped;
+
+	int64_t start = Sys_Milliseconds();
+
+	DynamicArray< NavNode > nodes( sys_allocator );
+	DynamicArray< NavLink > links( sys_allocator );
+
+	const cmodel_t * world_model = CM_FindCModel( CM_Server, StringHash( svs.cms->world_hash ) );
+	for( int i = 0; i < world_model->nummarkbrushes; i++ ) {
+		SampleBrush( &nodes, &svs.cms->map_brushes[ world_model->markbrushes[ i ] ] );
+	}
+	for( int i = 0; i < world_model->nummarkfaces; i++ ) {
+		const cface_t * face = &svs.cms->map_faces[ world_model->markfaces[ i ] ];
+		for( int j = 0; j < face->numfacets; j++ ) {
+			SampleBrush( &nodes, &face->facets[ j ] );
+		}
+	}
+
+	// overlapping brushes find the same floor more than once
+	std::sort( nodes.begin(), nodes.end(), NavNodeLess );
+	size_t num_unique = 0;
+	for( size_t i = 0; i < nodes.size(); i++ ) {
+		if( num_unique > 0 ) {
+			const NavNode & prev = nodes[ num_unique - 1 ];
+			if( NavColumnKey( prev ) == NavColumnKey( nodes[ i ] ) && nodes[ i ].origin.z - prev.origin.z < STEPSIZE )
+				continue;
+		}
+		nodes[ num_unique ] = nodes[ i ];
+		num_unique++;
+	}
+	nodes.resize( num_unique );
+
+	LinkNodes( nodes.span(), &links );
+	PruneUnreachable( &nodes, &links );
+
+	navmesh.nodes = ALLOC_SPAN( sys_allocator, NavNode, nodes.size() );
+	navmesh.links = ALLOC_SPAN( sys_allocator, NavLink, links.size() );
+	memcpy( navmesh.nodes.ptr, nodes.ptr(), nodes.num_bytes() );
+	memcpy( navmesh.links.ptr, links.ptr(), links.num_bytes() );
+
+	Com_Printf( "Built navmesh for %s: %zu cells, %zu links in %" PRIi64 "ms\n", sv.mapname, nodes.size(), links.size(), Sys_Milliseconds() - start );
+}
+
+/*
+ * caching
+ */
+
+static bool LoadCachedNavMesh() {
+	TempAllocator temp = svs.frame_arena.temp();
+	const char * path = NavMeshPath( &temp );
+
+	int file;
+	if( FS_FOpenFile( path, &file, FS_READ ) == -1 )
+		return false;
+	defer { FS_FCloseFile( file ); };
+
+	NavFileHeader header;
+	if( FS_Read( &header, sizeof( header ), file ) != sizeof( header ) )
+		return false;
+
+	if( header.magic != NAV_MAGIC || header.version != NAV_VERSION || header.map_checksum != svs.cms->checksum ) {
+		Com_Printf( "%s is out of date\n", path );
+		return false;
+	}
+
+	Span< NavNode > nodes = ALLOC_SPAN( sys_allocator, NavNode, header.num_nodes );
+	Span< NavLink > links = ALLOC_SPAN( sys_allocator, NavLink, header.num_links );
+
+	bool ok = size_t( FS_Read( nodes.ptr, nodes.num_bytes(), file ) ) == nodes.num_bytes();
+	ok = ok && size_t( FS_Read( links.ptr, links.num_bytes(), file ) ) == links.num_bytes();
+	for( size_t i = 0; ok && i < nodes.n; i++ ) {
+		ok = u64( nodes[ i ].first_link ) + nodes[ i ].num_links <= links.n;
+	}
+	for( size_t i = 0; ok && i < links.n; i++ ) {
+		ok = links[ i ].target < nodes.n;
+	}
+
+	if( !ok ) {
+		Com_Printf( "%s is corrupt\n", path );
+		FREE( sys_allocator, nodes.ptr );
+		FREE( sys_allocator, links.ptr );
+		return false;
+	}
+
+	navmesh.nodes = nodes;
+	navmesh.links = links;
+
+	return true;
+}
+
+static void WriteCachedNavMesh() {
+	TempAllocator temp = svs.frame_arena.temp();
+	const char * path = NavMeshPath( &temp );
+
+	int file;
+	if( FS_FOpenFile( path, &file, FS_WRITE ) == -1 ) {
+		Com_Printf( "Couldn't write %s\n", path );
+		return;
+	}
+
+	NavFileHeader header;
+	header.magic = NAV_MAGIC;
+	header.version = NAV_VERSION;
+	header.map_checksum = svs.cms->checksum;
+	header.num_nodes = navmesh.nodes.n;
+	header.num_links = navmesh.links.n;
+
+	FS_Write( &header, sizeof( header ), file );
+	FS_Write( navmesh.nodes.ptr, navmesh.nodes.num_bytes(), file );
+	FS_Write( navmesh.links.ptr, navmesh.links.num_bytes(), file );
+	FS_FCloseFile( file );
+}
+
+void AI_LoadNavMesh( bool rebuild ) {
+	if( svs.cms == NULL )
+		return;
+
+	if( !rebuild && navmesh.world_hash == svs.cms->world_hash && navmesh.map_checksum == svs.cms->checksum )
+		return;
+
+	AI_FreeNavMesh();
+
+	if( rebuild || !LoadCachedNavMesh() ) {
+		BuildNavMesh();
+		WriteCachedNavMesh();
+	}
+
+	navmesh.world_hash = svs.cms->world_hash;
+	navmesh.map_checksum = svs.cms->checksum;
+	AllocateSearchScratch();
+}
+
+void AI_BuildNavMesh_f() {
+	AI_LoadNavMesh( true );
+}
+
+/*
+ * queries
+ */
+
+static bool FindNearestGeneratedNode( Span< const NavNode > nodes, Vec3 p, s32 radius, u32 * result ) {
+	s32 cx = s32( floorf( p.x / NAV_CELL_SIZE ) );
+	s32 cy = s32( floorf( p.y / NAV_CELL_SIZE ) );
+
+	float best = FLT_MAX;
+	for( s32 dx = -radius; dx <= radius; dx++ ) {
+		for( s32 dy = -radius; dy <= radius; dy++ ) {
+			for( const NavNode & node : NodesInColumn( nodes, cx + dx, cy + dy ) ) {
+				// prefer the floor we're standing on over the one above us
+				float dz = p.z - node.origin.z;
+				if( dz < -STEPSIZE || dz > 128.0f )
+					continue;
+
+				float d = LengthSquared( node.origin - p );
+				if( d < best ) {
+					best = d;
+					*result = &node - nodes.ptr;
+				}
+			}
+		}
+	}
+
+	return best != FLT_MAX;
+}
+
+int AI_NearestNavNode( Vec3 p ) {
+	u32 node;
+	// look further afield if we got knocked somewhere off the mesh
+	if( FindNearestGeneratedNode( navmesh.nodes, p, 1, &node ) || FindNearestGeneratedNode( navmesh.nodes, p, 4, &node ) )
+		return int( node );
+	return -1;
+}
+
+int AI_RandomNavNode( RNG * rng ) {
+	if( navmesh.nodes.n == 0 )
+		return -1;
+	return random_uniform( rng, 0, navmesh.nodes.n );
+}
+
+static bool IsValidNavNode( int node ) {
+	return node >= 0 && size_t( node ) < navmesh.nodes.n;
+}
+
+Vec3 AI_NavNodeOrigin( int node ) {
+	if( !IsValidNavNode( node ) )
+		return Vec3( 0.0f );
+	return navmesh.nodes[ node ].origin;
+}
+
+bool AI_NavLinkIsJump( int from, int to ) {
+	if( !IsValidNavNode( from ) )
+		return false;
+
+	const NavNode & node = navmesh.nodes[ from ];
+	for( u32 i = 0; i < node.num_links; i++ ) {
+		const NavLink & link = navmesh.links[ node.first_link + i ];
+		if( link.target == u32( to ) )
+			return link.type == NavLink_Jump;
+	}
+	return false;
+}
+
+static bool OpenNodeGreater( const NavOpenNode & a, const NavOpenNode & b ) {
+	return a.f > b.f;
+}
+
+/*
+ * AI_FindPath
+ *
+ * A* from one cell to another. The search gives up after NAV_MAX_SEARCH_NODES
+ * expansions and returns the path to the closest cell it found instead, so
+ * callers can always make progress. Returns the path length.
+ */
+int AI_FindPath( int from, int to, int * path, int max_len ) {
+	ZoneScoped;
+
+	if( !IsValidNavNode( from ) || !IsValidNavNode( to ) || max_len <= 0 )
+		return 0;
+
+	navmesh.search_id++;
+	if( navmesh.search_id == 0 ) {
+		memset( navmesh.visited, 0, navmesh.nodes.n * sizeof( u32 ) );
+		navmesh.search_id = 1;
+	}
+
+	Vec3 goal = navmesh.nodes[ to ].origin;
+
+	DynamicArray< NavOpenNode > open( sys_allocator, 256 );
+
+	navmesh.visited[ from ] = navmesh.search_id;
+	navmesh.parent[ from ] = u32( from );
+	navmesh.cost[ from ] = 0.0f;
+	open.add( { Length( goal - navmesh.nodes[ from ].origin ), u32( from ) } );
+
+	u32 best = u32( from );
+	float best_h = FLT_MAX;
+
+	for( int expanded = 0; open.size() > 0 && expanded < NAV_MAX_SEARCH_NODES; expanded++ ) {
+		std::pop_heap( open.begin(), open.end(), OpenNodeGreater );
+		NavOpenNode current = open.top();
+		open.resize( open.size() - 1 );
+
+		const NavNode & node = navmesh.nodes[ current.node ];
+		float h = Length( goal - node.origin );
+		if( h < best_h ) {
+			best_h = h;
+			best = current.node;
+		}
+
+		if( current.node == u32( to ) )
+			break;
+
+		// stale heap entry
+		if( current.f > navmesh.cost[ current.node ] + h + 0.01f )
+			continue;
+
+		for( u32 i = 0; i < node.num_links; i++ ) {
+			const NavLink & link = navmesh.links[ node.first_link + i ];
+			const NavNode & next = navmesh.nodes[ link.target ];
+
+			float g = navmesh.cost[ current.node ] + Length( next.origin - node.origin );
+			if( link.type == NavLink_Jump ) {
+				g += NAV_CELL_SIZE;
+			}
+
+			if( navmesh.visited[ link.target ] == navmesh.search_id && navmesh.cost[ link.target ] <= g )
+				continue;
+
+			navmesh.visited[ link.target ] = navmesh.search_id;
+			navmesh.parent[ link.target ] = current.node;
+			navmesh.cost[ link.target ] = g;
+
+			open.add( { g + Length( goal - next.origin ), link.target } );
+			std::push_heap( open.begin(), open.end(), OpenNodeGreater );
+		}
+	}
+
+	int len = 0;
+	for( u32 n = best; n != u32( from ); n = navmesh.parent[ n ] ) {
+		len++;
+	}
+
+	// keep the start of the path if it doesn't fit, the caller replans before it runs out
+	int skip = Max2( 0, len - max_len );
+	int written = len - skip;
+	int i = len - 1;
+	for( u32 n = best; n != u32( from ); n = navmesh.parent[ n ], i-- ) {
+		if( i < written ) {
+			path[ i ] = int( n );
+		}
+	}
+
+	return written;
+}
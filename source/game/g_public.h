@@ -49,6 +49,8 @@ typedef struct {
 	solid_t solid;
 	int clipmask;
 	edict_t *owner;
+
+	int64_t spawnTimeStamp;     // svs.gametime when the edict was last (re)spawned
 } entity_shared_t;
 
 //===============================================================
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "qcommon/base.h"
 #include "qcommon/compression.h"
 #include "qcommon/cmodel.h"
+#include "qcommon/shared_bsp.h"
 #include "game/g_local.h"
 
 enum EntityFieldType {
@@ -555,31 +556,45 @@ void G_LoadMap( const char * name ) {
 		CM_Free( CM_Server, svs.cms );
 	}
 
+	AI_FreeNavMesh();
+
 	Q_strncpyz( sv.mapname, name, sizeof( sv.mapname ) );
 
 	const char * path = temp( "maps/{}.bsp", name );
-	u8 * buf;
-	int length = FS_LoadFile( path, ( void ** ) &buf, NULL, 0 );
-	if( buf == NULL ) {
-		Com_Error( ERR_FATAL, "Couldn't load %s", path );
-	}
+	u64 base_hash = Hash64( path, strlen( path ) - strlen( ".bsp" ) );
 
-	Span< const u8 > compressed = Span< const u8 >( buf, length );
-	Span< u8 > decompressed;
-	defer { FREE( sys_allocator, decompressed.ptr ); };
-	bool ok = Decompress( path, sys_allocator, compressed, &decompressed );
-	if( !ok ) {
-		Com_Error( ERR_FATAL, "Couldn't decompress %s", path );
+	// a listen server can use the client's copy of the map
+	Span< const u8 > data;
+	if( FindSharedBSP( base_hash, &data ) ) {
+		svs.cms = CM_LoadMap( CM_Server, data, base_hash );
 	}
+	else {
+		u8 * buf;
+		int length = FS_LoadFile( path, ( void ** ) &buf, NULL, 0 );
+		if( buf == NULL ) {
+			Com_Error( ERR_FATAL, "Couldn't load %s", path );
+		}
+		defer { FS_FreeFile( buf ); };
+
+		Span< const u8 > compressed = Span< const u8 >( buf, length );
+		Span< u8 > decompressed;
+		defer { FREE( sys_allocator, decompressed.ptr ); };
+		bool ok = Decompress( path, sys_allocator, compressed, &decompressed );
+		if( !ok ) {
+			Com_Error( ERR_FATAL, "Couldn't decompress %s", path );
+		}
 
-	Span< const u8 > data = decompressed.ptr == NULL ? compressed : decompressed;
-	u64 base_hash = Hash64( path, strlen( path ) - strlen( ".bsp" ) );
-	svs.cms = CM_LoadMap( CM_Server, data, base_hash );
+		data = decompressed.ptr == NULL ? compressed : decompressed;
+		svs.cms = CM_LoadMap( CM_Server, data, base_hash );
+	}
 
 	server_gs.gameState.map = StringHash( base_hash );
 	server_gs.gameState.map_checksum = svs.cms->checksum;
 
-	FS_FreeFile( buf );
+	// build the navmesh now rather than on the first bot think mid-match
+	if( g_numbots->integer > 0 ) {
+		AI_LoadNavMesh( false );
+	}
 }
 
 // TODO: game module init is a mess and I'm not sure how to clean this up
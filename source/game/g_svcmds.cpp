@@ -355,7 +355,13 @@ void G_AddServerCommands( void ) {
 	Cmd_AddCommand( "listip", Cmd_ListIP_f );
 	Cmd_AddCommand( "writeip", Cmd_WriteIP_f );
 
+	// bots
+	Cmd_AddCommand( "buildnav", AI_BuildNavMesh_f );
+
 	Cmd_AddCommand( "dumpASapi", G_asDumpAPI_f );
+	Cmd_AddCommand( "asprofile", G_asProfile_f );
+
+	Cmd_AddCommand( "tracebatchstats", GClip_PrintTraceBatchStats );
 }
 
 /*
@@ -376,5 +382,11 @@ void G_RemoveCommands( void ) {
 	Cmd_RemoveCommand( "listip" );
 	Cmd_RemoveCommand( "writeip" );
 
+	// bots
+	Cmd_RemoveCommand( "buildnav" );
+
 	Cmd_RemoveCommand( "dumpASapi" );
+	Cmd_RemoveCommand( "asprofile" );
+
+	Cmd_RemoveCommand( "tracebatchstats" );
 }
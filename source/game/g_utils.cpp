@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "game/g_local.h"
+#include "qcommon/memtrack.h"
 
 /*
 ==============================================================================
@@ -46,6 +47,7 @@ typedef struct memblock_s
 	int tag;                // a tag of 0 is a free block
 	struct memblock_s       *next, *prev;
 	int id;                 // should be ZONEID
+	unsigned int site;      // allocation site for memreport
 } memblock_t;
 
 typedef struct
@@ -108,6 +110,7 @@ static void G_Z_Free( void *ptr, const char *filename, int fileline ) {
 	zone = levelzone;
 	zone->used -= block->size;
 	zone->count--;
+	TrackFree( block->site, block->size );
 
 	block->tag = 0;     // mark as free
 
@@ -192,6 +195,7 @@ static void *G_Z_TagMalloc( int size, int tag, const char *filename, int filelin
 	zone->used += base->size;
 	zone->count++;
 	base->id = ZONEID;
+	base->site = TrackAllocation( MemoryHeap_LevelZone, filename, fileline, base->size );
 
 	// marker for memory trash testing
 	*(int *)( (uint8_t *)base + base->size - 4 ) = ZONEID;
@@ -224,6 +228,9 @@ void G_LevelInitPool( size_t size ) {
 
 	levelzone = ( memzone_t * )G_Malloc( size );
 	G_Z_ClearZone( levelzone, size );
+
+	// the blocks get tracked as the level zone heap instead
+	Mem_Untrack( levelzone );
 }
 
 /*
@@ -231,6 +238,12 @@ void G_LevelInitPool( size_t size ) {
 */
 void G_LevelFreePool( void ) {
 	if( levelzone ) {
+		for( memblock_t *block = levelzone->blocklist.next; block != &levelzone->blocklist; block = block->next ) {
+			if( block->tag ) {
+				TrackFree( block->site, block->size );
+			}
+		}
+
 		G_Free( levelzone );
 		levelzone = NULL;
 	}
@@ -567,6 +580,7 @@ void G_InitEdict( edict_t *e ) {
 
 	// mark all entities to not be sent by default
 	e->r.svflags = SVF_NOCLIENT | (e->r.svflags & SVF_FAKECLIENT);
+	e->r.spawnTimeStamp = svs.gametime;
 
 	// clear the old state data
 	memset( &e->olds, 0, sizeof( e->olds ) );
@@ -1010,7 +1010,9 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta ) {
 	pm.cmd = *ucmd;
 
 	// perform a pmove
+	GClip_BeginTraceBatch();
 	Pmove( &server_gs, &pm );
+	GClip_EndTraceBatch();
 
 	// save results of pmove
 	client->old_pmove = client->ps.pmove;
@@ -27,7 +27,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 * Show the scoreboard messages if the scoreboards are active
 */
 void G_UpdateScoreBoardMessages( void ) {
-	char as_scoreboard[ 1024 ];
+	// static so a call aborted by g_asBudget leaves last frame's message
+	static char as_scoreboard[ 1024 ];
 	GT_asCallScoreboardMessage( as_scoreboard, sizeof( as_scoreboard ) );
 
 	String< 1024 > scoreboard( "scb \"{}", as_scoreboard );
@@ -0,0 +1,686 @@
+#include <algorithm> // std::sort
+
+#include "qcommon/qcommon.h"
+#include "qcommon/csprng.h"
+#include "qcommon/rng.h"
+#include "qcommon/version.h"
+#include "cgame/cg_public.h"
+
+/*
+ * headless load generator. it stands in for the client half of the engine
+ * and drives lots of simulated players against a server through the same
+ * connectionless handshake, netchan and snapshot parsing that real clients
+ * use
+ */
+
+enum LoadGenState {
+	LoadGenState_Waiting, // waiting for our turn to get a challenge
+	LoadGenState_Connecting,
+	LoadGenState_Handshake,
+	LoadGenState_Connected, // loading, waiting for the first snapshot
+	LoadGenState_Active,
+	LoadGenState_Dropped,
+};
+
+struct LoadGenClient {
+	LoadGenState state;
+	int index;
+
+	socket_t socket;
+	netchan_t netchan;
+	int game_port;
+
+	int64_t connect_time;
+	int connect_attempts;
+
+	int servercount;
+
+	char reliable_commands[ MAX_RELIABLE_COMMANDS ][ MAX_STRING_CHARS ];
+	int64_t reliable_sequence;
+	int64_t reliable_acknowledge;
+	int64_t last_executed_server_command;
+
+	snapshot_t * snapshots;
+	SyncEntityState * baselines;
+	int64_t received_snap_num;
+	int64_t last_snap_server_time;
+	int64_t last_snap_realtime;
+
+	usercmd_t cmds[ CMD_BACKUP ];
+	int64_t cmd_sent_time[ CMD_BACKUP ];
+	u32 ucmd_head;
+	u32 ucmd_acknowledged;
+	int64_t last_cmd_time;
+	int64_t last_packet_received_time;
+
+	float yaw, pitch;
+	s8 forwardmove, sidemove;
+	int64_t next_move_change;
+
+	// stats for the current report window
+	u64 bytes_in, bytes_out;
+	u32 snaps;
+};
+
+#define MAX_LATENCY_SAMPLES 65536
+
+struct LoadGenReport {
+	int64_t start_time;
+	u32 latency_samples[ MAX_LATENCY_SAMPLES ];
+	size_t num_latency_samples;
+	u32 dropped_snaps;
+};
+
+static cvar_t * loadgen_fps;
+static cvar_t * loadgen_move;
+static cvar_t * loadgen_report;
+static cvar_t * loadgen_timeout;
+
+static netadr_t server_address;
+static LoadGenClient * clients;
+static int num_clients;
+static LoadGenClient * parsing_client;
+static LoadGenReport report;
+static RNG rng;
+
+static void AddReliableCommand( LoadGenClient * client, const char * cmd ) {
+	if( client->reliable_sequence - client->reliable_acknowledge >= MAX_RELIABLE_COMMANDS - 1 ) {
+		Com_Printf( "loadgen %d: reliable command buffer overflow\n", client->index );
+		client->state = LoadGenState_Dropped;
+		return;
+	}
+
+	client->reliable_sequence++;
+	Q_strncpyz( client->reliable_commands[ client->reliable_sequence & ( MAX_RELIABLE_COMMANDS - 1 ) ], cmd, MAX_STRING_CHARS );
+}
+
+static void Transmit( LoadGenClient * client, msg_t * msg ) {
+	Netchan_PushAllFragments( &client->netchan );
+
+	if( msg->cursize > 60 ) {
+		Netchan_CompressMessage( msg );
+	}
+
+	client->bytes_out += msg->cursize;
+	Netchan_Transmit( &client->netchan, msg );
+}
+
+static void SendGetChallenge( LoadGenClient * client ) {
+	client->state = LoadGenState_Connecting;
+	client->connect_time = Sys_Milliseconds();
+	client->connect_attempts++;
+	Netchan_OutOfBandPrint( &client->socket, &server_address, "getchallenge\n" );
+}
+
+static void SendConnect( LoadGenClient * client, int challenge ) {
+	char userinfo[ MAX_INFO_STRING ] = "";
+	Info_SetValueForKey( userinfo, "name", va( "loadgen%03d", client->index ) );
+
+	Netchan_OutOfBandPrint( &client->socket, &server_address, "connect %i %i %i \"%s\"\n",
+		APP_PROTOCOL_VERSION, client->game_port, challenge, userinfo );
+}
+
+static void DropClient( LoadGenClient * client, const char * reason ) {
+	if( client->state == LoadGenState_Dropped )
+		return;
+
+	Com_Printf( "loadgen %d: dropped: %s\n", client->index, reason );
+	client->state = LoadGenState_Dropped;
+}
+
+static void ResetConnection( LoadGenClient * client ) {
+	memset( client->reliable_commands, 0, sizeof( client->reliable_commands ) );
+	client->reliable_sequence = 0;
+	client->reliable_acknowledge = 0;
+	client->last_executed_server_command = 0;
+	client->received_snap_num = 0;
+	client->ucmd_head = 1;
+	client->ucmd_acknowledged = 0;
+}
+
+/*
+ * server messages
+ */
+
+static void ParseServerData( LoadGenClient * client, msg_t * msg ) {
+	int protocol = MSG_ReadInt32( msg );
+	if( protocol != APP_PROTOCOL_VERSION ) {
+		DropClient( client, va( "server returned version %i, not %i", protocol, APP_PROTOCOL_VERSION ) );
+		return;
+	}
+
+	client->servercount = MSG_ReadInt32( msg );
+	MSG_ReadInt16( msg ); // snapFrameTime
+	MSG_ReadString( msg ); // base game directory
+	MSG_ReadInt16( msg ); // playernum
+
+	int sv_bitflags = MSG_ReadUint8( msg );
+	if( sv_bitflags & SV_BITFLAGS_HTTP ) {
+		if( sv_bitflags & SV_BITFLAGS_HTTP_BASEURL ) {
+			MSG_ReadString( msg );
+		}
+		else {
+			MSG_ReadInt16( msg );
+		}
+	}
+
+	client->state = LoadGenState_Connected;
+	client->received_snap_num = 0;
+	AddReliableCommand( client, va( "configstrings %i 0", client->servercount ) );
+}
+
+static void ParseServerCommand( LoadGenClient * client, msg_t * msg ) {
+	Cmd_TokenizeString( MSG_ReadString( msg ) );
+	const char * cmd = Cmd_Argv( 0 );
+
+	if( strcmp( cmd, "cmd" ) == 0 ) {
+		// server wants us to forward something back, e.g. the baselines request
+		if( Cmd_Argc() > 1 ) {
+			AddReliableCommand( client, Cmd_Args() );
+		}
+	}
+	else if( strcmp( cmd, "precache" ) == 0 ) {
+		AddReliableCommand( client, va( "begin %i", atoi( Cmd_Argv( 1 ) ) ) );
+	}
+	else if( strcmp( cmd, "changing" ) == 0 ) {
+		client->state = LoadGenState_Connected;
+		client->received_snap_num = 0;
+	}
+	else if( strcmp( cmd, "reconnect" ) == 0 || strcmp( cmd, "forcereconnect" ) == 0 ) {
+		client->state = LoadGenState_Handshake;
+		client->received_snap_num = 0;
+		AddReliableCommand( client, "new" );
+	}
+	else if( strcmp( cmd, "disconnect" ) == 0 ) {
+		DropClient( client, Cmd_Argv( 2 ) );
+	}
+}
+
+static void ParseFrame( LoadGenClient * client, msg_t * msg ) {
+	int64_t now = Sys_Milliseconds();
+
+	snapshot_t * last = client->received_snap_num > 0 ? &client->snapshots[ client->received_snap_num & UPDATE_MASK ] : NULL;
+	snapshot_t * snap = SNAP_ParseFrame( msg, last, client->snapshots, client->baselines, 0 );
+	if( !snap->valid )
+		return;
+
+	if( last != NULL && snap->serverFrame > last->serverFrame + 1 ) {
+		report.dropped_snaps += snap->serverFrame - last->serverFrame - 1;
+	}
+
+	client->received_snap_num = snap->serverFrame;
+	client->last_snap_server_time = snap->serverTime;
+	client->last_snap_realtime = now;
+	client->snaps++;
+
+	if( client->state == LoadGenState_Connected ) {
+		client->state = LoadGenState_Active;
+	}
+
+	// time from sending a usercmd to getting back a snapshot that includes it
+	if( snap->ucmdExecuted > 0 && snap->ucmdExecuted < client->ucmd_head && client->ucmd_head - snap->ucmdExecuted < CMD_BACKUP ) {
+		int64_t & sent = client->cmd_sent_time[ snap->ucmdExecuted & CMD_MASK ];
+		if( sent != 0 && report.num_latency_samples < MAX_LATENCY_SAMPLES ) {
+			report.latency_samples[ report.num_latency_samples ] = u32( now - sent );
+			report.num_latency_samples++;
+			sent = 0;
+		}
+	}
+}
+
+static void ParseServerMessage( LoadGenClient * client, msg_t * msg ) {
+	while( msg->readcount < msg->cursize && client->state != LoadGenState_Dropped ) {
+		int cmd = MSG_ReadUint8( msg );
+		switch( cmd ) {
+			case svc_servercmd: {
+				int cmd_num = MSG_ReadInt32( msg );
+				if( cmd_num <= client->last_executed_server_command ) {
+					MSG_ReadString( msg );
+					break;
+				}
+				client->last_executed_server_command = cmd_num;
+				ParseServerCommand( client, msg );
+			} break;
+
+			case svc_serverdata:
+				if( client->state != LoadGenState_Handshake )
+					return; // serverdata is always sent alone
+				ParseServerData( client, msg );
+				break;
+
+			case svc_spawnbaseline:
+				SNAP_ParseBaseline( msg, client->baselines );
+				break;
+
+			case svc_clcack:
+				client->reliable_acknowledge = MSG_ReadUintBase128( msg );
+				client->ucmd_acknowledged = MSG_ReadUintBase128( msg );
+				break;
+
+			case svc_frame:
+				ParseFrame( client, msg );
+				break;
+
+			default:
+				DropClient( client, va( "unexpected server message %i", cmd ) );
+				return;
+		}
+	}
+}
+
+static void ParseConnectionlessPacket( LoadGenClient * client, msg_t * msg ) {
+	MSG_BeginReading( msg );
+	MSG_ReadInt32( msg ); // skip the -1
+
+	Cmd_TokenizeString( MSG_ReadStringLine( msg ) );
+	const char * cmd = Cmd_Argv( 0 );
+
+	if( strcmp( cmd, "challenge" ) == 0 ) {
+		if( client->state == LoadGenState_Connecting ) {
+			SendConnect( client, atoi( Cmd_Argv( 1 ) ) );
+		}
+	}
+	else if( strcmp( cmd, "client_connect" ) == 0 ) {
+		if( client->state != LoadGenState_Connecting )
+			return;
+
+		ResetConnection( client );
+		Netchan_Setup( &client->netchan, &client->socket, &server_address, client->game_port );
+		client->state = LoadGenState_Handshake;
+		client->last_packet_received_time = Sys_Milliseconds();
+		AddReliableCommand( client, "new" );
+	}
+	else if( strcmp( cmd, "reject" ) == 0 ) {
+		if( client->state != LoadGenState_Connecting )
+			return;
+
+		MSG_ReadStringLine( msg ); // drop type
+		int flags = atoi( MSG_ReadStringLine( msg ) );
+		const char * reason = MSG_ReadStringLine( msg );
+
+		// the server may bounce us if it's full or we tripped a limit.
+		// just go back to the queue
+		if( flags & DROP_FLAG_AUTORECONNECT ) {
+			client->state = LoadGenState_Waiting;
+			Com_DPrintf( "loadgen %d: rejected, retrying: %s\n", client->index, reason );
+		}
+		else {
+			DropClient( client, reason );
+		}
+	}
+}
+
+static void ReadPackets( LoadGenClient * client ) {
+	msg_t msg;
+	uint8_t msg_data[ MAX_MSGLEN ];
+	MSG_Init( &msg, msg_data, sizeof( msg_data ) );
+
+	netadr_t address;
+	int ret;
+	while( client->socket.open && ( ret = NET_GetPacket( &client->socket, &address, &msg ) ) != 0 ) {
+		if( ret == -1 ) {
+			DropClient( client, va( "error receiving packet: %s", NET_ErrorString() ) );
+			return;
+		}
+
+		if( !NET_CompareAddress( &address, &server_address ) )
+			continue;
+
+		client->bytes_in += msg.cursize;
+
+		if( *( int * ) msg.data == -1 ) {
+			ParseConnectionlessPacket( client, &msg );
+			continue;
+		}
+
+		if( client->state < LoadGenState_Handshake || client->state == LoadGenState_Dropped || msg.cursize < 8 )
+			continue;
+
+		if( !Netchan_Process( &client->netchan, &msg ) )
+			continue;
+
+		MSG_BeginReading( &msg );
+		MSG_ReadInt32( &msg ); // sequence
+		MSG_ReadInt32( &msg ); // sequence_ack
+		if( msg.compressed && Netchan_DecompressMessage( &msg ) < 0 ) {
+			continue;
+		}
+
+		client->last_packet_received_time = Sys_Milliseconds();
+
+		parsing_client = client;
+		ParseServerMessage( client, &msg );
+		parsing_client = NULL;
+	}
+}
+
+/*
+ * usercmds
+ */
+
+static void ScriptMovement( LoadGenClient * client, int64_t now, usercmd_t * ucmd ) {
+	if( loadgen_move->integer == 0 )
+		return;
+
+	// run around in a random direction for a while, spinning and shooting
+	if( now >= client->next_move_change ) {
+		client->forwardmove = s8( random_uniform( &rng, -1, 2 ) * 127 );
+		client->sidemove = s8( random_uniform( &rng, -1, 2 ) * 127 );
+		client->pitch = random_uniform_float( &rng, -30.0f, 30.0f );
+		client->next_move_change = now + random_uniform( &rng, 250, 2000 );
+	}
+
+	client->yaw += random_uniform_float( &rng, -5.0f, 5.0f );
+
+	ucmd->forwardmove = client->forwardmove;
+	ucmd->sidemove = client->sidemove;
+	ucmd->upmove = random_p( &rng, 0.02f ) ? 127 : 0;
+	if( random_p( &rng, 0.1f ) ) {
+		ucmd->buttons |= BUTTON_ATTACK;
+	}
+}
+
+static void CreateUserCommand( LoadGenClient * client, int64_t now ) {
+	usercmd_t * ucmd = &client->cmds[ client->ucmd_head & CMD_MASK ];
+	memset( ucmd, 0, sizeof( *ucmd ) );
+
+	ucmd->msec = u8( Clamp( 1, int( now - client->last_cmd_time ), 255 ) );
+	ucmd->serverTimeStamp = client->last_snap_server_time + ( now - client->last_snap_realtime );
+
+	ScriptMovement( client, now, ucmd );
+
+	ucmd->angles[ 0 ] = ANGLE2SHORT( client->pitch );
+	ucmd->angles[ 1 ] = ANGLE2SHORT( client->yaw );
+
+	client->cmd_sent_time[ client->ucmd_head & CMD_MASK ] = now;
+	client->last_cmd_time = now;
+	client->ucmd_head++;
+}
+
+static void WriteUserCommands( LoadGenClient * client, msg_t * msg ) {
+	// resend everything that hasn't been acknowledged, like the real client
+	// does with cl_ucmdMaxResend
+	u32 first = Max2( client->ucmd_acknowledged + 1, client->ucmd_head > 3 ? client->ucmd_head - 3 : 0u );
+	first = Min2( first, client->ucmd_head );
+
+	MSG_WriteUint8( msg, clc_move );
+	MSG_WriteInt32( msg, client->received_snap_num > 0 ? client->received_snap_num : -1 );
+	MSG_WriteInt32( msg, client->ucmd_head );
+	MSG_WriteUint8( msg, client->ucmd_head - first );
+
+	usercmd_t nullcmd = { };
+	const usercmd_t * oldcmd = &nullcmd;
+	for( u32 i = first; i < client->ucmd_head; i++ ) {
+		const usercmd_t * cmd = &client->cmds[ i & CMD_MASK ];
+		MSG_WriteDeltaUsercmd( msg, oldcmd, cmd );
+		oldcmd = cmd;
+	}
+}
+
+static void SendMessageToServer( LoadGenClient * client, bool with_usercmds ) {
+	msg_t msg;
+	uint8_t msg_data[ MAX_MSGLEN ];
+	MSG_Init( &msg, msg_data, sizeof( msg_data ) );
+
+	MSG_WriteUint8( &msg, clc_svcack );
+	MSG_WriteIntBase128( &msg, client->last_executed_server_command );
+
+	for( int64_t i = client->reliable_acknowledge + 1; i <= client->reliable_sequence; i++ ) {
+		MSG_WriteUint8( &msg, clc_clientcommand );
+		MSG_WriteIntBase128( &msg, i );
+		MSG_WriteString( &msg, client->reliable_commands[ i & ( MAX_RELIABLE_COMMANDS - 1 ) ] );
+	}
+
+	if( with_usercmds ) {
+		WriteUserCommands( client, &msg );
+	}
+
+	Transmit( client, &msg );
+}
+
+/*
+ * frame
+ */
+
+static void ClientFrame( LoadGenClient * client, int64_t now, bool * connecting ) {
+	if( client->state == LoadGenState_Dropped )
+		return;
+
+	ReadPackets( client );
+
+	switch( client->state ) {
+		case LoadGenState_Waiting:
+			// connect one at a time so we don't hammer the server with connectionless packets
+			if( !*connecting ) {
+				*connecting = true;
+				SendGetChallenge( client );
+			}
+			return;
+
+		case LoadGenState_Connecting:
+			if( now - client->connect_time > 3000 ) {
+				if( client->connect_attempts > 3 ) {
+					DropClient( client, "connection timed out" );
+					*connecting = false;
+					return;
+				}
+				SendGetChallenge( client );
+			}
+			return;
+
+		default:
+			break;
+	}
+
+	if( client->state == LoadGenState_Dropped )
+		return;
+
+	if( now - client->last_packet_received_time > loadgen_timeout->integer * 1000 ) {
+		DropClient( client, "server timed out" );
+		return;
+	}
+
+	if( client->netchan.unsentFragments ) {
+		Netchan_TransmitNextFragment( &client->netchan );
+		return;
+	}
+
+	int msec = 1000 / Max2( 1, loadgen_fps->integer );
+	if( client->state == LoadGenState_Active ) {
+		if( now - client->last_cmd_time >= msec ) {
+			CreateUserCommand( client, now );
+			SendMessageToServer( client, true );
+		}
+	}
+	else if( now - client->last_cmd_time >= 100 ) {
+		// only reliable commands while loading
+		client->last_cmd_time = now;
+		SendMessageToServer( client, false );
+	}
+}
+
+static void PrintReport( int64_t now ) {
+	int num_active = 0;
+	int num_dropped = 0;
+	u64 bytes_in = 0;
+	u64 bytes_out = 0;
+	u64 snaps = 0;
+
+	for( int i = 0; i < num_clients; i++ ) {
+		LoadGenClient * client = &clients[ i ];
+		num_active += client->state == LoadGenState_Active ? 1 : 0;
+		num_dropped += client->state == LoadGenState_Dropped ? 1 : 0;
+		bytes_in += client->bytes_in;
+		bytes_out += client->bytes_out;
+		snaps += client->snaps;
+
+		client->bytes_in = 0;
+		client->bytes_out = 0;
+		client->snaps = 0;
+	}
+
+	float seconds = Max2( 1, int( now - report.start_time ) ) / 1000.0f;
+
+	u32 p50 = 0, p99 = 0, max = 0;
+	if( report.num_latency_samples > 0 ) {
+		std::sort( report.latency_samples, report.latency_samples + report.num_latency_samples );
+		p50 = report.latency_samples[ report.num_latency_samples / 2 ];
+		p99 = report.latency_samples[ ( report.num_latency_samples * 99 ) / 100 ];
+		max = report.latency_samples[ report.num_latency_samples - 1 ];
+	}
+
+	Com_Printf( "loadgen: %d/%d active, %d dropped | %.1f snaps/s per client, %u lost | latency p50 %ums p99 %ums max %ums | in %.1f KB/s, out %.1f KB/s\n",
+		num_active, num_clients, num_dropped,
+		num_active > 0 ? snaps / seconds / num_active : 0.0f, report.dropped_snaps,
+		p50, p99, max,
+		bytes_in / seconds / 1024.0f, bytes_out / seconds / 1024.0f );
+
+	report.start_time = now;
+	report.num_latency_samples = 0;
+	report.dropped_snaps = 0;
+}
+
+/*
+ * commands
+ */
+
+static void StopLoadGen() {
+	for( int i = 0; i < num_clients; i++ ) {
+		LoadGenClient * client = &clients[ i ];
+		if( client->state >= LoadGenState_Handshake && client->state != LoadGenState_Dropped ) {
+			for( int j = 0; j < 3; j++ ) {
+				AddReliableCommand( client, "disconnect" );
+				SendMessageToServer( client, false );
+			}
+		}
+
+		NET_CloseSocket( &client->socket );
+		FREE( sys_allocator, client->snapshots );
+		FREE( sys_allocator, client->baselines );
+	}
+
+	FREE( sys_allocator, clients );
+	clients = NULL;
+	num_clients = 0;
+}
+
+static void LoadGen_f() {
+	if( Cmd_Argc() < 3 ) {
+		Com_Printf( "Usage: %s <server> <num clients>\n", Cmd_Argv( 0 ) );
+		Com_Printf( "The server should run with sv_iplimit 0 and enough sv_maxclients\n" );
+		return;
+	}
+
+	if( !NET_StringToAddress( Cmd_Argv( 1 ), &server_address ) ) {
+		Com_Printf( "Bad server address\n" );
+		return;
+	}
+	if( NET_GetAddressPort( &server_address ) == 0 ) {
+		NET_SetAddressPort( &server_address, PORT_SERVER );
+	}
+
+	int n = atoi( Cmd_Argv( 2 ) );
+	if( n <= 0 ) {
+		Com_Printf( "Bad client count\n" );
+		return;
+	}
+
+	StopLoadGen();
+
+	clients = ALLOC_MANY( sys_allocator, LoadGenClient, n );
+	memset( clients, 0, n * sizeof( LoadGenClient ) );
+	num_clients = n;
+
+	netadr_t bind_address;
+	NET_InitAddress( &bind_address, server_address.type );
+
+	int base_game_port = Netchan_GamePort();
+	for( int i = 0; i < n; i++ ) {
+		LoadGenClient * client = &clients[ i ];
+		client->index = i;
+		client->state = LoadGenState_Waiting;
+		client->game_port = ( base_game_port + i ) & 0xffff;
+		client->yaw = random_uniform_float( &rng, 0.0f, 360.0f );
+
+		// each client gets its own socket so the server sees distinct ports
+		if( !NET_OpenSocket( &client->socket, SOCKET_UDP, &bind_address, false ) ) {
+			Com_Printf( "Couldn't open UDP socket: %s\n", NET_ErrorString() );
+			client->state = LoadGenState_Dropped;
+			continue;
+		}
+
+		client->snapshots = ALLOC_MANY( sys_allocator, snapshot_t, UPDATE_BACKUP );
+		client->baselines = ALLOC_MANY( sys_allocator, SyncEntityState, MAX_EDICTS );
+		memset( client->snapshots, 0, UPDATE_BACKUP * sizeof( snapshot_t ) );
+		memset( client->baselines, 0, MAX_EDICTS * sizeof( SyncEntityState ) );
+	}
+
+	report = { };
+	report.start_time = Sys_Milliseconds();
+
+	Com_Printf( "Starting %d clients against %s\n", n, NET_AddressToString( &server_address ) );
+}
+
+static void LoadGenStop_f() {
+	StopLoadGen();
+}
+
+/*
+ * engine interface
+ */
+
+void CL_Init() {
+	u64 entropy[ 2 ];
+	CSPRNG_Bytes( entropy, sizeof( entropy ) );
+	rng = new_rng( entropy[ 0 ], entropy[ 1 ] );
+
+	loadgen_fps = Cvar_Get( "loadgen_fps", "62", CVAR_ARCHIVE );
+	loadgen_move = Cvar_Get( "loadgen_move", "1", CVAR_ARCHIVE );
+	loadgen_report = Cvar_Get( "loadgen_report", "5", CVAR_ARCHIVE );
+	loadgen_timeout = Cvar_Get( "loadgen_timeout", "10", CVAR_ARCHIVE );
+
+	Cmd_AddCommand( "loadgen", LoadGen_f );
+	Cmd_AddCommand( "loadgen_stop", LoadGenStop_f );
+}
+
+void CL_Shutdown() {
+	StopLoadGen();
+
+	Cmd_RemoveCommand( "loadgen" );
+	Cmd_RemoveCommand( "loadgen_stop" );
+}
+
+void CL_Frame( int realMsec, int gameMsec ) {
+	ZoneScoped;
+
+	if( num_clients == 0 )
+		return;
+
+	int64_t now = Sys_Milliseconds();
+
+	bool connecting = false;
+	for( int i = 0; i < num_clients; i++ ) {
+		connecting = connecting || clients[ i ].state == LoadGenState_Connecting;
+	}
+
+	for( int i = 0; i < num_clients; i++ ) {
+		ClientFrame( &clients[ i ], now, &connecting );
+	}
+
+	if( now - report.start_time >= Max2( 1, loadgen_report->integer ) * 1000 ) {
+		PrintReport( now );
+	}
+}
+
+// called on Com_Error, so only drop whoever sent the bad message
+void CL_Disconnect( const char * message ) {
+	if( parsing_client != NULL ) {
+		DropClient( parsing_client, message != NULL ? message : "error" );
+		parsing_client = NULL;
+	}
+}
+
+void Con_Print( const char * text ) { }
+
+void Key_Init() { }
+void Key_Shutdown() { }
@@ -1,6 +1,7 @@
 #include "qcommon/base.h"
 #include "qcommon/qcommon.h"
 #include "qcommon/asan.h"
+#include "qcommon/memtrack.h"
 
 void * Allocator::allocate( size_t size, size_t alignment, const char * func, const char * file, int line ) {
 	void * p = try_allocate( size, alignment, func, file, line );
@@ -80,6 +81,20 @@ struct AllocationTracker {
 
 #endif
 
+// every block starts with this so frees can be attributed in memreport
+// without looking the pointer up. 16 bytes keeps the block 16 aligned
+struct SystemAllocationHeader {
+	u32 site;
+	u32 padding;
+	u64 size;
+};
+
+STATIC_ASSERT( sizeof( SystemAllocationHeader ) == 16 );
+
+static SystemAllocationHeader * GetSystemAllocationHeader( void * ptr ) {
+	return ptr == NULL ? NULL : ( SystemAllocationHeader * ) ptr - 1;
+}
+
 struct SystemAllocator final : public Allocator {
 	SystemAllocator() { }
 	NONCOPYABLE( SystemAllocator );
@@ -99,7 +114,17 @@ struct SystemAllocator final : public Allocator {
 		 */
 
 		assert( alignment <= 16 );
-		void * ptr = malloc( size );
+		if( size > SIZE_MAX - sizeof( SystemAllocationHeader ) )
+			return NULL;
+
+		SystemAllocationHeader * header = ( SystemAllocationHeader * ) malloc( sizeof( SystemAllocationHeader ) + size );
+		if( header == NULL )
+			return NULL;
+
+		header->site = TrackAllocation( MemoryHeap_System, file, line, size );
+		header->size = size;
+
+		void * ptr = header + 1;
 		TracyAlloc( ptr, size );
 		tracker.track( ptr, func, file, line );
 		return ptr;
@@ -107,17 +132,29 @@ struct SystemAllocator final : public Allocator {
 
 	void * try_reallocate( void * ptr, size_t current_size, size_t new_size, size_t alignment, const char * func, const char * file, int line ) {
 		assert( alignment <= 16 );
+		if( new_size > SIZE_MAX - sizeof( SystemAllocationHeader ) )
+			return NULL;
 
 		TracyFree( ptr );
 		tracker.untrack( ptr, func, file, line );
 
-		void * new_ptr = realloc( ptr, new_size );
-		if( new_ptr == NULL ) {
-			TracyAlloc( ptr, new_size );
+		SystemAllocationHeader * header = GetSystemAllocationHeader( ptr );
+		SystemAllocationHeader old_header = header == NULL ? SystemAllocationHeader() : *header;
+
+		SystemAllocationHeader * new_header = ( SystemAllocationHeader * ) realloc( header, sizeof( SystemAllocationHeader ) + new_size );
+		if( new_header == NULL ) {
+			TracyAlloc( ptr, current_size );
 			tracker.track( ptr, func, file, line );
 			return NULL;
 		}
 
+		if( header != NULL ) {
+			TrackFree( old_header.site, old_header.size );
+		}
+		new_header->site = TrackAllocation( MemoryHeap_System, file, line, new_size );
+		new_header->size = new_size;
+
+		void * new_ptr = new_header + 1;
 		TracyAlloc( new_ptr, new_size );
 		tracker.track( new_ptr, func, file, line );
 
@@ -125,9 +162,15 @@ struct SystemAllocator final : public Allocator {
 	}
 
 	void deallocate( void * ptr, const char * func, const char * file, int line ) {
+		if( ptr == NULL )
+			return;
+
 		TracyFree( ptr );
 		tracker.untrack( ptr, func, file, line );
-		free( ptr );
+
+		SystemAllocationHeader * header = GetSystemAllocationHeader( ptr );
+		TrackFree( header->site, header->size );
+		free( header );
 	}
 };
 
@@ -163,6 +206,7 @@ ArenaAllocator::ArenaAllocator( void * mem, size_t size ) {
 	top = memory + size;
 	cursor = memory;
 	cursor_max = cursor;
+	peak = 0;
 	num_temp_allocators = 0;
 }
 
@@ -228,6 +272,7 @@ TempAllocator ArenaAllocator::temp() {
 void ArenaAllocator::clear() {
 	assert( num_temp_allocators == 0 );
 	ASAN_POISON_MEMORY_REGION( memory, top - memory );
+	peak = Max2( peak, size_t( cursor_max - memory ) );
 	cursor = memory;
 	cursor_max = cursor;
 }
@@ -240,6 +285,14 @@ float ArenaAllocator::max_utilisation() const {
 	return float( cursor_max - cursor ) / float( top - cursor );
 }
 
+size_t ArenaAllocator::capacity() const {
+	return top - memory;
+}
+
+size_t ArenaAllocator::peak_usage() const {
+	return Max2( peak, size_t( cursor_max - memory ) );
+}
+
 void * AllocManyHelper( Allocator * a, size_t n, size_t size, size_t alignment, const char * func, const char * file, int line ) {
 	if( n != 0 && SIZE_MAX / n < size )
 		Sys_Error( "allocation too large" );
@@ -12,6 +12,7 @@
 #include "qcommon/linear_algebra.h"
 
 #include "tracy/Tracy.hpp"
+#include "qcommon/profiler.h"
 
 /*
  * helpers
@@ -455,7 +455,7 @@ BOX TRACING
 #define DIST_EPSILON    ( 1.0f / 32.0f )
 
 static void CM_ClipBoxToBrush( traceWork_t *tw, const cbrush_t *brush ) {
-	ZoneScoped;
+	ZoneScopedTracyOnly;
 
 	if( !brush->numsides ) {
 		return;
@@ -551,7 +551,7 @@ static void CM_ClipBoxToBrush( traceWork_t *tw, const cbrush_t *brush ) {
 }
 
 static void CM_TestBoxInBrush( traceWork_t *tw, const cbrush_t *brush ) {
-	ZoneScoped;
+	ZoneScopedTracyOnly;
 
 	if( !brush->numsides ) {
 		return;
@@ -580,7 +580,7 @@ static void CM_TestBoxInBrush( traceWork_t *tw, const cbrush_t *brush ) {
 }
 
 static void CM_CollideBox( traceWork_t *tw, const int *markbrushes, int nummarkbrushes, const int *markfaces, int nummarkfaces, void ( *func )( traceWork_t *, const cbrush_t *b ) ) {
-	ZoneScoped;
+	ZoneScopedTracyOnly;
 
 	const cbrush_t *brushes = tw->brushes;
 	const cface_t *faces = tw->faces;
@@ -651,7 +651,7 @@ static inline void CM_TestBox( traceWork_t *tw, const int *markbrushes, int numm
 }
 
 static void CM_RecursiveHullCheck( traceWork_t *tw, int num, float p1f, float p2f, Vec3 p1, Vec3 p2 ) {
-	ZoneScoped;
+	ZoneScopedTracyOnly;
 
 	const CollisionModel *cms = tw->cms;
 	const cnode_t *node;
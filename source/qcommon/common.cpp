@@ -39,6 +39,7 @@ static char com_errormsg[MAX_PRINTMSG];
 static bool com_quit;
 
 static jmp_buf abortframe;     // an ERR_DROP occured, exit the entire frame
+static thread_local jmp_buf * error_trap;
 
 cvar_t *developer;
 cvar_t *timescale;
@@ -244,6 +245,16 @@ void Com_Error( com_error_code_t code, const char *format, ... ) {
 	const size_t sizeof_msg = sizeof( com_errormsg );
 	static bool recursive = false;
 
+	if( code == ERR_DROP && error_trap != NULL ) {
+		char trapped[MAX_PRINTMSG];
+		va_start( argptr, format );
+		vsnprintf( trapped, sizeof( trapped ), format, argptr );
+		va_end( argptr );
+
+		Com_Printf( "ERROR: %s\n", trapped );
+		longjmp( *error_trap, -1 );
+	}
+
 	if( recursive ) {
 		Com_Printf( "recursive error after: %s", msg ); // wsw : jal : log it
 		Sys_Error( "recursive error after: %s", msg );
@@ -278,6 +289,13 @@ void Com_Error( com_error_code_t code, const char *format, ... ) {
 	Sys_Error( "%s", msg );
 }
 
+/*
+* Com_SetErrorTrap
+*/
+void Com_SetErrorTrap( jmp_buf * trap ) {
+	error_trap = trap;
+}
+
 /*
 * Com_DeferQuit
 */
@@ -534,6 +552,8 @@ void Qcommon_Init( int argc, char **argv ) {
 
 	Sys_Init();
 
+	InitProfiler();
+
 	if( setjmp( abortframe ) ) {
 		Sys_Error( "Error during initialization: %s", com_errormsg );
 	}
@@ -627,6 +647,9 @@ void Qcommon_Init( int argc, char **argv ) {
 * Qcommon_Frame
 */
 void Qcommon_Frame( unsigned int realMsec ) {
+	// before our own zone so the last frame's Qcommon_Frame lands in its totals
+	ProfilerFrame();
+
 	ZoneScoped;
 
 	static unsigned int gameMsec;
@@ -698,4 +721,6 @@ void Qcommon_Shutdown( void ) {
 	Memory_Shutdown();
 
 	DeleteMutex( com_print_mutex );
+
+	ShutdownProfiler();
 }
@@ -18,26 +18,89 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#include <algorithm> // std::lower_bound
+
 #include "qcommon/qcommon.h"
-#include "qcommon/q_trie.h"
+#include "qcommon/hash.h"
+#include "qcommon/hashtable.h"
 #include "qcommon/threads.h"
 #include "client/console.h"
 
 static bool cvar_initialized = false;
 static bool cvar_preinitialized = false;
 
-static trie_t *cvar_trie = NULL;
+#define MAX_CVARS 2048
+
+// cvars are never removed before shutdown, so cvars[] only grows and
+// indices into it stay valid. cvars_sorted is ordered by name for listing
+// and completion, cvars_hashtable maps a case insensitive name hash to an
+// index for exact lookups
+static cvar_t *cvars[ MAX_CVARS ];
+static u32 cvars_sorted[ MAX_CVARS ];
+static u32 num_cvars;
+static Hashtable< MAX_CVARS * 2 > cvars_hashtable;
+
+// one bit per cvar index, kept up to date as flags and latched values
+// change so the scans below don't have to touch every cvar
+static u64 cvars_latched[ MAX_CVARS / 64 ];
+static u64 cvars_archived[ MAX_CVARS / 64 ];
+
 static Mutex *cvar_mutex = NULL;
 
-static int Cvar_HasFlags( void *cvar, const void *flags ) {
-	assert( cvar );
-	return Cvar_FlagIsSet( ( (cvar_t *) cvar )->flags, *(const cvar_flag_t *) flags );
+static u64 Cvar_NameHash( const char *name ) {
+	u64 hash = Hash64( "" );
+	for( const char *p = name; *p != '\0'; p++ ) {
+		char c = tolower( *p );
+		hash = Hash64( &c, 1, hash );
+	}
+	return hash;
+}
+
+static bool Cvar_Index( const char *name, u32 *idx ) {
+	u64 value;
+	if( !cvars_hashtable.get( Cvar_NameHash( name ), &value ) )
+		return false;
+	*idx = u32( value );
+	return true;
+}
+
+static void Cvar_SetBit( u64 *bits, u32 idx, bool set ) {
+	u64 mask = U64( 1 ) << ( idx % 64 );
+	if( set ) {
+		bits[ idx / 64 ] |= mask;
+	} else {
+		bits[ idx / 64 ] &= ~mask;
+	}
+}
+
+static bool Cvar_GetBit( const u64 *bits, u32 idx ) {
+	return ( bits[ idx / 64 ] & ( U64( 1 ) << ( idx % 64 ) ) ) != 0;
+}
+
+/*
+* Cvar_UpdateBits
+* call after changing a cvar's flags or latched_string
+*/
+static void Cvar_UpdateBits( const cvar_t *var ) {
+	u32 idx;
+	Lock( cvar_mutex );
+	if( Cvar_Index( var->name, &idx ) ) {
+		Cvar_SetBit( cvars_latched, idx, var->latched_string != NULL );
+		Cvar_SetBit( cvars_archived, idx, Cvar_FlagIsSet( var->flags, CVAR_ARCHIVE ) );
+	}
+	Unlock( cvar_mutex );
+}
+
+static bool Cvar_NameLess( u32 a, const char *b ) {
+	return Q_stricmp( cvars[ a ]->name, b ) < 0;
 }
 
-static int Cvar_IsLatched( void *cvar, const void *flags ) {
-	const cvar_t *const var = (cvar_t *) cvar;
-	assert( cvar );
-	return Cvar_FlagIsSet( var->flags, *(const cvar_flag_t *) flags ) && var->latched_string;
+/*
+* Cvar_FirstWithPrefix
+* index into cvars_sorted of the first cvar whose name could start with partial
+*/
+static u32 Cvar_FirstWithPrefix( const char *partial ) {
+	return u32( std::lower_bound( cvars_sorted, cvars_sorted + num_cvars, partial, Cvar_NameLess ) - cvars_sorted );
 }
 
 static bool Cvar_CheatsAllowed() {
@@ -50,8 +113,8 @@ static bool Cvar_CheatsAllowed() {
 #endif
 }
 
-static int Cvar_PatternMatches( void *cvar, const void *pattern ) {
-	return !pattern || Com_GlobMatch( (const char *) pattern, ( (cvar_t *) cvar )->name, false );
+static bool Cvar_PatternMatches( const cvar_t *var, const char *pattern ) {
+	return !pattern || Com_GlobMatch( pattern, var->name, false );
 }
 
 /*
@@ -75,10 +138,13 @@ bool Cvar_Initialized( void ) {
 * Cvar_Find
 */
 cvar_t *Cvar_Find( const char *var_name ) {
-	cvar_t *cvar;
-	assert( cvar_trie );
+	cvar_t *cvar = NULL;
+	assert( cvar_preinitialized );
 	Lock( cvar_mutex );
-	Trie_Find( cvar_trie, var_name, TRIE_EXACT_MATCH, (void **)&cvar );
+	u32 idx;
+	if( Cvar_Index( var_name, &idx ) ) {
+		cvar = cvars[ idx ];
+	}
 	Unlock( cvar_mutex );
 	return cvar;
 }
@@ -137,10 +203,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 		}
 	}
 
-	assert( cvar_trie );
-	Lock( cvar_mutex );
-	Trie_Find( cvar_trie, var_name, TRIE_EXACT_MATCH, (void **)&var );
-	Unlock( cvar_mutex );
+	var = Cvar_Find( var_name );
 
 	if( !var_value ) {
 		return NULL;
@@ -184,6 +247,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 
 		}
 		Cvar_FlagSet( &var->flags, flags );
+		Cvar_UpdateBits( var );
 		return var;
 	}
 
@@ -205,7 +269,29 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 	Cvar_SetModified( var );
 
 	Lock( cvar_mutex );
-	Trie_Insert( cvar_trie, var_name, var );
+
+	if( num_cvars == ARRAY_COUNT( cvars ) ) {
+		Unlock( cvar_mutex );
+		Com_Error( ERR_FATAL, "Too many cvars" );
+	}
+
+	u32 idx = num_cvars;
+	if( !cvars_hashtable.add( Cvar_NameHash( var_name ), idx ) ) {
+		Unlock( cvar_mutex );
+		Com_Error( ERR_FATAL, "Cvar hash name collision %s", var_name );
+	}
+
+	cvars[ idx ] = var;
+
+	u32 pos = Cvar_FirstWithPrefix( var_name );
+	memmove( cvars_sorted + pos + 1, cvars_sorted + pos, ( num_cvars - pos ) * sizeof( cvars_sorted[ 0 ] ) );
+	cvars_sorted[ pos ] = idx;
+
+	Cvar_SetBit( cvars_latched, idx, false );
+	Cvar_SetBit( cvars_archived, idx, Cvar_FlagIsSet( flags, CVAR_ARCHIVE ) );
+
+	num_cvars++;
+
 	Unlock( cvar_mutex );
 
 	return var;
@@ -261,10 +347,12 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, bool force )
 			if( Com_ServerState() ) {
 				Com_Printf( "%s will be changed upon restarting.\n", var->name );
 				var->latched_string = ZoneCopyString( (char *) value );
+				Cvar_UpdateBits( var );
 			} else {
 				if( Cvar_FlagIsSet( var->flags, CVAR_LATCH_VIDEO ) ) {
 					Com_Printf( "%s will be changed upon restarting video.\n", var->name );
 					var->latched_string = ZoneCopyString( (char *) value );
+					Cvar_UpdateBits( var );
 				} else {
 					Mem_ZoneFree( var->string ); // free the old value string
 					var->string = ZoneCopyString( value );
@@ -279,6 +367,7 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, bool force )
 		if( var->latched_string ) {
 			Mem_ZoneFree( var->latched_string );
 			var->latched_string = NULL;
+			Cvar_UpdateBits( var );
 		}
 	}
 
@@ -332,6 +421,7 @@ cvar_t *Cvar_FullSet( const char *var_name, const char *value, cvar_flag_t flags
 	} else {
 		Cvar_FlagSet( &var->flags, flags );
 	}
+	Cvar_UpdateBits( var );
 
 	// if we overwrite the flags, we will also force the value
 	return Cvar_Set2( var_name, value, overwrite_flags );
@@ -357,8 +447,6 @@ void Cvar_SetValue( const char *var_name, float value ) {
 * Any variables with CVAR_LATCHED will now be updated
 */
 void Cvar_GetLatchedVars( cvar_flag_t flags ) {
-	unsigned int i;
-	struct trie_dump_s *dump = NULL;
 	cvar_flag_t latchFlags;
 
 	Cvar_FlagsClear( &latchFlags );
@@ -369,19 +457,27 @@ void Cvar_GetLatchedVars( cvar_flag_t flags ) {
 		return;
 	}
 
-	assert( cvar_trie );
 	Lock( cvar_mutex );
-	Trie_DumpIf( cvar_trie, "", TRIE_DUMP_VALUES, Cvar_IsLatched, &flags, &dump );
-	Unlock( cvar_mutex );
-	for( i = 0; i < dump->size; ++i ) {
-		cvar_t * var = ( cvar_t * ) dump->key_value_vector[i].value;
-		Mem_ZoneFree( var->string );
-		var->string = var->latched_string;
-		var->latched_string = NULL;
-		var->value = atof( var->string );
-		var->integer = Q_rint( var->value );
+	for( u32 i = 0; i < ARRAY_COUNT( cvars_latched ); i++ ) {
+		u64 bits = cvars_latched[ i ];
+		while( bits != 0 ) {
+			u32 idx = i * 64 + __builtin_ctzll( bits );
+			bits &= bits - 1;
+
+			cvar_t * var = cvars[ idx ];
+			if( !Cvar_FlagIsSet( var->flags, flags ) ) {
+				continue;
+			}
+
+			Mem_ZoneFree( var->string );
+			var->string = var->latched_string;
+			var->latched_string = NULL;
+			var->value = atof( var->string );
+			var->integer = Q_rint( var->value );
+			Cvar_SetBit( cvars_latched, idx, false );
+		}
 	}
-	Trie_FreeDump( dump );
+	Unlock( cvar_mutex );
 }
 
 /*
@@ -390,23 +486,21 @@ void Cvar_GetLatchedVars( cvar_flag_t flags ) {
 * All cheat variables with be reset to default unless cheats are allowed
 */
 void Cvar_FixCheatVars( void ) {
-	struct trie_dump_s *dump = NULL;
-	unsigned int i;
-	cvar_flag_t flags = CVAR_CHEAT;
-
 	if( Cvar_CheatsAllowed() ) {
 		return;
 	}
 
-	assert( cvar_trie );
+	// cvars[] is append only so iterating without the lock is fine, and
+	// Cvar_ForceSet needs to take it
 	Lock( cvar_mutex );
-	Trie_DumpIf( cvar_trie, "", TRIE_DUMP_VALUES, Cvar_HasFlags, &flags, &dump );
+	u32 n = num_cvars;
 	Unlock( cvar_mutex );
-	for( i = 0; i < dump->size; ++i ) {
-		cvar_t * var = ( cvar_t * ) dump->key_value_vector[i].value;
-		Cvar_ForceSet( var->name, var->dvalue );
+	for( u32 i = 0; i < n; i++ ) {
+		cvar_t * var = cvars[ i ];
+		if( Cvar_FlagIsSet( var->flags, CVAR_CHEAT ) ) {
+			Cvar_ForceSet( var->name, var->dvalue );
+		}
 	}
-	Trie_FreeDump( dump );
 }
 
 
@@ -529,16 +623,14 @@ static void Cvar_Toggle_f( void ) {
 */
 void Cvar_WriteVariables( int file ) {
 	char buffer[MAX_PRINTMSG];
-	struct trie_dump_s *dump = NULL;
-	unsigned int i;
-	cvar_flag_t cvar_archive = CVAR_ARCHIVE;
 
-	assert( cvar_trie );
 	Lock( cvar_mutex );
-	Trie_DumpIf( cvar_trie, "", TRIE_DUMP_VALUES, Cvar_HasFlags, &cvar_archive, &dump );
-	Unlock( cvar_mutex );
-	for( i = 0; i < dump->size; ++i ) {
-		cvar_t * var = ( cvar_t * ) dump->key_value_vector[i].value;
+	for( u32 i = 0; i < num_cvars; i++ ) {
+		u32 idx = cvars_sorted[ i ];
+		if( !Cvar_GetBit( cvars_archived, idx ) )
+			continue;
+
+		cvar_t * var = cvars[ idx ];
 		if( ( var->flags & CVAR_FROMCONFIG ) == 0 && strcmp( var->string, var->dvalue ) == 0 )
 			continue;
 		const char *cmd;
@@ -562,16 +654,15 @@ void Cvar_WriteVariables( int file ) {
 		}
 		FS_Printf( file, "%s", buffer );
 	}
-	Trie_FreeDump( dump );
+	Unlock( cvar_mutex );
 }
 
 /*
 * Cvar_List_f
 */
 static void Cvar_List_f( void ) {
-	struct trie_dump_s *dump = NULL;
-	unsigned int i;
 	char *pattern;
+	u32 matches = 0;
 
 	if( Cmd_Argc() == 1 ) {
 		pattern = NULL;
@@ -579,14 +670,15 @@ static void Cvar_List_f( void ) {
 		pattern = Cmd_Args();
 	}
 
-	assert( cvar_trie );
-	Lock( cvar_mutex );
-	Trie_DumpIf( cvar_trie, "", TRIE_DUMP_VALUES, Cvar_PatternMatches, pattern, &dump );
-	Unlock( cvar_mutex );
-
 	Com_Printf( "\nConsole variables:\n" );
-	for( i = 0; i < dump->size; ++i ) {
-		cvar_t * var = ( cvar_t * ) dump->key_value_vector[i].value;
+
+	Lock( cvar_mutex );
+	for( u32 i = 0; i < num_cvars; i++ ) {
+		cvar_t * var = cvars[ cvars_sorted[ i ] ];
+		if( !Cvar_PatternMatches( var, pattern ) ) {
+			continue;
+		}
+		matches++;
 #ifdef PUBLIC_BUILD
 		if( Cvar_FlagIsSet( var->flags, CVAR_DEVELOPER ) ) {
 			continue;
@@ -621,9 +713,9 @@ static void Cvar_List_f( void ) {
 		}
 		Com_Printf( " %s \"%s\", default: \"%s\"\n", var->name, var->string, var->dvalue );
 	}
-	Com_Printf( "%i variables\n", i );
+	Unlock( cvar_mutex );
 
-	Trie_FreeDump( dump );
+	Com_Printf( "%u variables\n", matches );
 }
 
 #ifndef PUBLIC_BUILD
@@ -631,26 +723,19 @@ static void Cvar_List_f( void ) {
 * Cvar_ArchiveList_f
 */
 static void Cvar_ArchiveList_f( void ) {
-	struct trie_dump_s *dump;
-	unsigned int i;
-
-	assert( cvar_trie );
 	Lock( cvar_mutex );
-	Trie_Dump( cvar_trie, "", TRIE_DUMP_VALUES, &dump );
-	Unlock( cvar_mutex );
-
-	for( i = 0; i < dump->size; ++i ) {
-		cvar_t * var = ( cvar_t * ) dump->key_value_vector[i].value;
-		if( Cvar_FlagIsSet( var->flags, CVAR_DEVELOPER ) ) {
+	for( u32 i = 0; i < num_cvars; i++ ) {
+		u32 idx = cvars_sorted[ i ];
+		if( !Cvar_GetBit( cvars_archived, idx ) ) {
 			continue;
 		}
-		if( !Cvar_FlagIsSet( var->flags, CVAR_ARCHIVE ) ) {
+		cvar_t * var = cvars[ idx ];
+		if( Cvar_FlagIsSet( var->flags, CVAR_DEVELOPER ) ) {
 			continue;
 		}
 		Com_Printf( "set %s \"%s\"\n", var->name, var->dvalue );
 	}
-
-	Trie_FreeDump( dump );
+	Unlock( cvar_mutex );
 }
 #endif
 
@@ -658,34 +743,23 @@ bool userinfo_modified;
 
 static char *Cvar_BitInfo( int bit ) {
 	static char info[MAX_INFO_STRING];
-	struct trie_dump_s *dump = NULL;
-	unsigned int i;
 
 	info[0] = 0;
 
-	assert( cvar_trie );
-	Lock( cvar_mutex );
-	Trie_DumpIf( cvar_trie, "", TRIE_DUMP_VALUES, Cvar_HasFlags, &bit, &dump );
-	Unlock( cvar_mutex );
-
 	// make sure versioncvar comes first
-	for( i = dump->size; i > 0; --i ) {
-		cvar_t * var = ( cvar_t * ) dump->key_value_vector[i - 1].value;
-		if( var == versioncvar ) {
-			Info_SetValueForKey( info, var->name, var->string );
-			break;
-		}
+	if( versioncvar != NULL && Cvar_FlagIsSet( versioncvar->flags, bit ) ) {
+		Info_SetValueForKey( info, versioncvar->name, versioncvar->string );
 	}
 
 	// dump other cvars
-	for( i = 0; i < dump->size; ++i ) {
-		cvar_t * var = ( cvar_t * ) dump->key_value_vector[i].value;
-		if( var != versioncvar ) {
+	Lock( cvar_mutex );
+	for( u32 i = 0; i < num_cvars; i++ ) {
+		cvar_t * var = cvars[ cvars_sorted[ i ] ];
+		if( var != versioncvar && Cvar_FlagIsSet( var->flags, bit ) ) {
 			Info_SetValueForKey( info, var->name, var->string );
 		}
 	}
-
-	Trie_FreeDump( dump );
+	Unlock( cvar_mutex );
 
 	return info;
 }
@@ -707,28 +781,56 @@ char *Cvar_Serverinfo( void ) {
 }
 
 /*
-* Cvar_NotDeveloper
+* Cvar_CompleteBuildListWithFlag
 */
-#ifdef PUBLIC_BUILD
-static int Cvar_NotDeveloper( void *cvar, const void *nothing ) {
-	return !Cvar_FlagIsSet( ( (cvar_t *)cvar )->flags, CVAR_DEVELOPER );
+static const char **Cvar_CompleteBuildListWithFlag( const char *partial, cvar_flag_t flag, cvar_flag_t hidden ) {
+	size_t len = strlen( partial );
+
+	Lock( cvar_mutex );
+
+	u32 first = Cvar_FirstWithPrefix( partial );
+	u32 last = first;
+	while( last < num_cvars && Q_strnicmp( cvars[ cvars_sorted[ last ] ]->name, partial, len ) == 0 ) {
+		last++;
+	}
+
+	const char **buf = (const char **) Mem_TempMalloc( sizeof( char * ) * ( last - first + 1 ) );
+	u32 n = 0;
+	for( u32 i = first; i < last; i++ ) {
+		const cvar_t * var = cvars[ cvars_sorted[ i ] ];
+		if( flag != 0 && !Cvar_FlagIsSet( var->flags, flag ) )
+			continue;
+		if( Cvar_FlagIsSet( var->flags, hidden ) )
+			continue;
+		buf[ n ] = var->name;
+		n++;
+	}
+	buf[ n ] = NULL;
+
+	Unlock( cvar_mutex );
+
+	return buf;
 }
+
+#ifdef PUBLIC_BUILD
+static constexpr cvar_flag_t CVAR_HIDDEN_FROM_COMPLETION = CVAR_DEVELOPER;
+#else
+static constexpr cvar_flag_t CVAR_HIDDEN_FROM_COMPLETION = 0;
 #endif
 
 /*
 * CVar_CompleteCountPossible
 */
 int Cvar_CompleteCountPossible( const char *partial ) {
-	unsigned int matches;
-	assert( cvar_trie );
 	assert( partial );
-	Lock( cvar_mutex );
-#ifdef PUBLIC_BUILD
-	Trie_NoOfMatchesIf( cvar_trie, partial, Cvar_NotDeveloper, NULL, &matches );
-#else
-	Trie_NoOfMatches( cvar_trie, partial, &matches );
-#endif
-	Unlock( cvar_mutex );
+
+	const char **list = Cvar_CompleteBuildListWithFlag( partial, 0, CVAR_HIDDEN_FROM_COMPLETION );
+	int matches = 0;
+	while( list[ matches ] != NULL ) {
+		matches++;
+	}
+	Mem_TempFree( list );
+
 	return matches;
 }
 
@@ -736,58 +838,21 @@ int Cvar_CompleteCountPossible( const char *partial ) {
 * CVar_CompleteBuildList
 */
 const char **Cvar_CompleteBuildList( const char *partial ) {
-	struct trie_dump_s *dump = NULL;
-	const char **buf;
-	unsigned int i;
-
-	assert( cvar_trie );
-	Lock( cvar_mutex );
-#ifdef PUBLIC_BUILD
-	Trie_DumpIf( cvar_trie, partial, TRIE_DUMP_VALUES, Cvar_NotDeveloper, NULL, &dump );
-#else
-	Trie_Dump( cvar_trie, partial, TRIE_DUMP_VALUES, &dump );
-#endif
-	Unlock( cvar_mutex );
-	buf = (const char **) Mem_TempMalloc( sizeof( char * ) * ( dump->size + 1 ) );
-	for( i = 0; i < dump->size; ++i )
-		buf[i] = ( ( cvar_t * ) dump->key_value_vector[i].value )->name;
-	buf[dump->size] = NULL;
-	Trie_FreeDump( dump );
-	return buf;
-}
-
-/*
-* Cvar_CompleteBuildListWithFlag
-*/
-const char **Cvar_CompleteBuildListWithFlag( const char *partial, cvar_flag_t flag ) {
-	struct trie_dump_s *dump = NULL;
-	const char **buf;
-	unsigned int i;
-
-	assert( cvar_trie );
-	Lock( cvar_mutex );
-	Trie_DumpIf( cvar_trie, partial, TRIE_DUMP_VALUES, Cvar_HasFlags, &flag, &dump );
-	Unlock( cvar_mutex );
-	buf = (const char **) Mem_TempMalloc( sizeof( char * ) * ( dump->size + 1 ) );
-	for( i = 0; i < dump->size; ++i )
-		buf[i] = ( ( cvar_t * ) dump->key_value_vector[i].value )->name;
-	buf[dump->size] = NULL;
-	Trie_FreeDump( dump );
-	return buf;
+	return Cvar_CompleteBuildListWithFlag( partial, 0, CVAR_HIDDEN_FROM_COMPLETION );
 }
 
 /*
 * Cvar_CompleteBuildListUser
 */
 const char **Cvar_CompleteBuildListUser( const char *partial ) {
-	return Cvar_CompleteBuildListWithFlag( partial, CVAR_USERINFO );
+	return Cvar_CompleteBuildListWithFlag( partial, CVAR_USERINFO, 0 );
 }
 
 /*
 * Cvar_CompleteBuildListServer
 */
 const char **Cvar_CompleteBuildListServer( const char *partial ) {
-	return Cvar_CompleteBuildListWithFlag( partial, CVAR_SERVERINFO );
+	return Cvar_CompleteBuildListWithFlag( partial, CVAR_SERVERINFO, 0 );
 }
 
 /*
@@ -797,11 +862,12 @@ void Cvar_PreInit( void ) {
 	assert( !cvar_initialized );
 	assert( !cvar_preinitialized );
 
-	assert( !cvar_trie );
-
 	cvar_mutex = NewMutex();
 
-	Trie_Create( TRIE_CASE_INSENSITIVE, &cvar_trie );
+	num_cvars = 0;
+	cvars_hashtable.clear();
+	memset( cvars_latched, 0, sizeof( cvars_latched ) );
+	memset( cvars_archived, 0, sizeof( cvars_archived ) );
 
 	cvar_preinitialized = true;
 }
@@ -815,8 +881,6 @@ void Cvar_Init( void ) {
 	assert( !cvar_initialized );
 	assert( cvar_preinitialized );
 
-	assert( cvar_trie );
-
 	Cmd_AddCommand( "set", Cvar_Set_f );
 	Cmd_AddCommand( "seta", Cvar_Seta_f );
 	Cmd_AddCommand( "setau", Cvar_Setau_f );
@@ -850,12 +914,8 @@ void Cvar_Init( void ) {
 */
 void Cvar_Shutdown( void ) {
 	if( cvar_initialized ) {
-		unsigned int i;
-		struct trie_dump_s *dump;
 		extern cvar_t *developer, *developer_memory;
 
-		assert( cvar_trie );
-
 		// NULL out some console variables so that we won't try to read from
 		// the memory pointers after the data has already been freed but before we
 		// reset the pointers to NULL
@@ -876,10 +936,8 @@ void Cvar_Shutdown( void ) {
 #endif
 
 		Lock( cvar_mutex );
-		Trie_Dump( cvar_trie, "", TRIE_DUMP_VALUES, &dump );
-		Unlock( cvar_mutex );
-		for( i = 0; i < dump->size; ++i ) {
-			cvar_t * var = ( cvar_t * ) dump->key_value_vector[i].value;
+		for( u32 i = 0; i < num_cvars; i++ ) {
+			cvar_t * var = cvars[ i ];
 
 			if( var->string ) {
 				Mem_ZoneFree( var->string );
@@ -889,19 +947,14 @@ void Cvar_Shutdown( void ) {
 			}
 			Mem_ZoneFree( var );
 		}
-		Trie_FreeDump( dump );
+		num_cvars = 0;
+		cvars_hashtable.clear();
+		Unlock( cvar_mutex );
 
 		cvar_initialized = false;
 	}
 
 	if( cvar_preinitialized ) {
-		assert( cvar_trie );
-
-		Lock( cvar_mutex );
-		Trie_Destroy( cvar_trie );
-		Unlock( cvar_mutex );
-		cvar_trie = NULL;
-
 		DeleteMutex( cvar_mutex );
 
 		cvar_preinitialized = false;
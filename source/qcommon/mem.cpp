@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "qcommon/qcommon.h"
+#include "qcommon/memtrack.h"
 #include "qcommon/threads.h"
 
 #define POOLNAMESIZE 128
@@ -49,6 +50,9 @@ typedef struct memheader_s {
 	const char *filename;
 	int fileline;
 
+	// allocation site for memreport
+	unsigned int site;
+
 	// should always be MEMHEADER_SENTINEL1
 	unsigned int sentinel1;
 	// immediately followed by data, which is followed by a MEMHEADER_SENTINEL2 byte
@@ -171,6 +175,7 @@ ATTRIBUTE_MALLOC void *_Mem_AllocExt( mempool_t *pool, size_t size, size_t align
 	mem->baseaddress = base;
 	mem->filename = filename;
 	mem->fileline = fileline;
+	mem->site = TrackAllocation( MemoryHeap_Pools, filename, fileline, size );
 	mem->size = size;
 	mem->realsize = realsize;
 	mem->pool = pool;
@@ -239,6 +244,21 @@ void *_Mem_Realloc( void *data, size_t size, const char *filename, int fileline
 	return newdata;
 }
 
+/*
+* Mem_Untrack
+*
+* For allocations that get carved up and tracked block by block, so memreport
+* doesn't count the memory twice
+*/
+void Mem_Untrack( void *data ) {
+	memheader_t *mem = ( memheader_t * )( (uint8_t *) data - sizeof( memheader_t ) );
+
+	Lock( memMutex );
+	TrackFree( mem->site, mem->size );
+	mem->site = UNTRACKED_ALLOCATION;
+	Unlock( memMutex );
+}
+
 char *_Mem_CopyString( mempool_t *pool, const char *in, const char *filename, int fileline ) {
 	char *out;
 	size_t num_chars = strlen( in ) + 1;
@@ -304,6 +324,7 @@ void _Mem_Free( void *data, int musthave, int canthave, const char *filename, in
 
 	// memheader has been unlinked, do the actual free now
 	pool->totalsize -= mem->size;
+	TrackFree( mem->site, mem->size );
 
 	base = mem->baseaddress;
 	pool->realsize -= mem->realsize;
@@ -691,6 +712,7 @@ void Memory_InitCommands( void ) {
 
 	Cmd_AddCommand( "memlist", MemList_f );
 	Cmd_AddCommand( "memstats", MemStats_f );
+	InitMemoryTrackingCommands();
 
 	commands_initialized = true;
 }
@@ -740,4 +762,5 @@ void Memory_ShutdownCommands( void ) {
 
 	Cmd_RemoveCommand( "memlist" );
 	Cmd_RemoveCommand( "memstats" );
+	ShutdownMemoryTrackingCommands();
 }
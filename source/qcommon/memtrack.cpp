@@ -0,0 +1,380 @@
+#include <algorithm> // std::sort
+
+#include "qcommon/base.h"
+#include "qcommon/qcommon.h"
+#include "qcommon/hash.h"
+#include "qcommon/hashtable.h"
+#include "qcommon/memtrack.h"
+#include "qcommon/threads.h"
+
+constexpr u32 MAX_ALLOCATION_SITES = 4096;
+constexpr u32 MAX_MEMORY_SUBSYSTEMS = 64;
+constexpr u32 MAX_TRACKED_ARENAS = 64;
+constexpr u32 SITE_CACHE_SIZE = 256;
+
+STATIC_ASSERT( IsPowerOf2( SITE_CACHE_SIZE ) );
+
+static const char * heap_names[] = { "pools", "system", "level zone" };
+STATIC_ASSERT( ARRAY_COUNT( heap_names ) == MemoryHeap_Count );
+
+struct MemoryTotals {
+	u64 live_bytes;
+	u64 peak_bytes;
+	u64 live_allocations;
+};
+
+struct AllocationSite {
+	const char * file;
+	int line;
+	MemoryHeap heap;
+	u32 subsystem;
+
+	MemoryTotals totals;
+	u64 snapshot_bytes;
+	u64 snapshot_allocations;
+};
+
+struct MemorySubsystem {
+	char name[ 32 ];
+	MemoryTotals heaps[ MemoryHeap_Count ];
+};
+
+struct TrackedArena {
+	const char * name;
+	const ArenaAllocator * arena;
+};
+
+struct MemoryTracker {
+	Mutex * mutex;
+
+	// site 0 catches everything once the table is full
+	AllocationSite sites[ MAX_ALLOCATION_SITES ];
+	u32 num_sites;
+	Hashtable< MAX_ALLOCATION_SITES * 2 > sites_hashtable;
+
+	MemorySubsystem subsystems[ MAX_MEMORY_SUBSYSTEMS ];
+	u32 num_subsystems;
+
+	MemoryTotals heaps[ MemoryHeap_Count ];
+
+	TrackedArena arenas[ MAX_TRACKED_ARENAS ];
+	u32 num_arenas;
+
+	bool snapshot_taken;
+	s64 snapshot_time;
+};
+
+// sys_allocator allocates during static initialisation, so this can't be a
+// plain global. it's never destroyed so it also outlives every other global
+static MemoryTracker * GetMemoryTracker() {
+	static MemoryTracker * tracker = [] {
+		MemoryTracker * t = new MemoryTracker();
+		t->mutex = NewMutex();
+		t->num_sites = 1;
+		t->num_subsystems = 1;
+		strcpy( t->subsystems[ 0 ].name, "(other)" );
+		t->sites[ 0 ].file = "(too many allocation sites)";
+		return t;
+	}();
+	return tracker;
+}
+
+static void AddToTotals( MemoryTotals * totals, size_t size ) {
+	totals->live_bytes += size;
+	totals->live_allocations++;
+	totals->peak_bytes = Max2( totals->peak_bytes, totals->live_bytes );
+}
+
+static void RemoveFromTotals( MemoryTotals * totals, size_t size ) {
+	totals->live_bytes -= Min2( u64( size ), totals->live_bytes );
+	totals->live_allocations -= Min2( u64( 1 ), totals->live_allocations );
+}
+
+static u32 FindSubsystem( MemoryTracker * tracker, const char * file ) {
+	// source/game/angelwrap/qas_main.cpp -> game/angelwrap
+	const char * source = strstr( file, "source/" );
+	const char * begin = source != NULL ? source + strlen( "source/" ) : file;
+	const char * end = strrchr( begin, '/' );
+	if( end == NULL )
+		return 0;
+
+	size_t len = Min2( size_t( end - begin ), sizeof( tracker->subsystems[ 0 ].name ) - 1 );
+
+	for( u32 i = 1; i < tracker->num_subsystems; i++ ) {
+		const char * name = tracker->subsystems[ i ].name;
+		if( strlen( name ) == len && memcmp( name, begin, len ) == 0 )
+			return i;
+	}
+
+	if( tracker->num_subsystems == MAX_MEMORY_SUBSYSTEMS )
+		return 0;
+
+	MemorySubsystem * subsystem = &tracker->subsystems[ tracker->num_subsystems ];
+	memcpy( subsystem->name, begin, len );
+	subsystem->name[ len ] = '\0';
+	return tracker->num_subsystems++;
+}
+
+static u32 FindSite( MemoryTracker * tracker, MemoryHeap heap, const char * file, int line ) {
+	// the same header can have a different __FILE__ pointer in every
+	// translation unit, so hash the contents
+	u64 key = Hash64( file, strlen( file ) );
+	key = Hash64( &line, sizeof( line ), key );
+	key = Hash64( &heap, sizeof( heap ), key );
+
+	u64 idx;
+	if( tracker->sites_hashtable.get( key, &idx ) )
+		return u32( idx );
+
+	if( tracker->num_sites == MAX_ALLOCATION_SITES )
+		return 0;
+
+	AllocationSite * site = &tracker->sites[ tracker->num_sites ];
+	site->file = file;
+	site->line = line;
+	site->heap = heap;
+	site->subsystem = FindSubsystem( tracker, file );
+
+	tracker->sites_hashtable.add( key, tracker->num_sites );
+	return tracker->num_sites++;
+}
+
+// __FILE__ is a string literal so the pointer and line identify a call site
+// without hashing the string, at least within one translation unit
+struct SiteCacheEntry {
+	const char * file;
+	int line;
+	MemoryHeap heap;
+	u32 site;
+};
+
+static thread_local SiteCacheEntry site_cache[ SITE_CACHE_SIZE ];
+
+static SiteCacheEntry * SiteCacheSlot( MemoryHeap heap, const char * file, int line ) {
+	size_t h = size_t( file ) ^ ( size_t( line ) * 2654435761u ) ^ size_t( heap );
+	return &site_cache[ ( h ^ ( h >> 12 ) ) & ( SITE_CACHE_SIZE - 1 ) ];
+}
+
+u32 TrackAllocation( MemoryHeap heap, const char * file, int line, size_t size ) {
+	MemoryTracker * tracker = GetMemoryTracker();
+
+	SiteCacheEntry * cached = SiteCacheSlot( heap, file, line );
+	bool hit = cached->file == file && cached->line == line && cached->heap == heap;
+
+	Lock( tracker->mutex );
+
+	u32 id = hit ? cached->site : FindSite( tracker, heap, file, line );
+	AllocationSite * site = &tracker->sites[ id ];
+	AddToTotals( &site->totals, size );
+	AddToTotals( &tracker->subsystems[ site->subsystem ].heaps[ site->heap ], size );
+	AddToTotals( &tracker->heaps[ site->heap ], size );
+
+	Unlock( tracker->mutex );
+
+	if( !hit ) {
+		*cached = { file, line, heap, id };
+	}
+
+	return id;
+}
+
+void TrackFree( u32 id, size_t size ) {
+	if( id == UNTRACKED_ALLOCATION )
+		return;
+
+	MemoryTracker * tracker = GetMemoryTracker();
+
+	Lock( tracker->mutex );
+
+	AllocationSite * site = &tracker->sites[ id ];
+	RemoveFromTotals( &site->totals, size );
+	RemoveFromTotals( &tracker->subsystems[ site->subsystem ].heaps[ site->heap ], size );
+	RemoveFromTotals( &tracker->heaps[ site->heap ], size );
+
+	Unlock( tracker->mutex );
+}
+
+void RegisterArena( const char * name, const ArenaAllocator * arena ) {
+	MemoryTracker * tracker = GetMemoryTracker();
+
+	Lock( tracker->mutex );
+	if( tracker->num_arenas < MAX_TRACKED_ARENAS ) {
+		tracker->arenas[ tracker->num_arenas ] = { name, arena };
+		tracker->num_arenas++;
+	}
+	Unlock( tracker->mutex );
+}
+
+void UnregisterArena( const ArenaAllocator * arena ) {
+	MemoryTracker * tracker = GetMemoryTracker();
+
+	Lock( tracker->mutex );
+	for( u32 i = 0; i < tracker->num_arenas; i++ ) {
+		if( tracker->arenas[ i ].arena == arena ) {
+			tracker->num_arenas--;
+			Swap2( &tracker->arenas[ i ], &tracker->arenas[ tracker->num_arenas ] );
+			break;
+		}
+	}
+	Unlock( tracker->mutex );
+}
+
+/*
+ * reports
+ */
+
+// reports copy everything out first because printing can allocate, and
+// allocating while holding the tracker mutex would deadlock
+static MemoryTracker report;
+
+static void CopyMemoryTracker() {
+	MemoryTracker * tracker = GetMemoryTracker();
+	Lock( tracker->mutex );
+	memcpy( report.sites, tracker->sites, tracker->num_sites * sizeof( AllocationSite ) );
+	report.num_sites = tracker->num_sites;
+	memcpy( report.subsystems, tracker->subsystems, tracker->num_subsystems * sizeof( MemorySubsystem ) );
+	report.num_subsystems = tracker->num_subsystems;
+	memcpy( report.heaps, tracker->heaps, sizeof( report.heaps ) );
+	memcpy( report.arenas, tracker->arenas, tracker->num_arenas * sizeof( TrackedArena ) );
+	report.num_arenas = tracker->num_arenas;
+	report.snapshot_taken = tracker->snapshot_taken;
+	report.snapshot_time = tracker->snapshot_time;
+	Unlock( tracker->mutex );
+}
+
+static double KB( u64 bytes ) {
+	return bytes / 1024.0;
+}
+
+static void PrintSite( const AllocationSite * site, u64 bytes, u64 peak, u64 allocations ) {
+	Com_Printf( "%10.1f %10.1f %8" PRIu64 " %-10s %s:%d\n", KB( bytes ), KB( peak ), allocations, heap_names[ site->heap ], site->file, site->line );
+}
+
+static void MemReport_f() {
+	int num_sites = Cmd_Argc() >= 2 ? atoi( Cmd_Argv( 1 ) ) : 20;
+
+	CopyMemoryTracker();
+
+	Com_Printf( "%-24s %-10s %10s %10s %8s\n", "subsystem", "heap", "live KB", "peak KB", "allocs" );
+	for( int i = 0; i < MemoryHeap_Count; i++ ) {
+		const MemoryTotals * heap = &report.heaps[ i ];
+		Com_Printf( "%-24s %-10s %10.1f %10.1f %8" PRIu64 "\n", "(all)", heap_names[ i ], KB( heap->live_bytes ), KB( heap->peak_bytes ), heap->live_allocations );
+	}
+	for( u32 i = 0; i < report.num_subsystems; i++ ) {
+		const MemorySubsystem * subsystem = &report.subsystems[ i ];
+		for( int j = 0; j < MemoryHeap_Count; j++ ) {
+			const MemoryTotals * heap = &subsystem->heaps[ j ];
+			if( heap->peak_bytes == 0 )
+				continue;
+			Com_Printf( "%-24s %-10s %10.1f %10.1f %8" PRIu64 "\n", subsystem->name, heap_names[ j ], KB( heap->live_bytes ), KB( heap->peak_bytes ), heap->live_allocations );
+		}
+	}
+
+	std::sort( report.sites, report.sites + report.num_sites, []( const AllocationSite & a, const AllocationSite & b ) {
+		return a.totals.live_bytes > b.totals.live_bytes;
+	} );
+
+	Com_Printf( "\n%10s %10s %8s %-10s %s\n", "live KB", "peak KB", "allocs", "heap", "site" );
+	for( u32 i = 0; i < report.num_sites && int( i ) < num_sites; i++ ) {
+		const AllocationSite * site = &report.sites[ i ];
+		if( site->totals.live_bytes == 0 )
+			break;
+		PrintSite( site, site->totals.live_bytes, site->totals.peak_bytes, site->totals.live_allocations );
+	}
+
+	if( report.num_arenas > 0 ) {
+		Com_Printf( "\n%-24s %10s %10s %16s\n", "arena", "size KB", "peak KB", "max utilisation" );
+		for( u32 i = 0; i < report.num_arenas; i++ ) {
+			const ArenaAllocator * arena = report.arenas[ i ].arena;
+			Com_Printf( "%-24s %10.1f %10.1f %15.1f%%\n", report.arenas[ i ].name,
+				KB( arena->capacity() ), KB( arena->peak_usage() ), arena->max_utilisation() * 100.0f );
+		}
+	}
+}
+
+static void MemSnapshot_f() {
+	MemoryTracker * tracker = GetMemoryTracker();
+
+	Lock( tracker->mutex );
+	for( u32 i = 0; i < tracker->num_sites; i++ ) {
+		AllocationSite * site = &tracker->sites[ i ];
+		site->snapshot_bytes = site->totals.live_bytes;
+		site->snapshot_allocations = site->totals.live_allocations;
+	}
+	tracker->snapshot_taken = true;
+	tracker->snapshot_time = Sys_Milliseconds();
+	Unlock( tracker->mutex );
+
+	Com_Printf( "Took a heap snapshot, use memdiff to compare against it\n" );
+}
+
+static s64 SnapshotGrowth( const AllocationSite & site ) {
+	return s64( site.totals.live_bytes ) - s64( site.snapshot_bytes );
+}
+
+static void MemDiff_f() {
+	CopyMemoryTracker();
+
+	if( !report.snapshot_taken ) {
+		Com_Printf( "No heap snapshot, use memsnapshot first\n" );
+		return;
+	}
+
+	std::sort( report.sites, report.sites + report.num_sites, []( const AllocationSite & a, const AllocationSite & b ) {
+		return SnapshotGrowth( a ) > SnapshotGrowth( b );
+	} );
+
+	char date[ 64 ];
+	Sys_FormatTime( date, sizeof( date ), "%Y-%m-%d_%H-%M-%S" );
+
+	char filename[ MAX_QPATH ];
+	snprintf( filename, sizeof( filename ), "memdiffs/%s.txt", date );
+
+	int file;
+	if( FS_FOpenFile( filename, &file, FS_WRITE ) == -1 ) {
+		Com_Printf( S_COLOR_RED "Couldn't open %s for writing\n", filename );
+		return;
+	}
+
+	s64 total = 0;
+	for( u32 i = 0; i < report.num_sites; i++ ) {
+		total += SnapshotGrowth( report.sites[ i ] );
+	}
+
+	FS_Printf( file, "%.1fKB change over %.1f minutes\n\n", total / 1024.0, ( Sys_Milliseconds() - report.snapshot_time ) / 60000.0 );
+	FS_Printf( file, "%10s %10s %10s %-10s %s\n", "change KB", "live KB", "allocs", "heap", "site" );
+
+	Com_Printf( "%.1fKB change since the snapshot, biggest growth:\n", total / 1024.0 );
+
+	int printed = 0;
+	for( u32 i = 0; i < report.num_sites; i++ ) {
+		const AllocationSite * site = &report.sites[ i ];
+		s64 growth = SnapshotGrowth( *site );
+		if( growth == 0 && site->totals.live_allocations == site->snapshot_allocations )
+			continue;
+
+		s64 allocations = s64( site->totals.live_allocations ) - s64( site->snapshot_allocations );
+		FS_Printf( file, "%+10.1f %10.1f %+10" PRIi64 " %-10s %s:%d\n", growth / 1024.0, KB( site->totals.live_bytes ), allocations, heap_names[ site->heap ], site->file, site->line );
+
+		if( growth > 0 && printed < 10 ) {
+			Com_Printf( "%+10.1fKB %s:%d\n", growth / 1024.0, site->file, site->line );
+			printed++;
+		}
+	}
+
+	FS_FCloseFile( file );
+
+	Com_Printf( "Wrote %s\n", filename );
+}
+
+void InitMemoryTrackingCommands() {
+	Cmd_AddCommand( "memreport", MemReport_f );
+	Cmd_AddCommand( "memsnapshot", MemSnapshot_f );
+	Cmd_AddCommand( "memdiff", MemDiff_f );
+}
+
+void ShutdownMemoryTrackingCommands() {
+	Cmd_RemoveCommand( "memreport" );
+	Cmd_RemoveCommand( "memsnapshot" );
+	Cmd_RemoveCommand( "memdiff" );
+}
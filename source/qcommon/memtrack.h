@@ -0,0 +1,31 @@
+#pragma once
+
+#include "qcommon/types.h"
+
+/*
+ * every tracked allocation is tagged with its heap and call site, and the
+ * subsystem is the source directory of the call site. sites keep live and
+ * peak totals so memreport/memsnapshot/memdiff can find what grows over long
+ * sessions. libraries calling malloc directly aren't seen
+ */
+
+enum MemoryHeap {
+	MemoryHeap_Pools, // Mem_Alloc
+	MemoryHeap_System, // sys_allocator
+	MemoryHeap_LevelZone, // G_LevelMalloc, carved out of a game pool
+
+	MemoryHeap_Count
+};
+
+// for allocations that are tracked some other way, TrackFree ignores it
+constexpr u32 UNTRACKED_ALLOCATION = U32_MAX;
+
+// returns the site to pass to TrackFree
+u32 TrackAllocation( MemoryHeap heap, const char * file, int line, size_t size );
+void TrackFree( u32 site, size_t size );
+
+void RegisterArena( const char * name, const ArenaAllocator * arena );
+void UnregisterArena( const ArenaAllocator * arena );
+
+void InitMemoryTrackingCommands();
+void ShutdownMemoryTrackingCommands();
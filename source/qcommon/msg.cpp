@@ -431,7 +431,7 @@ int MSG_SkipData( msg_t *msg, size_t length ) {
 
 static char *MSG_ReadString2( msg_t *msg, bool linebreak ) {
 	int l, c;
-	static char string[MAX_MSG_STRING_CHARS];
+	static thread_local char string[MAX_MSG_STRING_CHARS]; // thread_local so demotool can parse demos in parallel
 
 	l = 0;
 	do {
@@ -314,7 +314,7 @@ bool Netchan_TransmitNextFragment( netchan_t *chan ) {
 
 	// send the game port if we are a client
 	if( !chan->socket->server ) {
-		MSG_WriteInt16( &send, local_game_port );
+		MSG_WriteInt16( &send, chan->game_port );
 	}
 
 	// copy the reliable message to the packet first
@@ -417,7 +417,7 @@ bool Netchan_Transmit( netchan_t *chan, msg_t *msg ) {
 
 	// send the game port if we are a client
 	if( !chan->socket->server ) {
-		MSG_WriteInt16( &send, local_game_port );
+		MSG_WriteInt16( &send, chan->game_port );
 	}
 
 	MSG_CopyData( &send, msg->data, msg->cursize );
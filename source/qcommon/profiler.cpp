@@ -0,0 +1,288 @@
+#include <algorithm> // std::sort
+#include <chrono>
+
+#include "qcommon/base.h"
+#include "qcommon/threads.h"
+
+constexpr u32 MAX_PROFILER_THREADS = 32;
+constexpr u32 PROFILER_WINDOW = 256;
+
+// per-site running totals, only ever written by the owning thread. they
+// only go up, so ProfilerFrame reads them once per frame without stopping
+// the thread and takes the difference from what it saw last frame
+struct ProfilerThread {
+	std::atomic< bool > in_use;
+	std::atomic< u64 > totals[ MAX_PROFILER_SITES ];
+	std::atomic< u32 > calls[ MAX_PROFILER_SITES ];
+
+	// ProfilerFrame only
+	u64 seen_totals[ MAX_PROFILER_SITES ];
+	u32 seen_calls[ MAX_PROFILER_SITES ];
+};
+
+// gives the ring back when its thread exits
+struct ProfilerThreadHandle {
+	ProfilerThread * thread;
+
+	~ProfilerThreadHandle() {
+		if( thread != NULL ) {
+			thread->in_use.store( false, std::memory_order_release );
+		}
+	}
+};
+
+static ProfilerThread profiler_threads[ MAX_PROFILER_THREADS ];
+static thread_local ProfilerThread * profiler_thread;
+static thread_local bool profiler_thread_unavailable;
+static thread_local ProfilerThreadHandle profiler_thread_handle;
+
+// so recursive zones only count their outermost call
+static thread_local u16 profiler_zone_depth[ MAX_PROFILER_SITES ];
+
+static std::atomic< ProfilerSite * > profiler_sites[ MAX_PROFILER_SITES ];
+static std::atomic< u32 > num_profiler_sites;
+
+struct ProfilerSiteStats {
+	u64 frame_total;
+	u32 frame_calls;
+
+	u64 totals[ PROFILER_WINDOW ];
+	u32 calls[ PROFILER_WINDOW ];
+};
+
+static Mutex * profiler_mutex;
+static ProfilerSiteStats profiler_stats[ MAX_PROFILER_SITES ];
+static u64 profiler_frames;
+static u64 profiler_last_frame;
+
+static ProfilerSite frame_site( "Frame", false );
+
+static u64 ProfilerNow() {
+	return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static u32 ProfilerSiteID( ProfilerSite * site ) {
+	u32 id = site->id.load( std::memory_order_acquire );
+	if( id != 0 )
+		return id;
+
+	// id 0 means unregistered. if two threads race here one id gets wasted,
+	// which is harmless because nothing will ever be recorded against it
+	u32 new_id = num_profiler_sites.fetch_add( 1, std::memory_order_relaxed ) + 1;
+	if( new_id >= MAX_PROFILER_SITES )
+		return 0;
+
+	profiler_sites[ new_id ].store( site, std::memory_order_release );
+
+	u32 expected = 0;
+	if( !site->id.compare_exchange_strong( expected, new_id, std::memory_order_acq_rel ) )
+		return expected;
+	return new_id;
+}
+
+static ProfilerThread * GetProfilerThread() {
+	if( profiler_thread != NULL || profiler_thread_unavailable )
+		return profiler_thread;
+
+	for( ProfilerThread & thread : profiler_threads ) {
+		bool expected = false;
+		if( thread.in_use.compare_exchange_strong( expected, true, std::memory_order_acquire ) ) {
+			profiler_thread = &thread;
+			profiler_thread_handle.thread = &thread;
+			return profiler_thread;
+		}
+	}
+
+	profiler_thread_unavailable = true;
+	return NULL;
+}
+
+// we are the only writer so this doesn't need a locked add
+static void AddToProfilerThread( u32 id, u64 value ) {
+	ProfilerThread * thread = GetProfilerThread();
+	if( thread == NULL || id == 0 )
+		return;
+
+	thread->totals[ id ].store( thread->totals[ id ].load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+	thread->calls[ id ].store( thread->calls[ id ].load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+}
+
+ProfilerZone::ProfilerZone( ProfilerSite * site ) {
+	id = ProfilerSiteID( site );
+	outermost = profiler_zone_depth[ id ] == 0;
+	profiler_zone_depth[ id ]++;
+	start = outermost ? ProfilerNow() : 0;
+}
+
+ProfilerZone::~ProfilerZone() {
+	profiler_zone_depth[ id ]--;
+	if( outermost ) {
+		AddToProfilerThread( id, ProfilerNow() - start );
+	}
+}
+
+void AddProfilerCount( ProfilerSite * site, u64 value ) {
+	AddToProfilerThread( ProfilerSiteID( site ), value );
+}
+
+void InitProfiler() {
+	profiler_mutex = NewMutex();
+	profiler_last_frame = ProfilerNow();
+	ResetProfilerStats();
+}
+
+void ShutdownProfiler() {
+	DeleteMutex( profiler_mutex );
+	profiler_mutex = NULL;
+}
+
+void ProfilerFrame() {
+	if( profiler_mutex == NULL )
+		return;
+
+	u64 now = ProfilerNow();
+	u32 frame_id = ProfilerSiteID( &frame_site );
+
+	Lock( profiler_mutex );
+
+	if( frame_id != 0 ) {
+		profiler_stats[ frame_id ].frame_total += now - profiler_last_frame;
+		profiler_stats[ frame_id ].frame_calls++;
+	}
+	profiler_last_frame = now;
+
+	u32 num_sites = Min2( num_profiler_sites.load( std::memory_order_acquire ) + 1, MAX_PROFILER_SITES );
+
+	// zones still open on other threads land in whichever frame they finish in
+	for( ProfilerThread & thread : profiler_threads ) {
+		for( u32 i = 1; i < num_sites; i++ ) {
+			u64 total = thread.totals[ i ].load( std::memory_order_relaxed );
+			u32 calls = thread.calls[ i ].load( std::memory_order_relaxed );
+			profiler_stats[ i ].frame_total += total - thread.seen_totals[ i ];
+			profiler_stats[ i ].frame_calls += calls - thread.seen_calls[ i ];
+			thread.seen_totals[ i ] = total;
+			thread.seen_calls[ i ] = calls;
+		}
+	}
+
+	u32 slot = profiler_frames % PROFILER_WINDOW;
+	for( u32 i = 1; i < num_sites; i++ ) {
+		ProfilerSiteStats * stats = &profiler_stats[ i ];
+		stats->totals[ slot ] = stats->frame_total;
+		stats->calls[ slot ] = stats->frame_calls;
+		stats->frame_total = 0;
+		stats->frame_calls = 0;
+	}
+
+	profiler_frames++;
+
+	Unlock( profiler_mutex );
+}
+
+static bool SortByAvg( const ProfilerStats & a, const ProfilerStats & b ) {
+	if( a.counter != b.counter )
+		return !a.counter;
+	return a.avg > b.avg;
+}
+
+size_t GetProfilerStats( Span< ProfilerStats > stats, u32 * num_frames ) {
+	if( profiler_mutex == NULL ) {
+		*num_frames = 0;
+		return 0;
+	}
+
+	Lock( profiler_mutex );
+	defer { Unlock( profiler_mutex ); };
+
+	u32 frames = Min2( profiler_frames, u64( PROFILER_WINDOW ) );
+	*num_frames = frames;
+	if( frames == 0 )
+		return 0;
+
+	size_t n = 0;
+	u32 num_sites = Min2( num_profiler_sites.load( std::memory_order_acquire ) + 1, MAX_PROFILER_SITES );
+	for( u32 i = 1; i < num_sites && n < stats.n; i++ ) {
+		const ProfilerSite * site = profiler_sites[ i ].load( std::memory_order_acquire );
+		if( site == NULL || site->id.load( std::memory_order_relaxed ) != i )
+			continue;
+
+		const ProfilerSiteStats * site_stats = &profiler_stats[ i ];
+
+		u64 sorted[ PROFILER_WINDOW ];
+		u64 total = 0;
+		u64 calls = 0;
+		for( u32 j = 0; j < frames; j++ ) {
+			sorted[ j ] = site_stats->totals[ j ];
+			total += site_stats->totals[ j ];
+			calls += site_stats->calls[ j ];
+		}
+
+		if( calls == 0 )
+			continue;
+
+		std::sort( sorted, sorted + frames );
+
+		ProfilerStats * s = &stats[ n ];
+		s->name = site->name;
+		s->counter = site->counter;
+		s->min = sorted[ 0 ];
+		s->avg = total / frames;
+		s->p99 = sorted[ ( frames - 1 ) * 99 / 100 ];
+		s->max = sorted[ frames - 1 ];
+		s->calls_per_frame = float( calls ) / float( frames );
+		n++;
+	}
+
+	std::sort( stats.ptr, stats.ptr + n, SortByAvg );
+
+	return n;
+}
+
+static bool SortByTotal( const ProfilerFrameStats & a, const ProfilerFrameStats & b ) {
+	if( a.counter != b.counter )
+		return !a.counter;
+	return a.total > b.total;
+}
+
+size_t GetLastProfilerFrame( Span< ProfilerFrameStats > stats ) {
+	if( profiler_mutex == NULL )
+		return 0;
+
+	Lock( profiler_mutex );
+	defer { Unlock( profiler_mutex ); };
+
+	if( profiler_frames == 0 )
+		return 0;
+
+	u32 slot = ( profiler_frames - 1 ) % PROFILER_WINDOW;
+
+	size_t n = 0;
+	u32 num_sites = Min2( num_profiler_sites.load( std::memory_order_acquire ) + 1, MAX_PROFILER_SITES );
+	for( u32 i = 1; i < num_sites && n < stats.n; i++ ) {
+		const ProfilerSite * site = profiler_sites[ i ].load( std::memory_order_acquire );
+		if( site == NULL || site->id.load( std::memory_order_relaxed ) != i )
+			continue;
+
+		const ProfilerSiteStats * site_stats = &profiler_stats[ i ];
+		if( site_stats->calls[ slot ] == 0 )
+			continue;
+
+		ProfilerFrameStats * s = &stats[ n ];
+		s->name = site->name;
+		s->counter = site->counter;
+		s->total = site_stats->totals[ slot ];
+		s->calls = site_stats->calls[ slot ];
+		n++;
+	}
+
+	std::sort( stats.ptr, stats.ptr + n, SortByTotal );
+
+	return n;
+}
+
+void ResetProfilerStats() {
+	Lock( profiler_mutex );
+	memset( profiler_stats, 0, sizeof( profiler_stats ) );
+	profiler_frames = 0;
+	Unlock( profiler_mutex );
+}
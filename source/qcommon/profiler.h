@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+
+#include "qcommon/types.h"
+
+/*
+ * a lightweight always-on profiler for when we can't attach tracy, like on
+ * dedicated servers. ZoneScoped and ProfilerCount add into per-thread,
+ * per-site totals, and ProfilerFrame folds them into per-frame totals that
+ * are kept over a rolling window of frames
+ */
+
+constexpr u32 MAX_PROFILER_SITES = 512;
+
+struct ProfilerSite {
+	const char * name;
+	bool counter;
+	std::atomic< u32 > id;
+
+	constexpr ProfilerSite( const char * name_, bool counter_ ) : name( name_ ), counter( counter_ ), id( 0 ) { }
+};
+
+struct ProfilerZone {
+	u32 id;
+	bool outermost;
+	u64 start;
+
+	ProfilerZone( ProfilerSite * site );
+	~ProfilerZone();
+};
+
+void AddProfilerCount( ProfilerSite * site, u64 value );
+
+#define PROFILER_ZONE( name ) \
+	static ProfilerSite LINE_NAME( profiler_site )( name, false ); \
+	ProfilerZone LINE_NAME( profiler_zone )( &LINE_NAME( profiler_site ) )
+
+#define ProfilerCount( name, value ) do { \
+	static ProfilerSite profiler_site( name, true ); \
+	AddProfilerCount( &profiler_site, value ); \
+} while( false )
+
+// record every tracy zone too
+#undef ZoneScoped
+#undef ZoneScopedN
+#define ZoneScoped ZoneNamed( ___tracy_scoped_zone, true ); PROFILER_ZONE( __FUNCTION__ )
+#define ZoneScopedN( name ) ZoneNamedN( ___tracy_scoped_zone, name, true ); PROFILER_ZONE( name )
+
+// tracy only, for leaf functions that run too often to read the clock twice
+#define ZoneScopedTracyOnly ZoneNamed( ___tracy_scoped_zone, true )
+
+struct ProfilerStats {
+	const char * name;
+	bool counter;
+
+	// per-frame totals over the window, nanoseconds for zones
+	u64 min;
+	u64 avg;
+	u64 p99;
+	u64 max;
+	float calls_per_frame;
+};
+
+void InitProfiler();
+void ShutdownProfiler();
+
+void ProfilerFrame();
+
+// sorted by avg, most expensive first. returns how many stats were written
+size_t GetProfilerStats( Span< ProfilerStats > stats, u32 * num_frames );
+void ResetProfilerStats();
+
+struct ProfilerFrameStats {
+	const char * name;
+	bool counter;
+	u64 total; // nanoseconds for zones
+	u32 calls;
+};
+
+// the most recently finished frame, sorted like GetProfilerStats
+size_t GetLastProfilerFrame( Span< ProfilerFrameStats > stats );
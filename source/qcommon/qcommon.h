@@ -20,6 +20,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #pragma once
 
+#include <setjmp.h>
+
 #include "gameshared/q_arch.h"
 #include "gameshared/q_math.h"
 #include "gameshared/q_shared.h"
@@ -127,6 +129,9 @@ void MSG_ReadData( msg_t *sb, void *buffer, size_t length );
 // define this 0 to disable compression of demo files
 #define SNAP_DEMO_GZ                    FS_GZ
 
+// how often recorders write a full frame that playback can seek to
+#define SNAP_DEMO_KEYFRAME_INTERVAL     10000
+
 void SNAP_ParseBaseline( msg_t *msg, SyncEntityState *baselines );
 struct snapshot_s *SNAP_ParseFrame( msg_t *msg, struct snapshot_s *lastFrame, struct snapshot_s *backup, SyncEntityState *baselines, int showNet );
 
@@ -144,6 +149,8 @@ void SNAP_RecordDemoMessage( int demofile, msg_t *msg, int offset );
 int SNAP_ReadDemoMessage( int demofile, msg_t *msg );
 void SNAP_BeginDemoRecording( int demofile, unsigned int spawncount, unsigned int snapFrameTime,
 	unsigned int sv_bitflags, char *configstrings, SyncEntityState *baselines );
+void SNAP_RecordDemoKeyframe( int demofile, int64_t serverTime, const char *configstrings );
+bool SNAP_IsDemoKeyframe( const msg_t *msg, int64_t *serverTime );
 void SNAP_StopDemoRecording( int demofile );
 void SNAP_WriteDemoMetaData( const char *filename, const char *meta_data, size_t meta_data_realsize );
 size_t SNAP_ClearDemoMeta( char *meta_data, size_t meta_data_max_size );
@@ -617,6 +624,10 @@ void Com_GGError( com_error_code_t code, const char * fmt, const Rest & ... rest
 	Com_Error( code, "%s", buf );
 }
 
+// ERR_DROPs on the calling thread longjmp to trap instead of shutting the game
+// down, so worker threads can give up on bad input. NULL to clear
+void        Com_SetErrorTrap( jmp_buf * trap );
+
 void        Com_DeferQuit( void );
 
 int         Com_ClientState( void );        // this should have just been a cvar...
@@ -666,6 +677,7 @@ void _Mem_CheckSentinels( void *data, const char *filename, int fileline );
 void _Mem_CheckSentinelsGlobal( const char *filename, int fileline );
 
 size_t Mem_PoolTotalSize( mempool_t *pool );
+void Mem_Untrack( void *data );
 
 #define Mem_AllocExt( pool, size, z ) _Mem_AllocExt( pool, size, 0, z, 0, 0, __FILE__, __LINE__ )
 #define Mem_Alloc( pool, size ) _Mem_Alloc( pool, size, 0, 0, __FILE__, __LINE__ )
@@ -0,0 +1,48 @@
+#include "qcommon/base.h"
+#include "qcommon/radix_sort.h"
+
+void RadixSort( Span< RadixSortItem > items, Span< RadixSortItem > scratch ) {
+	ZoneScoped;
+
+	assert( scratch.n >= items.n );
+
+	if( items.n <= 1 )
+		return;
+
+	u32 histograms[ 8 ][ 256 ] = { };
+	for( RadixSortItem item : items ) {
+		for( u32 i = 0; i < 8; i++ ) {
+			histograms[ i ][ ( item.key >> ( i * 8 ) ) & 0xff ]++;
+		}
+	}
+
+	RadixSortItem * src = items.ptr;
+	RadixSortItem * dst = scratch.ptr;
+
+	for( u32 i = 0; i < 8; i++ ) {
+		u32 shift = i * 8;
+
+		// every key has the same byte here so this pass wouldn't move anything
+		if( histograms[ i ][ ( src[ 0 ].key >> shift ) & 0xff ] == items.n )
+			continue;
+
+		u32 offsets[ 256 ];
+		u32 total = 0;
+		for( u32 j = 0; j < 256; j++ ) {
+			offsets[ j ] = total;
+			total += histograms[ i ][ j ];
+		}
+
+		for( size_t j = 0; j < items.n; j++ ) {
+			u32 digit = ( src[ j ].key >> shift ) & 0xff;
+			dst[ offsets[ digit ] ] = src[ j ];
+			offsets[ digit ]++;
+		}
+
+		Swap2( &src, &dst );
+	}
+
+	if( src != items.ptr ) {
+		memcpy( items.ptr, src, items.num_bytes() );
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "qcommon/types.h"
+
+struct RadixSortItem {
+	u64 key;
+	u64 value;
+};
+
+/*
+ * stable LSD radix sort on key, a byte at a time. bytes that are the same
+ * in every key get skipped, so unused key bits are free. scratch must be
+ * at least as big as items
+ */
+void RadixSort( Span< RadixSortItem > items, Span< RadixSortItem > scratch );
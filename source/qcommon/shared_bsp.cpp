@@ -0,0 +1,50 @@
+#include "qcommon/base.h"
+#include "qcommon/hashtable.h"
+#include "qcommon/shared_bsp.h"
+
+constexpr size_t MAX_SHARED_BSPS = 128;
+
+static Span< const u8 > shared_bsps[ MAX_SHARED_BSPS ];
+static u64 shared_bsp_hashes[ MAX_SHARED_BSPS ];
+static size_t num_shared_bsps;
+static Hashtable< MAX_SHARED_BSPS * 2 > shared_bsps_hashtable;
+
+void ShareBSP( u64 base_hash, Span< const u8 > data ) {
+	u64 idx;
+	if( shared_bsps_hashtable.get( base_hash, &idx ) ) {
+		shared_bsps[ idx ] = data;
+		return;
+	}
+
+	if( num_shared_bsps == ARRAY_COUNT( shared_bsps ) )
+		return;
+
+	shared_bsps[ num_shared_bsps ] = data;
+	shared_bsp_hashes[ num_shared_bsps ] = base_hash;
+	shared_bsps_hashtable.add( base_hash, num_shared_bsps );
+	num_shared_bsps++;
+}
+
+void UnshareBSP( u64 base_hash ) {
+	u64 idx;
+	if( !shared_bsps_hashtable.get( base_hash, &idx ) )
+		return;
+
+	shared_bsps_hashtable.remove( base_hash );
+	num_shared_bsps--;
+
+	// swap the last one into the hole
+	if( idx != num_shared_bsps ) {
+		shared_bsps[ idx ] = shared_bsps[ num_shared_bsps ];
+		shared_bsp_hashes[ idx ] = shared_bsp_hashes[ num_shared_bsps ];
+		shared_bsps_hashtable.update( shared_bsp_hashes[ idx ], idx );
+	}
+}
+
+bool FindSharedBSP( u64 base_hash, Span< const u8 > * data ) {
+	u64 idx;
+	if( !shared_bsps_hashtable.get( base_hash, &idx ) )
+		return false;
+	*data = shared_bsps[ idx ];
+	return true;
+}
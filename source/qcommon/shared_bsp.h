@@ -0,0 +1,13 @@
+#pragma once
+
+#include "qcommon/types.h"
+
+/*
+ * decompressed BSPs the client already has in memory, so a listen server can
+ * build its collision model from them instead of loading its own copy. the
+ * owner has to unshare the data before freeing it
+ */
+
+void ShareBSP( u64 base_hash, Span< const u8 > data );
+void UnshareBSP( u64 base_hash );
+bool FindSharedBSP( u64 base_hash, Span< const u8 > * data );
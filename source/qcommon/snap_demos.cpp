@@ -201,6 +201,54 @@ void SNAP_BeginDemoRecording( int demofile, unsigned int spawncount, unsigned in
 	DEMO_SAFEWRITE( demofile, &msg, true );
 }
 
+/*
+* SNAP_RecordDemoKeyframe
+*
+* Writes a marker and every configstring so playback can resume from here
+* without replaying the demo from the start. Must be followed by a nodelta
+* frame message.
+*/
+void SNAP_RecordDemoKeyframe( int demofile, int64_t serverTime, const char *configstrings ) {
+	msg_t msg;
+	uint8_t msg_buffer[MAX_MSGLEN];
+
+	MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
+
+	MSG_WriteUint8( &msg, svc_servercs );
+	MSG_WriteString( &msg, va( "keyframe %" PRIi64, serverTime ) );
+
+	// empty ones too, they may have been set after this point in the demo
+	for( int i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		const char *configstring = configstrings + i * MAX_CONFIGSTRING_CHARS;
+		MSG_WriteUint8( &msg, svc_servercs );
+		MSG_WriteString( &msg, va( "cs %i \"%s\"", i, configstring ) );
+
+		DEMO_SAFEWRITE( demofile, &msg, false );
+	}
+
+	DEMO_SAFEWRITE( demofile, &msg, true );
+}
+
+/*
+* SNAP_IsDemoKeyframe
+*/
+bool SNAP_IsDemoKeyframe( const msg_t *msg, int64_t *serverTime ) {
+	const char *prefix = "keyframe ";
+	size_t prefix_len = strlen( prefix );
+
+	if( msg->cursize < 1 + prefix_len || msg->data[0] != svc_servercs ) {
+		return false;
+	}
+
+	const char *str = (const char *) msg->data + 1;
+	if( strncmp( str, prefix, prefix_len ) != 0 ) {
+		return false;
+	}
+
+	*serverTime = strtoll( str + prefix_len, NULL, 10 );
+	return true;
+}
+
 /*
 * SNAP_ClearDemoMeta
 */
@@ -374,6 +374,9 @@ snapshot_t *SNAP_ParseFrame( msg_t *msg, snapshot_t *lastFrame, snapshot_t *back
 		if( cmd != svc_playerinfo ) {
 			Com_Error( ERR_DROP, "SNAP_ParseFrame: not playerinfo" );
 		}
+		if( numplayers == MAX_CLIENTS ) {
+			Com_Error( ERR_DROP, "SNAP_ParseFrame: too many playerinfos" );
+		}
 		if( deltaframe && deltaframe->numplayers >= numplayers ) {
 			SNAP_ParsePlayerstate( msg, &deltaframe->playerStates[numplayers], &newframe->playerStates[numplayers] );
 		} else {
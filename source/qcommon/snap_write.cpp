@@ -104,6 +104,33 @@ static void SNAP_EmitPacketEntities( ginfo_t *gi, client_snapshot_t *from, clien
 	MSG_WriteEntityNumber( msg, 0, false ); // end of packetentities
 }
 
+/*
+* SNAP_DeltaFrame
+*
+* The frame the client last acknowledged, if we can delta compress against it
+*/
+static client_snapshot_t *SNAP_DeltaFrame( client_t *client, const client_snapshot_t *frame, int64_t frameNum ) {
+	client_snapshot_t *oldframe;
+
+	if( client->lastframe <= 0 || client->lastframe > frameNum || client->nodelta ) {
+		// client is asking for a not compressed retransmit
+		return NULL;
+	}
+
+	if( frameNum >= client->lastframe + UPDATE_MASK ) {
+		// client hasn't gotten a good message through in a long time
+		return NULL;
+	}
+
+	// we have a valid message to delta from
+	oldframe = &client->snapShots[client->lastframe & UPDATE_MASK];
+	if( oldframe->multipov != frame->multipov ) {
+		return NULL;        // don't delta compress a frame of different POV type
+	}
+
+	return oldframe;
+}
+
 /*
 * SNAP_WriteDeltaGameStateToClient
 */
@@ -247,21 +274,7 @@ void SNAP_WriteFrameSnapToClient( ginfo_t *gi, client_t *client, msg_t *msg, int
 		}
 	}
 
-	if( client->lastframe <= 0 || client->lastframe > frameNum || client->nodelta ) {
-		// client is asking for a not compressed retransmit
-		oldframe = NULL;
-	}
-	//else if( frameNum >= client->lastframe + (UPDATE_BACKUP - 3) )
-	else if( frameNum >= client->lastframe + UPDATE_MASK ) {
-		// client hasn't gotten a good message through in a long time
-		oldframe = NULL;
-	} else {
-		// we have a valid message to delta from
-		oldframe = &client->snapShots[client->lastframe & UPDATE_MASK];
-		if( oldframe->multipov != frame->multipov ) {
-			oldframe = NULL;        // don't delta compress a frame of different POV type
-		}
-	}
+	oldframe = SNAP_DeltaFrame( client, frame, frameNum );
 
 	if( client->nodelta && client->reliable ) {
 		client->nodelta = false;
@@ -602,6 +615,61 @@ static void SNAP_BuildSnapEntitiesList( CollisionModel *cms, ginfo_t *gi, edict_
 	SNAP_SortSnapList( entList );
 }
 
+#define SNAP_DEFER_DISTANCE 2048
+#define SNAP_DEFER_INTERVAL 4
+
+/*
+* SNAP_DeferredEntityState
+*
+* For clients on congested links, far away scenery without events repeats its
+* state from the frame we delta compress against, which costs nothing on the
+* wire. It still gets a fresh state every SNAP_DEFER_INTERVAL snapshots, and
+* straight away if it was respawned or its model, solid or sound changed
+*/
+static const SyncEntityState *SNAP_DeferredEntityState( const client_snapshot_t *oldframe, int *oldindex, const edict_t *ent,
+														const edict_t *clent, Vec3 vieworg, int64_t snapsSent,
+														const client_entities_t *client_entities ) {
+	const SyncEntityState *s = &ent->s;
+
+	if( ent == clent || s->type == ET_PLAYER || s->type == ET_CORPSE || s->type >= EVENT_ENTITIES_START ) {
+		return NULL;
+	}
+	if( ( ent->r.svflags & SVF_PROJECTILE ) || s->events[0].type || s->events[1].type || s->teleported ) {
+		return NULL;
+	}
+	if( ( snapsSent + s->number ) % SNAP_DEFER_INTERVAL == 0 ) {
+		return NULL;
+	}
+	if( Length( ( ent->r.absmin + ent->r.absmax ) * 0.5f - vieworg ) < SNAP_DEFER_DISTANCE ) {
+		return NULL;
+	}
+	if( ent->r.spawnTimeStamp >= oldframe->sentTimeStamp ) {
+		return NULL;
+	}
+
+	// both lists are sorted by entity number
+	while( *oldindex < oldframe->num_entities ) {
+		const SyncEntityState *old = &client_entities->entities[( oldframe->first_entity + *oldindex ) % client_entities->num_entities];
+		if( old->number > s->number ) {
+			return NULL;
+		}
+
+		( *oldindex )++;
+
+		if( old->number == s->number ) {
+			if( old->type != s->type || old->events[0].type || old->events[1].type ) {
+				return NULL;
+			}
+			if( old->model != s->model || old->model2 != s->model2 || old->solid != s->solid || old->sound != s->sound ) {
+				return NULL;
+			}
+			return old;
+		}
+	}
+
+	return NULL;
+}
+
 /*
 * SNAP_BuildClientFrameSnap
 *
@@ -709,6 +777,9 @@ void SNAP_BuildClientFrameSnap( CollisionModel *cms, ginfo_t *gi, int64_t frameN
 	//=============================
 
 	// dump the entities list
+	const client_snapshot_t *deltaframe = client->rate.deferFarEntities ? SNAP_DeltaFrame( client, frame, frameNum ) : NULL;
+	int deltaindex = 0;
+
 	ne = client_entities->next_entities;
 	frame->num_entities = 0;
 	frame->first_entity = ne;
@@ -718,12 +789,21 @@ void SNAP_BuildClientFrameSnap( CollisionModel *cms, ginfo_t *gi, int64_t frameN
 		ent = EDICT_NUM( entsList.snapshotEntities[e] );
 		state = &client_entities->entities[ne % client_entities->num_entities];
 
-		*state = ent->s;
-		state->svflags = ent->r.svflags;
+		const SyncEntityState *deferred = NULL;
+		if( deltaframe != NULL ) {
+			deferred = SNAP_DeferredEntityState( deltaframe, &deltaindex, ent, clent, org, client->rate.snapsSent, client_entities );
+		}
+
+		if( deferred != NULL ) {
+			*state = *deferred;
+		} else {
+			*state = ent->s;
+			state->svflags = ent->r.svflags;
 
-		// don't mark *any* missiles as solid
-		if( ent->r.svflags & SVF_PROJECTILE ) {
-			state->solid = 0;
+			// don't mark *any* missiles as solid
+			if( ent->r.svflags & SVF_PROJECTILE ) {
+				state->solid = 0;
+			}
 		}
 
 		frame->num_entities++;
@@ -93,12 +93,15 @@ struct ArenaAllocator final : public Allocator {
 	void * get_memory();
 
 	float max_utilisation() const;
+	size_t capacity() const;
+	size_t peak_usage() const; // since creation, not just since the last clear
 
 private:
 	u8 * memory;
 	u8 * top;
 	u8 * cursor;
 	u8 * cursor_max;
+	size_t peak;
 
 	u32 num_temp_allocators;
 
@@ -51,6 +51,24 @@ typedef struct ginfo_s {
 	int max_clients;        // <= sv_maxclients, <= max_edicts
 } ginfo_t;
 
+// configstrings are pre-encoded for connecting clients as one "cs" command
+// per page, and a page is rebuilt the next time it's needed after one of
+// its configstrings changes
+#define CONFIGSTRING_PAGE_SIZE  12
+#define CONFIGSTRING_PAGES      ( ( MAX_CONFIGSTRINGS + CONFIGSTRING_PAGE_SIZE - 1 ) / CONFIGSTRING_PAGE_SIZE )
+
+typedef struct {
+	char command[MAX_STRING_CHARS];     // empty if the whole page is empty
+	bool valid;
+} configstring_page_t;
+
+// baselines never change after the map has spawned, so they get encoded
+// once and sent to everyone in the same chunks
+typedef struct {
+	int start, end;                     // baselines [start, end) are in this chunk
+	size_t offset, size;                // into sv.baselineData
+} baseline_chunk_t;
+
 typedef struct {
 	server_state_t state;       // precache commands are only valid during load
 
@@ -62,6 +80,11 @@ typedef struct {
 	char configstrings[MAX_CONFIGSTRINGS][MAX_CONFIGSTRING_CHARS];
 	SyncEntityState baselines[MAX_EDICTS];
 
+	configstring_page_t configstringPages[CONFIGSTRING_PAGES];
+	uint8_t *baselineData;              // NULL until a client asks for baselines
+	baseline_chunk_t *baselineChunks;
+	int numBaselineChunks;
+
 	//
 	// global variables shared between game and server
 	//
@@ -101,8 +124,46 @@ typedef struct {
 
 #define LATENCY_COUNTS  16
 
+#define BROADCAST_COMMANDS_SIZE     256     // must be a power of two, and well above MAX_RELIABLE_COMMANDS
+#define PRIVATE_COMMANDS_SIZE       ( 16 * 1024 )
+
+// reliable commands are either shared through svs.broadcastCommands or
+// live in the client's own privateCommands ring
+typedef struct {
+	int64_t broadcast;              // index into svs.broadcastCommands, or -1 if private
+	int64_t privateOffset;          // position in privateCommands
+} reliable_command_t;
+
 #define HTTP_CLIENT_SESSION_SIZE 16
 
+// per-client send scheduling. each client is measured over one second
+// windows and backs off to every 2nd/4th/... snapshot when its link looks
+// congested, then creeps back up once it's been stable for a while
+typedef struct {
+	int snapDivisor;                // send every Nth snapshot
+	int64_t nextSnapFrame;          // sv.framenum the next snapshot is due
+	int64_t snapsSent;
+	bool deferFarEntities;          // refresh far away scenery less often
+
+	// optional sv_maxClientRate token bucket, in bytes
+	int64_t tokens;
+	int64_t lastRefill;
+
+	// current measurement window
+	int64_t windowStart;
+	int windowPackets;
+	int windowDropped;
+	int windowBytes;
+	int windowSnaps;
+
+	// results of the last window
+	float loss;                     // fraction of the client's packets we didn't get, smoothed
+	int bytesPerSecond;
+	int snapsPerSecond;
+	int minPing;                    // baseline, pings above it mean we're filling queues
+	int stableWindows;
+} client_rate_t;
+
 typedef struct client_s {
 	sv_client_state_t state;
 
@@ -116,11 +177,15 @@ typedef struct client_s {
 
 	socket_t socket;
 
-	char reliableCommands[MAX_RELIABLE_COMMANDS][MAX_STRING_CHARS];
+	reliable_command_t reliableCommands[MAX_RELIABLE_COMMANDS];
 	int64_t reliableSequence;      // last added reliable message, not necesarily sent or acknowledged yet
 	int64_t reliableAcknowledge;   // last acknowledged reliable message
 	int64_t reliableSent;          // last sent reliable message, not necesarily acknowledged yet
 
+	char privateCommands[PRIVATE_COMMANDS_SIZE];
+	int64_t privateCommandsHead;   // total bytes ever written to privateCommands
+	int64_t broadcastCursor;       // next broadcast command to queue for this client
+
 	game_command_t gameCommands[MAX_RELIABLE_COMMANDS];
 	int64_t gameCommandCurrent;             // position in the gameCommands table
 
@@ -153,6 +218,7 @@ typedef struct client_s {
 	int challenge;                  // challenge of this user, randomly generated
 
 	netchan_t netchan;
+	client_rate_t rate;
 
 	int mm_session;
 	unsigned int mm_ticket;
@@ -167,20 +233,31 @@ typedef struct client_s {
 
 //=============================================================================
 
-// MAX_CHALLENGES is made large to prevent a denial
-// of service attack that could cycle all of them
-// out before legitimate users connected
-#define MAX_CHALLENGES  1024
+// challenges are a keyed hash of the client's address and the time, so the
+// server doesn't need to remember who asked for one. a challenge stays valid
+// for one to two buckets, and the key is replaced every CHALLENGE_SECRET_MSECS
+#define CHALLENGE_BUCKET_MSECS  10000
+#define CHALLENGE_SECRET_MSECS  ( 15 * 60 * 1000 )
+
+// connectionless packets are rate limited per address with token buckets,
+// hashed into a fixed table. collisions just hand out a fresh bucket
+#define OOB_RATE_BUCKETS    4096
 
 // MAX_SNAP_ENTITIES is the guess of what we consider maximum amount of entities
 // to be sent to a client into a snap. It's used for finding size of the backup storage
 #define MAX_SNAP_ENTITIES 64
 
+typedef struct {
+	uint8_t key[32];
+	int64_t generation;
+	bool valid;
+} challenge_secret_t;
+
 typedef struct {
 	netadr_t adr;
-	int challenge;
+	float tokens;
 	int64_t time;
-} challenge_t;
+} oob_rate_bucket_t;
 
 // for server side demo recording
 typedef struct {
@@ -189,11 +266,57 @@ typedef struct {
 	char *tempname;
 	time_t localtime;
 	int64_t basetime, duration;
+	int64_t last_keyframe;
 	client_t client;                // special client for writing the messages
 	char meta_data[SNAP_MAX_DEMO_META_DATA_SIZE];
 	size_t meta_data_realsize;
 } server_static_demo_t;
 
+// the frame watchdog keeps stage timings for the last few server frames and
+// dumps them to a file when a frame goes over sv_frameBudget
+#define SV_WATCHDOG_FRAMES          64
+#define SV_WATCHDOG_SCRIPT_CALLS    16
+
+typedef enum {
+	FRAMESTAGE_PACKETS,     // timeouts, reading packets and userinfo changes
+	FRAMESTAGE_FRAGMENTS,
+	FRAMESTAGE_SLEEP,       // not counted against the budget
+	FRAMESTAGE_GAME,        // SV_CalcPings and ge->RunFrame
+	FRAMESTAGE_SNAP,
+	FRAMESTAGE_SEND,
+	FRAMESTAGE_DEMO,
+	FRAMESTAGE_HEARTBEAT,
+
+	FRAMESTAGE_COUNT
+} sv_framestage_t;
+
+typedef struct {
+	char name[64];
+	int calls;
+	uint64_t usec;
+} sv_scriptcall_t;
+
+typedef struct {
+	int64_t gametime;
+	int64_t framenum;
+	uint64_t start;
+	uint64_t stages[FRAMESTAGE_COUNT];     // usecs
+	uint64_t total;                         // usecs, without sleeping
+	int numEntities;
+	int numClients;
+	sv_scriptcall_t scriptCalls[SV_WATCHDOG_SCRIPT_CALLS];
+	int numScriptCalls;
+} sv_frametiming_t;
+
+typedef struct {
+	sv_frametiming_t frames[SV_WATCHDOG_FRAMES];
+	unsigned int head;                      // the frame being recorded
+	bool recording;
+	bool dumpPending;                       // written next frame, once the profiler has the slow one
+	int64_t lastDump;
+	int suppressedDumps;
+} sv_watchdog_t;
+
 typedef struct client_entities_s {
 	unsigned num_entities;              // maxclients->integer*UPDATE_BACKUP*MAX_PACKET_ENTITIES
 	unsigned next_entities;             // next client_entity to use
@@ -219,10 +342,19 @@ typedef struct {
 	client_t *clients;                  // [sv_maxclients->integer];
 	client_entities_t client_entities;
 
-	challenge_t challenges[MAX_CHALLENGES]; // to prevent invalid IPs from connecting
+	challenge_secret_t challengeSecrets[2];    // current and previous, indexed by generation
+	oob_rate_bucket_t oobRateBuckets[OOB_RATE_BUCKETS];
+	uint32_t oobRateSeed;
+
+	// append-only log of commands sent to everyone, which clients pick up lazily
+	char broadcastCommands[BROADCAST_COMMANDS_SIZE][MAX_STRING_CHARS];
+	int64_t broadcastCommandsHead;          // index of the next broadcast command
+	int64_t broadcastCommandsSealed;        // commands before this may have been seen and can't be batched into
 
 	server_static_demo_t demo;
 
+	sv_watchdog_t watchdog;
+
 	CollisionModel *cms;                // passed to CM-functions
 } server_static_t;
 
@@ -260,12 +392,15 @@ extern cvar_t *sv_http_port;
 extern cvar_t *sv_http_upstream_baseurl;
 extern cvar_t *sv_http_upstream_ip;
 extern cvar_t *sv_http_upstream_realip_header;
+extern cvar_t *sv_http_profile;
 #endif
 
 extern cvar_t *sv_maxclients;
 
 extern cvar_t *sv_showRcon;
 extern cvar_t *sv_showChallenge;
+extern cvar_t *sv_oobRate;
+extern cvar_t *sv_oobBurst;
 extern cvar_t *sv_showInfoQueries;
 
 extern cvar_t *sv_public;         // should heartbeats be sent
@@ -280,6 +415,13 @@ extern cvar_t *sv_uploads_demos_baseurl;
 
 extern cvar_t *sv_demodir;
 
+extern cvar_t *sv_frameBudget;
+extern cvar_t *sv_frameDump;
+
+extern cvar_t *sv_adaptiveSnaps;
+extern cvar_t *sv_maxSnapDivisor;
+extern cvar_t *sv_maxClientRate;
+
 //===========================================================
 
 //
@@ -317,9 +459,14 @@ void SV_SetServerConfigStrings( void );
 //
 bool SV_Netchan_Transmit( netchan_t *netchan, msg_t *msg );
 void SV_AddServerCommand( client_t *client, const char *cmd );
+void SV_InvalidateConfigstring( int index );
+void SV_FreeGamestateCache( void );
 void SV_SendServerCommand( client_t *cl, const char *format, ... );
 void SV_AddGameCommand( client_t *client, const char *cmd );
 void SV_AddReliableCommandsToMessage( client_t *client, msg_t *msg );
+void SV_QueueBroadcastCommands( client_t *client );
+void SV_ResetBroadcastCursor( client_t *client );
+size_t SV_FreePrivateCommandBytes( const client_t *client );
 bool SV_SendClientsFragments( void );
 void SV_InitClientMessage( client_t *client, msg_t *msg, uint8_t *data, size_t size );
 bool SV_SendMessageToClient( client_t *client, msg_t *msg );
@@ -401,6 +548,24 @@ void SV_DemoGet_f( client_t *client );
 
 bool SV_IsDemoDownloadRequest( const char *request );
 
+//
+// sv_rate.c
+//
+void SV_Rate_Reset( client_t *client );
+void SV_Rate_PacketReceived( client_t *client );
+bool SV_Rate_SnapDue( client_t *client );
+void SV_Rate_SnapSent( client_t *client, size_t bytes );
+bool SV_Rate_CanSendFragment( client_t *client );
+void SV_Rate_Print_f( void );
+
+//
+// sv_watchdog.c
+//
+void SV_Watchdog_BeginFrame( void );
+void SV_Watchdog_AddStage( sv_framestage_t stage, uint64_t start );
+void SV_Watchdog_ScriptCall( const char *name, uint64_t usec );
+void SV_Watchdog_EndFrame( void );
+
 //
 // sv_web.c
 //
@@ -225,6 +225,54 @@ static void SV_KillServer_f( void ) {
 	SV_ShutdownGame( "Server was killed", false );
 }
 
+/*
+* SV_Profile_f
+* Per-frame zone timings and counters over the profiler's rolling window
+*/
+static void SV_Profile_f( void ) {
+	if( Cmd_Argc() == 2 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		ResetProfilerStats();
+		Com_Printf( "Profiler stats reset\n" );
+		return;
+	}
+
+	size_t limit = 30;
+	if( Cmd_Argc() == 2 ) {
+		limit = Max2( atoi( Cmd_Argv( 1 ) ), 1 );
+	}
+
+	static ProfilerStats stats[ MAX_PROFILER_SITES ];
+	u32 num_frames;
+	size_t n = GetProfilerStats( Span< ProfilerStats >( stats, ARRAY_COUNT( stats ) ), &num_frames );
+
+	if( num_frames == 0 ) {
+		Com_Printf( "No frames profiled yet\n" );
+		return;
+	}
+
+	Com_Printf( "Last %u frames\n", num_frames );
+	Com_Printf( "%-40s %7s %8s %8s %8s %8s\n", "zone", "calls", "min ms", "avg ms", "p99 ms", "max ms" );
+
+	size_t printed = 0;
+	for( size_t i = 0; i < n && printed < limit; i++ ) {
+		const ProfilerStats & s = stats[ i ];
+		if( s.counter )
+			continue;
+		Com_Printf( "%-40.40s %7.1f %8.3f %8.3f %8.3f %8.3f\n", s.name, s.calls_per_frame,
+			s.min / 1000000.0, s.avg / 1000000.0, s.p99 / 1000000.0, s.max / 1000000.0 );
+		printed++;
+	}
+
+	Com_Printf( "%-40s %7s %8s %8s %8s %8s\n", "counter", "calls", "min", "avg", "p99", "max" );
+	for( size_t i = 0; i < n; i++ ) {
+		const ProfilerStats & s = stats[ i ];
+		if( !s.counter )
+			continue;
+		Com_Printf( "%-40.40s %7.1f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n", s.name, s.calls_per_frame,
+			s.min, s.avg, s.p99, s.max );
+	}
+}
+
 //===========================================================
 
 /*
@@ -235,6 +283,8 @@ void SV_InitOperatorCommands( void ) {
 	Cmd_AddCommand( "status", SV_Status_f );
 	Cmd_AddCommand( "serverinfo", SV_Serverinfo_f );
 	Cmd_AddCommand( "dumpuser", SV_DumpUser_f );
+	Cmd_AddCommand( "profile", SV_Profile_f );
+	Cmd_AddCommand( "clientrates", SV_Rate_Print_f );
 
 	Cmd_AddCommand( "map", SV_Map_f );
 	Cmd_AddCommand( "devmap", SV_Map_f );
@@ -259,6 +309,8 @@ void SV_ShutdownOperatorCommands( void ) {
 	Cmd_RemoveCommand( "status" );
 	Cmd_RemoveCommand( "serverinfo" );
 	Cmd_RemoveCommand( "dumpuser" );
+	Cmd_RemoveCommand( "profile" );
+	Cmd_RemoveCommand( "clientrates" );
 
 	Cmd_RemoveCommand( "map" );
 	Cmd_RemoveCommand( "devmap" );
@@ -35,6 +35,8 @@ void SV_ClientResetCommandBuffers( client_t *client ) {
 	client->reliableSequence = 0;
 	client->reliableSent = 0;
 	memset( client->reliableCommands, 0, sizeof( client->reliableCommands ) );
+	client->privateCommandsHead = 0;
+	SV_ResetBroadcastCursor( client );
 
 	// reset the usercommands buffer(clc_move)
 	client->UcmdTime = 0;
@@ -101,6 +103,7 @@ bool SV_ClientConnect( const socket_t *socket, const netadr_t *address, client_t
 	}
 
 	SV_ClientResetCommandBuffers( client );
+	SV_Rate_Reset( client );
 
 	// reset timeouts
 	client->lastPacketReceivedTime = svs.realtime;
@@ -284,11 +287,138 @@ static void SV_New_f( client_t *client ) {
 	client->state = CS_CONNECTING;
 }
 
+/*
+* SV_InvalidateConfigstring
+*
+* Makes connecting clients get the new value
+*/
+void SV_InvalidateConfigstring( int index ) {
+	sv.configstringPages[index / CONFIGSTRING_PAGE_SIZE].valid = false;
+}
+
+/*
+* SV_ConfigstringPage
+*/
+static const char *SV_ConfigstringPage( int page ) {
+	STATIC_ASSERT( CONFIGSTRING_PAGE_SIZE * ( MAX_CONFIGSTRING_CHARS + 8 ) + 3 < MAX_STRING_CHARS );
+
+	configstring_page_t *p = &sv.configstringPages[page];
+	if( p->valid ) {
+		return p->command;
+	}
+
+	size_t len = 0;
+	p->command[0] = '\0';
+
+	int end = Min2( ( page + 1 ) * CONFIGSTRING_PAGE_SIZE, MAX_CONFIGSTRINGS );
+	for( int i = page * CONFIGSTRING_PAGE_SIZE; i < end; i++ ) {
+		if( sv.configstrings[i][0] ) {
+			len += snprintf( p->command + len, sizeof( p->command ) - len, "%s %i \"%s\"", len == 0 ? "cs" : "", i, sv.configstrings[i] );
+		}
+	}
+
+	p->valid = true;
+	return p->command;
+}
+
+/*
+* SV_FreeGamestateCache
+*/
+void SV_FreeGamestateCache( void ) {
+	if( sv.baselineData ) {
+		Mem_Free( sv.baselineData );
+		Mem_Free( sv.baselineChunks );
+	}
+	sv.baselineData = NULL;
+	sv.baselineChunks = NULL;
+	sv.numBaselineChunks = 0;
+}
+
+/*
+* SV_EncodeBaselines
+*
+* Writes baselines into chunks of about the same size SV_Baselines_f used
+* to send. Returns the number of bytes written, data can be NULL to measure
+*/
+static size_t SV_EncodeBaselines( uint8_t *data, baseline_chunk_t *chunks, int *numChunks ) {
+	SyncEntityState nullstate;
+	uint8_t entityData[sizeof( SyncEntityState ) * 2 + 16];
+	size_t size = 0;
+	size_t chunkStart = 0;
+	int chunkEntity = 0;
+
+	memset( &nullstate, 0, sizeof( nullstate ) );
+	*numChunks = 0;
+
+	for( int i = 0; i < MAX_EDICTS; i++ ) {
+		const SyncEntityState *base = &sv.baselines[i];
+		if( base->number == 0 ) {
+			continue;
+		}
+
+		msg_t msg;
+		MSG_Init( &msg, entityData, sizeof( entityData ) );
+		MSG_WriteUint8( &msg, svc_spawnbaseline );
+		MSG_WriteDeltaEntity( &msg, &nullstate, base, true );
+
+		if( data ) {
+			memcpy( data + size, msg.data, msg.cursize );
+		}
+		size += msg.cursize;
+
+		if( size - chunkStart >= FRAGMENT_SIZE * 3 ) {
+			if( chunks ) {
+				chunks[*numChunks].start = chunkEntity;
+				chunks[*numChunks].end = i + 1;
+				chunks[*numChunks].offset = chunkStart;
+				chunks[*numChunks].size = size - chunkStart;
+			}
+			( *numChunks )++;
+			chunkStart = size;
+			chunkEntity = i + 1;
+		}
+	}
+
+	if( chunks ) {
+		chunks[*numChunks].start = chunkEntity;
+		chunks[*numChunks].end = MAX_EDICTS;
+		chunks[*numChunks].offset = chunkStart;
+		chunks[*numChunks].size = size - chunkStart;
+	}
+	( *numChunks )++;
+
+	return size;
+}
+
+/*
+* SV_BaselineChunk
+*
+* Returns the chunk holding baseline start
+*/
+static const baseline_chunk_t *SV_BaselineChunk( int start ) {
+	if( !sv.baselineData ) {
+		int numChunks;
+		size_t size = SV_EncodeBaselines( NULL, NULL, &numChunks );
+
+		sv.baselineData = ( uint8_t * )Mem_Alloc( sv_mempool, Max2( size, size_t( 1 ) ) );
+		sv.baselineChunks = ( baseline_chunk_t * )Mem_Alloc( sv_mempool, numChunks * sizeof( baseline_chunk_t ) );
+		SV_EncodeBaselines( sv.baselineData, sv.baselineChunks, &sv.numBaselineChunks );
+	}
+
+	for( int i = 0; i < sv.numBaselineChunks; i++ ) {
+		if( sv.baselineChunks[i].end > start ) {
+			return &sv.baselineChunks[i];
+		}
+	}
+
+	return NULL;
+}
+
 /*
 * SV_Configstrings_f
 */
 static void SV_Configstrings_f( client_t *client ) {
-	int start;
+	int start, page;
 
 	if( client->state == CS_CONNECTING ) {
 		Com_DPrintf( "Start Configstrings() from %s\n", client->name );
@@ -310,18 +440,22 @@ static void SV_Configstrings_f( client_t *client ) {
 	}
 
 	start = atoi( Cmd_Argv( 2 ) );
-	if( start < 0 ) {
-		start = 0;
-	}
+	start = Clamp( 0, start, MAX_CONFIGSTRINGS );
+
+	// send whole pages, resending the start of one is harmless
+	page = start / CONFIGSTRING_PAGE_SIZE;
 
 	// write a packet full of data
-	while( start < MAX_CONFIGSTRINGS &&
-		   client->reliableSequence - client->reliableAcknowledge < MAX_RELIABLE_COMMANDS - 8 ) {
-		if( sv.configstrings[start][0] ) {
-			SV_SendServerCommand( client, "cs %i \"%s\"", start, sv.configstrings[start] );
+	while( page < CONFIGSTRING_PAGES &&
+		   client->reliableSequence - client->reliableAcknowledge < MAX_RELIABLE_COMMANDS - 8 &&
+		   SV_FreePrivateCommandBytes( client ) > MAX_STRING_CHARS * 3 ) {
+		const char *cmd = SV_ConfigstringPage( page );
+		if( cmd[0] ) {
+			SV_AddServerCommand( client, cmd );
 		}
-		start++;
+		page++;
 	}
+	start = Min2( page * CONFIGSTRING_PAGE_SIZE, MAX_CONFIGSTRINGS );
 
 	// send next command
 	if( start == MAX_CONFIGSTRINGS ) {
@@ -336,8 +470,7 @@ static void SV_Configstrings_f( client_t *client ) {
 */
 static void SV_Baselines_f( client_t *client ) {
 	int start;
-	SyncEntityState nullstate;
-	SyncEntityState *base;
+	const baseline_chunk_t *chunk;
 
 	Com_DPrintf( "Baselines() from %s\n", client->name );
 
@@ -358,18 +491,15 @@ static void SV_Baselines_f( client_t *client ) {
 		start = 0;
 	}
 
-	memset( &nullstate, 0, sizeof( nullstate ) );
-
 	// write a packet full of data
 	SV_InitClientMessage( client, &tmpMessage, NULL, 0 );
 
-	while( tmpMessage.cursize < FRAGMENT_SIZE * 3 && start < MAX_EDICTS ) {
-		base = &sv.baselines[start];
-		if( base->number != 0 ) {
-			MSG_WriteUint8( &tmpMessage, svc_spawnbaseline );
-			MSG_WriteDeltaEntity( &tmpMessage, &nullstate, base, true );
-		}
-		start++;
+	chunk = SV_BaselineChunk( start );
+	if( chunk != NULL ) {
+		MSG_WriteData( &tmpMessage, sv.baselineData + chunk->offset, chunk->size );
+		start = chunk->end;
+	} else {
+		start = MAX_EDICTS;
 	}
 
 	// send next command
@@ -76,6 +76,12 @@ void SV_Demo_WriteSnap( void ) {
 
 	MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
 
+	if( svs.gametime - svs.demo.last_keyframe >= SNAP_DEMO_KEYFRAME_INTERVAL ) {
+		SNAP_RecordDemoKeyframe( svs.demo.file, svs.gametime, sv.configstrings[0] );
+		svs.demo.client.nodelta = true;
+		svs.demo.last_keyframe = svs.gametime;
+	}
+
 	SV_BuildClientFrameSnap( &svs.demo.client );
 
 	SV_WriteFrameSnapToClient( &svs.demo.client, &msg );
@@ -101,6 +107,7 @@ static void SV_Demo_InitClient( void ) {
 	svs.demo.client.reliableSequence = 0;
 	svs.demo.client.reliableSent = 0;
 	memset( svs.demo.client.reliableCommands, 0, sizeof( svs.demo.client.reliableCommands ) );
+	SV_ResetBroadcastCursor( &svs.demo.client );
 
 	svs.demo.client.lastframe = sv.framenum - 1;
 	svs.demo.client.nodelta = false;
@@ -184,6 +191,7 @@ void SV_Demo_Start_f( void ) {
 	// write serverdata, configstrings and baselines
 	svs.demo.duration = 0;
 	svs.demo.basetime = svs.gametime;
+	svs.demo.last_keyframe = svs.gametime;
 	svs.demo.localtime = time( NULL );
 	SV_Demo_WriteStartMessages();
 
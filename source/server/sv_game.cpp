@@ -133,6 +133,7 @@ static void PF_ConfigString( int index, const char *val ) {
 
 	// change the string in sv
 	Q_strncpyz( sv.configstrings[index], val, sizeof( sv.configstrings[index] ) );
+	SV_InvalidateConfigstring( index );
 
 	if( sv.state != ss_loading ) {
 		SV_SendServerCommand( NULL, "cs %i \"%s\"", index, val );
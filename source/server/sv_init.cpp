@@ -51,6 +51,8 @@ static void SV_CreateBaseline( void ) {
 void SV_SetServerConfigStrings( void ) {
 	snprintf( sv.configstrings[CS_MAXCLIENTS], sizeof( sv.configstrings[0] ), "%i", sv_maxclients->integer );
 	Q_strncpyz( sv.configstrings[CS_HOSTNAME], Cvar_String( "sv_hostname" ), sizeof( sv.configstrings[0] ) );
+	SV_InvalidateConfigstring( CS_MAXCLIENTS );
+	SV_InvalidateConfigstring( CS_HOSTNAME );
 }
 
 /*
@@ -70,6 +72,7 @@ static void SV_SpawnServer( const char *mapname, bool devmap ) {
 	Com_SetServerState( ss_dead );
 
 	// wipe the entire per-level structure
+	SV_FreeGamestateCache();
 	memset( &sv, 0, sizeof( sv ) );
 
 	SV_ResetClientFrameCounters();
@@ -250,6 +253,7 @@ void SV_ShutdownGame( const char *finalmsg, bool reconnect ) {
 	}
 
 	SV_ShutdownGameProgs();
+	SV_FreeGamestateCache();
 
 	NET_CloseSocket( &svs.socket_loopback );
 	NET_CloseSocket( &svs.socket_udp );
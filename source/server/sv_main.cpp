@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "server/server.h"
 #include "qcommon/version.h"
 #include "qcommon/csprng.h"
+#include "qcommon/memtrack.h"
 
 static bool sv_initialized = false;
 
@@ -54,10 +55,13 @@ cvar_t *sv_http_port;
 cvar_t *sv_http_upstream_baseurl;
 cvar_t *sv_http_upstream_ip;
 cvar_t *sv_http_upstream_realip_header;
+cvar_t *sv_http_profile;
 #endif
 
 cvar_t *sv_showRcon;
 cvar_t *sv_showChallenge;
+cvar_t *sv_oobRate;
+cvar_t *sv_oobBurst;
 cvar_t *sv_showInfoQueries;
 
 cvar_t *sv_hostname;
@@ -75,6 +79,13 @@ cvar_t *sv_debug_serverCmd;
 
 cvar_t *sv_demodir;
 
+cvar_t *sv_frameBudget;
+cvar_t *sv_frameDump;
+
+cvar_t *sv_adaptiveSnaps;
+cvar_t *sv_maxSnapDivisor;
+cvar_t *sv_maxClientRate;
+
 //============================================================================
 
 /*
@@ -225,6 +236,7 @@ static void SV_ReadPackets( void ) {
 
 				if( SV_ProcessPacket( &cl->netchan, &msg ) ) { // this is a valid, sequenced packet, so process it
 					cl->lastPacketReceivedTime = svs.realtime;
+					SV_Rate_PacketReceived( cl );
 					SV_ParseClientMessage( cl, &msg );
 				}
 				break;
@@ -256,6 +268,7 @@ static void SV_ReadPackets( void ) {
 				if( SV_ProcessPacket( &cl->netchan, &msg ) ) {
 					// this is a valid, sequenced packet, so process it
 					cl->lastPacketReceivedTime = svs.realtime;
+					SV_Rate_PacketReceived( cl );
 					SV_ParseClientMessage( cl, &msg );
 				}
 			}
@@ -365,7 +378,9 @@ static bool SV_RunGameFrame( int msec ) {
 	refreshSnapshot = false;
 	refreshGameModule = false;
 
+	uint64_t stageStart = Sys_Microseconds();
 	sentFragments = SV_SendClientsFragments();
+	SV_Watchdog_AddStage( FRAMESTAGE_FRAGMENTS, stageStart );
 
 	// see if it's time to run a new game frame
 	if( accTime >= WORLDFRAMETIME ) {
@@ -398,13 +413,17 @@ static bool SV_RunGameFrame( int msec ) {
 			}
 			opened_sockets[open_ind] = NULL;
 
+			stageStart = Sys_Microseconds();
 			NET_Sleep( sleeptime, opened_sockets );
+			SV_Watchdog_AddStage( FRAMESTAGE_SLEEP, stageStart );
 		}
 	}
 
 	if( refreshGameModule ) {
 		int64_t moduleTime;
 
+		stageStart = Sys_Microseconds();
+
 		// update ping based on the last known frame from all clients
 		SV_CalcPings();
 
@@ -420,6 +439,7 @@ static bool SV_RunGameFrame( int msec ) {
 		}
 
 		ge->RunFrame( moduleTime );
+		SV_Watchdog_AddStage( FRAMESTAGE_GAME, stageStart );
 	}
 
 	// if we don't have to send a snapshot we are done here
@@ -428,7 +448,9 @@ static bool SV_RunGameFrame( int msec ) {
 
 		// set up for sending a snapshot
 		sv.framenum++;
+		stageStart = Sys_Microseconds();
 		ge->SnapFrame();
+		SV_Watchdog_AddStage( FRAMESTAGE_SNAP, stageStart );
 
 		// set time for next snapshot
 		extraSnapTime = (int)( svs.gametime - sv.nextSnapTime );
@@ -479,6 +501,10 @@ void SV_Frame( unsigned realmsec, unsigned gamemsec ) {
 	svs.realtime += realmsec;
 	svs.gametime += gamemsec;
 
+	SV_Watchdog_BeginFrame();
+
+	uint64_t stageStart = Sys_Microseconds();
+
 	// check timeouts
 	SV_CheckTimeouts();
 
@@ -488,20 +514,30 @@ void SV_Frame( unsigned realmsec, unsigned gamemsec ) {
 	// apply latched userinfo changes
 	SV_CheckLatchedUserinfoChanges();
 
+	SV_Watchdog_AddStage( FRAMESTAGE_PACKETS, stageStart );
+
 	// let everything in the world think and move
 	if( SV_RunGameFrame( gamemsec ) ) {
 		// send messages back to the clients that had packets read this frame
+		stageStart = Sys_Microseconds();
 		SV_SendClientMessages();
+		SV_Watchdog_AddStage( FRAMESTAGE_SEND, stageStart );
 
 		// write snap to server demo file
+		stageStart = Sys_Microseconds();
 		SV_Demo_WriteSnap();
+		SV_Watchdog_AddStage( FRAMESTAGE_DEMO, stageStart );
 
 		// send a heartbeat to the master if needed
+		stageStart = Sys_Microseconds();
 		SV_MasterHeartbeat();
+		SV_Watchdog_AddStage( FRAMESTAGE_HEARTBEAT, stageStart );
 
 		// clear teleport flags, etc for next frame
 		ge->ClearSnap();
 	}
+
+	SV_Watchdog_EndFrame();
 }
 
 //============================================================================
@@ -569,10 +605,12 @@ void SV_Init( void ) {
 	constexpr size_t frame_arena_size = 1024 * 1024; // 1MB
 	void * frame_arena_memory = ALLOC_SIZE( sys_allocator, frame_arena_size, 16 );
 	svs.frame_arena = ArenaAllocator( frame_arena_memory, frame_arena_size );
+	RegisterArena( "Server frame", &svs.frame_arena );
 
 	u64 entropy[ 2 ];
 	CSPRNG_Bytes( entropy, sizeof( entropy ) );
 	svs.rng = new_rng( entropy[ 0 ], entropy[ 1 ] );
+	CSPRNG_Bytes( &svs.oobRateSeed, sizeof( svs.oobRateSeed ) );
 
 	SV_InitOperatorCommands();
 
@@ -595,6 +633,7 @@ void SV_Init( void ) {
 	sv_http_upstream_baseurl =  Cvar_Get( "sv_http_upstream_baseurl", "", CVAR_ARCHIVE | CVAR_LATCH );
 	sv_http_upstream_realip_header = Cvar_Get( "sv_http_upstream_realip_header", "", CVAR_ARCHIVE );
 	sv_http_upstream_ip = Cvar_Get( "sv_http_upstream_ip", "", CVAR_ARCHIVE );
+	sv_http_profile =   Cvar_Get( "sv_http_profile", "0", CVAR_ARCHIVE );
 #endif
 
 	rcon_password =         Cvar_Get( "rcon_password", "", 0 );
@@ -603,6 +642,8 @@ void SV_Init( void ) {
 	sv_zombietime =         Cvar_Get( "sv_zombietime", "2", 0 );
 	sv_showRcon =           Cvar_Get( "sv_showRcon", "1", 0 );
 	sv_showChallenge =      Cvar_Get( "sv_showChallenge", "0", 0 );
+	sv_oobRate =            Cvar_Get( "sv_oobRate", "10", CVAR_ARCHIVE );
+	sv_oobBurst =           Cvar_Get( "sv_oobBurst", "20", CVAR_ARCHIVE );
 	sv_showInfoQueries =    Cvar_Get( "sv_showInfoQueries", "0", 0 );
 
 	sv_uploads_http =       Cvar_Get( "sv_uploads_http", "1", CVAR_READONLY );
@@ -638,6 +679,13 @@ void SV_Init( void ) {
 		Cvar_ForceSet( "sv_demodir", "" );
 	}
 
+	sv_frameBudget =    Cvar_Get( "sv_frameBudget", "0", CVAR_ARCHIVE );
+	sv_frameDump =      Cvar_Get( "sv_frameDump", "1", CVAR_ARCHIVE );
+
+	sv_adaptiveSnaps =  Cvar_Get( "sv_adaptiveSnaps", "1", CVAR_ARCHIVE );
+	sv_maxSnapDivisor = Cvar_Get( "sv_maxSnapDivisor", "4", CVAR_ARCHIVE );
+	sv_maxClientRate =  Cvar_Get( "sv_maxClientRate", "0", CVAR_ARCHIVE );
+
 	sv_masterservers =          Cvar_Get( "masterservers", DEFAULT_MASTER_SERVERS_IPS, CVAR_LATCH );
 
 	sv_debug_serverCmd =        Cvar_Get( "sv_debug_serverCmd", "0", CVAR_ARCHIVE );
@@ -693,5 +741,6 @@ void SV_Shutdown( const char *finalmsg ) {
 
 	Mem_FreePool( &sv_mempool );
 
+	UnregisterArena( &svs.frame_arena );
 	FREE( sys_allocator, svs.frame_arena.get_memory() );
 }
@@ -19,8 +19,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "server.h"
+#include "qcommon/csprng.h"
+#include "qcommon/hash.h"
 #include "qcommon/version.h"
 
+#include "monocypher/monocypher.h"
+
 typedef struct sv_master_s {
 	netadr_t address;
 } sv_master_t;
@@ -444,6 +448,87 @@ static void SVC_GetStatusResponse( const socket_t *socket, const netadr_t *addre
 }
 
 
+/*
+* SV_BaseAddressBytes
+*
+* Serializes the address without the port
+*/
+static size_t SV_BaseAddressBytes( const netadr_t *address, uint8_t *buf ) {
+	size_t n = 0;
+	buf[n++] = (uint8_t)address->type;
+
+	if( address->type == NA_IP ) {
+		memcpy( buf + n, address->address.ipv4.ip, sizeof( address->address.ipv4.ip ) );
+		n += sizeof( address->address.ipv4.ip );
+	} else if( address->type == NA_IP6 ) {
+		uint32_t scope_id = (uint32_t)address->address.ipv6.scope_id;
+		memcpy( buf + n, address->address.ipv6.ip, sizeof( address->address.ipv6.ip ) );
+		n += sizeof( address->address.ipv6.ip );
+		memcpy( buf + n, &scope_id, sizeof( scope_id ) );
+		n += sizeof( scope_id );
+	}
+
+	return n;
+}
+
+/*
+* SV_ChallengeSecret
+*
+* Secrets are generated lazily the first time their generation is needed,
+* which retires the one from two generations ago
+*/
+static const challenge_secret_t *SV_ChallengeSecret( int64_t generation, int64_t current ) {
+	challenge_secret_t *secret = &svs.challengeSecrets[generation & 1];
+	if( secret->valid && secret->generation == generation ) {
+		return secret;
+	}
+
+	// never recreate an old secret, that would just reject everyone holding it
+	if( generation != current ) {
+		return NULL;
+	}
+
+	CSPRNG_Bytes( secret->key, sizeof( secret->key ) );
+	secret->generation = generation;
+	secret->valid = true;
+	return secret;
+}
+
+/*
+* SV_Challenge
+*
+* Keyed hash of the base address and time bucket, truncated to a positive int
+*/
+static int SV_Challenge( const netadr_t *address, int64_t bucket, int64_t now ) {
+	int64_t generation = bucket * CHALLENGE_BUCKET_MSECS / CHALLENGE_SECRET_MSECS;
+	const challenge_secret_t *secret = SV_ChallengeSecret( generation, now / CHALLENGE_SECRET_MSECS );
+	if( secret == NULL ) {
+		return -1;
+	}
+
+	uint8_t msg[1 + 16 + 4 + sizeof( bucket )];
+	size_t n = SV_BaseAddressBytes( address, msg );
+	memcpy( msg + n, &bucket, sizeof( bucket ) );
+	n += sizeof( bucket );
+
+	uint32_t hash;
+	crypto_blake2b_general( (uint8_t *)&hash, sizeof( hash ), secret->key, sizeof( secret->key ), msg, n );
+
+	return (int)( hash & 0x7fffffff );
+}
+
+/*
+* SV_CheckChallenge
+*
+* Accepts challenges from the current or previous time bucket
+*/
+static bool SV_CheckChallenge( const netadr_t *address, int challenge ) {
+	int64_t now = Sys_Milliseconds();
+	int64_t bucket = now / CHALLENGE_BUCKET_MSECS;
+
+	return challenge >= 0 && ( challenge == SV_Challenge( address, bucket, now ) || challenge == SV_Challenge( address, bucket - 1, now ) );
+}
+
 /*
 * SVC_GetChallenge
 *
@@ -454,37 +539,12 @@ static void SVC_GetStatusResponse( const socket_t *socket, const netadr_t *addre
 * challenge, they must give a valid IP address.
 */
 static void SVC_GetChallenge( const socket_t *socket, const netadr_t *address ) {
-	int i;
-	int oldest;
-	int oldestTime;
-
-	oldest = 0;
-	oldestTime = 0x7fffffff;
-
 	if( sv_showChallenge->integer ) {
 		Com_Printf( "Challenge Packet %s\n", NET_AddressToString( address ) );
 	}
 
-	// see if we already have a challenge for this ip
-	for( i = 0; i < MAX_CHALLENGES; i++ ) {
-		if( NET_CompareBaseAddress( address, &svs.challenges[i].adr ) ) {
-			break;
-		}
-		if( svs.challenges[i].time < oldestTime ) {
-			oldestTime = svs.challenges[i].time;
-			oldest = i;
-		}
-	}
-
-	if( i == MAX_CHALLENGES ) {
-		// overwrite the oldest
-		svs.challenges[oldest].challenge = random_uniform( &svs.rng, 0, S16_MAX );
-		svs.challenges[oldest].adr = *address;
-		svs.challenges[oldest].time = Sys_Milliseconds();
-		i = oldest;
-	}
-
-	Netchan_OutOfBandPrint( socket, address, "challenge %i", svs.challenges[i].challenge );
+	int64_t now = Sys_Milliseconds();
+	Netchan_OutOfBandPrint( socket, address, "challenge %i", SV_Challenge( address, now / CHALLENGE_BUCKET_MSECS, now ) );
 }
 
 
@@ -534,21 +594,8 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 	}
 
 	// see if the challenge is valid
-	for( i = 0; i < MAX_CHALLENGES; i++ ) {
-		if( NET_CompareBaseAddress( address, &svs.challenges[i].adr ) ) {
-			if( challenge == svs.challenges[i].challenge ) {
-				svs.challenges[i].challenge = 0; // wsw : r1q2 : reset challenge
-				svs.challenges[i].time = 0;
-				NET_InitAddress( &svs.challenges[i].adr, NA_NOTRANSMIT );
-				break; // good
-			}
-			Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nBad challenge\n",
-									DROP_TYPE_GENERAL, DROP_FLAG_AUTORECONNECT );
-			return;
-		}
-	}
-	if( i == MAX_CHALLENGES ) {
-		Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nNo challenge for address\n",
+	if( !SV_CheckChallenge( address, challenge ) ) {
+		Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nBad challenge\n",
 								DROP_TYPE_GENERAL, DROP_FLAG_AUTORECONNECT );
 		return;
 	}
@@ -791,6 +838,40 @@ connectionless_cmd_t connectionless_cmds[] =
 	{ NULL, NULL }
 };
 
+/*
+* SV_RateLimitConnectionless
+*
+* Token bucket per source address. Returns true if the packet should be dropped
+*/
+static bool SV_RateLimitConnectionless( const netadr_t *address ) {
+	if( sv_oobRate->value <= 0 || NET_IsLocalAddress( address ) ) {
+		return false;
+	}
+
+	uint8_t key[1 + 16 + 4];
+	size_t n = SV_BaseAddressBytes( address, key );
+	oob_rate_bucket_t *bucket = &svs.oobRateBuckets[Hash32( key, n, svs.oobRateSeed ) % OOB_RATE_BUCKETS];
+
+	int64_t now = Sys_Milliseconds();
+	float burst = Max2( sv_oobBurst->value, 1.0f );
+
+	if( !NET_CompareBaseAddress( address, &bucket->adr ) ) {
+		bucket->adr = *address;
+		bucket->tokens = burst;
+		bucket->time = now;
+	}
+
+	bucket->tokens = Min2( bucket->tokens + ( now - bucket->time ) * 0.001f * sv_oobRate->value, burst );
+	bucket->time = now;
+
+	if( bucket->tokens < 1.0f ) {
+		return true;
+	}
+
+	bucket->tokens -= 1.0f;
+	return false;
+}
+
 /*
 * SV_ConnectionlessPacket
 *
@@ -802,6 +883,10 @@ connectionless_cmd_t connectionless_cmds[] =
 void SV_ConnectionlessPacket( const socket_t *socket, const netadr_t *address, msg_t *msg ) {
 	connectionless_cmd_t *cmd;
 
+	if( SV_RateLimitConnectionless( address ) ) {
+		return;
+	}
+
 	MSG_BeginReading( msg );
 	MSG_ReadInt32( msg );    // skip the -1 marker
 
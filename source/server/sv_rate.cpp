@@ -0,0 +1,197 @@
+#include "server/server.h"
+
+#define SV_RATE_WINDOW              1000    // msecs per measurement window
+#define SV_RATE_LOSS_THRESHOLD      0.05f   // back off above this much packet loss
+#define SV_RATE_QUEUEING_PING       80      // or when ping is this far above the baseline
+#define SV_RATE_PING_DRIFT          2       // the baseline creeps up by this much per window so route changes settle
+#define SV_RATE_STABLE_WINDOWS      3       // clean windows before we try a faster snapshot rate
+#define SV_RATE_BURST               250     // msecs worth of sv_maxClientRate we let a client burst
+
+/*
+* SV_Rate_Throttleable
+*
+* Local and reliable connections don't lose packets to congestion
+*/
+static bool SV_Rate_Throttleable( const client_t *client ) {
+	return !client->reliable && !NET_IsLocalAddress( &client->netchan.remoteAddress );
+}
+
+/*
+* SV_Rate_Reset
+*/
+void SV_Rate_Reset( client_t *client ) {
+	memset( &client->rate, 0, sizeof( client->rate ) );
+	client->rate.snapDivisor = 1;
+	client->rate.windowStart = svs.realtime;
+	client->rate.lastRefill = svs.realtime;
+}
+
+/*
+* SV_Rate_PacketReceived
+*
+* Called for every sequenced packet we accept from the client
+*/
+void SV_Rate_PacketReceived( client_t *client ) {
+	client->rate.windowPackets++;
+	client->rate.windowDropped += client->netchan.dropped;
+}
+
+/*
+* SV_Rate_EndWindow
+*/
+static void SV_Rate_EndWindow( client_t *client ) {
+	client_rate_t *rate = &client->rate;
+	int64_t elapsed = svs.realtime - rate->windowStart;
+
+	int total = rate->windowPackets + rate->windowDropped;
+	float loss = total > 0 ? (float)rate->windowDropped / total : 0.0f;
+	rate->loss = rate->loss * 0.5f + loss * 0.5f;
+	rate->bytesPerSecond = elapsed > 0 ? rate->windowBytes * 1000 / elapsed : 0;
+	rate->snapsPerSecond = elapsed > 0 ? rate->windowSnaps * 1000 / elapsed : 0;
+
+	if( client->ping > 0 ) {
+		rate->minPing = rate->minPing == 0 ? client->ping : Min2( rate->minPing + SV_RATE_PING_DRIFT, client->ping );
+	}
+
+	rate->windowStart = svs.realtime;
+	rate->windowPackets = 0;
+	rate->windowDropped = 0;
+	rate->windowBytes = 0;
+	rate->windowSnaps = 0;
+
+	int maxDivisor = Max2( sv_maxSnapDivisor->integer, 1 );
+	if( !sv_adaptiveSnaps->integer || !SV_Rate_Throttleable( client ) ) {
+		rate->snapDivisor = 1;
+		rate->deferFarEntities = false;
+		return;
+	}
+
+	bool congested = rate->loss > SV_RATE_LOSS_THRESHOLD ||
+		( rate->minPing > 0 && client->ping > rate->minPing + SV_RATE_QUEUEING_PING );
+
+	if( congested ) {
+		int divisor = Min2( rate->snapDivisor * 2, maxDivisor );
+		if( divisor != rate->snapDivisor ) {
+			// spread clients that back off together over different snapshots
+			rate->nextSnapFrame = sv.framenum + 1 + ( client - svs.clients ) % divisor;
+		}
+		rate->snapDivisor = divisor;
+		rate->stableWindows = 0;
+	} else {
+		rate->snapDivisor = Min2( rate->snapDivisor, maxDivisor );
+		rate->stableWindows++;
+		if( rate->stableWindows >= SV_RATE_STABLE_WINDOWS && rate->snapDivisor > 1 ) {
+			rate->snapDivisor--;
+			rate->stableWindows = 0;
+		}
+	}
+
+	rate->deferFarEntities = rate->snapDivisor > 1;
+}
+
+/*
+* SV_Rate_RefillTokens
+*/
+static void SV_Rate_RefillTokens( client_t *client ) {
+	client_rate_t *rate = &client->rate;
+	int maxRate = sv_maxClientRate->integer;
+
+	if( maxRate <= 0 ) {
+		rate->tokens = 0;
+	} else {
+		int64_t burst = (int64_t)maxRate * SV_RATE_BURST / 1000;
+		rate->tokens = Min2( rate->tokens + (int64_t)maxRate * ( svs.realtime - rate->lastRefill ) / 1000, burst );
+	}
+
+	rate->lastRefill = svs.realtime;
+}
+
+/*
+* SV_Rate_SnapDue
+*
+* Whether this snapshot should go to the client. Skipped snapshots are fine,
+* the next one is delta compressed against whatever the client last acked
+*/
+bool SV_Rate_SnapDue( client_t *client ) {
+	client_rate_t *rate = &client->rate;
+
+	if( svs.realtime - rate->windowStart >= SV_RATE_WINDOW ) {
+		SV_Rate_EndWindow( client );
+	}
+
+	SV_Rate_RefillTokens( client );
+
+	if( !SV_Rate_Throttleable( client ) ) {
+		return true;
+	}
+
+	// over its byte budget, try again next snapshot
+	if( rate->tokens < 0 ) {
+		return false;
+	}
+
+	return sv.framenum >= rate->nextSnapFrame;
+}
+
+/*
+* SV_Rate_SnapSent
+*/
+void SV_Rate_SnapSent( client_t *client, size_t bytes ) {
+	client_rate_t *rate = &client->rate;
+
+	rate->snapsSent++;
+	rate->nextSnapFrame = sv.framenum + Max2( rate->snapDivisor, 1 );
+	rate->windowBytes += bytes;
+	rate->windowSnaps++;
+	if( sv_maxClientRate->integer > 0 ) {
+		rate->tokens -= bytes;
+	}
+}
+
+/*
+* SV_Rate_CanSendFragment
+*
+* Fragments of big messages go out one per server frame, but not faster
+* than the client's byte budget allows
+*/
+bool SV_Rate_CanSendFragment( client_t *client ) {
+	client_rate_t *rate = &client->rate;
+
+	if( sv_maxClientRate->integer <= 0 || !SV_Rate_Throttleable( client ) ) {
+		return true;
+	}
+
+	SV_Rate_RefillTokens( client );
+	if( rate->tokens < 0 ) {
+		return false;
+	}
+
+	size_t fragment = Min2( client->netchan.unsentLength - client->netchan.unsentFragmentStart, (size_t)FRAGMENT_SIZE );
+	rate->tokens -= fragment;
+	rate->windowBytes += fragment;
+	return true;
+}
+
+/*
+* SV_Rate_Print_f
+*/
+void SV_Rate_Print_f( void ) {
+	if( !svs.clients ) {
+		Com_Printf( "No server running.\n" );
+		return;
+	}
+
+	Com_Printf( "num ping base  loss   KB/s snaps/s name\n" );
+	Com_Printf( "--- ---- ---- ----- ------ ------- ---------------\n" );
+
+	for( int i = 0; i < sv_maxclients->integer; i++ ) {
+		const client_t *cl = &svs.clients[i];
+		if( cl->state != CS_SPAWNED || ( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) ) ) {
+			continue;
+		}
+
+		const client_rate_t *rate = &cl->rate;
+		Com_Printf( "%3i %4i %4i %4.1f%% %6.1f %7i %s%s\n", i, cl->ping, rate->minPing, rate->loss * 100.0f,
+			rate->bytesPerSecond / 1024.0f, rate->snapsPerSecond, cl->name, rate->deferFarEntities ? " (deferring)" : "" );
+	}
+}
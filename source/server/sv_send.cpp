@@ -69,6 +69,123 @@ void SV_AddGameCommand( client_t *client, const char *cmd ) {
 	}
 }
 
+/*
+* SV_ReliableCommandString
+*/
+static char *SV_ReliableCommandString( client_t *client, int64_t sequence ) {
+	const reliable_command_t *cmd = &client->reliableCommands[sequence & ( MAX_RELIABLE_COMMANDS - 1 )];
+	if( cmd->broadcast >= 0 ) {
+		return svs.broadcastCommands[cmd->broadcast & ( BROADCAST_COMMANDS_SIZE - 1 )];
+	}
+	return client->privateCommands + cmd->privateOffset % PRIVATE_COMMANDS_SIZE;
+}
+
+/*
+* SV_ReliableCommandOverflow
+*
+* Throws away everything pending so the disconnect can't overflow again
+*/
+static void SV_ReliableCommandOverflow( client_t *client, const char *cmd ) {
+	int64_t i;
+
+	for( i = client->reliableAcknowledge + 1; i <= client->reliableSequence; i++ ) {
+		Com_DPrintf( "cmd %5" PRIi64 ": %s\n", i, SV_ReliableCommandString( client, i ) );
+	}
+	Com_DPrintf( "cmd %5" PRIi64 ": %s\n", i, cmd );
+
+	client->reliableSent = client->reliableSequence;
+	client->reliableAcknowledge = client->reliableSequence;
+	client->broadcastCursor = svs.broadcastCommandsHead;
+
+	SV_DropClient( client, DROP_TYPE_GENERAL, "%s", "Error: Server command overflow" );
+}
+
+/*
+* SV_AddReliableCommand
+*/
+static bool SV_AddReliableCommand( client_t *client, reliable_command_t cmd, const char *string ) {
+	// if we would be losing an old command that hasn't been acknowledged, we must drop the connection
+	if( client->reliableSequence - client->reliableAcknowledge == MAX_RELIABLE_COMMANDS ) {
+		SV_ReliableCommandOverflow( client, string );
+		return false;
+	}
+
+	client->reliableSequence++;
+	client->reliableCommands[client->reliableSequence & ( MAX_RELIABLE_COMMANDS - 1 )] = cmd;
+	return true;
+}
+
+/*
+* SV_OldestPrivateCommand
+*
+* Returns the offset of the oldest unacknowledged private command
+*/
+static int64_t SV_OldestPrivateCommand( const client_t *client ) {
+	for( int64_t i = client->reliableAcknowledge + 1; i <= client->reliableSequence; i++ ) {
+		const reliable_command_t *cmd = &client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )];
+		if( cmd->broadcast < 0 ) {
+			return cmd->privateOffset;
+		}
+	}
+	return client->privateCommandsHead;
+}
+
+/*
+* SV_FreePrivateCommandBytes
+*/
+size_t SV_FreePrivateCommandBytes( const client_t *client ) {
+	return PRIVATE_COMMANDS_SIZE - ( client->privateCommandsHead - SV_OldestPrivateCommand( client ) );
+}
+
+/*
+* SV_ResetBroadcastCursor
+*
+* The client only gets broadcast commands sent from now on
+*/
+void SV_ResetBroadcastCursor( client_t *client ) {
+	client->broadcastCursor = svs.broadcastCommandsHead;
+
+	// configstrings can still get batched into the newest command, so the
+	// client needs to see it. resending configstrings is harmless
+	if( svs.broadcastCommandsHead > svs.broadcastCommandsSealed ) {
+		const char *last = svs.broadcastCommands[( svs.broadcastCommandsHead - 1 ) & ( BROADCAST_COMMANDS_SIZE - 1 )];
+		if( !strncmp( last, "cs ", 3 ) ) {
+			client->broadcastCursor--;
+		}
+	}
+}
+
+/*
+* SV_QueueBroadcastCommands
+*
+* Adds references to any broadcast commands the client hasn't picked up yet
+*/
+void SV_QueueBroadcastCommands( client_t *client ) {
+	if( client->edict && ( client->edict->r.svflags & SVF_FAKECLIENT ) ) {
+		client->broadcastCursor = svs.broadcastCommandsHead;
+		return;
+	}
+
+	// commands the client still references must not have been overwritten
+	if( svs.broadcastCommandsHead - client->broadcastCursor > BROADCAST_COMMANDS_SIZE - MAX_RELIABLE_COMMANDS ) {
+		SV_ReliableCommandOverflow( client, "(broadcast commands lost)" );
+		return;
+	}
+
+	while( client->broadcastCursor < svs.broadcastCommandsHead ) {
+		reliable_command_t cmd;
+		cmd.broadcast = client->broadcastCursor;
+		cmd.privateOffset = 0;
+
+		// advance first, dropping the client queues a command
+		client->broadcastCursor++;
+
+		if( !SV_AddReliableCommand( client, cmd, svs.broadcastCommands[cmd.broadcast & ( BROADCAST_COMMANDS_SIZE - 1 )] ) ) {
+			return;
+		}
+	}
+}
+
 /*
 * SV_AddServerCommand
 *
@@ -76,9 +193,6 @@ void SV_AddGameCommand( client_t *client, const char *cmd ) {
 * not have future snapshot_t executed before it is executed
 */
 void SV_AddServerCommand( client_t *client, const char *cmd ) {
-	int index;
-	unsigned int i;
-
 	if( !client ) {
 		return;
 	}
@@ -87,48 +201,83 @@ void SV_AddServerCommand( client_t *client, const char *cmd ) {
 		return;
 	}
 
-	if( !cmd || !cmd[0] || !strlen( cmd ) ) {
+	if( !cmd || !cmd[0] ) {
 		return;
 	}
 
+	// keep ordering with broadcasts sent before this
+	SV_QueueBroadcastCommands( client );
+
+	// truncate like the old fixed size slots and the broadcast path do
+	size_t len = Min2( strlen( cmd ), size_t( MAX_STRING_CHARS - 1 ) ) + 1;
+	int64_t oldest = SV_OldestPrivateCommand( client );
+
 	// ch : To avoid overflow of messages from excessive amount of configstrings
-	// we batch them here. On incoming "cs" command, we'll trackback the queue
-	// to find a pending "cs" command that has space in it. If we'll find one,
-	// we'll batch this there, if not, we'll create a new one.
-	if( !strncmp( cmd, "cs ", 3 ) ) {
-		// length of the index/value (leave room for one space and null char)
-		size_t len = strlen( cmd ) - 1;
-		for( i = client->reliableSequence; i > client->reliableSent; i-- ) {
-			size_t otherLen;
-			char *otherCmd;
-
-			otherCmd = client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )];
-			if( !strncmp( otherCmd, "cs ", 3 ) ) {
-				otherLen = strlen( otherCmd );
-				// is there any room? (should check for sizeof client->reliableCommands[0]?)
-				if( ( otherLen + len ) < MAX_STRING_CHARS ) {
-					// yahoo, put it in here
-					Q_strncatz( otherCmd, cmd + 2, MAX_STRING_CHARS - 1 );
-					return;
-				}
+	// we batch them here. If the newest command is an unsent private "cs", append to it
+	if( !strncmp( cmd, "cs ", 3 ) && client->reliableSequence > client->reliableSent ) {
+		reliable_command_t *last = &client->reliableCommands[client->reliableSequence & ( MAX_RELIABLE_COMMANDS - 1 )];
+		if( last->broadcast < 0 ) {
+			char *lastCmd = client->privateCommands + last->privateOffset % PRIVATE_COMMANDS_SIZE;
+			size_t lastLen = strlen( lastCmd );
+			size_t newLen = lastLen + len - 3; // drop "cs", keep the space
+			int64_t newHead = last->privateOffset + newLen + 1;
+			bool fits_ring = last->privateOffset % PRIVATE_COMMANDS_SIZE + newLen + 1 <= PRIVATE_COMMANDS_SIZE;
+
+			if( !strncmp( lastCmd, "cs ", 3 ) && newLen < MAX_STRING_CHARS && fits_ring && newHead - oldest <= PRIVATE_COMMANDS_SIZE ) {
+				// yahoo, put it in here
+				memcpy( lastCmd + lastLen, cmd + 2, len - 2 );
+				client->privateCommandsHead = newHead;
+				return;
 			}
 		}
 	}
 
-	client->reliableSequence++;
-	// if we would be losing an old command that hasn't been acknowledged, we must drop the connection
-	// we check == instead of >= so a broadcast print added by SV_DropClient() doesn't cause a recursive drop client
-	if( client->reliableSequence - client->reliableAcknowledge == MAX_RELIABLE_COMMANDS + 1 ) {
-		//Com_Printf( "===== pending server commands =====\n" );
-		for( i = client->reliableAcknowledge + 1; i <= client->reliableSequence; i++ ) {
-			Com_DPrintf( "cmd %5d: %s\n", i, client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )] );
-		}
-		Com_DPrintf( "cmd %5d: %s\n", i, cmd );
-		SV_DropClient( client, DROP_TYPE_GENERAL, "%s", "Error: Server command overflow" );
+	// don't let commands wrap around the end of the ring
+	int64_t offset = client->privateCommandsHead;
+	if( offset % PRIVATE_COMMANDS_SIZE + len > PRIVATE_COMMANDS_SIZE ) {
+		offset += PRIVATE_COMMANDS_SIZE - offset % PRIVATE_COMMANDS_SIZE;
+	}
+
+	if( offset + int64_t( len ) - oldest > PRIVATE_COMMANDS_SIZE ) {
+		SV_ReliableCommandOverflow( client, cmd );
 		return;
 	}
-	index = client->reliableSequence & ( MAX_RELIABLE_COMMANDS - 1 );
-	Q_strncpyz( client->reliableCommands[index], cmd, sizeof( client->reliableCommands[index] ) );
+
+	reliable_command_t reliable;
+	reliable.broadcast = -1;
+	reliable.privateOffset = offset;
+	if( !SV_AddReliableCommand( client, reliable, cmd ) ) {
+		return;
+	}
+
+	char *dst = client->privateCommands + offset % PRIVATE_COMMANDS_SIZE;
+	memcpy( dst, cmd, len - 1 );
+	dst[len - 1] = '\0';
+	client->privateCommandsHead = offset + len;
+}
+
+/*
+* SV_AddBroadcastCommand
+*
+* Costs the same no matter how many clients there are, each client picks
+* it up in SV_QueueBroadcastCommands
+*/
+static void SV_AddBroadcastCommand( const char *cmd ) {
+	if( !cmd[0] ) {
+		return;
+	}
+
+	// batch configstrings into the newest command if nobody has seen it yet
+	if( !strncmp( cmd, "cs ", 3 ) && svs.broadcastCommandsHead > svs.broadcastCommandsSealed ) {
+		char *last = svs.broadcastCommands[( svs.broadcastCommandsHead - 1 ) & ( BROADCAST_COMMANDS_SIZE - 1 )];
+		if( !strncmp( last, "cs ", 3 ) && strlen( last ) + strlen( cmd ) - 1 < MAX_STRING_CHARS ) {
+			Q_strncatz( last, cmd + 2, MAX_STRING_CHARS - 1 );
+			return;
+		}
+	}
+
+	Q_strncpyz( svs.broadcastCommands[svs.broadcastCommandsHead & ( BROADCAST_COMMANDS_SIZE - 1 )], cmd, MAX_STRING_CHARS );
+	svs.broadcastCommandsHead++;
 }
 
 /*
@@ -141,8 +290,6 @@ void SV_AddServerCommand( client_t *client, const char *cmd ) {
 void SV_SendServerCommand( client_t *cl, const char *format, ... ) {
 	va_list argptr;
 	char message[MAX_MSGLEN];
-	client_t *client;
-	int i;
 
 	va_start( argptr, format );
 	vsnprintf( message, sizeof( message ), format, argptr );
@@ -156,18 +303,7 @@ void SV_SendServerCommand( client_t *cl, const char *format, ... ) {
 		return;
 	}
 
-	// send the data to all relevant clients
-	for( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ ) {
-		if( client->state < CS_CONNECTING ) {
-			continue;
-		}
-		SV_AddServerCommand( client, message );
-	}
-
-	// add to demo
-	if( svs.demo.file ) {
-		SV_AddServerCommand( &svs.demo.client, message );
-	}
+	SV_AddBroadcastCommand( message );
 }
 
 /*
@@ -176,12 +312,14 @@ void SV_SendServerCommand( client_t *cl, const char *format, ... ) {
 * (re)send all server commands the client hasn't acknowledged yet
 */
 void SV_AddReliableCommandsToMessage( client_t *client, msg_t *msg ) {
-	unsigned int i;
+	int64_t i;
 
 	if( client->edict && ( client->edict->r.svflags & SVF_FAKECLIENT ) ) {
 		return;
 	}
 
+	SV_QueueBroadcastCommands( client );
+
 	if( sv_debug_serverCmd->integer ) {
 		Com_Printf( "sv_cl->reliableAcknowledge: %" PRIi64" sv_cl->reliableSequence:%" PRIi64"\n", client->reliableAcknowledge,
 					client->reliableSequence );
@@ -189,17 +327,21 @@ void SV_AddReliableCommandsToMessage( client_t *client, msg_t *msg ) {
 
 	// write any unacknowledged serverCommands
 	for( i = client->reliableAcknowledge + 1; i <= client->reliableSequence; i++ ) {
-		if( !strlen( client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )] ) ) {
-			continue;
+		const reliable_command_t *cmd = &client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )];
+		const char *string = SV_ReliableCommandString( client, i );
+
+		// once anyone has seen a broadcast command it can't be batched into
+		if( cmd->broadcast >= 0 ) {
+			svs.broadcastCommandsSealed = Max2( svs.broadcastCommandsSealed, cmd->broadcast + 1 );
 		}
+
 		MSG_WriteUint8( msg, svc_servercmd );
 		if( !client->reliable ) {
 			MSG_WriteInt32( msg, i );
 		}
-		MSG_WriteString( msg, client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )] );
+		MSG_WriteString( msg, string );
 		if( sv_debug_serverCmd->integer ) {
-			Com_Printf( "SV_AddServerCommandsToMessage(%i):%s\n", i,
-						client->reliableCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )] );
+			Com_Printf( "SV_AddServerCommandsToMessage(%" PRIi64 "):%s\n", i, string );
 		}
 	}
 	client->reliableSent = client->reliableSequence;
@@ -266,6 +408,9 @@ bool SV_SendClientsFragments( void ) {
 		if( !client->netchan.unsentFragments ) {
 			continue;
 		}
+		if( !SV_Rate_CanSendFragment( client ) ) {
+			continue;
+		}
 
 		if( !Netchan_TransmitNextFragment( &client->netchan ) ) {
 			Com_Printf( "Error sending fragment to %s: %s\n", NET_AddressToString( &client->netchan.remoteAddress ),
@@ -387,7 +532,15 @@ static bool SV_SendClientDatagram( client_t *client ) {
 
 	SV_WriteFrameSnapToClient( client, &tmpMessage );
 
-	return SV_SendMessageToClient( client, &tmpMessage );
+	ProfilerCount( "Snapshot bytes", tmpMessage.cursize );
+
+	if( !SV_SendMessageToClient( client, &tmpMessage ) ) {
+		return false;
+	}
+
+	// cursize is after compression now
+	SV_Rate_SnapSent( client, tmpMessage.cursize );
+	return true;
 }
 
 /*
@@ -411,6 +564,10 @@ void SV_SendClientMessages( void ) {
 		}
 
 		if( client->state == CS_SPAWNED ) {
+			if( !SV_Rate_SnapDue( client ) ) {
+				continue;
+			}
+
 			if( !SV_SendClientDatagram( client ) ) {
 				Com_Printf( "Error sending message to %s: %s\n", client->name, NET_ErrorString() );
 				if( client->reliable ) {
@@ -419,6 +576,7 @@ void SV_SendClientMessages( void ) {
 			}
 		} else {
 			// send pending reliable commands, or send heartbeats for not timing out
+			SV_QueueBroadcastCommands( client );
 			if( client->reliableSequence > client->reliableAcknowledge ||
 				svs.realtime - client->lastPacketSentTime > 1000 ) {
 				SV_InitClientMessage( client, &tmpMessage, NULL, 0 );
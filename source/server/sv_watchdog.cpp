@@ -0,0 +1,223 @@
+#include "server/server.h"
+
+static const char *sv_frameStageNames[FRAMESTAGE_COUNT] = {
+	"packets",
+	"fragments",
+	"sleep",
+	"game",
+	"snap",
+	"send",
+	"demo",
+	"heartbeat",
+};
+
+#define SV_WATCHDOG_DUMP_INTERVAL 30000 // msecs between dumps so a struggling server doesn't fill the disk
+
+static sv_frametiming_t *SV_Watchdog_Frame( unsigned int framesAgo ) {
+	return &svs.watchdog.frames[( svs.watchdog.head - framesAgo ) % SV_WATCHDOG_FRAMES];
+}
+
+static void SV_Watchdog_PrintFrame( int file, const sv_frametiming_t *frame ) {
+	uint64_t accounted = 0;
+	for( int i = 0; i < FRAMESTAGE_COUNT; i++ ) {
+		if( i != FRAMESTAGE_SLEEP ) {
+			accounted += frame->stages[i];
+		}
+	}
+
+	FS_Printf( file, "%10" PRIi64 " %8" PRIi64 " %8.2f", frame->gametime, frame->framenum, frame->total / 1000.0 );
+	for( int i = 0; i < FRAMESTAGE_COUNT; i++ ) {
+		FS_Printf( file, " %9.2f", frame->stages[i] / 1000.0 );
+	}
+	FS_Printf( file, " %9.2f %8d %7d\n", ( frame->total - Min2( accounted, frame->total ) ) / 1000.0, frame->numEntities, frame->numClients );
+}
+
+/*
+* SV_Watchdog_Dump
+*
+* Writes the slow frame, the zones the profiler saw during it and the
+* timings of the frames leading up to it
+*/
+static void SV_Watchdog_Dump( void ) {
+	const sv_frametiming_t *slow = SV_Watchdog_Frame( 0 );
+
+	if( svs.watchdog.lastDump != 0 && svs.realtime < svs.watchdog.lastDump + SV_WATCHDOG_DUMP_INTERVAL ) {
+		svs.watchdog.suppressedDumps++;
+		return;
+	}
+
+	svs.watchdog.lastDump = svs.realtime;
+
+	if( !sv_frameDump->integer ) {
+		Com_Printf( S_COLOR_YELLOW "Server frame took %.2fms (budget %.2fms)\n", slow->total / 1000.0, sv_frameBudget->value );
+		return;
+	}
+
+	char date[64];
+	Sys_FormatTime( date, sizeof( date ), "%Y-%m-%d_%H-%M-%S" );
+
+	char filename[MAX_QPATH];
+	snprintf( filename, sizeof( filename ), "slowframes/%s_%" PRIi64 ".txt", date, slow->framenum );
+
+	Com_Printf( S_COLOR_YELLOW "Server frame took %.2fms (budget %.2fms), writing %s\n",
+		slow->total / 1000.0, sv_frameBudget->value, filename );
+
+	int file;
+	if( FS_FOpenFile( filename, &file, FS_WRITE ) == -1 ) {
+		Com_Printf( S_COLOR_RED "Couldn't open %s for writing\n", filename );
+		return;
+	}
+
+	FS_Printf( file, "map %s, gametime %" PRIi64 ", snap frame %" PRIi64 "\n", sv.mapname, slow->gametime, slow->framenum );
+	FS_Printf( file, "frame took %.2fms, budget %.2fms\n", slow->total / 1000.0, sv_frameBudget->value );
+	FS_Printf( file, "%d entities, %d clients\n", slow->numEntities, slow->numClients );
+	if( svs.watchdog.suppressedDumps > 0 ) {
+		FS_Printf( file, "%d slow frames since the last dump weren't written\n", svs.watchdog.suppressedDumps );
+		svs.watchdog.suppressedDumps = 0;
+	}
+
+	FS_Printf( file, "\nstages (ms):\n" );
+	for( int i = 0; i < FRAMESTAGE_COUNT; i++ ) {
+		FS_Printf( file, "%-10s %9.2f\n", sv_frameStageNames[i], slow->stages[i] / 1000.0 );
+	}
+
+	FS_Printf( file, "\nscript callbacks:\n" );
+	FS_Printf( file, "%-40s %6s %9s\n", "function", "calls", "ms" );
+	for( int i = 0; i < slow->numScriptCalls; i++ ) {
+		const sv_scriptcall_t *call = &slow->scriptCalls[i];
+		FS_Printf( file, "%-40s %6d %9.2f\n", call->name, call->calls, call->usec / 1000.0 );
+	}
+
+	// the profiler folded the slow frame at the top of this one. it covers
+	// the whole process frame, so traces etc are counted here too
+	ProfilerFrameStats zones[MAX_PROFILER_SITES];
+	size_t numZones = GetLastProfilerFrame( Span< ProfilerFrameStats >( zones, ARRAY_COUNT( zones ) ) );
+
+	FS_Printf( file, "\nzones:\n" );
+	FS_Printf( file, "%-40s %6s %9s\n", "zone", "calls", "ms" );
+	for( size_t i = 0; i < numZones; i++ ) {
+		if( !zones[i].counter ) {
+			FS_Printf( file, "%-40s %6u %9.3f\n", zones[i].name, zones[i].calls, zones[i].total / 1000000.0 );
+		}
+	}
+
+	FS_Printf( file, "\ncounters:\n" );
+	for( size_t i = 0; i < numZones; i++ ) {
+		if( zones[i].counter ) {
+			FS_Printf( file, "%-40s %6u %9" PRIu64 "\n", zones[i].name, zones[i].calls, zones[i].total );
+		}
+	}
+
+	FS_Printf( file, "\nlast %d frames, oldest first (ms):\n", SV_WATCHDOG_FRAMES );
+	FS_Printf( file, "%10s %8s %8s", "gametime", "snap", "total" );
+	for( int i = 0; i < FRAMESTAGE_COUNT; i++ ) {
+		FS_Printf( file, " %9s", sv_frameStageNames[i] );
+	}
+	FS_Printf( file, " %9s %8s %7s\n", "other", "entities", "clients" );
+
+	for( int i = SV_WATCHDOG_FRAMES - 1; i >= 0; i-- ) {
+		const sv_frametiming_t *frame = SV_Watchdog_Frame( i );
+		if( frame->start != 0 ) {
+			SV_Watchdog_PrintFrame( file, frame );
+		}
+	}
+
+	FS_FCloseFile( file );
+}
+
+/*
+* SV_Watchdog_BeginFrame
+*/
+void SV_Watchdog_BeginFrame( void ) {
+	if( svs.watchdog.dumpPending ) {
+		svs.watchdog.dumpPending = false;
+		SV_Watchdog_Dump();
+	}
+
+	svs.watchdog.head++;
+
+	sv_frametiming_t *frame = SV_Watchdog_Frame( 0 );
+	memset( frame, 0, sizeof( *frame ) );
+	frame->gametime = svs.gametime;
+	frame->framenum = sv.framenum;
+	frame->start = Sys_Microseconds();
+
+	svs.watchdog.recording = true;
+}
+
+/*
+* SV_Watchdog_AddStage
+*/
+void SV_Watchdog_AddStage( sv_framestage_t stage, uint64_t start ) {
+	if( !svs.watchdog.recording ) {
+		return;
+	}
+
+	SV_Watchdog_Frame( 0 )->stages[stage] += Sys_Microseconds() - start;
+}
+
+/*
+* SV_Watchdog_ScriptCall
+*
+* Called for every top level script call
+*/
+void SV_Watchdog_ScriptCall( const char *name, uint64_t usec ) {
+	if( !svs.watchdog.recording ) {
+		return;
+	}
+
+	sv_frametiming_t *frame = SV_Watchdog_Frame( 0 );
+
+	sv_scriptcall_t *call = NULL;
+	for( int i = 0; i < frame->numScriptCalls; i++ ) {
+		if( !strcmp( frame->scriptCalls[i].name, name ) ) {
+			call = &frame->scriptCalls[i];
+			break;
+		}
+	}
+
+	if( call == NULL ) {
+		if( frame->numScriptCalls < SV_WATCHDOG_SCRIPT_CALLS - 1 ) {
+			call = &frame->scriptCalls[frame->numScriptCalls];
+			frame->numScriptCalls++;
+			Q_strncpyz( call->name, name, sizeof( call->name ) );
+		} else {
+			// the last slot is kept for lumping the rest together, so the
+			// named slots only ever hold their own function's time
+			call = &frame->scriptCalls[SV_WATCHDOG_SCRIPT_CALLS - 1];
+			if( frame->numScriptCalls < SV_WATCHDOG_SCRIPT_CALLS ) {
+				frame->numScriptCalls = SV_WATCHDOG_SCRIPT_CALLS;
+				Q_strncpyz( call->name, "(other)", sizeof( call->name ) );
+			}
+		}
+	}
+
+	call->calls++;
+	call->usec += usec;
+}
+
+/*
+* SV_Watchdog_EndFrame
+*/
+void SV_Watchdog_EndFrame( void ) {
+	if( !svs.watchdog.recording ) {
+		return;
+	}
+
+	svs.watchdog.recording = false;
+
+	sv_frametiming_t *frame = SV_Watchdog_Frame( 0 );
+	uint64_t elapsed = Sys_Microseconds() - frame->start;
+	frame->total = elapsed - Min2( frame->stages[FRAMESTAGE_SLEEP], elapsed );
+	frame->numEntities = sv.gi.num_edicts;
+
+	for( int i = 0; i < sv_maxclients->integer; i++ ) {
+		if( svs.clients[i].state >= CS_CONNECTED ) {
+			frame->numClients++;
+		}
+	}
+
+	if( sv_frameBudget->value > 0 && frame->total > sv_frameBudget->value * 1000.0f ) {
+		svs.watchdog.dumpPending = true;
+	}
+}
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "server.h"
 #include "qcommon/q_trie.h"
+#include "qcommon/string.h"
 #include "qcommon/threads.h"
 
 #ifdef HTTP_SUPPORT
@@ -423,6 +424,22 @@ static bool SV_Web_FindGameClientByAddress( const netadr_t *netadr ) {
 	return valid_address;
 }
 
+/*
+* SV_Web_AllowProfileRequest
+*
+* Monitoring can read the profile without a game session, but only from
+* this machine since those are the only sessionless connections we accept
+*/
+static bool SV_Web_AllowProfileRequest( const sv_http_request_t *request, const sv_http_connection_t *con ) {
+	if( !sv_http_profile->integer || con->is_upstream ) {
+		return false;
+	}
+	if( !request->resource || Q_stricmp( request->resource, "profile" ) ) {
+		return false;
+	}
+	return NET_IsLocalAddress( &con->address );
+}
+
 /*
 * SV_Web_ConnectionLimitReached
 */
@@ -799,6 +816,7 @@ static void SV_Web_ReceiveRequest( socket_t *socket, sv_http_connection_t *con )
 			if( con->is_upstream &&
 				( request->realAddr.type == NA_NOTRANSMIT || SV_Web_ConnectionLimitReached( &request->realAddr ) ) ) {
 				request->error = HTTP_RESP_SERVICE_UNAVAILABLE;
+			} else if( SV_Web_AllowProfileRequest( request, con ) ) {
 			} else if( !SV_Web_FindGameClientBySession( request->clientSession, request->clientNum ) ) {
 				request->error = HTTP_RESP_FORBIDDEN;
 			}
@@ -887,6 +905,51 @@ static const char *SV_Web_ResponseCodeMessage( http_response_code_t code ) {
 	}
 }
 
+/*
+* SV_Web_ProfileJSON
+*/
+static char *SV_Web_ProfileJSON( void ) {
+	Span< ProfilerStats > stats = ALLOC_SPAN( sys_allocator, ProfilerStats, MAX_PROFILER_SITES );
+	defer { FREE( sys_allocator, stats.ptr ); };
+
+	u32 num_frames;
+	size_t n = GetProfilerStats( stats, &num_frames );
+
+	DynamicString json( sys_allocator );
+	json += "{";
+	json.append( "\"frames\":{},\"zones\":[", num_frames );
+
+	bool first = true;
+	for( size_t i = 0; i < n; i++ ) {
+		const ProfilerStats & s = stats[ i ];
+		if( s.counter )
+			continue;
+		json += first ? "{" : ",{";
+		json.append( "\"name\":\"{}\",\"calls\":{.2},\"min_ms\":{.4},\"avg_ms\":{.4},\"p99_ms\":{.4},\"max_ms\":{.4}",
+			s.name, s.calls_per_frame, s.min / 1000000.0, s.avg / 1000000.0, s.p99 / 1000000.0, s.max / 1000000.0 );
+		json += "}";
+		first = false;
+	}
+
+	json += "],\"counters\":[";
+
+	first = true;
+	for( size_t i = 0; i < n; i++ ) {
+		const ProfilerStats & s = stats[ i ];
+		if( !s.counter )
+			continue;
+		json += first ? "{" : ",{";
+		json.append( "\"name\":\"{}\",\"calls\":{.2},\"min\":{},\"avg\":{},\"p99\":{},\"max\":{}",
+			s.name, s.calls_per_frame, s.min, s.avg, s.p99, s.max );
+		json += "}";
+		first = false;
+	}
+
+	json += "]}\n";
+
+	return ZoneCopyString( json.c_str() );
+}
+
 /*
 * SV_Web_RouteRequest
 */
@@ -933,6 +996,23 @@ static void SV_Web_RouteRequest( const sv_http_request_t *request, sv_http_respo
 		} else {
 			response->code = HTTP_RESP_BAD_REQUEST;
 		}
+	} else if( !Q_stricmp( resource, "profile" ) ) {
+		// frame timings can tell people more about the server than we'd like
+		if( !sv_http_profile->integer ) {
+			response->code = HTTP_RESP_FORBIDDEN;
+			return;
+		}
+
+		if( request->method != HTTP_METHOD_GET && request->method != HTTP_METHOD_HEAD ) {
+			response->code = HTTP_RESP_BAD_REQUEST;
+			return;
+		}
+
+		response->content = SV_Web_ProfileJSON();
+		response->content_length = strlen( response->content );
+		*content = response->content;
+		*content_length = response->content_length;
+		response->code = HTTP_RESP_OK;
 	} else {
 		response->code = HTTP_RESP_NOT_FOUND;
 	}